@@ -58,9 +58,51 @@ include_directories(${CMAKE_SOURCE_DIR}/include)
 
 set(HDR_N
     ${CMAKE_SOURCE_DIR}/include/nsk.h ${CMAKE_SOURCE_DIR}/include/nskgui.h
-    ${CMAKE_SOURCE_DIR}/include/nskguiimpl.h)
-set(SRC_N ${CMAKE_SOURCE_DIR}/src/nsk.cpp ${CMAKE_SOURCE_DIR}/src/nskgui.cpp
-          ${CMAKE_SOURCE_DIR}/src/nskguiimpl.cpp)
+    ${CMAKE_SOURCE_DIR}/include/nskguiimpl.h ${CMAKE_SOURCE_DIR}/include/ais.h
+    ${CMAKE_SOURCE_DIR}/include/ais_targets.h ${CMAKE_SOURCE_DIR}/include/cpa.h
+    ${CMAKE_SOURCE_DIR}/include/sk_paths.h ${CMAKE_SOURCE_DIR}/include/sk_state.h
+    ${CMAKE_SOURCE_DIR}/include/sk_encoding.h
+    ${CMAKE_SOURCE_DIR}/include/net_compat.h
+    ${CMAKE_SOURCE_DIR}/include/output_sinks.h
+    ${CMAKE_SOURCE_DIR}/include/event_loop.h
+    ${CMAKE_SOURCE_DIR}/include/signalk_server.h
+    ${CMAKE_SOURCE_DIR}/include/sk_subscriptions.h
+    ${CMAKE_SOURCE_DIR}/include/source_priorities.h
+    ${CMAKE_SOURCE_DIR}/include/derived_wind.h
+    ${CMAKE_SOURCE_DIR}/include/magnetic_variation.h
+    ${CMAKE_SOURCE_DIR}/include/path_filters.h
+    ${CMAKE_SOURCE_DIR}/include/time_base.h
+    ${CMAKE_SOURCE_DIR}/include/metrics.h
+    ${CMAKE_SOURCE_DIR}/include/traffic_stats.h
+    ${CMAKE_SOURCE_DIR}/include/flight_recorder.h
+    ${CMAKE_SOURCE_DIR}/include/nmea_logger.h
+    ${CMAKE_SOURCE_DIR}/include/clock.h
+    ${CMAKE_SOURCE_DIR}/include/byte_scan.h
+    ${CMAKE_SOURCE_DIR}/include/nmea_framer.h
+    ${CMAKE_SOURCE_DIR}/include/nmea_inputs.h)
+set(SRC_N
+    ${CMAKE_SOURCE_DIR}/src/nsk.cpp ${CMAKE_SOURCE_DIR}/src/nskgui.cpp
+    ${CMAKE_SOURCE_DIR}/src/nskguiimpl.cpp ${CMAKE_SOURCE_DIR}/src/ais.cpp
+    ${CMAKE_SOURCE_DIR}/src/ais_targets.cpp ${CMAKE_SOURCE_DIR}/src/cpa.cpp
+    ${CMAKE_SOURCE_DIR}/src/sk_paths.cpp ${CMAKE_SOURCE_DIR}/src/sk_state.cpp
+    ${CMAKE_SOURCE_DIR}/src/sk_encoding.cpp
+    ${CMAKE_SOURCE_DIR}/src/output_sinks.cpp
+    ${CMAKE_SOURCE_DIR}/src/event_loop.cpp
+    ${CMAKE_SOURCE_DIR}/src/signalk_server.cpp
+    ${CMAKE_SOURCE_DIR}/src/sk_subscriptions.cpp
+    ${CMAKE_SOURCE_DIR}/src/source_priorities.cpp
+    ${CMAKE_SOURCE_DIR}/src/derived_wind.cpp
+    ${CMAKE_SOURCE_DIR}/src/magnetic_variation.cpp
+    ${CMAKE_SOURCE_DIR}/src/path_filters.cpp
+    ${CMAKE_SOURCE_DIR}/src/time_base.cpp
+    ${CMAKE_SOURCE_DIR}/src/metrics.cpp
+    ${CMAKE_SOURCE_DIR}/src/traffic_stats.cpp
+    ${CMAKE_SOURCE_DIR}/src/flight_recorder.cpp
+    ${CMAKE_SOURCE_DIR}/src/nmea_logger.cpp
+    ${CMAKE_SOURCE_DIR}/src/clock.cpp
+    ${CMAKE_SOURCE_DIR}/src/byte_scan.cpp
+    ${CMAKE_SOURCE_DIR}/src/nmea_framer.cpp
+    ${CMAKE_SOURCE_DIR}/src/nmea_inputs.cpp)
 
 set(SRC ${HDR_N} ${SRC_N} ${CMAKE_SOURCE_DIR}/include/nsk_pi.h
         ${CMAKE_SOURCE_DIR}/src/nsk_pi.cpp)
@@ -86,6 +128,17 @@ macro(late_init)
 endmacro()
 
 macro(add_plugin_libraries)
+  find_package(Threads REQUIRED)
+  target_link_libraries(${PACKAGE_NAME} Threads::Threads)
+  # Without zlib the raw NMEA log is written uncompressed
+  find_package(ZLIB)
+  if(ZLIB_FOUND)
+    target_link_libraries(${PACKAGE_NAME} ZLIB::ZLIB)
+    target_compile_definitions(${PACKAGE_NAME} PRIVATE NSK_HAVE_ZLIB)
+  endif()
+  if(WIN32)
+    target_link_libraries(${PACKAGE_NAME} ws2_32)
+  endif()
   if(APPLE)
     add_subdirectory(opencpn-libs/marnav)
     target_link_libraries(${PACKAGE_NAME} ocpn::marnav)
@@ -0,0 +1,229 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _AIS_H_
+#define _AIS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Maximum number of payload bits we are able to reassemble from the fragments
+/// of a single AIS message (Type 5 needs 424, leave plenty of headroom)
+constexpr size_t AIS_MAX_PAYLOAD_BITS = 1024;
+
+/// Number of multi-fragment messages that may be in flight at the same time
+constexpr size_t AIS_FRAGMENT_SLOTS = 8;
+
+/// Result of feeding a sentence to the AIS decoder
+enum class ais_result {
+    /// Fragment stored, waiting for the rest of the message
+    incomplete,
+    /// A complete message of a supported type has been decoded
+    decoded,
+    /// The message is complete and valid, but of a type we do not decode
+    unsupported,
+    /// The sentence is malformed (Bad checksum, armoring, fragment sequence)
+    error
+};
+
+/// Decoded contents of an AIS message
+///
+/// Only the fields relevant for the message type are filled, the rest is left
+/// at the "not available" defaults. Strings are fixed size, zero terminated
+/// and trimmed of the trailing AIS padding.
+struct ais_message {
+    /// Message type (1, 2, 3, 5, 18, 19 or 24)
+    uint8_t type = 0;
+    /// MMSI of the transmitting station
+    uint32_t mmsi = 0;
+    /// True if the message came in a VDO (own vessel) sentence
+    bool own = false;
+    /// Class of the transmitting station ('A' or 'B')
+    char ais_class = 'A';
+
+    /// Position, course and speed data are present (Types 1, 2, 3, 18, 19)
+    bool has_position_report = false;
+    /// Navigational status, 15 if not defined
+    uint8_t nav_status = 15;
+    /// Raw rate of turn indicator, -128 if not available
+    int8_t rot = -128;
+    /// Speed over ground in 1/10 knot steps, 1023 if not available
+    uint16_t sog = 1023;
+    /// Longitude in 1/10000 minute, 181 degrees if not available
+    int32_t lon = 181 * 600000;
+    /// Latitude in 1/10000 minute, 91 degrees if not available
+    int32_t lat = 91 * 600000;
+    /// Course over ground in 1/10 degree, 3600 if not available
+    uint16_t cog = 3600;
+    /// True heading in degrees, 511 if not available
+    uint16_t heading = 511;
+
+    /// Static and voyage data are present (Types 5, 19 and 24)
+    bool has_static_data = false;
+    /// Type 24 part number (0 - Part A, 1 - Part B)
+    uint8_t part = 0;
+    /// IMO number, 0 if not available
+    uint32_t imo = 0;
+    /// Ship and cargo type, 0 if not available
+    uint8_t ship_type = 0;
+    /// Dimension to bow in meters
+    uint16_t to_bow = 0;
+    /// Dimension to stern in meters
+    uint16_t to_stern = 0;
+    /// Dimension to port in meters
+    uint8_t to_port = 0;
+    /// Dimension to starboard in meters
+    uint8_t to_starboard = 0;
+    /// Draught in 1/10 meter, 0 if not available
+    uint8_t draught = 0;
+    /// Vessel name
+    std::array<char, 21> name {};
+    /// Call sign
+    std::array<char, 8> callsign {};
+    /// Destination
+    std::array<char, 21> destination {};
+};
+
+/// Decoder of the !AIVDM/!AIVDO sentences
+///
+/// The decoder never allocates memory, all the state including the
+/// reassembly buffers for the multi-fragment messages lives in fixed size
+/// arrays inside the object.
+class AISDecoder {
+private:
+    /// Reassembly buffer of a multi-fragment message
+    struct fragment_slot {
+        /// Whether the slot is holding an unfinished message
+        bool in_use = false;
+        /// Sequential message ID from the sentence
+        char seq_id = 0;
+        /// Radio channel from the sentence
+        char channel = 0;
+        /// Total number of fragments of the message
+        uint8_t total = 0;
+        /// Number of the fragment we expect next
+        uint8_t next = 0;
+        /// Time the first fragment arrived
+        std::chrono::steady_clock::time_point started;
+        /// Number of valid bits in the buffer
+        size_t nbits = 0;
+        /// The payload bits
+        std::array<uint8_t, AIS_MAX_PAYLOAD_BITS / 8> bits {};
+    };
+
+    /// Reassembly slots
+    std::array<fragment_slot, AIS_FRAGMENT_SLOTS> m_slots;
+    /// Scratch buffer for the single fragment messages
+    fragment_slot m_single;
+    /// The last decoded message
+    ais_message m_msg;
+    /// How long we wait for the remaining fragments of a message
+    std::chrono::steady_clock::duration m_timeout;
+    /// Number of messages decoded
+    size_t m_decoded;
+    /// Number of malformed sentences
+    size_t m_errors;
+    /// Number of fragments dropped due to timeout or lack of free slots
+    size_t m_dropped;
+    /// Number of valid messages of types we do not decode
+    size_t m_unsupported;
+
+    /// @brief Append armored payload to a slot buffer
+    /// @param slot Slot to append to
+    /// @param payload Armored payload characters
+    /// @param fill Number of fill bits to remove at the end
+    /// @return false if the payload contains invalid characters or is too long
+    static bool Dearmor(
+        fragment_slot& slot, std::string_view payload, unsigned fill);
+    /// @brief Decode the complete message from the slot
+    /// @param slot Slot containing the complete payload
+    /// @return Decoding result
+    ais_result DecodePayload(const fragment_slot& slot);
+    /// @brief Find the slot holding fragments of the given message
+    /// @param seq_id Sequential message ID
+    /// @param channel Radio channel
+    /// @return Pointer to the slot or nullptr if not found
+    fragment_slot* FindSlot(char seq_id, char channel);
+    /// @brief Get a slot for a new multi-fragment message, evicting the oldest
+    /// one if all of them are in use
+    /// @return Reference to the slot
+    fragment_slot& AllocateSlot();
+
+public:
+    /// @brief Constructor
+    /// @param timeout How long to wait for the remaining fragments of
+    /// a multi-fragment message
+    explicit AISDecoder(std::chrono::steady_clock::duration timeout
+        = std::chrono::seconds(5))
+        : m_timeout(timeout)
+        , m_decoded(0)
+        , m_errors(0)
+        , m_dropped(0)
+        , m_unsupported(0) { };
+    /// @brief Feed a single !AIVDM or !AIVDO sentence to the decoder
+    /// @param sentence The sentence without the trailing "\r\n"
+    /// @param now Current time used to expire unfinished messages
+    /// @return Result of the decoding, the message is available from Message()
+    /// if ais_result::decoded is returned
+    ais_result Decode(std::string_view sentence,
+        std::chrono::steady_clock::time_point now
+        = std::chrono::steady_clock::now());
+    /// @brief Get the last decoded message
+    /// @return Reference to the message, valid until the next call to Decode()
+    const ais_message& Message() const { return m_msg; };
+    /// @brief Return number of messages decoded since start
+    /// @return Number of messages
+    size_t Decoded() const { return m_decoded; };
+    /// @brief Return number of malformed sentences received since start
+    /// @return Number of sentences
+    size_t Errors() const { return m_errors; };
+    /// @brief Return number of fragments dropped due to timeouts
+    /// @return Number of fragments
+    size_t Dropped() const { return m_dropped; };
+    /// @brief Return number of valid messages of types we do not decode
+    /// @return Number of messages
+    size_t Unsupported() const { return m_unsupported; };
+};
+
+/// @brief Get human readable name of the AIS ship and cargo type
+/// @param type Ship and cargo type from AIS message 5, 19 or 24
+/// @return Name of the type or nullptr if not defined
+const char* AISShipTypeName(uint8_t type);
+
+/// @brief Get SignalK navigation.state value for the AIS navigational status
+/// @param status Navigational status from AIS message 1, 2 or 3
+/// @return SignalK state string or nullptr if not defined
+const char* AISNavState(uint8_t status);
+
+PLUGIN_END_NAMESPACE
+
+#endif //_AIS_H_
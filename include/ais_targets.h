@@ -0,0 +1,288 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _AIS_TARGETS_H_
+#define _AIS_TARGETS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "ais.h"
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Static and voyage related data of an AIS target (Messages 5, 19 and 24)
+struct ais_static_data {
+    /// IMO number, 0 if not available
+    uint32_t imo = 0;
+    /// Ship and cargo type, 0 if not available
+    uint8_t ship_type = 0;
+    /// Dimension to bow in meters
+    uint16_t to_bow = 0;
+    /// Dimension to stern in meters
+    uint16_t to_stern = 0;
+    /// Dimension to port in meters
+    uint8_t to_port = 0;
+    /// Dimension to starboard in meters
+    uint8_t to_starboard = 0;
+    /// Draught in 1/10 meter, 0 if not available
+    uint8_t draught = 0;
+    /// Vessel name
+    std::array<char, 21> name {};
+    /// Call sign
+    std::array<char, 8> callsign {};
+    /// Destination
+    std::array<char, 21> destination {};
+};
+
+/// Table of the AIS targets we currently know about
+///
+/// The dynamic data used in bulk computations are stored in a
+/// struct-of-arrays layout, each attribute of the targets in its own
+/// contiguous array indexed by the slot number of the target. All the memory
+/// is allocated upfront for the configured capacity, the table does not
+/// allocate once constructed. Slots of unknown values hold NaN.
+///
+/// Besides the MMSI lookup, the targets are indexed in a uniform lat/lon
+/// grid (hashed to a fixed number of buckets) for range queries and in
+/// a timer wheel used to expire targets we did not hear from for the
+/// configured time.
+class AISTargets {
+public:
+    /// Marker of an unused link in the intrusive lists
+    static constexpr uint32_t NONE = UINT32_MAX;
+    /// Dirty flag: dynamic data (position, course, speed...) changed
+    static constexpr uint8_t DIRTY_DYNAMIC = 1;
+    /// Dirty flag: static data changed
+    static constexpr uint8_t DIRTY_STATIC = 2;
+    /// Dirty flag: CPA alarm state changed
+    static constexpr uint8_t DIRTY_CPA = 4;
+
+    /// @brief Constructor
+    /// @param capacity Maximum number of targets tracked
+    /// @param expiry Time after which a target we do not hear from is
+    /// forgotten
+    /// @param cell_size Size of the grid cell in degrees
+    explicit AISTargets(size_t capacity = 4096,
+        std::chrono::steady_clock::duration expiry = std::chrono::minutes(10),
+        double cell_size = 0.1);
+
+    /// @brief Update the target with data from a decoded message
+    /// @param msg Decoded AIS message
+    /// @param now Time of reception
+    /// @return Slot of the target or NONE if the table is full
+    uint32_t Update(
+        const ais_message& msg, std::chrono::steady_clock::time_point now);
+    /// @brief Forget the targets we did not hear from for the expiry time
+    /// @param now Current time
+    /// @return Number of targets expired
+    size_t Expire(std::chrono::steady_clock::time_point now);
+    /// @brief Find the targets within a range from a point
+    /// @param lat Latitude of the center in degrees
+    /// @param lon Longitude of the center in degrees
+    /// @param radius Radius in meters
+    /// @param out Vector receiving the slots of the targets found (cleared
+    /// first)
+    void Query(double lat, double lon, double radius,
+        std::vector<uint32_t>& out) const;
+    /// @brief Find the slot of the target
+    /// @param mmsi MMSI of the target
+    /// @return Slot of the target or NONE if we do not know it
+    uint32_t Find(uint32_t mmsi) const;
+    /// @brief Mark the target as changed
+    /// @param slot Slot of the target
+    /// @param flags Dirty flags to add
+    void MarkDirty(uint32_t slot, uint8_t flags);
+    /// @brief Call a function for every target changed since the last call
+    /// and clear the changes
+    /// @param f Callable taking the slot and the dirty flags
+    template <typename F> void ForEachDirty(F f)
+    {
+        for (auto slot : m_dirty_list) {
+            if (m_dirty[slot] != 0) {
+                f(slot, m_dirty[slot]);
+                m_dirty[slot] = 0;
+            }
+        }
+        m_dirty_list.clear();
+    }
+
+    /// @brief Change the time after which the targets are forgotten
+    /// @param expiry Time after which a target we do not hear from is
+    /// forgotten
+    void SetExpiry(std::chrono::steady_clock::duration expiry);
+    /// @brief Return the time after which the targets are forgotten
+    /// @return Expiry time
+    std::chrono::steady_clock::duration Expiry() const { return m_expiry; };
+    /// @brief Return number of targets in the table
+    /// @return Number of targets
+    size_t Size() const { return m_size; };
+    /// @brief Return maximum number of targets in the table
+    /// @return Capacity of the table
+    size_t Capacity() const { return m_mmsi.size(); };
+    /// @brief Return number of updates dropped because the table was full
+    /// @return Number of updates
+    size_t Overflows() const { return m_overflows; };
+    /// @brief Whether the slot holds a target
+    /// @param slot Slot number
+    /// @return true if the slot is in use
+    bool Active(uint32_t slot) const { return m_mmsi[slot] != 0; };
+
+    /// MMSI of the targets, 0 for free slots
+    const std::vector<uint32_t>& Mmsi() const { return m_mmsi; };
+    /// AIS class of the targets ('A' or 'B')
+    const std::vector<char>& Class() const { return m_class; };
+    /// Latitude in degrees
+    const std::vector<double>& Lat() const { return m_lat; };
+    /// Longitude in degrees
+    const std::vector<double>& Lon() const { return m_lon; };
+    /// Speed over ground in m/s
+    const std::vector<double>& Sog() const { return m_sog; };
+    /// Course over ground in radians
+    const std::vector<double>& Cog() const { return m_cog; };
+    /// True heading in radians
+    const std::vector<double>& Heading() const { return m_heading; };
+    /// Rate of turn in radians/s
+    const std::vector<double>& Rot() const { return m_rot; };
+    /// AIS navigational status, 15 if not defined
+    const std::vector<uint8_t>& NavStatus() const { return m_nav_status; };
+    /// Time the targets were last heard from
+    const std::vector<std::chrono::steady_clock::time_point>& Seen() const
+    {
+        return m_seen;
+    };
+    /// Static data of the targets
+    const std::vector<ais_static_data>& Static() const { return m_static; };
+
+private:
+    /// @brief Insert the MMSI into the lookup table
+    /// @param mmsi MMSI
+    /// @param slot Slot of the target
+    void IndexInsert(uint32_t mmsi, uint32_t slot);
+    /// @brief Remove the MMSI from the lookup table
+    /// @param mmsi MMSI
+    void IndexErase(uint32_t mmsi);
+    /// @brief Place the target in the grid according to its position
+    /// @param slot Slot of the target
+    void GridPlace(uint32_t slot);
+    /// @brief Remove the target from the grid
+    /// @param slot Slot of the target
+    void GridRemove(uint32_t slot);
+    /// @brief Move the target to the timer wheel bucket of its new expiry
+    /// @param slot Slot of the target
+    /// @param now Time the target was last heard from
+    void WheelPlace(uint32_t slot, std::chrono::steady_clock::time_point now);
+    /// @brief Remove the target from the timer wheel
+    /// @param slot Slot of the target
+    void WheelRemove(uint32_t slot);
+    /// @brief Forget the target and free its slot
+    /// @param slot Slot of the target
+    void Remove(uint32_t slot);
+    /// @brief Compute the grid cell key of a position
+    /// @param lat Latitude in degrees
+    /// @param lon Longitude in degrees
+    /// @return Cell key
+    uint32_t CellKey(double lat, double lon) const;
+    /// @brief Map a grid cell key to the bucket
+    /// @param key Cell key
+    /// @return Bucket index
+    uint32_t CellBucket(uint32_t key) const;
+    /// @brief Convert time to the timer wheel ticks
+    /// @param t Time
+    /// @return Number of ticks
+    int64_t Tick(std::chrono::steady_clock::time_point t) const;
+
+    /// MMSI of the targets, 0 for free slots
+    std::vector<uint32_t> m_mmsi;
+    /// AIS class of the targets
+    std::vector<char> m_class;
+    /// Latitude in degrees
+    std::vector<double> m_lat;
+    /// Longitude in degrees
+    std::vector<double> m_lon;
+    /// Speed over ground in m/s
+    std::vector<double> m_sog;
+    /// Course over ground in radians
+    std::vector<double> m_cog;
+    /// True heading in radians
+    std::vector<double> m_heading;
+    /// Rate of turn in radians/s
+    std::vector<double> m_rot;
+    /// AIS navigational status
+    std::vector<uint8_t> m_nav_status;
+    /// Changes since the last flush
+    std::vector<uint8_t> m_dirty;
+    /// Time the target was last heard from
+    std::vector<std::chrono::steady_clock::time_point> m_seen;
+    /// Static data, rarely accessed so kept as an array of structures
+    std::vector<ais_static_data> m_static;
+
+    /// Slots of the targets changed since the last flush
+    std::vector<uint32_t> m_dirty_list;
+    /// Free slots
+    std::vector<uint32_t> m_free;
+    /// Number of targets in the table
+    size_t m_size;
+    /// Number of updates dropped because the table was full
+    size_t m_overflows;
+
+    /// Open addressing MMSI -> slot lookup table (MMSI 0 marks empty entry)
+    std::vector<std::pair<uint32_t, uint32_t>> m_index;
+
+    /// Size of the grid cell in degrees
+    double m_cell_size;
+    /// Grid cell key of the target, NONE if the position is unknown
+    std::vector<uint32_t> m_cell;
+    /// Next target in the same grid bucket
+    std::vector<uint32_t> m_cell_next;
+    /// Previous target in the same grid bucket
+    std::vector<uint32_t> m_cell_prev;
+    /// First target in each grid bucket
+    std::vector<uint32_t> m_buckets;
+
+    /// Expiry time of the targets
+    std::chrono::steady_clock::duration m_expiry;
+    /// Length of the timer wheel tick
+    std::chrono::steady_clock::duration m_tick;
+    /// Tick at which the target expires
+    std::vector<int64_t> m_expires;
+    /// Next target in the same wheel bucket
+    std::vector<uint32_t> m_wheel_next;
+    /// Previous target in the same wheel bucket
+    std::vector<uint32_t> m_wheel_prev;
+    /// First target in each wheel bucket
+    std::vector<uint32_t> m_wheel;
+    /// The last tick processed by Expire, INT64_MIN before the first target
+    /// is placed in the wheel
+    int64_t m_wheel_tick;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_AIS_TARGETS_H_
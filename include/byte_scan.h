@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _BYTE_SCAN_H_
+#define _BYTE_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Instruction set of the byte scanning kernels
+enum class simd_level {
+    /// Plain C++, available everywhere
+    SCALAR,
+    /// 128-bit SSE2 vectors (every x86-64 CPU)
+    SSE2,
+    /// 256-bit AVX2 vectors
+    AVX2,
+    /// 128-bit NEON vectors (every AArch64 CPU, 32-bit ARM built for it)
+    NEON
+};
+
+/// Set of the byte scanning kernels built for one instruction set
+struct scan_kernels {
+    /// Instruction set
+    simd_level level;
+    /// Name of the instruction set
+    const char* name;
+    /// @brief XOR of all the bytes
+    uint8_t (*checksum)(const char* data, size_t size);
+    /// @brief Find the field separators ',' and '*'
+    /// @return Number of the positions stored, at most max
+    size_t (*separators)(
+        const char* data, size_t size, uint32_t* positions, size_t max);
+    /// @brief Find the end of a line
+    /// @return Position of the first '\r' or '\n', size if there is none
+    size_t (*eol)(const char* data, size_t size);
+    /// @brief Find the start or the end of a sentence
+    /// @return Position of the first '$', '!', '\r' or '\n', size if there
+    /// is none
+    size_t (*boundary)(const char* data, size_t size);
+};
+
+/// Byte level kernels of the handling of the NMEA 0183 sentences
+///
+/// Every kernel is built for each instruction set the compiler supports,
+/// without the instruction set being enabled for the rest of the plugin,
+/// and the best one the CPU runs is selected on the first use. The
+/// sentences are short, so the vector loops work on whole registers and
+/// finish the tail byte by byte.
+class ByteScan {
+public:
+    /// @brief Return the kernels selected for this CPU
+    /// @return Kernels
+    static const scan_kernels& Best();
+    /// @brief Return the kernels of an instruction set
+    /// @param level Instruction set
+    /// @return Kernels, nullptr if not built or not supported by the CPU
+    static const scan_kernels* Kernels(simd_level level);
+    /// @brief Return the instruction sets usable on this CPU
+    /// @return Instruction sets, the scalar one first
+    static std::vector<simd_level> Supported();
+
+    /// @brief Compute the NMEA 0183 checksum, the XOR of the bytes
+    /// @param s Bytes between the '$' or '!' and the '*'
+    /// @return Checksum
+    static uint8_t Checksum(std::string_view s)
+    {
+        return Best().checksum(s.data(), s.size());
+    };
+    /// @brief Find the field separators ',' and '*' of a sentence
+    /// @param s Sentence
+    /// @param positions Positions of the separators
+    /// @param max Maximum number of the positions stored
+    /// @return Number of the positions stored
+    static size_t Separators(
+        std::string_view s, uint32_t* positions, size_t max)
+    {
+        return Best().separators(s.data(), s.size(), positions, max);
+    };
+    /// @brief Find the end of a line
+    /// @param s Data
+    /// @return Position of the first '\r' or '\n', s.size() if there is none
+    static size_t EOL(std::string_view s)
+    {
+        return Best().eol(s.data(), s.size());
+    };
+    /// @brief Find the start or the end of a sentence
+    /// @param s Data
+    /// @return Position of the first '$', '!', '\r' or '\n', s.size() if
+    /// there is none
+    static size_t Boundary(std::string_view s)
+    {
+        return Best().boundary(s.data(), s.size());
+    };
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_BYTE_SCAN_H_
@@ -0,0 +1,126 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Source of the current time
+///
+/// Everything in NSK that depends on the flow of time (the rates, the
+/// timeouts, the windows of the filters and the timestamps) reads it from
+/// the clock it was given instead of the system, so the time can be
+/// simulated. The durations of the work itself (the profiling metrics)
+/// are always measured with the real monotonic clock.
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    /// @brief Return the current monotonic time
+    /// @return Time point
+    virtual std::chrono::steady_clock::time_point Steady() const = 0;
+    /// @brief Return the current wall clock time
+    /// @return Time point
+    virtual std::chrono::system_clock::time_point System() const = 0;
+    /// @brief Return the current wall clock time in milliseconds
+    /// @return Milliseconds since the Unix epoch
+    int64_t SystemMs() const;
+
+    /// @brief Return the clock shared by everything not given another one
+    /// @return Real clock
+    static const Clock& Real();
+};
+
+/// The clocks of the system
+class RealClock : public Clock {
+public:
+    std::chrono::steady_clock::time_point Steady() const override
+    {
+        return std::chrono::steady_clock::now();
+    };
+    std::chrono::system_clock::time_point System() const override
+    {
+        return std::chrono::system_clock::now();
+    };
+};
+
+/// Wall clock read once and advanced by the monotonic clock
+///
+/// Setting the system time or the NTP stepping it does not make the time
+/// jump, it keeps drifting with the monotonic clock instead.
+class SteadyClock : public Clock {
+public:
+    SteadyClock();
+
+    std::chrono::steady_clock::time_point Steady() const override
+    {
+        return std::chrono::steady_clock::now();
+    };
+    std::chrono::system_clock::time_point System() const override;
+
+private:
+    std::chrono::steady_clock::time_point m_steady_start;
+    std::chrono::system_clock::time_point m_system_start;
+};
+
+/// Clock that only moves when told to
+///
+/// Both the monotonic and the wall clock advance together. Setting it to
+/// the time of each sentence of a log replays the log with the time of
+/// the recording as fast as it can be processed. The time never goes
+/// backwards, an earlier time is ignored. Reading it is safe from any
+/// thread.
+class ManualClock : public Clock {
+public:
+    /// @brief Constructor
+    /// @param start Initial time in milliseconds since the Unix epoch
+    explicit ManualClock(int64_t start = 0);
+
+    std::chrono::steady_clock::time_point Steady() const override;
+    std::chrono::system_clock::time_point System() const override;
+
+    /// @brief Move the clock to a time
+    /// @param ms Milliseconds since the Unix epoch
+    void Set(int64_t ms);
+    /// @brief Move the clock forward
+    /// @param d Duration
+    void Advance(std::chrono::nanoseconds d);
+
+private:
+    /// Nanoseconds since the Unix epoch
+    std::atomic<int64_t> m_now;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_CLOCK_H_
@@ -0,0 +1,162 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _CPA_H_
+#define _CPA_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "ais_targets.h"
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Closest point of approach computation for all the AIS targets
+///
+/// The results are kept in arrays parallel to the AISTargets table. Target
+/// velocities are converted to the east/north components once when the target
+/// changes, the CPA/TCPA computation itself is a branch-free loop over the
+/// contiguous arrays the compiler is able to vectorize. Only the targets that
+/// changed since the last computation are processed, unless the own ship
+/// velocity changes or the own ship moves more than 50 m, in which case all of
+/// them are recomputed.
+class CPAEngine {
+public:
+    /// @brief Constructor
+    /// @param capacity Number of slots, must match the AIS target table
+    explicit CPAEngine(size_t capacity = 4096);
+
+    /// @brief Set the alarm limits
+    /// @param distance CPA distance in meters below which the alarm is raised
+    /// @param time Maximum time to CPA in seconds for which the alarm is
+    /// raised
+    void SetLimits(double distance, double time);
+    /// @brief Return the CPA distance limit
+    /// @return Distance in meters
+    double DistanceLimit() const { return m_limit_distance; };
+    /// @brief Return the TCPA limit
+    /// @return Time in seconds
+    double TimeLimit() const { return m_limit_time; };
+    /// @brief Update the own ship position
+    /// @param lat Latitude in degrees
+    /// @param lon Longitude in degrees
+    void SetOwnPosition(double lat, double lon);
+    /// @brief Update the own ship velocity
+    /// @param sog Speed over ground in m/s
+    /// @param cog Course over ground in radians
+    void SetOwnVelocity(double sog, double cog);
+    /// @brief Set the MMSI of the own ship, which is excluded from the
+    /// computation
+    /// @param mmsi MMSI
+    void SetOwnMmsi(uint32_t mmsi) { m_own_mmsi = mmsi; };
+    /// @brief Mark the target as changed
+    /// @param slot Slot of the target
+    /// @param targets The AIS target table
+    void Touch(uint32_t slot, const AISTargets& targets);
+    /// @brief Compute CPA and TCPA of the changed targets (or all of them if
+    /// the own ship velocity or position changed)
+    /// @param targets The AIS target table
+    /// @return Number of targets processed
+    size_t Compute(const AISTargets& targets);
+
+    /// Slots for which the alarm state changed during the last Compute()
+    const std::vector<uint32_t>& Changed() const { return m_changed; };
+    /// MMSI of the alarmed targets which left the AIS target table (expired
+    /// or replaced in their slot) before the last Compute(), their alarm is
+    /// cleared
+    const std::vector<uint32_t>& Expired() const { return m_expired; };
+    /// Distance at the closest point of approach in meters, NaN if unknown
+    const std::vector<double>& Cpa() const { return m_cpa; };
+    /// Time to the closest point of approach in seconds (negative if the
+    /// targets are already diverging), NaN if unknown
+    const std::vector<double>& Tcpa() const { return m_tcpa; };
+    /// Alarm state of the targets (1 if the target is inside the limits)
+    const std::vector<uint8_t>& Alarm() const { return m_alarm; };
+
+private:
+    /// @brief Compute CPA/TCPA for a contiguous range of slots
+    /// @param targets The AIS target table
+    /// @param from First slot
+    /// @param to One past the last slot
+    void ComputeRange(const AISTargets& targets, size_t from, size_t to);
+    /// @brief Compare the new alarm state with the previous one and record
+    /// the change
+    /// @param slot Slot of the target
+    void UpdateAlarm(uint32_t slot);
+
+    /// East component of the target velocity in m/s
+    std::vector<double> m_vx;
+    /// North component of the target velocity in m/s
+    std::vector<double> m_vy;
+    /// CPA distance in meters
+    std::vector<double> m_cpa;
+    /// Time to CPA in seconds
+    std::vector<double> m_tcpa;
+    /// Result of the limit check of the last computation
+    std::vector<uint8_t> m_inside;
+    /// Reported alarm state
+    std::vector<uint8_t> m_alarm;
+    /// MMSI the results in the slot belong to
+    std::vector<uint32_t> m_mmsi;
+    /// Whether the slot is in the list of changed targets
+    std::vector<uint8_t> m_touched;
+    /// Targets changed since the last computation
+    std::vector<uint32_t> m_dirty;
+    /// Targets whose alarm state changed in the last computation
+    std::vector<uint32_t> m_changed;
+    /// Alarmed targets gone since the last computation
+    std::vector<uint32_t> m_gone;
+    /// Alarmed targets gone before the last computation
+    std::vector<uint32_t> m_expired;
+
+    /// Own ship latitude in degrees
+    double m_own_lat;
+    /// Own ship longitude in degrees
+    double m_own_lon;
+    /// East component of the own ship velocity in m/s
+    double m_own_vx;
+    /// North component of the own ship velocity in m/s
+    double m_own_vy;
+    /// Own ship velocity used by the last full computation
+    double m_full_vx;
+    /// Own ship velocity used by the last full computation
+    double m_full_vy;
+    /// Own ship position used by the last full computation
+    double m_full_lat;
+    /// Own ship position used by the last full computation
+    double m_full_lon;
+    /// MMSI of the own ship
+    uint32_t m_own_mmsi;
+    /// CPA distance limit in meters
+    double m_limit_distance;
+    /// TCPA limit in seconds
+    double m_limit_time;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_CPA_H_
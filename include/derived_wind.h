@@ -0,0 +1,151 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _DERIVED_WIND_H_
+#define _DERIVED_WIND_H_
+
+#include <array>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "pi_common.h"
+#include "rapidjson/document.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// True and ground wind derived from the apparent wind
+///
+/// The latest values of the inputs are cached, the derived values are
+/// recomputed only when any of them changed. The apparent wind angle can be
+/// corrected for the upwash of the sails using a table of corrections by
+/// apparent wind angle.
+///
+/// All the angles are in radians, the speeds in m/s, angles relative to the
+/// bow are positive to starboard.
+class DerivedWind {
+public:
+    /// Inputs of the computation
+    enum input {
+        /// Apparent wind angle
+        APPARENT_ANGLE,
+        /// Apparent wind speed
+        APPARENT_SPEED,
+        /// Speed through water
+        SPEED_THROUGH_WATER,
+        /// True heading
+        HEADING,
+        /// Speed over ground
+        SPEED_OVER_GROUND,
+        /// Course over ground
+        COURSE_OVER_GROUND,
+        /// Number of the inputs
+        INPUTS
+    };
+
+    DerivedWind();
+
+    /// @brief Update an input
+    /// @param in Input
+    /// @param value New value
+    /// @param now Current time
+    void Set(input in, double value, std::chrono::steady_clock::time_point now);
+    /// @brief Recompute the derived values if any input changed
+    /// @param now Current time, inputs older than the maximum age are not
+    /// used
+    /// @return true if new values were computed
+    bool Compute(std::chrono::steady_clock::time_point now);
+
+    /// @brief Return whether the water referenced values are available
+    bool HasWater() const { return m_has_water; };
+    /// @brief Return whether the ground referenced values are available
+    bool HasGround() const { return m_has_ground; };
+    /// True wind angle relative to the bow (water referenced)
+    double AngleTrueWater() const { return m_angle_true_water; };
+    /// True wind speed (water referenced)
+    double SpeedTrue() const { return m_speed_true; };
+    /// Ground wind angle relative to the bow
+    double AngleTrueGround() const { return m_angle_true_ground; };
+    /// Ground wind speed
+    double SpeedOverGround() const { return m_speed_over_ground; };
+    /// Ground wind direction relative to the true north
+    double DirectionTrue() const { return m_direction_true; };
+
+    /// @brief Enable the computation
+    /// @param enabled Whether the derived values are produced
+    void SetEnabled(bool enabled) { m_enabled = enabled; };
+    /// @brief Return whether the computation is enabled
+    bool Enabled() const { return m_enabled; };
+    /// @brief Set the upwash correction table
+    /// @param table Pairs of the apparent wind angle and the correction added
+    /// to it, both in radians, sorted by the angle (0 to PI), the correction
+    /// is interpolated linearly and mirrored for port
+    void SetUpwash(const std::vector<std::pair<double, double>>& table);
+    /// @brief Set the maximum age of the inputs
+    /// @param age Maximum age
+    void SetMaxAge(std::chrono::milliseconds age) { m_max_age = age; };
+    /// @brief Load the configuration
+    /// @param v JSON object {"enabled": bool, "max_age": seconds, "upwash":
+    /// [[angle, correction], ...]} with angles in degrees
+    void FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+
+private:
+    /// @brief Return whether the input is known and recent
+    bool Fresh(input in, std::chrono::steady_clock::time_point now) const;
+    /// @brief Return the upwash correction for the apparent wind angle
+    /// @param angle Apparent wind angle in (-PI, PI], negative to port
+    double Upwash(double angle) const;
+
+    /// Latest values of the inputs
+    std::array<double, INPUTS> m_inputs;
+    /// Times the inputs were updated
+    std::array<std::chrono::steady_clock::time_point, INPUTS> m_updated;
+    /// Whether any input changed since the last computation
+    bool m_dirty;
+    /// Whether the computation is enabled
+    bool m_enabled;
+    /// Maximum age of the inputs
+    std::chrono::milliseconds m_max_age;
+    /// Upwash correction table
+    std::vector<std::pair<double, double>> m_upwash;
+
+    bool m_has_water;
+    bool m_has_ground;
+    double m_angle_true_water;
+    double m_speed_true;
+    double m_angle_true_ground;
+    double m_speed_over_ground;
+    double m_direction_true;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_DERIVED_WIND_H_
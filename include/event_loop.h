@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _EVENT_LOOP_H_
+#define _EVENT_LOOP_H_
+
+#ifdef __linux__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include <sys/epoll.h>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Minimal epoll based event loop
+///
+/// File descriptors are registered together with a handler called with the
+/// epoll event mask whenever the descriptor becomes ready. The loop is driven
+/// by the owning thread calling Poll(), any other thread may interrupt the
+/// wait with Wake().
+class EventLoop {
+public:
+    /// Handler of the events of a file descriptor
+    typedef std::function<void(uint32_t events)> handler;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /// @brief Whether the loop was created successfully
+    /// @return true if the loop can be used
+    bool Valid() const { return m_epoll >= 0 && m_wake >= 0; };
+    /// @brief Register a file descriptor
+    /// @param fd File descriptor
+    /// @param events Epoll events to wait for (EPOLLIN, EPOLLOUT...)
+    /// @param h Handler of the events
+    /// @return false if the descriptor could not be registered
+    bool Add(int fd, uint32_t events, handler h);
+    /// @brief Change the events waited for
+    /// @param fd File descriptor
+    /// @param events Epoll events to wait for
+    /// @return false on error
+    bool Modify(int fd, uint32_t events);
+    /// @brief Unregister a file descriptor (does not close it)
+    /// @param fd File descriptor
+    void Remove(int fd);
+    /// @brief Interrupt the wait in Poll(), may be called from any thread
+    void Wake();
+    /// @brief Wait for the events and call their handlers
+    /// @param timeout_ms Maximum time to wait in milliseconds (-1 to wait
+    /// indefinitely)
+    /// @return Number of handlers called, -1 on error
+    int Poll(int timeout_ms);
+    /// @brief Return the number of registered descriptors
+    /// @return Number of descriptors
+    size_t Size() const { return m_handlers.size(); };
+
+private:
+    /// Maximum number of events processed in one Poll() call
+    static constexpr int MAX_EVENTS = 64;
+
+    /// Epoll instance
+    int m_epoll;
+    /// Eventfd used by Wake()
+    int m_wake;
+    /// Handlers of the registered descriptors
+    std::unordered_map<int, std::shared_ptr<handler>> m_handlers;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif // __linux__
+
+#endif //_EVENT_LOOP_H_
@@ -0,0 +1,143 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "metrics.h"
+#include "pi_common.h"
+#include "rapidjson/document.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Record of a received sentence
+struct flight_record {
+    /// Longest sentence kept, longer ones are truncated
+    static constexpr size_t MAX_SENTENCE = 96;
+
+    /// Sequence number of the record
+    uint64_t sequence;
+    /// UTC time the sentence was received in milliseconds since the epoch
+    int64_t time;
+    /// Size of the delta(s) produced from the sentence in bytes
+    uint32_t delta_size;
+    /// Length of the sentence
+    uint32_t length;
+    /// FNV-1a hash of the delta(s) produced from the sentence, 0 if none
+    uint64_t delta_hash;
+    /// Sentence
+    char sentence[MAX_SENTENCE];
+
+    /// @brief Return the sentence
+    /// @return Sentence
+    std::string_view Sentence() const { return { sentence, length }; };
+};
+
+/// Flight recorder of the conversion
+///
+/// Keeps the last received sentences with their receive time and the size
+/// and hash of the resulting deltas in a ring of preallocated slots.
+/// Recording a sentence copies it into the next slot, each slot is
+/// a sequence lock, so the ring can be dumped from any thread without
+/// stopping the conversion.
+///
+/// The dump is a plain NMEA 0183 log, each sentence preceded by a comment
+/// line "#NSK <ISO time> <epoch ms> <delta size> <delta hash>", which any
+/// NMEA player can replay and Load reads back.
+class FlightRecorder {
+public:
+    /// Default number of the records kept
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    /// @brief Constructor
+    /// @param capacity Number of the records kept
+    explicit FlightRecorder(size_t capacity = DEFAULT_CAPACITY);
+
+    /// @brief Change the number of the records kept, dropping the records
+    /// @param capacity Number of the records, 0 to stop recording
+    void Resize(size_t capacity);
+    /// @brief Return the number of the records kept
+    /// @return Capacity
+    size_t Capacity() const { return m_capacity; };
+    /// @brief Record a received sentence
+    /// @param stc Sentence
+    /// @param time UTC time in milliseconds since the epoch
+    void Record(std::string_view stc, int64_t time);
+    /// @brief Add a delta produced from the last recorded sentence
+    /// @param json Serialized delta
+    void Delta(std::string_view json);
+    /// @brief Return the records still in the ring, oldest first
+    /// @return Records
+    std::vector<flight_record> Records() const;
+    /// @brief Write the records to a stream
+    /// @param out Stream
+    /// @return Number of the records written
+    size_t Dump(std::ostream& out) const;
+    /// @brief Write the records to a file
+    /// @param path Path to the file
+    /// @return true if the file was written
+    bool Dump(const std::string& path) const;
+    /// @brief Read the records back from a dump
+    /// @param in Stream with the dump
+    /// @return Records (the ones from a plain NMEA log have time 0)
+    static std::vector<flight_record> Load(std::istream& in);
+    /// @brief Return the FNV-1a hash of data
+    /// @param data Data
+    /// @param hash Hash to continue
+    /// @return Hash
+    static uint64_t Hash(
+        std::string_view data, uint64_t hash = 0xcbf29ce484222325ull);
+    /// @brief Load the configuration
+    /// @param v JSON object {"size": records}
+    void FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+
+private:
+    /// Slots of the ring
+    std::unique_ptr<Seqlock<flight_record>[]> m_slots;
+    size_t m_capacity;
+    /// Sequence number of the next record
+    std::atomic<uint64_t> m_next;
+    /// Copy of the last record being completed by the deltas
+    flight_record m_current;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_FLIGHT_RECORDER_H_
@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _MAGNETIC_VARIATION_H_
+#define _MAGNETIC_VARIATION_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// World Magnetic Model evaluator
+///
+/// Evaluates the spherical harmonic expansion of the main geomagnetic field
+/// with the coefficients in the format of the WMM.COF file distributed by
+/// NOAA (epoch and model name on the first line, then "n m g h gdot hdot"
+/// lines terminated by a line of nines).
+class MagneticModel {
+public:
+    /// Highest degree of the expansion supported
+    static constexpr int MAX_DEGREE = 12;
+
+    MagneticModel();
+
+    /// @brief Load the coefficients from a file
+    /// @param path Path to the WMM.COF file
+    /// @return true if the model was loaded
+    bool Load(const std::string& path);
+    /// @brief Load the coefficients from a stream
+    /// @param in Stream with the WMM.COF format
+    /// @return true if the model was loaded
+    bool Load(std::istream& in);
+    /// @brief Return whether a model is loaded
+    /// @return true if the model can be evaluated
+    bool Valid() const { return m_degree > 0; };
+    /// @brief Return the name of the model
+    /// @return Model name (eg. WMM-2025)
+    const std::string& Name() const { return m_name; };
+    /// @brief Return the epoch of the model
+    /// @return Decimal year
+    double Epoch() const { return m_epoch; };
+    /// @brief Compute the magnetic declination (variation)
+    /// @param lat Geodetic latitude in degrees
+    /// @param lon Longitude in degrees
+    /// @param alt Height above the WGS84 ellipsoid in kilometers
+    /// @param year Decimal year
+    /// @return Declination in radians, positive east, NaN without a model
+    double Declination(double lat, double lon, double alt, double year) const;
+
+private:
+    /// Coefficients indexed by n * (MAX_DEGREE + 1) + m
+    std::array<double, (MAX_DEGREE + 1) * (MAX_DEGREE + 1)> m_g;
+    std::array<double, (MAX_DEGREE + 1) * (MAX_DEGREE + 1)> m_h;
+    std::array<double, (MAX_DEGREE + 1) * (MAX_DEGREE + 1)> m_gdot;
+    std::array<double, (MAX_DEGREE + 1) * (MAX_DEGREE + 1)> m_hdot;
+    /// Degree of the loaded model, 0 if none
+    int m_degree;
+    /// Epoch of the coefficients
+    double m_epoch;
+    /// Name of the model
+    std::string m_name;
+};
+
+/// Magnetic variation with a geographic cache
+///
+/// Evaluating the model takes a few microseconds, the variation changes
+/// slowly in space and time though. The values are computed at the corners
+/// of a grid of cells (1 degree of latitude and longitude, a tenth of
+/// a year) and bilinearly interpolated inside the cell, so the cost of
+/// a lookup in a cell seen recently is a hash and four multiplications.
+class MagneticVariation {
+public:
+    MagneticVariation();
+
+    /// @brief Return the model
+    /// @return Reference to the model
+    const MagneticModel& Model() const { return m_model; };
+    /// @brief Load the model coefficients
+    /// @param path Path to the WMM.COF file
+    /// @return true if the model was loaded
+    bool Load(const std::string& path);
+    /// @brief Load the model coefficients
+    /// @param in Stream with the WMM.COF format
+    /// @return true if the model was loaded
+    bool Load(std::istream& in);
+    /// @brief Return the magnetic variation
+    /// @param lat Latitude in degrees
+    /// @param lon Longitude in degrees
+    /// @param year Decimal year
+    /// @return Variation in radians, positive east, NaN without a model
+    double Variation(double lat, double lon, double year);
+    /// @brief Convert a point in time to a decimal year
+    /// @param t Point in time
+    /// @return Decimal year (eg. 2025.5)
+    static double DecimalYear(std::chrono::system_clock::time_point t);
+    /// @brief Return the number of lookups served from the cache
+    uint64_t Hits() const { return m_hits; };
+    /// @brief Return the number of lookups that needed the model
+    uint64_t Misses() const { return m_misses; };
+
+private:
+    /// Cached grid cell
+    struct cell {
+        /// Cell key, UINT32_MAX for an empty entry
+        uint32_t key = UINT32_MAX;
+        /// Variation at the corners (south-west, south-east, north-west,
+        /// north-east)
+        std::array<float, 4> corners;
+    };
+
+    /// Number of the cached cells (power of two)
+    static constexpr size_t CELLS = 256;
+
+    /// The model
+    MagneticModel m_model;
+    /// Direct mapped cell cache
+    std::array<cell, CELLS> m_cells;
+    uint64_t m_hits;
+    uint64_t m_misses;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_MAGNETIC_VARIATION_H_
@@ -0,0 +1,235 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Sequence lock publishing a value from one writer to any number of readers
+///
+/// Neither side ever blocks, a reader copying the value while the writer
+/// replaces it simply copies it again. The value is kept in atomic words,
+/// so the racing copies are well defined.
+template <typename T> class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "The value must be trivially copyable");
+
+public:
+    Seqlock()
+        : m_sequence(0)
+    {
+        Store(T());
+    }
+
+    /// @brief Publish a new value (single writer)
+    /// @param value Value
+    void Store(const T& value)
+    {
+        std::array<uint64_t, WORDS> buf {};
+        std::memcpy(buf.data(), &value, sizeof(T));
+        const uint64_t seq = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            m_data[i].store(buf[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(seq + 2, std::memory_order_release);
+    }
+    /// @brief Return a consistent copy of the last published value
+    /// @return Value
+    T Load() const
+    {
+        std::array<uint64_t, WORDS> buf;
+        uint64_t before;
+        uint64_t after;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; ++i) {
+                buf[i] = m_data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+        T value;
+        std::memcpy(&value, buf.data(), sizeof(T));
+        return value;
+    }
+    /// @brief Return the number of the values published
+    /// @return Number of values
+    uint64_t Version() const
+    {
+        return m_sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint64_t> m_sequence;
+    std::array<std::atomic<uint64_t>, WORDS> m_data;
+};
+
+/// Stage of the conversion timed by the metrics
+enum class pipeline_stage {
+    /// Parsing the NMEA 0183 sentence
+    PARSE,
+    /// Converting the sentence to the SignalK values
+    CONVERT,
+    /// Serializing the delta to JSON
+    SERIALIZE,
+    /// Passing the delta to the sinks
+    PUBLISH,
+    /// Number of the stages
+    COUNT
+};
+
+/// Histogram of durations with power of two nanosecond buckets
+struct latency_histogram {
+    /// Number of the buckets, the last one collects everything above 2 s
+    static constexpr size_t BUCKETS = 32;
+
+    /// Number of durations in [2^i, 2^(i+1)) nanoseconds
+    std::array<uint64_t, BUCKETS> buckets {};
+
+    /// @brief Count a duration
+    /// @param d Duration
+    void Record(std::chrono::nanoseconds d);
+    /// @brief Return the number of the durations counted
+    /// @return Number of durations
+    uint64_t Count() const;
+    /// @brief Return the upper bound of the percentile
+    /// @param p Percentile 0-100
+    /// @return Upper bound of the bucket containing the percentile, zero if
+    /// nothing was counted
+    std::chrono::nanoseconds Percentile(double p) const;
+};
+
+/// Counter of the sentences with the same tag
+struct sentence_counter {
+    /// Sentence tag (eg. "GGA")
+    char tag[8];
+    /// Number of the sentences received
+    uint64_t count;
+};
+
+/// Metrics of the conversion at one point in time
+struct metrics_snapshot {
+    /// Number of the distinct sentence tags counted
+    static constexpr size_t MAX_SENTENCES = 48;
+
+    /// Monotonic time the snapshot was taken in milliseconds
+    int64_t taken;
+    /// NMEA 0183 sentences received
+    uint64_t nmea_total;
+    /// Deltas produced
+    uint64_t sk_total;
+    /// Sentences that failed to parse
+    uint64_t errors;
+    /// Sentences that did not produce any values
+    uint64_t ignored;
+    /// Values not produced because nobody subscribed to them
+    uint64_t skipped;
+    /// Values suppressed by a preferred source
+    uint64_t suppressed;
+    /// Deltas dropped by the sinks
+    uint64_t dropped;
+    /// Deltas waiting in the queues of the sinks
+    uint64_t queue_depth;
+    /// Memory allocated for the last delta in bytes
+    uint64_t allocated;
+    /// Most memory allocated for a delta in bytes
+    uint64_t allocated_peak;
+    /// Durations of the stages
+    std::array<latency_histogram, static_cast<size_t>(pipeline_stage::COUNT)>
+        latency;
+    /// Number of the used sentence counters
+    uint64_t sentence_count;
+    /// Sentences received per tag
+    std::array<sentence_counter, MAX_SENTENCES> sentences;
+};
+
+/// Collection of the metrics of the conversion
+///
+/// The conversion updates the plain counters of its private copy, which is
+/// published through a sequence lock at most every PUBLISH_INTERVAL. The
+/// user interface reads the published snapshot at its own pace without
+/// ever stopping the conversion.
+class PipelineMetrics {
+public:
+    /// Minimum time between two published snapshots
+    static constexpr std::chrono::milliseconds PUBLISH_INTERVAL { 250 };
+
+    PipelineMetrics();
+
+    /// @brief Count a received sentence by its tag
+    /// @param stc NMEA 0183 sentence
+    void CountSentence(std::string_view stc);
+    /// @brief Count the duration of a stage
+    /// @param s Stage
+    /// @param d Duration
+    void Record(pipeline_stage s, std::chrono::nanoseconds d)
+    {
+        m_live.latency[static_cast<size_t>(s)].Record(d);
+    };
+    /// @brief Count the memory allocated for a delta
+    /// @param bytes Number of bytes
+    void Allocated(size_t bytes);
+    /// @brief Return the private copy of the metrics to be updated
+    /// @return Reference to the metrics
+    metrics_snapshot& Live() { return m_live; };
+    /// @brief Return whether a snapshot should be published
+    /// @param now Current time
+    /// @return true if the last one is older than PUBLISH_INTERVAL
+    bool Due(std::chrono::steady_clock::time_point now) const
+    {
+        return now - m_published >= PUBLISH_INTERVAL;
+    };
+    /// @brief Publish the private copy of the metrics
+    /// @param now Current time
+    void Publish(std::chrono::steady_clock::time_point now);
+    /// @brief Return the last published snapshot, callable from any thread
+    /// @return Snapshot
+    metrics_snapshot Snapshot() const { return m_snapshot.Load(); };
+
+private:
+    metrics_snapshot m_live;
+    Seqlock<metrics_snapshot> m_snapshot;
+    std::chrono::steady_clock::time_point m_published;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_METRICS_H_
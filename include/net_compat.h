@@ -0,0 +1,104 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _NET_COMPAT_H_
+#define _NET_COMPAT_H_
+
+// Minimal portability layer over the BSD and Windows socket APIs
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#ifdef _WIN32
+/// Socket handle
+typedef SOCKET socket_t;
+/// Invalid socket handle
+constexpr socket_t INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+/// Flags suppressing SIGPIPE on send
+constexpr int SEND_FLAGS = 0;
+
+/// @brief Initialize the socket library (once per process)
+inline void NetInit()
+{
+    static WSADATA wsa;
+    static const bool initialized = WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+    (void)initialized;
+}
+/// @brief Close the socket
+inline void CloseSocket(socket_t s) { closesocket(s); }
+/// @brief Switch the socket to non-blocking mode
+inline bool SetNonBlocking(socket_t s)
+{
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+}
+/// @brief Whether the last socket operation failed because it would block
+inline bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+/// Socket handle
+typedef int socket_t;
+/// Invalid socket handle
+constexpr socket_t INVALID_SOCKET_HANDLE = -1;
+#ifdef MSG_NOSIGNAL
+/// Flags suppressing SIGPIPE on send
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+/// Flags suppressing SIGPIPE on send
+constexpr int SEND_FLAGS = 0;
+#endif
+
+/// @brief Initialize the socket library (once per process)
+inline void NetInit() { }
+/// @brief Close the socket
+inline void CloseSocket(socket_t s) { close(s); }
+/// @brief Switch the socket to non-blocking mode
+inline bool SetNonBlocking(socket_t s)
+{
+    const int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+/// @brief Whether the last socket operation failed because it would block
+inline bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+#endif
+
+PLUGIN_END_NAMESPACE
+
+#endif //_NET_COMPAT_H_
@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _NMEA_FRAMER_H_
+#define _NMEA_FRAMER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Splitter of a raw byte stream into the NMEA 0183 sentences
+///
+/// A sentence starts with '$' or '!' and ends with CR, LF or both. The
+/// boundaries are found with the vector kernels of ByteScan and the
+/// sentences are handed out as views into the buffer fed, only the piece
+/// of a sentence split between two reads is copied. The bytes outside
+/// of the sentences are discarded. A start inside a sentence means the
+/// sentence was cut short, it is discarded and the framer resynchronizes
+/// on the new start; so does a sentence longer than the limit.
+///
+/// Usage:
+///
+///     framer.Feed(buffer);
+///     std::string_view stc;
+///     while (framer.Next(stc)) {
+///         ...
+///     }
+class NMEAFramer {
+public:
+    /// Default limit of the length of a sentence, generous to the
+    /// proprietary sentences exceeding the 82 characters of the standard
+    static constexpr size_t MAX_SENTENCE = 256;
+
+    /// @brief Constructor
+    /// @param max_sentence Longest sentence accepted without the line end
+    explicit NMEAFramer(size_t max_sentence = MAX_SENTENCE);
+
+    /// @brief Pass the next piece of the stream
+    ///
+    /// The sentences of the previous piece must all have been taken by
+    /// Next, the buffer must stay valid until Next returns false.
+    /// @param data Bytes received
+    void Feed(std::string_view data);
+    /// @brief Take the next complete sentence
+    /// @param sentence Sentence without the line end, valid until the next
+    /// call to Next or Feed
+    /// @return false when the piece fed is exhausted
+    bool Next(std::string_view& sentence);
+    /// @brief Take the partial sentence at the end of the input as complete
+    ///
+    /// For the messages carrying whole sentences (UDP datagrams) whose
+    /// sender leaves out the line end of the last one.
+    /// @param sentence Sentence, valid until the next call to Next, Feed
+    /// or Flush
+    /// @return false if there is no partial sentence
+    bool Flush(std::string_view& sentence);
+    /// @brief Forget the partial sentence carried over, the counters are
+    /// kept
+    void Reset();
+
+    /// @brief Return the number of the sentences framed
+    /// @return Number of sentences
+    uint64_t Sentences() const { return m_sentences; };
+    /// @brief Return the number of the bytes discarded
+    /// @return Number of bytes
+    uint64_t Discarded() const { return m_discarded; };
+    /// @brief Return the number of the sentences cut short by a new start
+    /// @return Number of sentences
+    uint64_t Truncated() const { return m_truncated; };
+    /// @brief Return the number of the sentences over the length limit
+    /// @return Number of sentences
+    uint64_t Overlong() const { return m_overlong; };
+
+private:
+    /// @brief Drop the sentence in progress
+    void Drop(size_t length);
+
+    size_t m_max_sentence;
+    /// Piece of the stream being framed
+    std::string_view m_data;
+    /// Position of the next byte of the piece to scan
+    size_t m_pos;
+    /// Whether a sentence is in progress
+    bool m_in_sentence;
+    /// Whether the sentence in progress started in an earlier piece and
+    /// its beginning is in the carry buffer
+    bool m_carried;
+    /// Start of the sentence in progress within the piece
+    size_t m_start;
+    /// Beginning of a sentence split between the pieces
+    std::string m_carry;
+    /// The carry buffer was handed out and is emptied by the next call
+    bool m_carry_out;
+    uint64_t m_sentences;
+    uint64_t m_discarded;
+    uint64_t m_truncated;
+    uint64_t m_overlong;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_NMEA_FRAMER_H_
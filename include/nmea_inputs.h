@@ -0,0 +1,240 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _NMEA_INPUTS_H_
+#define _NMEA_INPUTS_H_
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "nmea_framer.h"
+#include "pi_common.h"
+#include "rapidjson/document.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Configuration of an NMEA 0183 input
+struct input_config {
+    /// Type of the input (serial, tcp, udp)
+    std::string type = "serial";
+    /// Device of the serial input
+    std::string path;
+    /// Speed of the serial input in bauds
+    uint32_t baud = 4800;
+    /// Server (TCP) or listen (UDP, empty for all the interfaces) address
+    std::string host;
+    /// Server (TCP) or listen (UDP, 0 for any free) port
+    uint16_t port = 0;
+    /// Delay before reopening a failed input or reconnecting
+    std::chrono::milliseconds reconnect { 5000 };
+    /// Longest sentence accepted
+    size_t max_sentence = NMEAFramer::MAX_SENTENCE;
+
+    /// @brief Read the configuration from JSON
+    /// @param v JSON object
+    /// @return Configuration, missing members have the default values
+    static input_config FromJSON(const rapidjson::Value& v);
+    /// @brief Write the configuration to JSON
+    /// @param allocator Allocator of the target document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+};
+
+/// Statistics of an input
+struct input_stats {
+    /// Whether the input is open (connected for TCP)
+    bool open = false;
+    /// Bytes received
+    uint64_t bytes = 0;
+    /// Datagrams received (UDP)
+    uint64_t datagrams = 0;
+    /// Sentences framed
+    uint64_t sentences = 0;
+    /// Bytes discarded by the framer
+    uint64_t discarded = 0;
+    /// Sentences cut short or over the length limit
+    uint64_t broken = 0;
+    /// Times the input was opened (connected for TCP)
+    uint64_t opens = 0;
+    /// Failures to open, connect or read and the connections closed by the
+    /// other side
+    uint64_t errors = 0;
+    /// Datagrams dropped by the kernel because they were not read in time
+    /// (UDP)
+    uint64_t kernel_drops = 0;
+    /// Bytes waiting in the kernel after the last read
+    uint64_t backlog = 0;
+};
+
+/// Reader of the NMEA 0183 sentences from the serial ports, TCP servers
+/// and UDP datagrams
+///
+/// All the inputs are multiplexed on a single thread driven by an epoll
+/// event loop, which frames the received bytes and passes the sentences to
+/// the handler. The sentences are not queued: an input is only read as
+/// fast as the handler takes them, the rest waits in the kernel, where
+/// the TCP flow control slows the sender down and the UDP datagrams
+/// overflowing the socket buffer are dropped and counted. Each readiness
+/// of an input is served with at most a burst of bytes, so a flood on one
+/// input does not starve the others. The failed inputs are reopened and
+/// the lost TCP connections reestablished after a delay.
+class NMEAInputs {
+public:
+    /// Handler of a sentence received by an input, called on the thread
+    /// of the inputs
+    typedef std::function<void(size_t input, std::string_view sentence)>
+        handler;
+
+    /// Bytes read from an input per readiness
+    static constexpr size_t BURST = 16384;
+
+    /// @brief Constructor
+    /// @param h Handler of the sentences
+    explicit NMEAInputs(handler h);
+    ~NMEAInputs();
+    NMEAInputs(const NMEAInputs&) = delete;
+    NMEAInputs& operator=(const NMEAInputs&) = delete;
+
+    /// @brief Add an input, only while stopped
+    /// @param cfg Configuration
+    /// @return Index of the input passed to the handler
+    size_t Add(const input_config& cfg);
+    /// @brief Remove all the inputs, only while stopped
+    void Clear();
+    /// @brief Open the inputs and start the thread
+    /// @return false if the event loop could not be created
+    bool Start();
+    /// @brief Stop the thread and close the inputs
+    void Stop();
+    /// @brief Return whether the thread runs
+    /// @return true if running
+    bool Running() const { return m_thread.joinable(); };
+    /// @brief Return the number of the inputs
+    /// @return Number of inputs
+    size_t Size() const { return m_inputs.size(); };
+    /// @brief Return the configuration of an input
+    /// @param input Index of the input
+    /// @return Configuration
+    const input_config& Config(size_t input) const
+    {
+        return m_inputs[input]->cfg;
+    };
+    /// @brief Return the statistics of an input, from any thread
+    /// @param input Index of the input
+    /// @return Statistics
+    input_stats Stats(size_t input) const;
+    /// @brief Return the port an UDP input listens on, from any thread
+    /// @param input Index of the input
+    /// @return Port (useful when configured with port 0), 0 if not open
+    uint16_t Port(size_t input) const { return m_inputs[input]->port; };
+
+private:
+    /// State and statistics of an input
+    struct input {
+        explicit input(const input_config& c)
+            : cfg(c)
+            , framer(c.max_sentence)
+        {
+        }
+
+        input_config cfg;
+        /// File descriptor, -1 while closed
+        int fd = -1;
+        /// Whether the TCP connection is being established
+        bool connecting = false;
+        /// Time to reopen the closed input
+        std::chrono::steady_clock::time_point retry;
+        NMEAFramer framer;
+        std::atomic<bool> open { false };
+        std::atomic<uint16_t> port { 0 };
+        std::atomic<uint64_t> bytes { 0 };
+        std::atomic<uint64_t> datagrams { 0 };
+        std::atomic<uint64_t> opens { 0 };
+        std::atomic<uint64_t> errors { 0 };
+        std::atomic<uint64_t> kernel_drops { 0 };
+        std::atomic<uint64_t> backlog { 0 };
+        std::atomic<uint64_t> sentences { 0 };
+        std::atomic<uint64_t> discarded { 0 };
+        std::atomic<uint64_t> broken { 0 };
+    };
+
+    /// @brief Thread of the inputs
+    void Run();
+    /// @brief Open an input
+    /// @return false if the input failed to open
+    bool Open(size_t index);
+    /// @brief Open the device of a serial input
+    int OpenSerial(input& in);
+    /// @brief Start the connection of a TCP input
+    int OpenTCP(input& in);
+    /// @brief Bind the socket of an UDP input
+    int OpenUDP(input& in);
+    /// @brief Close an input and schedule its reopening
+    /// @param failed Whether the input is closed because of a failure
+    void Close(size_t index, bool failed);
+    /// @brief Handle the events of an input
+    void OnEvent(size_t index, uint32_t events);
+    /// @brief Read a stream input
+    /// @return false if the input failed or was closed by the other side
+    bool ReadStream(input& in, size_t index);
+    /// @brief Read the datagrams of an UDP input
+    /// @return false if the input failed
+    bool ReadDatagrams(input& in, size_t index);
+    /// @brief Frame the received bytes and pass the sentences to the handler
+    /// @param datagram Whether the data end with the last sentence
+    void Frame(input& in, size_t index, std::string_view data, bool datagram);
+    /// @brief Reopen the inputs which are due
+    /// @return Time until the next input is due, -1 if none
+    int Retry();
+
+    handler m_handler;
+    std::vector<std::unique_ptr<input>> m_inputs;
+    /// Event loop
+    std::unique_ptr<EventLoop> m_loop;
+    /// Thread of the inputs
+    std::thread m_thread;
+    /// Request to stop the thread
+    std::atomic<bool> m_stop;
+    /// Receive buffer
+    std::vector<char> m_buffer;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif // __linux__
+
+#endif //_NMEA_INPUTS_H_
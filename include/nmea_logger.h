@@ -0,0 +1,270 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _NMEA_LOGGER_H_
+#define _NMEA_LOGGER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "pi_common.h"
+#include "rapidjson/document.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Configuration of the raw NMEA logger
+struct logger_config {
+    /// Whether the sentences are logged
+    bool enabled = false;
+    /// Directory of the segments, the default directory if empty
+    std::string directory;
+    /// Uncompressed size of a block, each block is compressed separately
+    size_t block_bytes = 64 * 1024;
+    /// Maximum age of a block before it is written
+    std::chrono::milliseconds flush_interval { 5000 };
+    /// Compressed size after which a new segment is started
+    size_t segment_bytes = 16 * 1024 * 1024;
+    /// Time span of the sentences after which a new segment is started
+    std::chrono::seconds segment_duration { 3600 };
+    /// Number of the segments kept, 0 to keep all of them
+    size_t segments = 24;
+    /// Number of the blocks waiting for the disk before the new ones are
+    /// dropped
+    size_t queue = 16;
+    /// Compression level (0-9)
+    int level = 6;
+
+    /// @brief Create the configuration from JSON
+    /// @param v JSON object
+    /// @return Configuration, defaults for the missing members
+    static logger_config FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+};
+
+/// Entry of the time index of a segment
+struct log_index_entry {
+    /// Time of the first sentence of the block in milliseconds since the
+    /// epoch
+    int64_t time;
+    /// Offset of the compressed block in the segment
+    uint64_t offset;
+    /// Number of the sentences in the block
+    uint32_t count;
+};
+
+/// Sentence read back from a segment
+struct logged_sentence {
+    /// UTC time the sentence was received in milliseconds since the epoch
+    int64_t time;
+    /// Sentence
+    std::string sentence;
+};
+
+/// Raw NMEA 0183 logger
+///
+/// Every received sentence is appended with its receive time to a block in
+/// memory, which is all the conversion pays for. Full (or old enough)
+/// blocks are handed over to a worker thread that compresses each of them
+/// into a separate gzip member and appends it to the current segment file,
+/// starting a new segment when the current one grows too big or spans too
+/// much time. If the disk can't keep up, the blocks that don't fit in the
+/// queue are dropped and counted instead of stalling the conversion.
+///
+/// A segment is a valid gzip file of lines "<epoch ms> <sentence>\r\n"
+/// (plain text when built without zlib).
+/// Next to it, a text index "<segment>.idx" lists the time of the first
+/// sentence, the offset and the number of the sentences of each block, so
+/// a reader can start decompressing at the block covering the time it
+/// looks for.
+class NMEALogger {
+public:
+    /// @brief Constructor, the logger is started by Configure
+    NMEALogger();
+    ~NMEALogger();
+    NMEALogger(const NMEALogger&) = delete;
+    NMEALogger& operator=(const NMEALogger&) = delete;
+
+    /// @brief Apply a configuration, restarting the logger
+    /// @param cfg Configuration
+    void Configure(const logger_config& cfg);
+    /// @brief Return the configuration
+    /// @return Configuration
+    const logger_config& Config() const { return m_cfg; };
+    /// @brief Set the directory used when the configuration has none
+    /// @param directory Directory, with the trailing separator
+    void SetDefaultDirectory(const std::string& directory);
+    /// @brief Return the directory the segments are written to
+    /// @return Directory
+    std::string Directory() const;
+    /// @brief Return whether the sentences are being logged
+    /// @return true if the worker thread runs
+    bool Running() const { return m_running; };
+    /// @brief Start the worker thread if the logger is enabled
+    void Start();
+    /// @brief Write everything pending and stop the worker thread
+    void Stop();
+    /// @brief Log a received sentence, never blocks on the disk
+    /// @param stc Sentence
+    /// @param time UTC time in milliseconds since the epoch
+    void Log(std::string_view stc, int64_t time);
+    /// @brief Hand the block being built over to the worker thread and wait
+    /// until everything queued is written
+    void Flush();
+
+    /// Number of the sentences accepted
+    uint64_t Logged() const { return m_logged; };
+    /// Number of the sentences written to the disk
+    uint64_t Written() const { return m_written; };
+    /// Number of the sentences dropped because the disk was too slow or
+    /// failed
+    uint64_t Dropped() const { return m_dropped; };
+    /// Number of the failed writes
+    uint64_t Errors() const { return m_errors; };
+    /// Number of the segments started
+    uint64_t Segments() const { return m_segment_count; };
+    /// @brief Return the path of the segment being written
+    /// @return Path, empty if there is none
+    std::string Segment() const;
+
+    /// @brief Return the extension of the segments
+    /// @return ".log.gz", or ".log" when built without zlib
+    static const char* Extension();
+    /// @brief Return the path of the index of a segment
+    /// @param segment Path of the segment
+    /// @return Path of the index
+    static std::string IndexPath(const std::string& segment);
+    /// @brief Read the index of a segment
+    /// @param segment Path of the segment
+    /// @return Entries of the index, empty if there is none
+    static std::vector<log_index_entry> Index(const std::string& segment);
+    /// @brief Read the sentences of a segment received in a time range
+    ///
+    /// Only the blocks that may contain the range are decompressed if the
+    /// segment has an index.
+    /// @param segment Path of the segment
+    /// @param from Start of the range in milliseconds since the epoch
+    /// @param to End of the range (inclusive)
+    /// @return Sentences
+    static std::vector<logged_sentence> Read(const std::string& segment,
+        int64_t from = 0, int64_t to = std::numeric_limits<int64_t>::max());
+
+private:
+    /// Block of the sentences
+    struct block {
+        /// Lines of the sentences
+        std::string data;
+        /// Number of the sentences
+        uint32_t count = 0;
+        /// Time of the first sentence
+        int64_t first = 0;
+        /// Time the first sentence was added
+        std::chrono::steady_clock::time_point started;
+    };
+    /// Compressor state, kept between the blocks
+    struct deflater;
+
+    /// @brief Move the block being built to the queue, the lock must be held
+    void Seal();
+    /// @brief Compress and write a block, called from the worker thread
+    void Write(block& b);
+    /// @brief Start a new segment, called from the worker thread
+    /// @param time Time of the first sentence of the segment
+    bool OpenSegment(int64_t time);
+    /// @brief Close the segment being written
+    void CloseSegment();
+    /// @brief Collect the segments already in the directory, oldest first
+    void ScanSegments();
+    /// @brief Remove the oldest segments above the configured number
+    void PruneSegments();
+    /// @brief Worker thread
+    void Run();
+
+    /// Configuration
+    logger_config m_cfg;
+    /// Directory used when the configuration has none
+    std::string m_default_directory;
+    /// Block being built
+    block m_current;
+    /// Sealed blocks waiting for the worker thread
+    std::deque<block> m_queue;
+    /// Written blocks whose buffers are reused
+    std::vector<std::string> m_spare;
+    /// Lock of the blocks
+    mutable std::mutex m_mutex;
+    /// Signals new blocks to the worker thread
+    std::condition_variable m_cv;
+    /// Signals the written blocks to Flush
+    std::condition_variable m_idle;
+    /// Whether the worker thread is writing a block
+    bool m_busy;
+    /// Request to stop the worker thread
+    bool m_stop;
+    /// Worker thread
+    std::thread m_thread;
+    /// Whether the worker thread runs
+    std::atomic<bool> m_running;
+
+    /// Compressor
+    std::unique_ptr<deflater> m_deflater;
+    /// Segment being written
+    std::ofstream m_segment;
+    /// Index of the segment being written
+    std::ofstream m_index;
+    /// Path of the segment being written
+    std::string m_segment_path;
+    /// Size of the segment being written
+    uint64_t m_segment_size;
+    /// Time of the first sentence of the segment being written
+    int64_t m_segment_start;
+    /// Segments in the directory, including those of the earlier runs,
+    /// oldest first
+    std::deque<std::string> m_segment_paths;
+
+    std::atomic<uint64_t> m_logged;
+    std::atomic<uint64_t> m_written;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_errors;
+    std::atomic<uint64_t> m_segment_count;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_NMEA_LOGGER_H_
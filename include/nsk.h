@@ -28,6 +28,9 @@
 #define _NSK_H_
 
 #include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <set>
 
 #include <marnav/nmea/angle.hpp>
@@ -71,7 +74,25 @@
 
 #include "rapidjson/document.h"
 
+#include "ais.h"
+#include "ais_targets.h"
+#include "clock.h"
+#include "cpa.h"
+#include "derived_wind.h"
+#include "flight_recorder.h"
+#include "magnetic_variation.h"
+#include "metrics.h"
+#include "nmea_framer.h"
+#include "nmea_inputs.h"
+#include "nmea_logger.h"
+#include "path_filters.h"
+#include "time_base.h"
+#include "traffic_stats.h"
+#include "output_sinks.h"
 #include "pi_common.h"
+#include "sk_state.h"
+#include "sk_subscriptions.h"
+#include "source_priorities.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -117,11 +138,23 @@ struct known_sentence {
 };
 
 /// The NMEA0183->SignalK converter
+///
+/// NSK is not thread safe. It is fed from the OpenCPN main thread and, when
+/// inputs are configured, from the thread of the inputs, which processes
+/// each sentence holding Mutex(). Everybody else calling NSK while the
+/// inputs run holds the lock as well. The plugin messages produced on the
+/// thread of the inputs are queued until the main thread calls
+/// DispatchMessages(). The metrics, the traffic statistics
+/// and the flight recorder can be read from any thread without it.
+/// StartInputs(), StopInputs() and LoadConfig() must be called without the
+/// lock, as stopping the inputs waits for the sentence being processed.
 class NSK {
 private:
+    /// Source of the current time
+    std::shared_ptr<Clock> m_clock;
     /// Number of NMEA0183 sentences received
     size_t m_nmea_received;
-    /// Number of SignalK deltas produced
+    /// Number of SignalK deltas published
     size_t m_sk_produced;
     /// Number of exceptions while processing the NMEA0183 messages
     size_t m_nmea_errors;
@@ -139,6 +172,187 @@ private:
     std::set<std::string> m_unknown;
     /// List of sentences we are able to process + flag whether we want to
     std::set<known_sentence> m_known;
+    /// Decoder of the AIS sentences
+    AISDecoder m_ais;
+    /// AIS targets we know about
+    AISTargets m_ais_targets;
+    /// Interval in which the changed AIS targets are sent
+    std::chrono::milliseconds m_ais_flush_interval;
+    /// Time of the last AIS targets flush
+    std::chrono::steady_clock::time_point m_ais_flushed;
+    /// Closest point of approach computation for the AIS targets
+    CPAEngine m_cpa;
+    /// Current state of the own vessel
+    SKState m_state;
+    /// Lock held while the state is updated, the sinks read it from their
+    /// own threads
+    std::mutex m_state_mutex;
+    /// Outputs the deltas are sent to
+    OutputSinks m_sinks;
+    /// Paths the consumers are interested in
+    SKSubscriptions m_subscriptions;
+    /// Preferred sources of the paths
+    SourcePriorities m_priorities;
+    /// True wind derived from the apparent wind
+    DerivedWind m_wind;
+    /// Smoothing filters of the noisy paths
+    PathFilters m_filters;
+    /// Source of the timestamps of the deltas
+    TimeBase m_time;
+    /// Metrics of the conversion
+    PipelineMetrics m_metrics;
+    /// Traffic statistics per talker ID and sentence tag
+    TrafficStats m_traffic;
+    /// Last received sentences and the deltas produced from them
+    FlightRecorder m_recorder;
+    /// Compressed log of the received sentences
+    NMEALogger m_logger;
+    /// Splitter of the raw byte stream into the sentences
+    NMEAFramer m_framer;
+    /// Sentence being processed from the raw byte stream
+    std::string m_framed;
+    /// Magnetic variation model
+    MagneticVariation m_magnetic;
+    /// Magnetic model file configured in the configuration
+    std::string m_magnetic_file;
+    /// Own ship latitude in degrees
+    double m_own_lat;
+    /// Own ship longitude in degrees
+    double m_own_lon;
+    /// Own ship speed over ground in m/s
+    double m_own_sog;
+    /// Own ship course over ground in radians, from the RMC and VTG sentences
+    double m_own_cog;
+    /// Lock serializing the threads feeding NSK
+    std::mutex m_mutex;
+#ifdef __linux__
+    /// NMEA 0183 inputs read by NSK itself, declared last to be stopped
+    /// before anything they use is destroyed
+    NMEAInputs m_inputs;
+#endif
+
+    /// @brief Update the own ship data used by the CPA computation from the
+    /// values produced for an NMEA 0183 sentence
+    /// @param values_array SignalK values array
+    void UpdateOwnShip(const rapidjson::Value& values_array);
+    /// @brief Remember the address field of a sentence that failed to parse
+    ///
+    /// Garbage on the input would grow the list without bound, so only
+    /// a limited number of the distinct addresses is kept.
+    /// @param stc Sentence
+    void AddUnknown(const std::string& stc);
+
+    /// @brief Add a numeric value to the values array if anybody wants it
+    /// @param values_array SignalK values array object reference
+    /// @param allocator Allocator reference
+    /// @param path SignalK path (string literal)
+    /// @param value Value
+    void AddNumber(rapidjson::Value& values_array,
+        rapidjson::Document::AllocatorType& allocator, const char* path,
+        double value);
+    /// @brief Add a string value to the values array if anybody wants it
+    /// @param values_array SignalK values array object reference
+    /// @param allocator Allocator reference
+    /// @param path SignalK path (string literal)
+    /// @param value Value
+    void AddString(rapidjson::Value& values_array,
+        rapidjson::Document::AllocatorType& allocator, const char* path,
+        const std::string& value);
+
+    /// @brief Remove the values for which a preferred source exists
+    /// @param values_array SignalK values array object reference
+    /// @param talker_tag Talker ID and tag of the sentence
+    /// @param tag Tag of the sentence
+    /// @param now Current time
+    void ArbitrateSources(rapidjson::Value& values_array,
+        const std::string& talker_tag, const std::string& tag,
+        std::chrono::steady_clock::time_point now);
+
+    /// @brief Damp the values of the filtered paths
+    ///
+    /// The values are replaced by the damped ones, or the damped ones are
+    /// added to the filtered array if the raw values are to be kept.
+    /// @param values_array SignalK values array
+    /// @param filtered SignalK values array receiving the damped values
+    /// @param allocator Allocator reference
+    /// @param now Current time
+    void FilterValues(rapidjson::Value& values_array,
+        rapidjson::Value& filtered,
+        rapidjson::Document::AllocatorType& allocator,
+        std::chrono::steady_clock::time_point now);
+
+    /// @brief Add the magnetic variation at the own position and the true
+    /// heading and wind direction if the sentence carries only the magnetic
+    /// ones
+    /// @param values_array SignalK values array produced from the sentence
+    /// @param derived SignalK values array receiving the derived values
+    /// @param allocator Allocator reference
+    /// @param now Current time
+    void DeriveMagnetic(const rapidjson::Value& values_array,
+        rapidjson::Value& derived,
+        rapidjson::Document::AllocatorType& allocator,
+        std::chrono::steady_clock::time_point now);
+
+    /// @brief Feed the values to the derived wind computation and add the
+    /// derived values if any input changed
+    /// @param values_array SignalK values array produced from the sentence
+    /// @param derived SignalK values array receiving the derived values
+    /// @param allocator Allocator reference
+    /// @param now Current time
+    void DeriveWind(const rapidjson::Value& values_array,
+        rapidjson::Value& derived,
+        rapidjson::Document::AllocatorType& allocator,
+        std::chrono::steady_clock::time_point now);
+
+    /// @brief Restart the rate counters if the measurement period elapsed and
+    /// count the incoming sentence
+    void CountIncoming();
+    /// @brief Publish the metrics if the last snapshot is old enough
+    /// @param now Current time
+    void PublishMetrics(std::chrono::steady_clock::time_point now);
+    /// @brief Count the delta document and pass it to the consumers
+    /// @param d SignalK delta document, or an array of deltas published one
+    /// by one
+    /// @param outdoc Pointer to a JSON document to which the delta is copied
+    void SendDelta(rapidjson::Document& d, rapidjson::Document* outdoc);
+    /// @brief Serialize a single delta and pass it to the sinks
+    /// @param delta SignalK delta
+    void PublishDelta(const rapidjson::Value& delta);
+    /// @brief Convert the data of an AIS target to SignalK values
+    /// @param slot Slot of the target in the AIS target table
+    /// @param flags Which data of the target changed
+    /// (AISTargets::DIRTY_DYNAMIC, AISTargets::DIRTY_STATIC)
+    /// @param values_array SignalK values array object reference
+    /// @param notifications Values of the own vessel receiving the CPA
+    /// notification of the target
+    /// @param allocator Allocator reference
+    void ProcessAISTarget(uint32_t slot, uint8_t flags,
+        rapidjson::Value& values_array, rapidjson::Value& notifications,
+        rapidjson::Document::AllocatorType& allocator);
+    /// @brief Add the CPA notification of an AIS target to the own vessel
+    /// values
+    /// @param notifications Values of the own vessel
+    /// @param allocator Allocator reference
+    /// @param mmsi MMSI of the target
+    /// @param alarm Whether the alarm is raised or cleared
+    /// @param message Text of the notification
+    void AddCPANotification(rapidjson::Value& notifications,
+        rapidjson::Document::AllocatorType& allocator, uint32_t mmsi,
+        bool alarm, const std::string& message);
+    /// @brief Send the AIS targets changed since the last flush, if the flush
+    /// interval elapsed
+    ///
+    /// All the changed targets are sent together, one delta (and plugin
+    /// message) per target context, followed by a vessels.self delta with
+    /// the CPA notifications
+    /// (notifications.navigation.closestApproach.<urn>). Targets not heard
+    /// from for the expiry time are forgotten, the alarm of a forgotten
+    /// target is cleared by a "normal" notification.
+    /// @param now Current time
+    /// @param outdoc Pointer to a JSON document to which the resulting JSON
+    /// Document is copied
+    void FlushAISTargets(std::chrono::steady_clock::time_point now,
+        rapidjson::Document* outdoc = nullptr);
 
     /// @brief Process the GGA NMEA0183 sentence
     /// @param s sentence pointer
@@ -273,38 +487,89 @@ private:
 
 public:
     /// @brief Constructor
-    NSK()
-        : m_nmea_received(0)
+    /// @param clock Source of the current time, a manual clock replays
+    /// recorded traffic with its original timing as fast as it is fed
+    explicit NSK(std::shared_ptr<Clock> clock = std::make_shared<RealClock>())
+        : m_clock(std::move(clock))
+        , m_nmea_received(0)
         , m_sk_produced(0)
         , m_nmea_errors(0)
         , m_ignored(0)
         , m_nmea_received_total(0)
         , m_sk_produced_total(0)
         , m_unimplemented_count(0)
-        , m_counters_start(std::chrono::system_clock::now()) { };
+        , m_counters_start(m_clock->System())
+        , m_ais_flush_interval(1000)
+        , m_own_lat(std::numeric_limits<double>::quiet_NaN())
+        , m_own_lon(std::numeric_limits<double>::quiet_NaN())
+        , m_own_sog(std::numeric_limits<double>::quiet_NaN())
+        , m_own_cog(std::numeric_limits<double>::quiet_NaN())
+#ifdef __linux__
+        , m_inputs([this](size_t, std::string_view stc) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ProcessFramedSentence(stc);
+        })
+#endif
+    {
+        m_time.SetClock(*m_clock);
+        m_sinks.SetClock(*m_clock);
+        m_sinks.SetState(m_state, m_state_mutex);
+        m_sinks.Add(OutputSinks::Create(sink_config()));
+        // The own ship data are needed for the CPA computation
+        m_subscriptions.Require("navigation.position");
+        m_subscriptions.Require("navigation.speedOverGround");
+        // The apparent wind, heading, course and boat speed are needed for
+        // the true wind
+        m_subscriptions.Require("navigation.headingTrue");
+        m_subscriptions.Require("navigation.courseOverGroundTrue");
+        m_subscriptions.Require("environment.wind.angleApparent");
+        m_subscriptions.Require("environment.wind.speedApparent");
+        m_subscriptions.Require("navigation.speedThroughWater");
+        // The magnetic heading and wind direction are converted to true
+        m_subscriptions.Require("navigation.headingMagnetic");
+        m_subscriptions.Require("environment.wind.directionMagnetic");
+    };
     /// @brief Process NMEA 0183 sentence string
     /// @param stc NMEA 0183 sentence without the trailing "\r\n"
     /// @param outdoc Pointer to a JSON document to which the resulting JSON
     /// Document is copied (usefull for testing)
     void ProcessNMEASentence(
         const std::string& stc, rapidjson::Document* outdoc = nullptr);
+    /// @brief Process NMEA 0183 AIS sentence string (!AIVDM or !AIVDO)
+    ///
+    /// Fragments of multi-sentence messages are collected until the message
+    /// is complete, the delta is produced for the whole message with the
+    /// context of the transmitting vessel.
+    /// @param stc NMEA 0183 sentence without the trailing "\r\n"
+    /// @param outdoc Pointer to a JSON document to which the resulting JSON
+    /// Document is copied (usefull for testing)
+    void ProcessAISSentence(
+        const std::string& stc, rapidjson::Document* outdoc = nullptr);
+    /// @brief Process a piece of a raw NMEA 0183 byte stream
+    ///
+    /// The stream is split into the sentences by the framer, a sentence
+    /// split between two pieces is processed with the piece completing it.
+    /// @param data Bytes received
+    void ProcessData(std::string_view data);
+    /// @brief Process a sentence already framed, NMEA 0183 or AIS by its
+    /// start
+    /// @param stc Sentence without the line end
+    void ProcessFramedSentence(std::string_view stc);
     /// @brief Get the current rate of incoming NMEA sentences
     /// @return Sentences/second
     size_t NMEARate()
     {
-        return 1000.0 * m_nmea_received
-            / std::chrono::duration_cast<std::chrono::milliseconds>(
-                chrono::system_clock::now() - m_counters_start)
-                  .count();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            m_clock->System() - m_counters_start);
+        return ms.count() > 0 ? 1000.0 * m_nmea_received / ms.count() : 0;
     };
     /// @brief Get the current rate of outgoing SignalK deltas
     /// @return Deltas/second
     size_t SKRate()
     {
-        return 1000.0 * m_sk_produced
-            / std::chrono::duration_cast<std::chrono::milliseconds>(
-                chrono::system_clock::now() - m_counters_start)
-                  .count();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            m_clock->System() - m_counters_start);
+        return ms.count() > 0 ? 1000.0 * m_sk_produced / ms.count() : 0;
     };
     /// @brief Return the unimplemented sentences that appeared in the data
     /// stream
@@ -345,6 +610,122 @@ public:
     /// since start
     /// @return Number of sentences
     size_t TotalUnknown() { return m_nmea_errors; };
+    /// @brief Return the AIS target table
+    /// @return Reference to the AIS target table
+    const AISTargets& AISTargetTable() const { return m_ais_targets; };
+    /// @brief Return the output sinks
+    ///
+    /// By default the deltas are sent as NSK_PI_SIGNALK plugin messages, more
+    /// sinks can be configured in the "sinks" array of nsk.json.
+    /// @return Reference to the output sinks
+    OutputSinks& Sinks() { return m_sinks; };
+    /// @brief Return the current state of the own vessel
+    /// @return Reference to the state
+    const SKState& State() const { return m_state; };
+    /// @brief Send the complete current state of the own vessel as a SignalK
+    /// full format document
+    ///
+    /// The document is sent as the NSK_PI_SIGNALK_SNAPSHOT plugin message, so
+    /// that a newly started consumer does not have to wait for all the
+    /// sentences to arrive again.
+    /// @param outdoc Pointer to a JSON document to which the snapshot is
+    /// copied
+    void SendSnapshot(rapidjson::Document* outdoc = nullptr);
+    /// @brief Return the paths the consumers are interested in
+    ///
+    /// By default everything is produced, once a consumer subscribes to some
+    /// paths, the paths nobody subscribed to are skipped.
+    /// @return Reference to the subscriptions
+    SKSubscriptions& Subscriptions() { return m_subscriptions; };
+    /// @brief Apply a subscription request of a consumer
+    ///
+    /// The request uses the format of the SignalK subscription messages with
+    /// the name of the consumer added, eg. {"consumer": "dashboardsk",
+    /// "subscribe": [{"path": "navigation.*"}]}, the unsubscribe requests
+    /// are applied first, {"path": "*"} unsubscribes everything. Every sender
+    /// (named by "consumer", or "sender") has its own set of patterns.
+    /// @param request JSON subscription request
+    void ProcessSubscription(const std::string& request);
+    /// @brief Return the source priorities
+    ///
+    /// For the paths with a priority list only the values from the most
+    /// preferred source heard from recently are emitted.
+    /// @return Reference to the source priorities
+    SourcePriorities& Priorities() { return m_priorities; };
+    /// @brief Return the derived wind computation
+    /// @return Reference to the derived wind computation
+    DerivedWind& Wind() { return m_wind; };
+    /// @brief Return the magnetic variation model
+    ///
+    /// Until the model coefficients are loaded no magnetic variation is
+    /// derived.
+    /// @return Reference to the magnetic variation model
+    MagneticVariation& Magnetic() { return m_magnetic; };
+    /// @brief Return the smoothing filters
+    /// @return Reference to the smoothing filters
+    PathFilters& Filters() { return m_filters; };
+    /// @brief Return the time base of the deltas
+    /// @return Reference to the time base
+    TimeBase& Time() { return m_time; };
+    /// @brief Return the metrics of the conversion
+    ///
+    /// The snapshot of the metrics can be read from any thread without
+    /// blocking the conversion.
+    /// @return Reference to the metrics
+    const PipelineMetrics& Metrics() const { return m_metrics; };
+    /// @brief Return the traffic statistics per talker ID and sentence tag
+    /// @return Reference to the traffic statistics
+    const TrafficStats& Traffic() const { return m_traffic; };
+    /// @brief Return the flight recorder
+    ///
+    /// The records can be dumped from any thread without blocking the
+    /// conversion.
+    /// @return Reference to the flight recorder
+    FlightRecorder& Recorder() { return m_recorder; };
+    /// @brief Return the raw NMEA logger
+    /// @return Reference to the logger
+    NMEALogger& Logger() { return m_logger; };
+    /// @brief Return the lock held while NSK is used from a thread other
+    /// than the one of the inputs
+    /// @return Reference to the lock
+    std::mutex& Mutex() { return m_mutex; };
+    /// @brief Start reading the inputs configured in the "inputs" array of
+    /// nsk.json, their sentences are processed on their own thread
+    void StartInputs();
+    /// @brief Stop reading the inputs, waits for the sentence being
+    /// processed
+    void StopInputs();
+    /// @brief Send the plugin messages produced on the thread of the inputs
+    ///
+    /// OpenCPN and the other plugins may only be called from the main
+    /// thread, which calls this periodically (without the lock) while the
+    /// inputs run.
+    void DispatchMessages() { m_sinks.Dispatch(); };
+#ifdef __linux__
+    /// @brief Return the NMEA 0183 inputs
+    /// @return Reference to the inputs
+    const NMEAInputs& Inputs() const { return m_inputs; };
+#endif
+    /// @brief Return the framer of the raw byte stream
+    /// @return Reference to the framer
+    const NMEAFramer& Framer() const { return m_framer; };
+    /// @brief Return the CPA computation engine
+    /// @return Reference to the CPA engine
+    const CPAEngine& CPA() const { return m_cpa; };
+    /// @brief Set the CPA alarm limits
+    /// @param distance CPA distance in meters below which the alarm is raised
+    /// @param time Maximum time to CPA in seconds for which the alarm is
+    /// raised
+    void SetCPALimits(double distance, double time)
+    {
+        m_cpa.SetLimits(distance, time);
+    };
+    /// @brief Set the interval in which the changed AIS targets are sent
+    /// @param interval Flush interval, zero to send every change immediately
+    void SetAISFlushInterval(std::chrono::milliseconds interval)
+    {
+        m_ais_flush_interval = interval;
+    };
     /// @brief Load configuration from file
     /// @param path Path to the JSON file with configuration
     void LoadConfig(const std::string& path);
@@ -31,12 +31,31 @@
 #include "nsk.h"
 #include "ocpn_plugin.h"
 #include "pi_common.h"
+#include <wx/timer.h>
 
 #define MY_API_VERSION_MAJOR 1
 #define MY_API_VERSION_MINOR 18
 
 PLUGIN_BEGIN_NAMESPACE
 
+/// Timer sending the plugin messages produced on the thread of the inputs
+/// from the main thread
+class NSKDispatchTimer : public wxTimer {
+public:
+    /// Constructor
+    ///
+    /// \param nsk Converter whose messages are sent
+    explicit NSKDispatchTimer(NSK& nsk)
+        : m_nsk(nsk)
+    {
+    }
+
+    void Notify() override { m_nsk.DispatchMessages(); }
+
+private:
+    NSK& m_nsk;
+};
+
 //----------------------------------------------------------------------------------------------------------
 //    The PlugIn Class Definition
 //----------------------------------------------------------------------------------------------------------
@@ -51,6 +70,8 @@ private:
     wxString m_config_file;
 
     NSK m_nsk;
+    /// Sends the messages produced on the thread of the inputs
+    NSKDispatchTimer m_dispatch;
 
     /// Load the configuration from disk
     void LoadConfig();
@@ -21,6 +21,7 @@
 #include <wx/stattext.h>
 #include <wx/string.h>
 #include <wx/textctrl.h>
+#include <wx/timer.h>
 #include <wx/xrc/xmlres.h>
 
 ///////////////////////////////////////////////////////////////////////////
@@ -38,9 +39,12 @@ protected:
     wxStaticText* m_stTotalUnimplemented;
     wxTextCtrl* m_tUnknown;
     wxStaticText* m_stTotalUnknown;
+    wxTextCtrl* m_tStats;
+    wxButton* m_btnDump;
     wxStdDialogButtonSizer* m_sdbSizerButtons;
     wxButton* m_sdbSizerButtonsOK;
     wxButton* m_sdbSizerButtonsCancel;
+    wxTimer m_timerStats;
 
     // Virtual event handlers, override them in your derived class
     virtual void m_sdbSizerButtonsOnCancelButtonClick(wxCommandEvent& event)
@@ -51,12 +55,17 @@ protected:
     {
         event.Skip();
     }
+    virtual void m_btnDumpOnButtonClick(wxCommandEvent& event)
+    {
+        event.Skip();
+    }
+    virtual void m_timerStatsOnTimer(wxTimerEvent& event) { event.Skip(); }
 
 public:
     NSKPreferencesDialog(wxWindow* parent, wxWindowID id = wxID_ANY,
         const wxString& title = wxEmptyString,
         const wxPoint& pos = wxDefaultPosition,
-        const wxSize& size = wxSize(700, 450),
+        const wxSize& size = wxSize(700, 650),
         long style = wxDEFAULT_DIALOG_STYLE);
 
     ~NSKPreferencesDialog();
@@ -33,15 +33,22 @@ PLUGIN_BEGIN_NAMESPACE
 class NSKPreferencesDialogImpl : public NSKPreferencesDialog {
 private:
     NSK* m_nsk;
+    /// Metrics snapshot shown last, the rates are computed against it
+    metrics_snapshot m_previous;
+
+    /// @brief Show the current metrics snapshot
+    void UpdateStatistics();
 
 protected:
     void m_sdbSizerButtonsOnOKButtonClick(wxCommandEvent& event) override;
+    void m_btnDumpOnButtonClick(wxCommandEvent& event) override;
+    void m_timerStatsOnTimer(wxTimerEvent& event) override;
 
 public:
     NSKPreferencesDialogImpl(NSK* nsk, wxWindow* parent,
         wxWindowID id = wxID_ANY, const wxString& title = wxEmptyString,
         const wxPoint& pos = wxDefaultPosition,
-        const wxSize& size = wxSize(700, 450),
+        const wxSize& size = wxSize(700, 650),
         long style = wxDEFAULT_DIALOG_STYLE);
 };
 
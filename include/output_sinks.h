@@ -0,0 +1,525 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _OUTPUT_SINKS_H_
+#define _OUTPUT_SINKS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "clock.h"
+#include "net_compat.h"
+#include "pi_common.h"
+#include "rapidjson/document.h"
+#include "sk_encoding.h"
+#include "sk_state.h"
+#include "sk_subscriptions.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// What a sink does when its queue is full
+enum class sink_policy : uint8_t {
+    /// Drop the oldest queued batch
+    drop_oldest,
+    /// Drop the batch that does not fit in the queue
+    drop_newest,
+    /// Keep merging the new deltas into the batch being built until it
+    /// reaches the byte limit, then drop the newest
+    merge
+};
+
+/// Configuration of an output sink
+struct sink_config {
+    /// Type of the sink (plugin, file, udp, tcp)
+    std::string type = "plugin";
+    /// Encoding of the deltas
+    delta_encoding encoding = delta_encoding::json;
+    /// Maximum number of deltas in a batch
+    size_t batch = 1;
+    /// Maximum age of a batch before it is sent (0 sends immediately)
+    std::chrono::milliseconds interval { 0 };
+    /// Maximum size of a batch in bytes
+    size_t batch_bytes = 65536;
+    /// Maximum number of batches waiting to be written
+    size_t queue = 64;
+    /// Policy applied when the queue is full
+    sink_policy policy = sink_policy::drop_oldest;
+    /// File name of the file sink
+    std::string path;
+    /// Destination (UDP) or listen (TCP) address
+    std::string host;
+    /// Destination (UDP) or listen (TCP) port
+    uint16_t port = 0;
+
+    /// @brief Read the configuration from JSON
+    /// @param v JSON object
+    /// @return Configuration, missing members have the default values
+    static sink_config FromJSON(const rapidjson::Value& v);
+    /// @brief Write the configuration to JSON
+    /// @param allocator Allocator of the target document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+};
+
+/// Base of the output sinks
+///
+/// Deltas already encoded by OutputSinks are collected into batches; sealed
+/// batches are put into a bounded queue drained by a worker thread owned by
+/// the sink, so a slow destination never blocks the conversion. Sinks that
+/// have to deliver on the calling thread (the plugin message bus) write the
+/// sealed batches directly instead.
+///
+/// JSON batches of more than one delta are sent as a JSON array (arrays of
+/// deltas being flattened into it) by the message oriented sinks and as
+/// newline delimited JSON by the stream oriented ones. CBOR batches are
+/// always CBOR sequences (RFC 8742). Sinks working with the structure of the
+/// deltas (the SignalK server) take the delta documents instead, so they
+/// don't have to parse the JSON again.
+///
+/// A sink without worker thread whose destination failed to open retries it
+/// from Push() and Tick() every few seconds.
+class OutputSink {
+public:
+    /// @brief Constructor
+    /// @param cfg Configuration
+    /// @param stream Whether the sink writes a stream (deltas are delimited
+    /// by newlines) rather than messages (batches are JSON arrays)
+    /// @param threaded Whether the batches are written by a worker thread
+    OutputSink(const sink_config& cfg, bool stream, bool threaded);
+    virtual ~OutputSink();
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /// @brief Return the configuration
+    /// @return Configuration
+    const sink_config& Config() const { return m_cfg; };
+    /// @brief Set the clock timing the batches, before Start()
+    /// @param clock Clock, must outlive the sink
+    void SetClock(const Clock& clock) { m_clock = &clock; };
+    /// @brief Share the state of the own vessel with the sink, before Start()
+    /// @param state State, must outlive the sink
+    /// @param mutex Lock held while the state is updated
+    void SetState(const SKState& state, std::mutex& mutex)
+    {
+        m_state = &state;
+        m_state_mutex = &mutex;
+    };
+    /// @brief Return whether the sink takes the delta documents rather than
+    /// the encoded deltas
+    /// @return true if PushDocument() has to be used
+    virtual bool TakesDocuments() const { return false; };
+    /// @brief Add a delta document, for the sinks taking documents
+    /// @param d Delta document, copied by the sink if needed later
+    /// @param now Current time
+    void PushDocument(
+        const rapidjson::Value& d, std::chrono::steady_clock::time_point now);
+    /// @brief Add an encoded delta, never blocks on the destination
+    /// @param data Delta in the encoding of the sink
+    /// @param now Current time
+    void Push(
+        std::string_view data, std::chrono::steady_clock::time_point now);
+    /// @brief Add an encoded delta at the current time of the clock
+    /// @param data Delta in the encoding of the sink
+    void Push(std::string_view data) { Push(data, m_clock->Steady()); };
+    /// @brief Send the batch being built if it is older than the interval
+    /// @param now Current time
+    void Tick(std::chrono::steady_clock::time_point now);
+    /// @brief Send the batch being built if it is older than the interval at
+    /// the current time of the clock
+    void Tick() { Tick(m_clock->Steady()); };
+    /// @brief Pass on the data the sink could only queue on the threads other
+    /// than the main one, called periodically from the main thread
+    virtual void Dispatch() {};
+    /// @brief Start the worker thread
+    void Start();
+    /// @brief Write everything pending and stop the worker thread
+    void Stop();
+
+    /// Number of deltas accepted
+    uint64_t Accepted() const { return m_accepted; };
+    /// Number of deltas written to the destination
+    uint64_t Delivered() const { return m_delivered; };
+    /// Number of batches written to the destination
+    uint64_t Batches() const { return m_batches; };
+    /// Number of deltas dropped because the queue was full
+    uint64_t Dropped() const { return m_dropped; };
+    /// Number of failed writes and attempts to open the destination
+    uint64_t Errors() const { return m_errors; };
+    /// Whether the destination is open
+    bool Opened() const { return m_open; };
+    /// Number of batches waiting to be written
+    size_t QueueDepth() const { return m_depth; };
+    /// @brief Return the path patterns the clients of the sink subscribed to
+    /// if they changed
+    ///
+    /// Sinks that don't know what their clients want ask for everything ("*"),
+    /// so they keep getting all the paths when another consumer filters.
+    /// @param generation Generation of the patterns known to the caller,
+    /// updated to the current one
+    /// @param patterns Receives the patterns, empty if nobody subscribed
+    /// @return true if the patterns changed since the generation
+    virtual bool Interest(
+        uint64_t& generation, std::vector<std::string>& patterns) const;
+
+protected:
+    /// @brief Prepare the destination, called from the worker thread (or from
+    /// Start() for the sinks without one)
+    /// @return false if the destination can't be used
+    virtual bool Open() { return true; };
+    /// @brief Release the destination
+    virtual void Close() {};
+    /// @brief Write a batch to the destination
+    /// @param data Batch
+    /// @return false on error
+    virtual bool Write(const std::string& data) = 0;
+    /// @brief Write a delta document to the destination, called on the
+    /// calling thread of PushDocument()
+    /// @return false on error
+    virtual bool WriteDocument(const rapidjson::Value&) { return false; };
+    /// @brief Called periodically from the worker thread when there is nothing
+    /// to write
+    virtual void Idle() {};
+    /// @brief Return the clock timing the sink
+    /// @return Clock
+    const Clock& SinkClock() const { return *m_clock; };
+    /// @brief Copy the shared state of the own vessel to the document
+    /// @param d Receives the state in the SignalK full format
+    /// @return false if no state is shared with the sink
+    bool Snapshot(rapidjson::Document& d) const;
+
+private:
+    /// Batch of deltas
+    struct batch {
+        /// Encoded data
+        std::string data;
+        /// Number of deltas
+        size_t count = 0;
+        /// Time the first delta was added
+        std::chrono::steady_clock::time_point started;
+    };
+
+    /// @brief Append the delta to the batch being built
+    void Append(std::string_view data);
+    /// @brief Move the batch being built to the queue (or to out for the sinks
+    /// without worker thread), the lock must be held
+    void Seal(batch* out);
+    /// @brief Return whether the queue is full and the merge policy keeps
+    /// the batch being built open, the lock must be held
+    bool Congested() const;
+    /// @brief Write the batch and update the counters
+    void Deliver(batch& b);
+    /// @brief Retry to open the destination of a sink without worker thread
+    /// if it failed and the retry period passed
+    void Reopen(std::chrono::steady_clock::time_point now);
+    /// @brief Worker thread
+    void Run();
+
+    /// Configuration
+    sink_config m_cfg;
+    /// Clock timing the batches
+    const Clock* m_clock;
+    /// Shared state of the own vessel
+    const SKState* m_state;
+    /// Lock of the shared state
+    std::mutex* m_state_mutex;
+    /// Whether the sink writes a stream
+    bool m_stream;
+    /// Whether the sink has a worker thread
+    bool m_threaded;
+    /// Batch being built
+    batch m_current;
+    /// Sealed batches waiting for the worker thread
+    std::deque<batch> m_queue;
+    /// Lock of the batch and the queue
+    std::mutex m_mutex;
+    /// Signals new batches to the worker
+    std::condition_variable m_cv;
+    /// Worker thread
+    std::thread m_thread;
+    /// Request to stop the worker thread (the sink is stopped for the sinks
+    /// without one)
+    bool m_stop;
+    /// Whether Open() succeeded
+    std::atomic<bool> m_open;
+    /// Time of the last attempt to open the destination
+    std::chrono::steady_clock::time_point m_opened;
+
+    std::atomic<uint64_t> m_accepted;
+    std::atomic<uint64_t> m_delivered;
+    std::atomic<uint64_t> m_batches;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_errors;
+    std::atomic<size_t> m_depth;
+};
+
+/// Sink sending the deltas as OpenCPN plugin messages (always JSON)
+///
+/// The consumers of the message expect a single delta in it, batches of more
+/// than one delta are sent as arrays in the message with the "_BATCH" suffix.
+///
+/// OpenCPN passes the messages straight to the other plugins, whose handlers
+/// run GUI code, so they are only sent from the thread that created the sink
+/// (the main thread). The batches written on the other threads (the thread
+/// of the NSK inputs) are queued until the main thread calls Dispatch().
+class PluginMessageSink : public OutputSink {
+public:
+    /// @brief Constructor
+    /// @param cfg Configuration
+    /// @param message_id ID of the plugin message
+    explicit PluginMessageSink(
+        const sink_config& cfg, std::string message_id = "NSK_PI_SIGNALK");
+    ~PluginMessageSink() override;
+
+    /// @brief The plugins subscribe themselves (NSK::ProcessSubscription), so
+    /// the sink has no interest of its own
+    bool Interest(uint64_t& generation,
+        std::vector<std::string>& patterns) const override;
+    /// @brief Send the messages queued by the other threads, on the thread
+    /// that created the sink only
+    void Dispatch() override;
+
+protected:
+    bool Write(const std::string& data) override;
+
+private:
+    /// ID of the plugin message
+    std::string m_message_id;
+    /// ID of the plugin message carrying the batches
+    std::string m_batch_id;
+    /// Thread allowed to send the messages
+    std::thread::id m_owner;
+    /// Messages written on the other threads (ID, body)
+    std::deque<std::pair<const std::string*, std::string>> m_pending;
+    /// Lock of the queued messages
+    std::mutex m_pending_mutex;
+};
+
+/// Sink passing the batches to a function, used for embedding and testing
+class CallbackSink : public OutputSink {
+public:
+    /// Function receiving the batches, returns false on error
+    typedef std::function<bool(const std::string&)> callback;
+
+    /// @brief Constructor
+    /// @param cfg Configuration
+    /// @param cb Function receiving the batches
+    /// @param threaded Whether the function is called from a worker thread
+    /// @param stream Whether the deltas are delimited by newlines
+    CallbackSink(const sink_config& cfg, callback cb, bool threaded = false,
+        bool stream = false);
+    ~CallbackSink() override;
+
+protected:
+    bool Write(const std::string& data) override;
+
+private:
+    /// Function receiving the batches
+    callback m_cb;
+};
+
+/// Sink appending the deltas to a file (newline delimited JSON or a CBOR
+/// sequence)
+class FileSink : public OutputSink {
+public:
+    /// @brief Constructor
+    /// @param cfg Configuration
+    explicit FileSink(const sink_config& cfg);
+    ~FileSink() override;
+
+protected:
+    bool Open() override;
+    void Close() override;
+    bool Write(const std::string& data) override;
+
+private:
+    /// Output file
+    std::ofstream m_file;
+};
+
+/// Sink sending each batch as a UDP datagram
+class UdpSink : public OutputSink {
+public:
+    /// @brief Constructor
+    /// @param cfg Configuration
+    explicit UdpSink(const sink_config& cfg);
+    ~UdpSink() override;
+
+protected:
+    bool Open() override;
+    void Close() override;
+    bool Write(const std::string& data) override;
+
+private:
+    /// Socket
+    socket_t m_socket;
+    /// Destination address
+    sockaddr_storage m_addr;
+    /// Length of the destination address
+    socklen_t m_addr_len;
+};
+
+/// Sink streaming the deltas to all the clients connected to a TCP port (the
+/// SignalK TCP delta stream)
+class TcpSink : public OutputSink {
+public:
+    /// @brief Constructor
+    /// @param cfg Configuration
+    explicit TcpSink(const sink_config& cfg);
+    ~TcpSink() override;
+    /// @brief Return the number of connected clients
+    /// @return Number of clients
+    size_t Clients() const { return m_client_count; };
+    /// @brief Return the port the sink listens on
+    /// @return Port (useful when configured with port 0)
+    uint16_t Port() const { return m_port; };
+
+protected:
+    bool Open() override;
+    void Close() override;
+    bool Write(const std::string& data) override;
+    void Idle() override;
+
+private:
+    /// Connected client
+    struct client {
+        /// Socket
+        socket_t socket;
+        /// Data not yet accepted by the socket
+        std::string pending;
+    };
+
+    /// @brief Accept the waiting connections
+    void Accept();
+    /// @brief Send as much of the pending data to the client as possible
+    /// @return false if the client has to be disconnected
+    bool Flush(client& c);
+
+    /// Listening socket
+    socket_t m_listen;
+    /// Connected clients
+    std::vector<client> m_clients;
+    /// Number of connected clients
+    std::atomic<size_t> m_client_count;
+    /// Port the sink listens on
+    std::atomic<uint16_t> m_port;
+};
+
+/// The set of the configured output sinks
+///
+/// Each delta is encoded once per encoding used by any of the sinks and the
+/// same data are passed to all of them.
+class OutputSinks {
+public:
+    OutputSinks() = default;
+    ~OutputSinks();
+
+    /// @brief Create a sink from its configuration
+    /// @param cfg Configuration
+    /// @return The sink or nullptr if the type is not known
+    static std::unique_ptr<OutputSink> Create(const sink_config& cfg);
+    /// @brief Set the clock of the sinks added from now on
+    /// @param clock Clock, must outlive the sinks
+    void SetClock(const Clock& clock) { m_clock = &clock; };
+    /// @brief Share the state of the own vessel with the sinks added from now
+    /// on
+    /// @param state State, must outlive the sinks
+    /// @param mutex Lock held while the state is updated
+    void SetState(const SKState& state, std::mutex& mutex)
+    {
+        m_state = &state;
+        m_state_mutex = &mutex;
+    };
+    /// @brief Add a sink and start it
+    /// @param sink Sink
+    /// @return Pointer to the added sink
+    OutputSink* Add(std::unique_ptr<OutputSink> sink);
+    /// @brief Stop and remove all the sinks
+    void Clear();
+    /// @brief Pass a delta to all the sinks
+    /// @param d Delta document
+    /// @param json The delta already serialized to JSON
+    /// @param now Current time
+    void Publish(const rapidjson::Value& d, std::string_view json,
+        std::chrono::steady_clock::time_point now);
+    /// @brief Pass a delta to all the sinks at the current time of the clock
+    /// @param d Delta document
+    /// @param json The delta already serialized to JSON
+    void Publish(const rapidjson::Value& d, std::string_view json)
+    {
+        Publish(d, json, m_clock->Steady());
+    };
+    /// @brief Send the batches older than their interval
+    /// @param now Current time
+    void Tick(std::chrono::steady_clock::time_point now);
+    /// @brief Send the batches older than their interval at the current time
+    /// of the clock
+    void Tick() { Tick(m_clock->Steady()); };
+    /// @brief Let the sinks pass on the data queued for the main thread,
+    /// called periodically from the main thread
+    void Dispatch();
+    /// @brief Pass the path patterns the clients of the sinks subscribed to
+    /// to the subscriptions, each sink being a consumer named "sink.<index>"
+    /// @param subscriptions Subscriptions to update
+    void UpdateSubscriptions(SKSubscriptions& subscriptions);
+    /// @brief Return the sinks
+    /// @return Vector of the sinks
+    const std::vector<std::unique_ptr<OutputSink>>& Sinks() const
+    {
+        return m_sinks;
+    };
+
+private:
+    /// Clock of the sinks
+    const Clock* m_clock = &Clock::Real();
+    /// Shared state of the own vessel
+    const SKState* m_state = nullptr;
+    /// Lock of the shared state
+    std::mutex* m_state_mutex = nullptr;
+    /// Sinks
+    std::vector<std::unique_ptr<OutputSink>> m_sinks;
+    /// Generations of the subscriptions of the sinks
+    std::vector<uint64_t> m_generations;
+    /// Number of sinks reported to the subscriptions
+    size_t m_reported = 0;
+    /// Encoder of the binary deltas
+    DeltaEncoder m_encoder;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_OUTPUT_SINKS_H_
@@ -0,0 +1,157 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _PATH_FILTERS_H_
+#define _PATH_FILTERS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pi_common.h"
+#include "rapidjson/document.h"
+#include "sk_paths.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Type of the smoothing filter
+enum class filter_type {
+    /// No filtering
+    NONE,
+    /// Exponential moving average
+    EMA,
+    /// Exponential moving average of the unit vector of an angle
+    CIRCULAR,
+    /// Kalman filter with a random walk process model
+    KALMAN
+};
+
+/// Configuration of the filter of a path
+struct filter_config {
+    /// Type of the filter
+    filter_type type = filter_type::NONE;
+    /// Time constant of the moving averages in seconds
+    double time_constant = 2.0;
+    /// Variance of the change of the value per second (Kalman)
+    double process_noise = 0.01;
+    /// Variance of the measurement (Kalman)
+    double measurement_noise = 0.1;
+    /// The value is an angle in radians (implied by CIRCULAR and by the
+    /// angular paths NSK produces)
+    bool angle = false;
+    /// The angle is signed, in (-PI, PI] instead of [0, 2 * PI) (implied by
+    /// the signed angular paths such as the apparent wind angle)
+    bool signed_angle = false;
+    /// Keep the raw value and emit the damped one in addition
+    bool raw = false;
+
+    /// @brief Load the configuration
+    /// @param v JSON object
+    /// @return Configuration
+    static filter_config FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+};
+
+/// Smoothing filters of the numeric paths
+///
+/// The moving averages weigh the samples by the time elapsed since the
+/// previous one, so the damping does not depend on the rate at which the
+/// sensor talks. The angles are averaged as unit vectors and the Kalman
+/// innovation is wrapped, so the values crossing north or dead ahead do not
+/// swing around the circle.
+///
+/// The state is a fixed size record per path identifier.
+class PathFilters {
+public:
+    PathFilters();
+
+    /// @brief Set the filter of the path
+    /// @param path SignalK path
+    /// @param config Filter configuration, filter_type::NONE to stop
+    /// filtering the path
+    void Set(const std::string& path, const filter_config& config);
+    /// @brief Remove all the filters
+    void Clear();
+    /// @brief Return whether any filter is configured
+    /// @return true if no path is filtered
+    bool Empty() const { return m_configured == 0; };
+    /// @brief Return the filter configuration of the path
+    /// @param path Identifier of the path
+    /// @return Configuration (type filter_type::NONE if not filtered)
+    const filter_config& Config(sk_path_id path) const;
+    /// @brief Filter a value
+    /// @param path Identifier of the path
+    /// @param value Raw value
+    /// @param now Time of the sample
+    /// @return Damped value, the raw value if the path is not filtered
+    double Apply(sk_path_id path, double value,
+        std::chrono::steady_clock::time_point now);
+    /// @brief Return the number of values filtered
+    /// @return Number of values
+    uint64_t Filtered() const { return m_filtered; };
+    /// @brief Load the configuration
+    /// @param v JSON object {"paths": {path: {filter configuration}}}
+    void FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+
+private:
+    /// Filter state of a path
+    struct record {
+        /// Configuration
+        filter_config config;
+        /// Estimate (moving average, Kalman state)
+        double x = 0.0;
+        /// Averaged sine and cosine of an angle
+        double s = 0.0;
+        double c = 0.0;
+        /// Variance of the Kalman estimate
+        double p = 0.0;
+        /// Time of the previous sample
+        std::chrono::steady_clock::time_point last;
+        /// The state holds a sample
+        bool initialized = false;
+    };
+
+    /// Filter state indexed by path identifier
+    std::vector<record> m_records;
+    /// Number of filtered paths
+    size_t m_configured;
+    /// Number of values filtered
+    uint64_t m_filtered;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_PATH_FILTERS_H_
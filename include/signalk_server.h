@@ -0,0 +1,240 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SIGNALK_SERVER_H_
+#define _SIGNALK_SERVER_H_
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "event_loop.h"
+#include "output_sinks.h"
+#include "pi_common.h"
+#include "rapidjson/document.h"
+#include "sk_paths.h"
+#include "sk_subscriptions.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Embedded SignalK server
+///
+/// Serves the SignalK discovery document (/signalk), full state snapshots
+/// (/signalk/v1/api/...) and the WebSocket delta stream (/signalk/v1/stream)
+/// supporting the subscribe and unsubscribe messages with per-client path
+/// filters and update periods. Everything runs on a single thread driven by
+/// an epoll event loop; the conversion thread only queues a copy of the delta
+/// document. Each delta is framed once, clients subscribed to everything
+/// receive the same frame, filtered clients get deltas assembled from the
+/// values serialized once per update. The REST API serves the state shared
+/// with the sink (SetState()), the server keeps no copy of its own.
+class SignalKServer : public OutputSink {
+public:
+    /// @brief Constructor
+    /// @param cfg Configuration (host, port, queue)
+    explicit SignalKServer(const sink_config& cfg);
+    ~SignalKServer() override;
+
+    /// @brief Return the number of connected WebSocket clients
+    /// @return Number of clients
+    size_t Clients() const { return m_ws_clients; };
+    /// @brief Return the port the server listens on
+    /// @return Port (useful when configured with port 0)
+    uint16_t Port() const { return m_port; };
+    /// @brief Return the number of frames not sent to slow clients
+    /// @return Number of frames
+    uint64_t ClientDrops() const { return m_client_drops; };
+    bool Interest(uint64_t& generation,
+        std::vector<std::string>& patterns) const override;
+    bool TakesDocuments() const override { return true; };
+
+protected:
+    bool Open() override;
+    void Close() override;
+    /// @brief Queue a delta pushed already serialized, it is parsed on the
+    /// calling thread
+    bool Write(const std::string& data) override;
+    bool WriteDocument(const rapidjson::Value& d) override;
+
+private:
+    /// Subscription of a client
+    struct subscription {
+        /// Context pattern
+        std::string context;
+        /// Path pattern
+        std::string path;
+        /// Update period (0 sends every change immediately)
+        std::chrono::milliseconds period;
+        /// Time the changed values are due to be sent
+        std::chrono::steady_clock::time_point due;
+    };
+
+    /// Latest value of a path with the data of its update
+    struct item {
+        /// Serialized {"path":...,"value":...} object
+        std::string value;
+        /// Serialized source of the update
+        std::shared_ptr<const std::string> source;
+        /// Timestamp of the update
+        std::string timestamp;
+    };
+
+    /// Connection of a client
+    struct client {
+        /// Socket
+        int fd;
+        /// Whether the HTTP connection was upgraded to WebSocket
+        bool websocket = false;
+        /// Close the connection once the output is written
+        bool close_after_write = false;
+        /// The connection failed and has to be closed
+        bool broken = false;
+        /// Whether the socket is polled for writability
+        bool want_out = false;
+        /// Received data not processed yet
+        std::string in;
+        /// Data waiting to be sent
+        std::string out;
+        /// Fragmented WebSocket message being assembled
+        std::string message;
+        /// Opcode of the fragmented message
+        uint8_t message_opcode = 0;
+        /// Subscriptions
+        std::vector<subscription> subs;
+        /// Whether the client receives every self delta as is
+        bool all = false;
+        /// Index of the subscription matching the self path (-1 none, -2
+        /// not evaluated yet) indexed by path identifier
+        std::vector<int16_t> match;
+        /// Self paths changed since the last periodic update
+        std::vector<sk_path_id> dirty;
+        /// Whether the path is in the dirty list
+        std::vector<uint8_t> is_dirty;
+    };
+
+    /// @brief Server thread
+    void Run();
+    /// @brief Accept the waiting connections
+    void Accept();
+    /// @brief Handle the events of a client socket
+    void OnClient(int fd, uint32_t events);
+    /// @brief Close the connection of a client
+    void Drop(int fd);
+    /// @brief Close the connections marked as broken
+    void Sweep();
+    /// @brief Process the received HTTP request
+    /// @return false if the connection has to be closed
+    bool HandleHttp(client& c);
+    /// @brief Process the received WebSocket frames
+    /// @return false if the connection has to be closed
+    bool HandleFrames(client& c);
+    /// @brief Process a message received from the client
+    void HandleMessage(client& c, const std::string& msg);
+    /// @brief Queue data for the client and try to send them
+    /// @param c Client
+    /// @param data Data
+    /// @param droppable Whether the data may be dropped if the client is slow
+    void Send(client& c, std::string_view data, bool droppable = true);
+    /// @brief Send as much of the pending output as the socket accepts
+    /// @return false if the connection has to be closed
+    bool Flush(client& c);
+    /// @brief Queue the delta for the server thread
+    /// @return false if the inbox is full
+    bool Queue(rapidjson::Document&& d);
+    /// @brief Process the deltas queued by the conversion thread
+    void ProcessInbox();
+    /// @brief Distribute a delta to the clients
+    void Distribute(const rapidjson::Value& delta);
+    /// @brief Send the periodic updates which are due
+    /// @return Time until the next periodic update is due
+    std::chrono::milliseconds SendPeriodic(
+        std::chrono::steady_clock::time_point now);
+    /// @brief Return the index of the subscription of the client matching
+    /// the path
+    int Match(client& c, std::string_view context, sk_path_id id);
+    /// @brief Return the index of the subscription of the client matching
+    /// a path which is not registered (without caching the result)
+    static int Match(
+        const client& c, std::string_view context, std::string_view path);
+    /// @brief Recompute the derived subscription data of the client
+    void SubscriptionsChanged(client& c);
+    /// @brief Recompute the union of the path patterns of all the clients
+    void InterestChanged();
+    /// @brief Build the delta with the given values
+    /// @param context Context of the delta
+    /// @param items Values, consecutive values from the same update are
+    /// grouped together
+    /// @return Serialized delta
+    static std::string BuildDelta(
+        std::string_view context, const std::vector<const item*>& items);
+    /// @brief Return the SignalK hello message
+    std::string Hello() const;
+
+    /// Deltas from the conversion thread
+    std::deque<rapidjson::Document> m_inbox;
+    /// Lock of the inbox
+    std::mutex m_inbox_mutex;
+    /// Event loop
+    std::unique_ptr<EventLoop> m_loop;
+    /// Server thread
+    std::thread m_thread;
+    /// Request to stop the server thread
+    std::atomic<bool> m_stop;
+    /// Listening socket
+    int m_listen;
+    /// Connected clients
+    std::unordered_map<int, std::unique_ptr<client>> m_clients;
+    /// Latest values of the self paths indexed by path identifier
+    std::vector<item> m_latest;
+    /// Number of WebSocket clients
+    std::atomic<size_t> m_ws_clients;
+    /// Port the server listens on
+    std::atomic<uint16_t> m_port;
+    /// Frames not sent to slow clients
+    std::atomic<uint64_t> m_client_drops;
+    /// Path patterns subscribed by the clients
+    std::vector<std::string> m_interest;
+    /// Generation of the path patterns
+    std::atomic<uint64_t> m_interest_generation;
+    /// Lock of the path patterns
+    mutable std::mutex m_interest_mutex;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif // __linux__
+
+#endif //_SIGNALK_SERVER_H_
@@ -0,0 +1,126 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SK_ENCODING_H_
+#define _SK_ENCODING_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pi_common.h"
+#include "rapidjson/document.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Wire encoding of the SignalK deltas
+enum class delta_encoding : uint8_t {
+    /// JSON text
+    json,
+    /// CBOR (RFC 8949) with the repeated strings shared using the stringref
+    /// extension (tags 256 and 25)
+    cbor
+};
+
+/// @brief Return the encoding with the given name
+/// @param name Name of the encoding ("json" or "cbor")
+/// @param def Encoding returned for unknown names
+/// @return Encoding
+delta_encoding DeltaEncodingFromName(
+    std::string_view name, delta_encoding def = delta_encoding::json);
+/// @brief Return the name of the encoding
+/// @param enc Encoding
+/// @return Name of the encoding
+const char* DeltaEncodingName(delta_encoding enc);
+
+/// Encoder of the SignalK documents
+///
+/// The binary encoding carries exactly the same structure as the JSON form.
+/// Numbers are stored as raw IEEE 754 values (single precision when it is
+/// lossless) and the strings occurring repeatedly in the document (paths,
+/// member names, sources) are only stored once. The output buffer and the
+/// string table are reused between the calls, so in the steady state encoding
+/// does not allocate.
+class DeltaEncoder {
+public:
+    DeltaEncoder() = default;
+
+    /// @brief Encode the document
+    /// @param v JSON value to encode
+    /// @param enc Encoding to use
+    /// @return Reference to the encoded data, valid until the next call
+    const std::string& Encode(const rapidjson::Value& v, delta_encoding enc);
+
+private:
+    /// @brief Write the CBOR major type with the argument
+    void Head(uint8_t major, uint64_t arg);
+    /// @brief Write the CBOR encoding of a string
+    void String(const char* s, size_t len);
+    /// @brief Write the CBOR encoding of a value
+    void Cbor(const rapidjson::Value& v);
+
+    /// Encoded data
+    std::string m_out;
+    /// Strings shared in the stringref namespace of the current document
+    std::vector<std::string_view> m_strings;
+    /// Open addressing hash index of m_strings (index + 1, 0 marks empty
+    /// slots)
+    std::vector<uint32_t> m_index;
+};
+
+/// Decoder of the SignalK documents produced by DeltaEncoder
+class DeltaDecoder {
+public:
+    DeltaDecoder() = default;
+
+    /// @brief Decode the data into a JSON document
+    /// @param data Encoded data
+    /// @param len Length of the data
+    /// @param enc Encoding of the data
+    /// @param doc Document to fill
+    /// @return true if the data were decoded successfully
+    bool Decode(const char* data, size_t len, delta_encoding enc,
+        rapidjson::Document& doc);
+
+private:
+    /// @brief Read the CBOR major type and argument
+    bool Head(uint8_t& major, uint8_t& info, uint64_t& arg);
+    /// @brief Read a CBOR value
+    bool Cbor(rapidjson::Value& v, rapidjson::Document::AllocatorType& allocator,
+        int depth);
+
+    /// Current read position
+    const uint8_t* m_pos = nullptr;
+    /// End of the data
+    const uint8_t* m_end = nullptr;
+    /// Strings shared in the stringref namespace of the current document
+    std::vector<std::string_view> m_strings;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_SK_ENCODING_H_
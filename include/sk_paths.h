@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SK_PATHS_H_
+#define _SK_PATHS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Numeric identifier of a SignalK path
+typedef uint16_t sk_path_id;
+
+/// Registry assigning small dense numeric identifiers to the SignalK paths
+///
+/// The identifiers are process wide and never change once assigned, so they
+/// can be used as indexes into flat per-path arrays (state, subscriptions,
+/// source arbitration, filters...). The registry has a fixed capacity, the
+/// number of distinct paths NSK produces is well below it. The paths naming
+/// another vessel (the CPA notifications of the AIS targets,
+/// notifications.navigation.closestApproach.urn:mrn:imo:mmsi:<MMSI>) are
+/// never registered, like the data of the AIS targets they are not kept in
+/// any per-path array.
+///
+/// The lookups never lock: a slot of the hash table and a name are written
+/// once, before the identifier is published in the slot, and never change
+/// afterwards. Only the registration of a new path takes the lock.
+class SKPaths {
+public:
+    /// Maximum number of paths
+    static constexpr size_t MAX_PATHS = 1024;
+    /// Identifier returned for paths that are not known
+    static constexpr sk_path_id NONE = UINT16_MAX;
+
+    /// @brief Return the identifier of the path, registering it if needed
+    /// @param path SignalK path
+    /// @return Identifier of the path or NONE if the registry is full or the
+    /// path names another vessel
+    static sk_path_id Id(std::string_view path);
+    /// @brief Return the identifier of an already registered path
+    /// @param path SignalK path
+    /// @return Identifier of the path or NONE if the path is not registered
+    static sk_path_id Find(std::string_view path);
+    /// @brief Return the name of the path
+    /// @param id Identifier of the path
+    /// @return SignalK path (empty string for unknown identifiers)
+    static const std::string& Name(sk_path_id id);
+    /// @brief Return the number of registered paths
+    /// @return Number of paths, all the identifiers are lower than this
+    static size_t Count();
+
+private:
+    SKPaths();
+    /// @brief Return the single registry instance
+    static SKPaths& Instance();
+    /// @brief Find the slot of the path in the hash table
+    /// @param path SignalK path
+    /// @param hash Hash of the path
+    /// @return Index of the slot containing the path or the empty slot where
+    /// it belongs
+    size_t Slot(std::string_view path, size_t hash) const;
+    /// @brief Return the identifier of the path without locking
+    /// @param path SignalK path
+    /// @param hash Hash of the path
+    /// @return Identifier of the path or NONE if the path is not registered
+    sk_path_id Lookup(std::string_view path, size_t hash) const;
+
+    /// Size of the hash table (twice the capacity, power of two)
+    static constexpr size_t TABLE_SIZE = 2 * MAX_PATHS;
+
+    /// Names of the paths indexed by identifier
+    std::array<std::string, MAX_PATHS> m_names;
+    /// Open addressing hash table of identifiers
+    std::array<std::atomic<sk_path_id>, TABLE_SIZE> m_table;
+    /// Number of registered paths
+    std::atomic<size_t> m_count;
+    /// Lock serializing the registrations
+    mutable std::mutex m_mutex;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_SK_PATHS_H_
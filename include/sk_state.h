@@ -0,0 +1,164 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SK_STATE_H_
+#define _SK_STATE_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pi_common.h"
+#include "rapidjson/document.h"
+#include "sk_paths.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Type of the value stored in the state
+enum class sk_value_type : uint8_t {
+    /// No value has been received for the path
+    none,
+    /// JSON null
+    null,
+    /// Number
+    number,
+    /// Boolean
+    boolean,
+    /// String
+    string,
+    /// Position object (latitude, longitude and optional altitude)
+    position,
+    /// Any other JSON object or array, stored serialized
+    json
+};
+
+/// Source of the values as referenced by the $source property
+struct sk_source {
+    /// Label of the source (NSK)
+    std::string label;
+    /// NMEA 0183 talker ID
+    std::string talker;
+    /// Type of the source (NMEA0183)
+    std::string type;
+    /// Reference used in the $source property (label.talker)
+    std::string ref;
+};
+
+/// Current value of a SignalK path
+struct sk_value {
+    /// Type of the value
+    sk_value_type type = sk_value_type::none;
+    /// Numeric or boolean value, latitude of a position
+    double number = 0.0;
+    /// Longitude of a position
+    double longitude = 0.0;
+    /// Altitude of a position (NaN if not present)
+    double altitude = 0.0;
+    /// String value or serialized JSON of objects and arrays
+    std::string text;
+    /// ISO 8601 timestamp of the update carrying the value
+    std::array<char, 32> timestamp {};
+    /// Index of the source in the state's source table
+    uint16_t source = 0;
+};
+
+/// Current state of the own vessel maintained from the produced deltas
+///
+/// The values are stored in a flat array indexed by the path identifier, so
+/// updating them does not involve any lookups in a tree. The complete SignalK
+/// full format document is only built when requested.
+class SKState {
+public:
+    SKState() = default;
+
+    /// @brief Apply a delta (or an array of deltas) to the state
+    ///
+    /// Only the deltas without context or with the vessels.self context are
+    /// applied, data of the other vessels are ignored.
+    /// @param delta SignalK delta
+    void Update(const rapidjson::Value& delta);
+    /// @brief Set the value of a path
+    /// @param id Identifier of the path
+    /// @param value JSON value
+    /// @param timestamp ISO 8601 timestamp
+    /// @param source Index of the source as returned by SourceId()
+    void SetValue(sk_path_id id, const rapidjson::Value& value,
+        std::string_view timestamp, uint16_t source);
+    /// @brief Return the index of the source, adding it if it is not known
+    /// @param label Label of the source
+    /// @param talker Talker ID
+    /// @param type Type of the source
+    /// @return Index of the source
+    uint16_t SourceId(
+        std::string_view label, std::string_view talker, std::string_view type);
+    /// @brief Return the current value of a path
+    /// @param id Identifier of the path
+    /// @return Pointer to the value or nullptr if no value has been received
+    const sk_value* Get(sk_path_id id) const;
+    /// @brief Return the current value of a path
+    /// @param path SignalK path
+    /// @return Pointer to the value or nullptr if no value has been received
+    const sk_value* Get(std::string_view path) const
+    {
+        return Get(SKPaths::Find(path));
+    };
+    /// @brief Return the source
+    /// @param idx Index of the source
+    /// @return Source
+    const sk_source& Source(uint16_t idx) const { return m_sources[idx]; };
+    /// @brief Return the number of paths with a value
+    /// @return Number of paths
+    size_t Size() const { return m_present.size(); };
+    /// @brief Forget all the values
+    void Clear();
+    /// @brief Render the complete state as a SignalK full format document
+    /// @param doc Document to fill
+    void Snapshot(rapidjson::Document& doc) const;
+    /// @brief Render the complete state as a serialized SignalK full format
+    /// document
+    /// @return JSON string
+    std::string Snapshot() const;
+    /// @brief Convert the stored value to JSON
+    /// @param v Stored value
+    /// @param allocator Allocator of the target document
+    /// @return JSON value
+    static rapidjson::Value ToJSON(
+        const sk_value& v, rapidjson::Document::AllocatorType& allocator);
+
+private:
+    /// Values indexed by the path identifier
+    std::vector<sk_value> m_values;
+    /// Identifiers of the paths with a value in the order of arrival
+    std::vector<sk_path_id> m_present;
+    /// Known sources
+    std::vector<sk_source> m_sources;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_SK_STATE_H_
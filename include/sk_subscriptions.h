@@ -0,0 +1,154 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SK_SUBSCRIPTIONS_H_
+#define _SK_SUBSCRIPTIONS_H_
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pi_common.h"
+#include "sk_paths.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// @brief Match a SignalK path or context against a subscription pattern
+///
+/// The '*' wildcard matches any sequence of characters, a pattern without
+/// a wildcard also matches all the paths below it.
+/// @param pattern Pattern
+/// @param s Path or context
+/// @return true if the pattern matches
+bool SKPatternMatch(std::string_view pattern, std::string_view s);
+
+/// Paths the consumers of the deltas are interested in
+///
+/// Every consumer (a plugin, an output sink serving its own clients...)
+/// registers the path patterns it wants under its name. As long as nobody
+/// registered anything, or somebody asked for "*", all the paths are
+/// produced. Otherwise only the paths matching a pattern of any consumer (or
+/// needed by NSK itself) are, the rest is skipped before any JSON is built.
+///
+/// The patterns are evaluated once per path identifier, the result is kept
+/// in a bitset, so the check done for every value is a couple of bit tests.
+class SKSubscriptions {
+public:
+    SKSubscriptions();
+
+    /// @brief Replace the patterns of the consumer
+    /// @param consumer Name of the consumer
+    /// @param patterns Path patterns, empty to remove the consumer
+    void Set(const std::string& consumer,
+        const std::vector<std::string>& patterns);
+    /// @brief Add a pattern of the consumer
+    /// @param consumer Name of the consumer
+    /// @param pattern Path pattern
+    void Subscribe(const std::string& consumer, const std::string& pattern);
+    /// @brief Remove a pattern of the consumer
+    /// @param consumer Name of the consumer
+    /// @param pattern Path pattern, "*" removes all the patterns
+    void Unsubscribe(const std::string& consumer, const std::string& pattern);
+    /// @brief Add a pattern that is always produced, for the data NSK needs
+    /// itself, without leaving the produce everything mode
+    /// @param pattern Path pattern
+    void Require(const std::string& pattern);
+    /// @brief Return whether all the paths are produced
+    /// @return true if nobody restricted the paths
+    bool Everything() const { return m_everything; };
+    /// @brief Return the consumers and their patterns
+    /// @return Map of the patterns by consumer name
+    const std::map<std::string, std::vector<std::string>>& Consumers() const
+    {
+        return m_consumers;
+    };
+
+    /// @brief Return whether the path is wanted by any consumer
+    /// @param id Identifier of the path
+    /// @return true if the path has to be produced
+    bool Wanted(sk_path_id id)
+    {
+        if (m_everything || id >= SKPaths::MAX_PATHS) {
+            return true;
+        }
+        const bool wanted = m_resolved[id] ? m_wanted[id] : Resolve(id);
+        m_skipped += !wanted;
+        return wanted;
+    };
+    /// @brief Return whether the path is wanted by any consumer
+    ///
+    /// The identifiers are cached by the address of the string, so the path
+    /// has to be a string literal (or another string that never changes
+    /// during the life of the object).
+    /// @param path SignalK path
+    /// @return true if the path has to be produced
+    bool Wanted(const char* path)
+    {
+        return m_everything || Wanted(LiteralId(path));
+    };
+    /// @brief Return the number of values skipped because nobody wanted them
+    /// @return Number of values
+    uint64_t Skipped() const { return m_skipped; };
+
+private:
+    /// @brief Evaluate the patterns for the path and remember the result
+    /// @param id Identifier of the path
+    /// @return true if the path is wanted
+    bool Resolve(sk_path_id id);
+    /// @brief Return the identifier of a string literal path
+    /// @param path SignalK path
+    /// @return Identifier of the path
+    sk_path_id LiteralId(const char* path);
+    /// @brief Recompute the mode and forget the evaluated paths after the
+    /// patterns changed
+    void Changed();
+
+    /// Size of the string literal identifier cache (power of two)
+    static constexpr size_t LITERALS = 512;
+
+    /// Patterns by consumer name
+    std::map<std::string, std::vector<std::string>> m_consumers;
+    /// Patterns needed by NSK itself
+    std::vector<std::string> m_required;
+    /// Whether all the paths are produced
+    bool m_everything;
+    /// Paths for which the patterns have been evaluated
+    std::bitset<SKPaths::MAX_PATHS> m_resolved;
+    /// Paths wanted by any consumer
+    std::bitset<SKPaths::MAX_PATHS> m_wanted;
+    /// Open addressing cache of the identifiers of string literal paths
+    std::array<std::pair<const char*, sk_path_id>, LITERALS> m_literals;
+    /// Number of values skipped
+    uint64_t m_skipped;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_SK_SUBSCRIPTIONS_H_
@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SOURCE_PRIORITIES_H_
+#define _SOURCE_PRIORITIES_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pi_common.h"
+#include "rapidjson/document.h"
+#include "sk_paths.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Arbitration between the sources producing the same path
+///
+/// For the configured paths only the values from the most preferred source
+/// heard from recently are let through. The sources are identified by the
+/// talker ID and sentence tag (eg. "HCHDT") or by the tag alone ("HDT"),
+/// sources not listed rank below all the listed ones. When the current
+/// source does not produce the path for the timeout, any other source takes
+/// over until a better one appears again.
+///
+/// The state is a fixed size record per path identifier, deciding about
+/// a value is a lookup in the record and a scan of its short source list.
+class SourcePriorities {
+public:
+    /// Maximum number of sources listed for a path
+    static constexpr size_t MAX_SOURCES = 8;
+
+    SourcePriorities();
+
+    /// @brief Set the priority list of the path
+    /// @param path SignalK path
+    /// @param sources Sources in the order of preference, empty to stop
+    /// arbitrating the path (only the first MAX_SOURCES are used)
+    void Set(const std::string& path, const std::vector<std::string>& sources);
+    /// @brief Remove all the priority lists
+    void Clear();
+    /// @brief Return whether any priority list is configured
+    /// @return true if no path is arbitrated
+    bool Empty() const { return m_configured == 0; };
+    /// @brief Set the time after which a silent source loses the path
+    /// @param timeout Timeout
+    void SetTimeout(std::chrono::milliseconds timeout)
+    {
+        m_timeout = timeout;
+    };
+    /// @brief Return the time after which a silent source loses the path
+    /// @return Timeout
+    std::chrono::milliseconds Timeout() const { return m_timeout; };
+    /// @brief Return the identifier of a source name
+    /// @param name Talker ID and tag or tag alone
+    /// @return Identifier or NONE if the name is not used by any priority
+    /// list
+    uint16_t Source(std::string_view name) const;
+    /// @brief Decide whether the value of the path from the source is used
+    /// @param path Identifier of the path
+    /// @param talker_tag Identifier of the talker ID and tag of the source
+    /// @param tag Identifier of the tag of the source
+    /// @param now Current time
+    /// @return true if the value has to be emitted
+    bool Accept(sk_path_id path, uint16_t talker_tag, uint16_t tag,
+        std::chrono::steady_clock::time_point now);
+    /// @brief Return the number of values suppressed
+    /// @return Number of values
+    uint64_t Suppressed() const { return m_suppressed; };
+    /// @brief Load the configuration
+    /// @param v JSON object {"timeout": seconds, "paths": {path: [sources]}}
+    void FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+
+    /// Identifier of an unknown source
+    static constexpr uint16_t NONE = UINT16_MAX;
+
+private:
+    /// Arbitration state of a path
+    struct record {
+        /// Sources in the order of preference
+        std::array<uint16_t, MAX_SOURCES> sources;
+        /// Number of sources, 0 if the path is not arbitrated
+        uint8_t count = 0;
+        /// Rank of the source currently winning, count for an unlisted one
+        uint8_t winner = UINT8_MAX;
+        /// Last time the winning source produced the path
+        std::chrono::steady_clock::time_point seen;
+    };
+
+    /// Arbitration state indexed by path identifier
+    std::vector<record> m_records;
+    /// Names of the sources indexed by identifier
+    std::vector<std::string> m_sources;
+    /// Number of arbitrated paths
+    size_t m_configured;
+    /// Time after which a silent source loses the path
+    std::chrono::milliseconds m_timeout;
+    /// Number of values suppressed
+    uint64_t m_suppressed;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_SOURCE_PRIORITIES_H_
@@ -0,0 +1,141 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _TIME_BASE_H_
+#define _TIME_BASE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "clock.h"
+#include "pi_common.h"
+#include "rapidjson/document.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Source of the timestamps of the deltas
+enum class time_mode {
+    /// Wall clock of the computer
+    SYSTEM,
+    /// GNSS time carried by the sentences, advanced by the monotonic clock
+    /// between them, the wall clock until the first one arrives
+    LIVE,
+    /// Time of the last GNSS sentence as is, for replaying logs
+    REPLAY
+};
+
+/// Time base of the deltas
+///
+/// Locks onto the UTC time carried by the RMC, ZDA and GGA sentences and
+/// keeps the offset between it and the monotonic clock. The small
+/// differences caused by the latency of the sentences are smoothed, a step
+/// of more than a second relocks. The stamps never go backwards while
+/// locked.
+///
+/// The formatted stamp is cached per second, so stamping a delta is
+/// a subtraction and writing the milliseconds.
+class TimeBase {
+public:
+    TimeBase();
+
+    /// @brief Set the clock the wall clock time is read from
+    /// @param clock Clock, must outlive the time base
+    void SetClock(const Clock& clock);
+    /// @brief Set the source of the timestamps
+    /// @param mode Mode
+    void SetMode(time_mode mode);
+    /// @brief Return the source of the timestamps
+    /// @return Mode
+    time_mode Mode() const { return m_mode; };
+    /// @brief Return whether the GNSS time is known
+    /// @return true if locked onto the GNSS time
+    bool Locked() const { return m_locked; };
+    /// @brief Synchronize to the full UTC time from a sentence
+    /// @param year Year (two digit years are in this century)
+    /// @param month Month 1-12
+    /// @param day Day of the month 1-31
+    /// @param ms_of_day Milliseconds since midnight
+    /// @param now Time the sentence was received
+    void Sync(int year, int month, int day, int64_t ms_of_day,
+        std::chrono::steady_clock::time_point now);
+    /// @brief Synchronize to the time of the day from a sentence without the
+    /// date, the date is the one closest to the current estimate
+    /// @param ms_of_day Milliseconds since midnight
+    /// @param now Time the sentence was received
+    void SyncTimeOfDay(
+        int64_t ms_of_day, std::chrono::steady_clock::time_point now);
+    /// @brief Return the current time
+    /// @param now Current monotonic time
+    /// @return Milliseconds since the Unix epoch
+    int64_t Now(std::chrono::steady_clock::time_point now);
+    /// @brief Return the current time as an ISO 8601 UTC string
+    /// @param now Current monotonic time
+    /// @return Timestamp (eg. 2026-10-19T10:00:00.250Z), valid until the
+    /// next call
+    const std::string& Stamp(std::chrono::steady_clock::time_point now);
+    /// @brief Load the configuration
+    /// @param v JSON object {"mode": "system" | "live" | "replay"}
+    void FromJSON(const rapidjson::Value& v);
+    /// @brief Save the configuration
+    /// @param allocator Allocator of the document
+    /// @return JSON object
+    rapidjson::Value ToJSON(
+        rapidjson::Document::AllocatorType& allocator) const;
+
+    /// @brief Return the number of days since the Unix epoch
+    /// @param year Year
+    /// @param month Month 1-12
+    /// @param day Day of the month 1-31
+    /// @return Days
+    static int64_t DaysFromCivil(int year, int month, int day);
+    /// @brief Format a time as an ISO 8601 UTC string
+    /// @param ms Milliseconds since the Unix epoch
+    /// @return Timestamp
+    static std::string Format(int64_t ms);
+
+private:
+    /// @brief Apply the GNSS time
+    void Apply(int64_t gnss, std::chrono::steady_clock::time_point now);
+
+    const Clock* m_clock;
+    time_mode m_mode;
+    bool m_locked;
+    /// GNSS time minus the monotonic clock in milliseconds
+    int64_t m_offset;
+    /// Last GNSS time received
+    int64_t m_gnss;
+    /// Last time returned
+    int64_t m_last;
+    /// Second of the cached stamp
+    int64_t m_stamp_second;
+    /// Cached stamp
+    std::string m_stamp;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_TIME_BASE_H_
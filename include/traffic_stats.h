@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _TRAFFIC_STATS_H_
+#define _TRAFFIC_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include "metrics.h"
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/// Traffic statistics of one talker ID and sentence tag
+struct traffic_entry {
+    /// Talker ID and tag (eg. "GPGGA"), empty for an unused entry
+    char name[8];
+    /// Number of the sentences received
+    uint64_t count;
+    /// Number of the sentences that failed to parse
+    uint64_t errors;
+    /// Number of the SignalK values produced
+    uint64_t values;
+    /// Monotonic time the last sentence was received in milliseconds
+    int64_t last_seen;
+    /// Mean time between the sentences in seconds
+    double interval;
+    /// Mean deviation of the time between the sentences from the mean in
+    /// seconds
+    double jitter;
+
+    /// @brief Return the current rate
+    /// @param now Monotonic time in milliseconds
+    /// @return Sentences per second, decaying when the talker goes silent
+    double Rate(int64_t now) const;
+};
+
+/// Traffic statistics of all the talkers at one point in time
+struct traffic_snapshot {
+    /// Maximum number of the distinct talker ID and tag pairs
+    static constexpr size_t CAPACITY = 64;
+
+    /// Monotonic time the snapshot was taken in milliseconds
+    int64_t taken;
+    /// Number of the used entries
+    uint64_t size;
+    /// Sentences not counted because the table was full
+    uint64_t overflow;
+    /// Entries in the order of the first appearance
+    std::array<traffic_entry, CAPACITY> entries;
+};
+
+/// Traffic statistics per talker ID and sentence tag
+///
+/// The entries are kept in a fixed table and found by a small open
+/// addressing index, counting a sentence is a hash of its first few
+/// characters and a few arithmetic operations. The mean and jitter of the
+/// inter-arrival time are exponential moving averages (with the gain of 1/16
+/// as for the RTP interarrival jitter), so the state does not grow.
+class TrafficStats {
+public:
+    /// Identifier of a sentence that was not counted
+    static constexpr size_t NONE = SIZE_MAX;
+
+    TrafficStats();
+
+    /// @brief Count a received sentence
+    /// @param stc NMEA 0183 sentence
+    /// @param now Time the sentence was received
+    /// @return Identifier of the entry, NONE if the sentence was not counted
+    size_t Sentence(
+        std::string_view stc, std::chrono::steady_clock::time_point now);
+    /// @brief Count a sentence that failed to parse
+    /// @param id Identifier returned by Sentence
+    void Error(size_t id);
+    /// @brief Count the values produced from a sentence
+    /// @param id Identifier returned by Sentence
+    /// @param values Number of the values
+    void Values(size_t id, size_t values);
+    /// @brief Return the private table
+    /// @return Reference to the table
+    const traffic_snapshot& Live() const { return m_live; };
+    /// @brief Publish the private table
+    /// @param now Current time
+    void Publish(std::chrono::steady_clock::time_point now);
+    /// @brief Return the last published table, callable from any thread
+    /// @return Snapshot
+    traffic_snapshot Snapshot() const { return m_snapshot.Load(); };
+
+private:
+    /// Size of the index (power of two)
+    static constexpr size_t INDEX_SIZE = 2 * traffic_snapshot::CAPACITY;
+
+    traffic_snapshot m_live;
+    /// Packed names of the entries
+    std::array<uint64_t, traffic_snapshot::CAPACITY> m_keys;
+    /// Entry of each index slot, NONE for an empty one
+    std::array<uint8_t, INDEX_SIZE> m_index;
+    Seqlock<traffic_snapshot> m_snapshot;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif //_TRAFFIC_STATS_H_
@@ -0,0 +1,484 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "ais.h"
+#include "byte_scan.h"
+
+#include <algorithm>
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// Marker of a character not allowed in the armored payload
+constexpr uint8_t INVALID_ARMOR = 0xFF;
+
+/// Lookup table translating the payload armoring characters to 6-bit values
+constexpr std::array<uint8_t, 256> ARMOR_TABLE = [] {
+    std::array<uint8_t, 256> t {};
+    for (size_t c = 0; c < t.size(); ++c) {
+        if (c >= '0' && c <= 'W') {
+            t[c] = static_cast<uint8_t>(c - '0');
+        } else if (c >= '`' && c <= 'w') {
+            t[c] = static_cast<uint8_t>(c - '`' + 40);
+        } else {
+            t[c] = INVALID_ARMOR;
+        }
+    }
+    return t;
+}();
+
+/// The AIS 6-bit ASCII character set
+constexpr char SIXBIT_ASCII[]
+    = "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_ !\"#$%&'()*+,-./0123456789:;<=>?";
+
+/// Minimal payload lengths of the supported message types
+constexpr size_t MIN_BITS_POSITION = 168;
+constexpr size_t MIN_BITS_STATIC = 420;
+constexpr size_t MIN_BITS_EXTENDED = 312;
+constexpr size_t MIN_BITS_STATIC_B = 160;
+
+/// @brief Read unsigned integer from the bit buffer
+/// @param bits Buffer
+/// @param nbits Number of valid bits in the buffer
+/// @param start Index of the first bit of the field
+/// @param len Length of the field in bits (max. 32)
+/// @return The value, 0 if the field is not entirely in the buffer
+uint32_t GetUInt(const uint8_t* bits, size_t nbits, size_t start, size_t len)
+{
+    if (len == 0 || start + len > nbits) {
+        return 0;
+    }
+    const size_t end = start + len;
+    const size_t first = start / 8;
+    const size_t last = (end - 1) / 8;
+    uint64_t v = 0;
+    for (size_t i = first; i <= last; ++i) {
+        v = (v << 8) | bits[i];
+    }
+    v >>= (last - first + 1) * 8 - (start % 8) - len;
+    return static_cast<uint32_t>(v & ((uint64_t(1) << len) - 1));
+}
+
+/// @brief Read two's complement signed integer from the bit buffer
+/// @param bits Buffer
+/// @param nbits Number of valid bits in the buffer
+/// @param start Index of the first bit of the field
+/// @param len Length of the field in bits (max. 32)
+/// @return The value, 0 if the field is not entirely in the buffer
+int32_t GetInt(const uint8_t* bits, size_t nbits, size_t start, size_t len)
+{
+    const uint32_t v = GetUInt(bits, nbits, start, len);
+    const uint32_t sign = uint32_t(1) << (len - 1);
+    return static_cast<int32_t>((v ^ sign) - sign);
+}
+
+/// @brief Read 6-bit ASCII text from the bit buffer, trimming the "@" padding
+/// and trailing spaces
+/// @param bits Buffer
+/// @param nbits Number of valid bits in the buffer
+/// @param start Index of the first bit of the field
+/// @param chars Number of characters in the field
+/// @param out Output array
+template <size_t N>
+void GetText(const uint8_t* bits, size_t nbits, size_t start, size_t chars,
+    std::array<char, N>& out)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < chars && len < N - 1; ++i) {
+        if (start + (i + 1) * 6 > nbits) {
+            break;
+        }
+        const char c = SIXBIT_ASCII[GetUInt(bits, nbits, start + i * 6, 6)];
+        if (c == '@') {
+            break;
+        }
+        out[len++] = c;
+    }
+    while (len > 0 && out[len - 1] == ' ') {
+        --len;
+    }
+    out[len] = '\0';
+}
+
+/// @brief Parse small unsigned decimal number
+/// @param s String to parse
+/// @param value Parsed value
+/// @return false if the string is empty or contains anything but digits
+bool ParseNumber(std::string_view s, unsigned& value)
+{
+    if (s.empty() || s.size() > 2) {
+        return false;
+    }
+    value = 0;
+    for (auto c : s) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+/// @brief Parse a hexadecimal digit
+/// @param c Character
+/// @return Value of the digit or -1 if invalid
+int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+}
+
+bool AISDecoder::Dearmor(
+    fragment_slot& slot, std::string_view payload, unsigned fill)
+{
+    if (slot.nbits + payload.size() * 6 > AIS_MAX_PAYLOAD_BITS) {
+        return false;
+    }
+    // Continue filling the partially used byte, if any
+    size_t pos = slot.nbits / 8;
+    unsigned accbits = slot.nbits % 8;
+    uint32_t acc = accbits ? (slot.bits[pos] >> (8 - accbits)) : 0;
+    for (auto c : payload) {
+        const uint8_t v = ARMOR_TABLE[static_cast<uint8_t>(c)];
+        if (v == INVALID_ARMOR) {
+            return false;
+        }
+        acc = (acc << 6) | v;
+        accbits += 6;
+        if (accbits >= 8) {
+            accbits -= 8;
+            slot.bits[pos++] = static_cast<uint8_t>(acc >> accbits);
+        }
+    }
+    if (accbits) {
+        slot.bits[pos] = static_cast<uint8_t>(acc << (8 - accbits));
+    }
+    slot.nbits += payload.size() * 6;
+    if (fill > slot.nbits || fill > 5) {
+        return false;
+    }
+    slot.nbits -= fill;
+    return true;
+}
+
+ais_result AISDecoder::DecodePayload(const fragment_slot& slot)
+{
+    const uint8_t* b = slot.bits.data();
+    const size_t n = slot.nbits;
+    m_msg = ais_message();
+    m_msg.type = static_cast<uint8_t>(GetUInt(b, n, 0, 6));
+    m_msg.mmsi = GetUInt(b, n, 8, 30);
+
+    switch (m_msg.type) {
+    case 1:
+    case 2:
+    case 3:
+        if (n < MIN_BITS_POSITION) {
+            return ais_result::error;
+        }
+        m_msg.has_position_report = true;
+        m_msg.nav_status = static_cast<uint8_t>(GetUInt(b, n, 38, 4));
+        m_msg.rot = static_cast<int8_t>(GetInt(b, n, 42, 8));
+        m_msg.sog = static_cast<uint16_t>(GetUInt(b, n, 50, 10));
+        m_msg.lon = GetInt(b, n, 61, 28);
+        m_msg.lat = GetInt(b, n, 89, 27);
+        m_msg.cog = static_cast<uint16_t>(GetUInt(b, n, 116, 12));
+        m_msg.heading = static_cast<uint16_t>(GetUInt(b, n, 128, 9));
+        break;
+    case 5:
+        if (n < MIN_BITS_STATIC) {
+            return ais_result::error;
+        }
+        m_msg.has_static_data = true;
+        m_msg.imo = GetUInt(b, n, 40, 30);
+        GetText(b, n, 70, 7, m_msg.callsign);
+        GetText(b, n, 112, 20, m_msg.name);
+        m_msg.ship_type = static_cast<uint8_t>(GetUInt(b, n, 232, 8));
+        m_msg.to_bow = static_cast<uint16_t>(GetUInt(b, n, 240, 9));
+        m_msg.to_stern = static_cast<uint16_t>(GetUInt(b, n, 249, 9));
+        m_msg.to_port = static_cast<uint8_t>(GetUInt(b, n, 258, 6));
+        m_msg.to_starboard = static_cast<uint8_t>(GetUInt(b, n, 264, 6));
+        m_msg.draught = static_cast<uint8_t>(GetUInt(b, n, 294, 8));
+        GetText(b, n, 302, 20, m_msg.destination);
+        break;
+    case 18:
+    case 19:
+        if (n < (m_msg.type == 18 ? MIN_BITS_POSITION : MIN_BITS_EXTENDED)) {
+            return ais_result::error;
+        }
+        m_msg.ais_class = 'B';
+        m_msg.has_position_report = true;
+        m_msg.sog = static_cast<uint16_t>(GetUInt(b, n, 46, 10));
+        m_msg.lon = GetInt(b, n, 57, 28);
+        m_msg.lat = GetInt(b, n, 85, 27);
+        m_msg.cog = static_cast<uint16_t>(GetUInt(b, n, 112, 12));
+        m_msg.heading = static_cast<uint16_t>(GetUInt(b, n, 124, 9));
+        if (m_msg.type == 19) {
+            m_msg.has_static_data = true;
+            GetText(b, n, 143, 20, m_msg.name);
+            m_msg.ship_type = static_cast<uint8_t>(GetUInt(b, n, 263, 8));
+            m_msg.to_bow = static_cast<uint16_t>(GetUInt(b, n, 271, 9));
+            m_msg.to_stern = static_cast<uint16_t>(GetUInt(b, n, 280, 9));
+            m_msg.to_port = static_cast<uint8_t>(GetUInt(b, n, 289, 6));
+            m_msg.to_starboard = static_cast<uint8_t>(GetUInt(b, n, 295, 6));
+        }
+        break;
+    case 24:
+        if (n < MIN_BITS_STATIC_B) {
+            return ais_result::error;
+        }
+        m_msg.ais_class = 'B';
+        m_msg.has_static_data = true;
+        m_msg.part = static_cast<uint8_t>(GetUInt(b, n, 38, 2));
+        if (m_msg.part == 0) {
+            GetText(b, n, 40, 20, m_msg.name);
+        } else if (m_msg.part == 1) {
+            m_msg.ship_type = static_cast<uint8_t>(GetUInt(b, n, 40, 8));
+            GetText(b, n, 90, 7, m_msg.callsign);
+            // Auxiliary craft (MMSI 98XXXYYYY) carry the mothership MMSI
+            // instead of the dimensions
+            if (m_msg.mmsi / 10000000 != 98) {
+                m_msg.to_bow = static_cast<uint16_t>(GetUInt(b, n, 132, 9));
+                m_msg.to_stern = static_cast<uint16_t>(GetUInt(b, n, 141, 9));
+                m_msg.to_port = static_cast<uint8_t>(GetUInt(b, n, 150, 6));
+                m_msg.to_starboard
+                    = static_cast<uint8_t>(GetUInt(b, n, 156, 6));
+            }
+        } else {
+            return ais_result::error;
+        }
+        break;
+    default:
+        ++m_unsupported;
+        return ais_result::unsupported;
+    }
+    ++m_decoded;
+    return ais_result::decoded;
+}
+
+AISDecoder::fragment_slot* AISDecoder::FindSlot(char seq_id, char channel)
+{
+    for (auto& slot : m_slots) {
+        if (slot.in_use && slot.seq_id == seq_id && slot.channel == channel) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+AISDecoder::fragment_slot& AISDecoder::AllocateSlot()
+{
+    fragment_slot* oldest = &m_slots[0];
+    for (auto& slot : m_slots) {
+        if (!slot.in_use) {
+            return slot;
+        }
+        if (slot.started < oldest->started) {
+            oldest = &slot;
+        }
+    }
+    m_dropped += oldest->next - 1;
+    oldest->in_use = false;
+    return *oldest;
+}
+
+ais_result AISDecoder::Decode(
+    std::string_view sentence, std::chrono::steady_clock::time_point now)
+{
+    for (auto& slot : m_slots) {
+        if (slot.in_use && now - slot.started > m_timeout) {
+            m_dropped += slot.next - 1;
+            slot.in_use = false;
+        }
+    }
+
+    // !AIVDM,<total>,<num>,<seq_id>,<channel>,<payload>,<fill>*hh
+    const auto star = sentence.rfind('*');
+    if (sentence.size() < 7 || sentence[0] != '!' || star == sentence.npos
+        || star + 3 > sentence.size() || sentence.substr(3, 2) != "VD"
+        || (sentence[5] != 'M' && sentence[5] != 'O')) {
+        ++m_errors;
+        return ais_result::error;
+    }
+    const uint8_t checksum = ByteScan::Checksum(sentence.substr(1, star - 1));
+    const int hi = HexDigit(sentence[star + 1]);
+    const int lo = HexDigit(sentence[star + 2]);
+    if (hi < 0 || lo < 0 || checksum != ((hi << 4) | lo)) {
+        ++m_errors;
+        return ais_result::error;
+    }
+
+    std::array<std::string_view, 7> fields;
+    std::array<uint32_t, 7> separators;
+    const std::string_view body = sentence.substr(0, star);
+    const size_t nseparators
+        = ByteScan::Separators(body, separators.data(), separators.size());
+    const size_t nfields = std::min(nseparators + 1, fields.size());
+    size_t start = 0;
+    for (size_t i = 0; i < nfields; ++i) {
+        const size_t end = i < nseparators ? separators[i] : body.size();
+        fields[i] = body.substr(start, end - start);
+        start = end + 1;
+    }
+    unsigned total;
+    unsigned num;
+    unsigned fill = 0;
+    if (nfields != fields.size() || !ParseNumber(fields[1], total)
+        || !ParseNumber(fields[2], num) || num == 0 || num > total
+        || fields[3].size() > 1 || fields[4].size() > 1
+        || (!fields[6].empty() && !ParseNumber(fields[6], fill))) {
+        ++m_errors;
+        return ais_result::error;
+    }
+    const char seq_id = fields[3].empty() ? 0 : fields[3][0];
+    const char channel = fields[4].empty() ? 0 : fields[4][0];
+    const bool own = sentence[5] == 'O';
+
+    ais_result result;
+    if (total == 1) {
+        m_single.nbits = 0;
+        if (!Dearmor(m_single, fields[5], fill)) {
+            ++m_errors;
+            return ais_result::error;
+        }
+        result = DecodePayload(m_single);
+    } else {
+        fragment_slot* slot = FindSlot(seq_id, channel);
+        if (num == 1) {
+            if (slot != nullptr) {
+                // The previous message with the same ID was never finished
+                m_dropped += slot->next - 1;
+            } else {
+                slot = &AllocateSlot();
+            }
+            slot->in_use = true;
+            slot->seq_id = seq_id;
+            slot->channel = channel;
+            slot->total = static_cast<uint8_t>(total);
+            slot->next = 1;
+            slot->started = now;
+            slot->nbits = 0;
+        } else if (slot == nullptr || slot->next != num
+            || slot->total != total) {
+            if (slot != nullptr) {
+                m_dropped += slot->next - 1;
+                slot->in_use = false;
+            }
+            ++m_dropped;
+            return ais_result::error;
+        }
+        if (!Dearmor(*slot, fields[5], num == total ? fill : 0)) {
+            slot->in_use = false;
+            ++m_errors;
+            return ais_result::error;
+        }
+        ++slot->next;
+        if (num < total) {
+            return ais_result::incomplete;
+        }
+        slot->in_use = false;
+        result = DecodePayload(*slot);
+    }
+    if (result == ais_result::error) {
+        ++m_errors;
+    }
+    m_msg.own = own;
+    return result;
+}
+
+const char* AISShipTypeName(uint8_t type)
+{
+    switch (type) {
+    case 30:
+        return "Fishing";
+    case 31:
+    case 32:
+        return "Towing";
+    case 33:
+        return "Dredging";
+    case 34:
+        return "Diving";
+    case 35:
+        return "Military";
+    case 36:
+        return "Sailing";
+    case 37:
+        return "Pleasure";
+    case 50:
+        return "Pilot vessel";
+    case 51:
+        return "SAR";
+    case 52:
+        return "Tug";
+    case 53:
+        return "Port tender";
+    case 54:
+        return "Anti-pollution";
+    case 55:
+        return "Law enforcement";
+    case 58:
+        return "Medical";
+    default:
+        break;
+    }
+    switch (type / 10) {
+    case 2:
+        return "Wing In Ground";
+    case 4:
+        return "High speed craft";
+    case 6:
+        return "Passenger";
+    case 7:
+        return "Cargo";
+    case 8:
+        return "Tanker";
+    case 9:
+        return "Other";
+    default:
+        return nullptr;
+    }
+}
+
+const char* AISNavState(uint8_t status)
+{
+    static const char* states[] = { "motoring", "anchored", "not under command",
+        "restricted manouverability", "constrained by draft", "moored",
+        "aground", "fishing", "sailing", "hazardous material high speed",
+        "hazardous material wing in ground", nullptr, nullptr, nullptr,
+        "ais-sart", nullptr };
+    return status < ARRAY_SIZE(states) ? states[status] : nullptr;
+}
+
+PLUGIN_END_NAMESPACE
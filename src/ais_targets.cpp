@@ -0,0 +1,445 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "ais_targets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// Number of buckets of the expiry timer wheel (Power of 2)
+constexpr uint32_t WHEEL_SIZE = 64;
+/// Meters per degree of latitude
+constexpr double METERS_PER_DEGREE = 60.0 * 1852.0;
+/// Value of the unknown data
+constexpr double UNKNOWN = std::numeric_limits<double>::quiet_NaN();
+
+/// @brief Smallest power of 2 not less than the value
+/// @param v Value
+/// @return The power of 2
+size_t Pow2(size_t v)
+{
+    size_t p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/// @brief Hash an integer key
+/// @param key Key
+/// @return Hash
+uint32_t Hash(uint32_t key) { return (key * 2654435761u) ^ (key >> 16); }
+}
+
+AISTargets::AISTargets(size_t capacity,
+    std::chrono::steady_clock::duration expiry, double cell_size)
+    : m_size(0)
+    , m_overflows(0)
+    , m_cell_size(cell_size)
+    , m_expiry(expiry)
+    , m_wheel_tick(INT64_MIN)
+{
+    m_mmsi.assign(capacity, 0);
+    m_class.assign(capacity, 'A');
+    m_lat.assign(capacity, UNKNOWN);
+    m_lon.assign(capacity, UNKNOWN);
+    m_sog.assign(capacity, UNKNOWN);
+    m_cog.assign(capacity, UNKNOWN);
+    m_heading.assign(capacity, UNKNOWN);
+    m_rot.assign(capacity, UNKNOWN);
+    m_nav_status.assign(capacity, 15);
+    m_dirty.assign(capacity, 0);
+    m_seen.assign(capacity, std::chrono::steady_clock::time_point());
+    m_static.assign(capacity, ais_static_data());
+    m_dirty_list.reserve(2 * capacity);
+    m_free.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i) {
+        m_free.push_back(static_cast<uint32_t>(i - 1));
+    }
+    m_index.assign(Pow2(2 * capacity), { 0, 0 });
+    m_cell.assign(capacity, NONE);
+    m_cell_next.assign(capacity, NONE);
+    m_cell_prev.assign(capacity, NONE);
+    m_buckets.assign(Pow2(std::max<size_t>(capacity, 256)), NONE);
+    m_tick = std::max<std::chrono::steady_clock::duration>(
+        m_expiry / WHEEL_SIZE, std::chrono::milliseconds(1));
+    m_expires.assign(capacity, 0);
+    m_wheel_next.assign(capacity, NONE);
+    m_wheel_prev.assign(capacity, NONE);
+    m_wheel.assign(WHEEL_SIZE, NONE);
+}
+
+void AISTargets::SetExpiry(std::chrono::steady_clock::duration expiry)
+{
+    m_expiry = expiry;
+    m_tick = std::max<std::chrono::steady_clock::duration>(
+        m_expiry / WHEEL_SIZE, std::chrono::milliseconds(1));
+    std::fill(m_wheel.begin(), m_wheel.end(), NONE);
+    std::fill(m_wheel_next.begin(), m_wheel_next.end(), NONE);
+    std::fill(m_wheel_prev.begin(), m_wheel_prev.end(), NONE);
+    m_wheel_tick = INT64_MIN;
+    for (uint32_t slot = 0; slot < m_mmsi.size(); ++slot) {
+        if (Active(slot)) {
+            WheelPlace(slot, m_seen[slot]);
+        }
+    }
+}
+
+int64_t AISTargets::Tick(std::chrono::steady_clock::time_point t) const
+{
+    return t.time_since_epoch() / m_tick;
+}
+
+uint32_t AISTargets::Find(uint32_t mmsi) const
+{
+    const size_t mask = m_index.size() - 1;
+    for (size_t i = Hash(mmsi) & mask;; i = (i + 1) & mask) {
+        if (m_index[i].first == mmsi) {
+            return m_index[i].second;
+        }
+        if (m_index[i].first == 0) {
+            return NONE;
+        }
+    }
+}
+
+void AISTargets::IndexInsert(uint32_t mmsi, uint32_t slot)
+{
+    const size_t mask = m_index.size() - 1;
+    size_t i = Hash(mmsi) & mask;
+    while (m_index[i].first != 0) {
+        i = (i + 1) & mask;
+    }
+    m_index[i] = { mmsi, slot };
+}
+
+void AISTargets::IndexErase(uint32_t mmsi)
+{
+    const size_t mask = m_index.size() - 1;
+    size_t i = Hash(mmsi) & mask;
+    while (m_index[i].first != mmsi) {
+        if (m_index[i].first == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    // Backward shift deletion, keeps the probe sequences intact without
+    // tombstones
+    for (size_t j = (i + 1) & mask; m_index[j].first != 0; j = (j + 1) & mask) {
+        const size_t k = Hash(m_index[j].first) & mask;
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+            m_index[i] = m_index[j];
+            i = j;
+        }
+    }
+    m_index[i] = { 0, 0 };
+}
+
+uint32_t AISTargets::CellKey(double lat, double lon) const
+{
+    const auto lon_cells = static_cast<uint32_t>(std::ceil(360.0 / m_cell_size));
+    const auto lat_idx = static_cast<uint32_t>((lat + 90.0) / m_cell_size);
+    const auto lon_idx
+        = static_cast<uint32_t>((lon + 180.0) / m_cell_size) % lon_cells;
+    return lat_idx * lon_cells + lon_idx;
+}
+
+uint32_t AISTargets::CellBucket(uint32_t key) const
+{
+    return Hash(key) & (m_buckets.size() - 1);
+}
+
+void AISTargets::GridPlace(uint32_t slot)
+{
+    const uint32_t key = std::isnan(m_lat[slot]) || std::isnan(m_lon[slot])
+        ? NONE
+        : CellKey(m_lat[slot], m_lon[slot]);
+    if (key == m_cell[slot]) {
+        return;
+    }
+    GridRemove(slot);
+    if (key == NONE) {
+        return;
+    }
+    const uint32_t bucket = CellBucket(key);
+    m_cell[slot] = key;
+    m_cell_prev[slot] = NONE;
+    m_cell_next[slot] = m_buckets[bucket];
+    if (m_buckets[bucket] != NONE) {
+        m_cell_prev[m_buckets[bucket]] = slot;
+    }
+    m_buckets[bucket] = slot;
+}
+
+void AISTargets::GridRemove(uint32_t slot)
+{
+    if (m_cell[slot] == NONE) {
+        return;
+    }
+    if (m_cell_prev[slot] != NONE) {
+        m_cell_next[m_cell_prev[slot]] = m_cell_next[slot];
+    } else {
+        m_buckets[CellBucket(m_cell[slot])] = m_cell_next[slot];
+    }
+    if (m_cell_next[slot] != NONE) {
+        m_cell_prev[m_cell_next[slot]] = m_cell_prev[slot];
+    }
+    m_cell[slot] = NONE;
+    m_cell_next[slot] = NONE;
+    m_cell_prev[slot] = NONE;
+}
+
+void AISTargets::WheelPlace(
+    uint32_t slot, std::chrono::steady_clock::time_point now)
+{
+    WheelRemove(slot);
+    if (m_wheel_tick == INT64_MIN) {
+        m_wheel_tick = Tick(now);
+    }
+    m_expires[slot] = Tick(now + m_expiry);
+    const uint32_t bucket = m_expires[slot] & (WHEEL_SIZE - 1);
+    m_wheel_prev[slot] = NONE;
+    m_wheel_next[slot] = m_wheel[bucket];
+    if (m_wheel[bucket] != NONE) {
+        m_wheel_prev[m_wheel[bucket]] = slot;
+    }
+    m_wheel[bucket] = slot;
+}
+
+void AISTargets::WheelRemove(uint32_t slot)
+{
+    if (m_wheel_prev[slot] != NONE) {
+        m_wheel_next[m_wheel_prev[slot]] = m_wheel_next[slot];
+    } else {
+        const uint32_t bucket = m_expires[slot] & (WHEEL_SIZE - 1);
+        if (m_wheel[bucket] == slot) {
+            m_wheel[bucket] = m_wheel_next[slot];
+        }
+    }
+    if (m_wheel_next[slot] != NONE) {
+        m_wheel_prev[m_wheel_next[slot]] = m_wheel_prev[slot];
+    }
+    m_wheel_next[slot] = NONE;
+    m_wheel_prev[slot] = NONE;
+}
+
+void AISTargets::MarkDirty(uint32_t slot, uint8_t flags)
+{
+    if (m_dirty[slot] == 0) {
+        m_dirty_list.push_back(slot);
+    }
+    m_dirty[slot] |= flags;
+}
+
+void AISTargets::Remove(uint32_t slot)
+{
+    GridRemove(slot);
+    WheelRemove(slot);
+    IndexErase(m_mmsi[slot]);
+    m_mmsi[slot] = 0;
+    m_dirty[slot] = 0;
+    m_free.push_back(slot);
+    --m_size;
+}
+
+uint32_t AISTargets::Update(
+    const ais_message& msg, std::chrono::steady_clock::time_point now)
+{
+    if (msg.mmsi == 0) {
+        return NONE;
+    }
+    uint32_t slot = Find(msg.mmsi);
+    if (slot == NONE) {
+        if (m_free.empty()) {
+            ++m_overflows;
+            return NONE;
+        }
+        slot = m_free.back();
+        m_free.pop_back();
+        m_mmsi[slot] = msg.mmsi;
+        m_lat[slot] = UNKNOWN;
+        m_lon[slot] = UNKNOWN;
+        m_sog[slot] = UNKNOWN;
+        m_cog[slot] = UNKNOWN;
+        m_heading[slot] = UNKNOWN;
+        m_rot[slot] = UNKNOWN;
+        m_nav_status[slot] = 15;
+        m_static[slot] = ais_static_data();
+        IndexInsert(msg.mmsi, slot);
+        ++m_size;
+    }
+    m_class[slot] = msg.ais_class;
+    m_seen[slot] = now;
+
+    if (msg.has_position_report) {
+        if (std::abs(msg.lon) <= 180 * 600000
+            && std::abs(msg.lat) <= 90 * 600000) {
+            m_lat[slot] = msg.lat / 600000.0;
+            m_lon[slot] = msg.lon / 600000.0;
+        } else {
+            m_lat[slot] = UNKNOWN;
+            m_lon[slot] = UNKNOWN;
+        }
+        m_sog[slot] = msg.sog < 1023 ? msg.sog / 10.0 * 1852.0 / 3600.0
+                                     : UNKNOWN;
+        m_cog[slot] = msg.cog < 3600 ? deg2rad(msg.cog / 10.0) : UNKNOWN;
+        m_heading[slot] = msg.heading < 360
+            ? deg2rad(static_cast<double>(msg.heading))
+            : UNKNOWN;
+        if (msg.rot >= -126 && msg.rot <= 126) {
+            // ROT_AIS = 4.733 * sqrt(ROT_sensor) [deg/min]
+            const double rot = msg.rot / 4.733;
+            m_rot[slot] = deg2rad(rot * std::abs(rot)) / 60.0;
+        } else {
+            m_rot[slot] = UNKNOWN;
+        }
+        if (msg.ais_class == 'A') {
+            m_nav_status[slot] = msg.nav_status;
+        }
+        GridPlace(slot);
+        MarkDirty(slot, DIRTY_DYNAMIC);
+    }
+
+    if (msg.has_static_data) {
+        auto& st = m_static[slot];
+        const bool dimensions = msg.type != 24 || msg.part == 1;
+        if (msg.type != 24 || msg.part == 0) {
+            st.name = msg.name;
+        }
+        if (msg.type == 5) {
+            st.imo = msg.imo;
+            st.draught = msg.draught;
+            st.destination = msg.destination;
+        }
+        if (msg.type == 5 || (msg.type == 24 && msg.part == 1)) {
+            st.callsign = msg.callsign;
+        }
+        if (dimensions) {
+            st.ship_type = msg.ship_type;
+            st.to_bow = msg.to_bow;
+            st.to_stern = msg.to_stern;
+            st.to_port = msg.to_port;
+            st.to_starboard = msg.to_starboard;
+        }
+        MarkDirty(slot, DIRTY_STATIC);
+    }
+
+    WheelPlace(slot, now);
+    return slot;
+}
+
+size_t AISTargets::Expire(std::chrono::steady_clock::time_point now)
+{
+    if (m_wheel_tick == INT64_MIN) {
+        return 0;
+    }
+    const int64_t cur = Tick(now);
+    if (cur <= m_wheel_tick) {
+        return 0;
+    }
+    size_t expired = 0;
+    const int64_t n = std::min<int64_t>(cur - m_wheel_tick, WHEEL_SIZE);
+    for (int64_t i = 1; i <= n; ++i) {
+        uint32_t slot = m_wheel[(m_wheel_tick + i) & (WHEEL_SIZE - 1)];
+        while (slot != NONE) {
+            const uint32_t next = m_wheel_next[slot];
+            if (m_expires[slot] <= cur) {
+                Remove(slot);
+                ++expired;
+            }
+            slot = next;
+        }
+    }
+    m_wheel_tick = cur;
+    return expired;
+}
+
+void AISTargets::Query(
+    double lat, double lon, double radius, std::vector<uint32_t>& out) const
+{
+    out.clear();
+    const double dlat = radius / METERS_PER_DEGREE;
+    const double lat0 = std::max(-90.0, lat - dlat);
+    const double lat1 = std::min(90.0 - 1e-9, lat + dlat);
+    const double c = std::cos(deg2rad(std::max(std::abs(lat0), std::abs(lat1))));
+    const double dlon = c > 1e-9 ? dlat / c : 360.0;
+    const auto lon_cells = static_cast<uint32_t>(std::ceil(360.0 / m_cell_size));
+    const auto lat_idx0 = static_cast<uint32_t>((lat0 + 90.0) / m_cell_size);
+    const auto lat_idx1 = static_cast<uint32_t>((lat1 + 90.0) / m_cell_size);
+    const auto lon_idx0 = static_cast<int64_t>(
+        std::floor((lon - std::min(dlon, 180.0) + 180.0) / m_cell_size));
+    const auto lon_span = std::min<int64_t>(lon_cells,
+        static_cast<int64_t>(std::floor(
+            (lon + std::min(dlon, 180.0) + 180.0) / m_cell_size))
+            - lon_idx0 + 1);
+
+    const double cos_lat = std::cos(deg2rad(lat));
+    const double r2 = radius * radius;
+    auto check = [&](uint32_t slot) {
+        const double dy = (m_lat[slot] - lat) * METERS_PER_DEGREE;
+        double dl = m_lon[slot] - lon;
+        if (dl > 180.0) {
+            dl -= 360.0;
+        } else if (dl < -180.0) {
+            dl += 360.0;
+        }
+        const double dx = dl * METERS_PER_DEGREE * cos_lat;
+        if (dx * dx + dy * dy <= r2) {
+            out.push_back(slot);
+        }
+    };
+
+    if (static_cast<size_t>((lat_idx1 - lat_idx0 + 1) * lon_span)
+        > m_buckets.size()) {
+        // The area covers more cells than we have buckets, scanning the
+        // whole table is cheaper
+        for (uint32_t slot = 0; slot < m_mmsi.size(); ++slot) {
+            if (m_cell[slot] != NONE) {
+                check(slot);
+            }
+        }
+        return;
+    }
+    for (uint32_t la = lat_idx0; la <= lat_idx1; ++la) {
+        for (int64_t i = 0; i < lon_span; ++i) {
+            const auto lo = static_cast<uint32_t>(
+                ((lon_idx0 + i) % lon_cells + lon_cells) % lon_cells);
+            const uint32_t key = la * lon_cells + lo;
+            for (uint32_t slot = m_buckets[CellBucket(key)]; slot != NONE;
+                 slot = m_cell_next[slot]) {
+                if (m_cell[slot] == key) {
+                    check(slot);
+                }
+            }
+        }
+    }
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,528 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "byte_scan.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)              \
+    || defined(_M_IX86)
+#define BYTE_SCAN_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define BYTE_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+/// Build a function for an instruction set not enabled for the whole plugin
+#define TARGET(isa) __attribute__((target(isa)))
+#else
+#define TARGET(isa)
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// @brief Return the position of the lowest set bit of a non-zero mask
+inline unsigned LowestBit(uint64_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long pos;
+#if defined(_M_IX86)
+    if (_BitScanForward(&pos, static_cast<uint32_t>(mask)) == 0) {
+        _BitScanForward(&pos, static_cast<uint32_t>(mask >> 32));
+        pos += 32;
+    }
+#else
+    _BitScanForward64(&pos, mask);
+#endif
+    return static_cast<unsigned>(pos);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+inline bool IsSeparator(char c) { return c == ',' || c == '*'; }
+
+inline bool IsEOL(char c) { return c == '\r' || c == '\n'; }
+
+inline bool IsBoundary(char c) { return IsEOL(c) || c == '$' || c == '!'; }
+
+// --- Scalar
+
+uint8_t ChecksumScalar(const char* data, size_t size)
+{
+    // Eight bytes at a time, folded at the end
+    uint64_t acc = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        acc ^= word;
+    }
+    acc ^= acc >> 32;
+    acc ^= acc >> 16;
+    acc ^= acc >> 8;
+    uint8_t checksum = static_cast<uint8_t>(acc);
+    for (; i < size; ++i) {
+        checksum ^= static_cast<uint8_t>(data[i]);
+    }
+    return checksum;
+}
+
+/// @brief Find the separators from a position on, after n already found
+inline size_t SeparatorsFrom(const char* data, size_t from, size_t size,
+    uint32_t* positions, size_t max, size_t n)
+{
+    for (size_t i = from; i < size && n < max; ++i) {
+        if (IsSeparator(data[i])) {
+            positions[n++] = static_cast<uint32_t>(i);
+        }
+    }
+    return n;
+}
+
+size_t SeparatorsScalar(
+    const char* data, size_t size, uint32_t* positions, size_t max)
+{
+    return SeparatorsFrom(data, 0, size, positions, max, 0);
+}
+
+size_t EOLScalar(const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (IsEOL(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+size_t BoundaryScalar(const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (IsBoundary(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+/// @brief Store the positions of the bits of a match mask
+/// @return false if the positions are full
+inline bool StoreMatches(uint64_t mask, size_t base, unsigned bits_per_byte,
+    uint32_t* positions, size_t max, size_t& n)
+{
+    while (mask != 0) {
+        if (n == max) {
+            return false;
+        }
+        const unsigned bit = LowestBit(mask);
+        positions[n++] = static_cast<uint32_t>(base + bit / bits_per_byte);
+        mask &= ~(((uint64_t(1) << bits_per_byte) - 1)
+            << (bit - bit % bits_per_byte));
+    }
+    return true;
+}
+
+#ifdef BYTE_SCAN_X86
+// --- SSE2
+
+TARGET("sse2") uint8_t ChecksumSSE2(const char* data, size_t size)
+{
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        acc = _mm_xor_si128(acc,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+    return static_cast<uint8_t>(_mm_cvtsi128_si32(acc))
+        ^ ChecksumScalar(data + i, size - i);
+}
+
+TARGET("sse2")
+size_t SeparatorsSSE2(
+    const char* data, size_t size, uint32_t* positions, size_t max)
+{
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i star = _mm_set1_epi8('*');
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v
+            = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, star))));
+        if (!StoreMatches(mask, i, 1, positions, max, n)) {
+            return n;
+        }
+    }
+    return SeparatorsFrom(data, i, size, positions, max, n);
+}
+
+TARGET("sse2") size_t EOLSSE2(const char* data, size_t size)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v
+            = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf))));
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+    return i + EOLScalar(data + i, size - i);
+}
+
+TARGET("sse2") size_t BoundarySSE2(const char* data, size_t size)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i dollar = _mm_set1_epi8('$');
+    const __m128i bang = _mm_set1_epi8('!');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v
+            = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i eq
+            = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, cr),
+                               _mm_cmpeq_epi8(v, lf)),
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(v, dollar), _mm_cmpeq_epi8(v, bang)));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+    return i + BoundaryScalar(data + i, size - i);
+}
+
+// --- AVX2
+
+TARGET("avx2") uint8_t ChecksumAVX2(const char* data, size_t size)
+{
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        acc = _mm256_xor_si256(acc,
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    __m128i half = _mm_xor_si128(
+        _mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    if (i + 16 <= size) {
+        half = _mm_xor_si128(half,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        i += 16;
+    }
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 8));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 4));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 2));
+    half = _mm_xor_si128(half, _mm_srli_si128(half, 1));
+    return static_cast<uint8_t>(_mm_cvtsi128_si32(half))
+        ^ ChecksumScalar(data + i, size - i);
+}
+
+TARGET("avx2")
+size_t SeparatorsAVX2(
+    const char* data, size_t size, uint32_t* positions, size_t max)
+{
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i star = _mm256_set1_epi8('*');
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i v
+            = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t mask
+            = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, comma), _mm256_cmpeq_epi8(v, star))));
+        if (!StoreMatches(mask, i, 1, positions, max, n)) {
+            return n;
+        }
+    }
+    if (i + 16 <= size) {
+        const __m128i v
+            = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const uint32_t mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm256_castsi256_si128(comma)),
+                _mm_cmpeq_epi8(v, _mm256_castsi256_si128(star)))));
+        if (!StoreMatches(mask, i, 1, positions, max, n)) {
+            return n;
+        }
+        i += 16;
+    }
+    return SeparatorsFrom(data, i, size, positions, max, n);
+}
+
+TARGET("avx2") size_t EOLAVX2(const char* data, size_t size)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i v
+            = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t mask
+            = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf))));
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+    if (i + 16 <= size) {
+        const __m128i v
+            = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const uint32_t mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm256_castsi256_si128(cr)),
+                _mm_cmpeq_epi8(v, _mm256_castsi256_si128(lf)))));
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+        i += 16;
+    }
+    return i + EOLScalar(data + i, size - i);
+}
+
+TARGET("avx2") size_t BoundaryAVX2(const char* data, size_t size)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i dollar = _mm256_set1_epi8('$');
+    const __m256i bang = _mm256_set1_epi8('!');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i v
+            = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i eq
+            = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr),
+                                  _mm256_cmpeq_epi8(v, lf)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, dollar),
+                    _mm256_cmpeq_epi8(v, bang)));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+    return i + BoundarySSE2(data + i, size - i);
+}
+
+bool CpuSupports(simd_level level)
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    const int max_leaf = r[0];
+    __cpuid(r, 1);
+    if (level == simd_level::SSE2) {
+        return (r[3] & (1 << 26)) != 0;
+    }
+    // AVX2 needs the OS to save the YMM registers
+    const bool avx = (r[2] & (1 << 27)) != 0 && (r[2] & (1 << 28)) != 0
+        && (_xgetbv(0) & 6) == 6;
+    if (max_leaf < 7 || !avx) {
+        return false;
+    }
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    if (level == simd_level::SSE2) {
+        return __builtin_cpu_supports("sse2");
+    }
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#ifdef BYTE_SCAN_NEON
+// --- NEON
+
+/// @brief Return a mask of 4 bits per byte of a comparison result
+inline uint64_t NibbleMask(uint8x16_t eq)
+{
+    return vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+uint8_t ChecksumNEON(const char* data, size_t size)
+{
+    uint8x16_t acc = vdupq_n_u8(0);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        acc = veorq_u8(
+            acc, vld1q_u8(reinterpret_cast<const uint8_t*>(data + i)));
+    }
+    const uint64x2_t words = vreinterpretq_u64_u8(acc);
+    uint64_t folded = vgetq_lane_u64(words, 0) ^ vgetq_lane_u64(words, 1);
+    folded ^= folded >> 32;
+    folded ^= folded >> 16;
+    folded ^= folded >> 8;
+    return static_cast<uint8_t>(folded) ^ ChecksumScalar(data + i, size - i);
+}
+
+size_t SeparatorsNEON(
+    const char* data, size_t size, uint32_t* positions, size_t max)
+{
+    const uint8x16_t comma = vdupq_n_u8(',');
+    const uint8x16_t star = vdupq_n_u8('*');
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t v
+            = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint64_t mask = NibbleMask(
+            vorrq_u8(vceqq_u8(v, comma), vceqq_u8(v, star)));
+        if (!StoreMatches(mask, i, 4, positions, max, n)) {
+            return n;
+        }
+    }
+    return SeparatorsFrom(data, i, size, positions, max, n);
+}
+
+size_t EOLNEON(const char* data, size_t size)
+{
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    const uint8x16_t lf = vdupq_n_u8('\n');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t v
+            = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint64_t mask
+            = NibbleMask(vorrq_u8(vceqq_u8(v, cr), vceqq_u8(v, lf)));
+        if (mask != 0) {
+            return i + LowestBit(mask) / 4;
+        }
+    }
+    return i + EOLScalar(data + i, size - i);
+}
+
+size_t BoundaryNEON(const char* data, size_t size)
+{
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    const uint8x16_t lf = vdupq_n_u8('\n');
+    const uint8x16_t dollar = vdupq_n_u8('$');
+    const uint8x16_t bang = vdupq_n_u8('!');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t v
+            = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint64_t mask = NibbleMask(
+            vorrq_u8(vorrq_u8(vceqq_u8(v, cr), vceqq_u8(v, lf)),
+                vorrq_u8(vceqq_u8(v, dollar), vceqq_u8(v, bang))));
+        if (mask != 0) {
+            return i + LowestBit(mask) / 4;
+        }
+    }
+    return i + BoundaryScalar(data + i, size - i);
+}
+#endif
+
+/// Kernels of all the instruction sets built, from the least preferred
+const scan_kernels KERNELS[] = {
+    { simd_level::SCALAR, "scalar", ChecksumScalar, SeparatorsScalar,
+        EOLScalar, BoundaryScalar },
+#ifdef BYTE_SCAN_X86
+    { simd_level::SSE2, "sse2", ChecksumSSE2, SeparatorsSSE2, EOLSSE2,
+        BoundarySSE2 },
+    { simd_level::AVX2, "avx2", ChecksumAVX2, SeparatorsAVX2, EOLAVX2,
+        BoundaryAVX2 },
+#endif
+#ifdef BYTE_SCAN_NEON
+    { simd_level::NEON, "neon", ChecksumNEON, SeparatorsNEON, EOLNEON,
+        BoundaryNEON },
+#endif
+};
+
+/// @brief Return whether the CPU runs the kernels of an instruction set
+bool Usable(simd_level level)
+{
+    switch (level) {
+    case simd_level::SCALAR:
+        return true;
+#ifdef BYTE_SCAN_X86
+    case simd_level::SSE2:
+    case simd_level::AVX2:
+        return CpuSupports(level);
+#endif
+#ifdef BYTE_SCAN_NEON
+    case simd_level::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+}
+
+const scan_kernels& ByteScan::Best()
+{
+    static const scan_kernels& best = []() -> const scan_kernels& {
+        const scan_kernels* k = &KERNELS[0];
+        for (const auto& kernels : KERNELS) {
+            if (Usable(kernels.level)) {
+                k = &kernels;
+            }
+        }
+        return *k;
+    }();
+    return best;
+}
+
+const scan_kernels* ByteScan::Kernels(simd_level level)
+{
+    for (const auto& kernels : KERNELS) {
+        if (kernels.level == level) {
+            return Usable(level) ? &kernels : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<simd_level> ByteScan::Supported()
+{
+    std::vector<simd_level> levels;
+    for (const auto& kernels : KERNELS) {
+        if (Usable(kernels.level)) {
+            levels.push_back(kernels.level);
+        }
+    }
+    return levels;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,97 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "clock.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+template <typename TimePoint> TimePoint FromNs(int64_t ns)
+{
+    return TimePoint(std::chrono::duration_cast<typename TimePoint::duration>(
+        std::chrono::nanoseconds(ns)));
+}
+}
+
+int64_t Clock::SystemMs() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        System().time_since_epoch())
+        .count();
+}
+
+const Clock& Clock::Real()
+{
+    static const RealClock clock;
+    return clock;
+}
+
+SteadyClock::SteadyClock()
+    : m_steady_start(std::chrono::steady_clock::now())
+    , m_system_start(std::chrono::system_clock::now())
+{
+}
+
+std::chrono::system_clock::time_point SteadyClock::System() const
+{
+    return m_system_start
+        + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::steady_clock::now() - m_steady_start);
+}
+
+ManualClock::ManualClock(int64_t start)
+    : m_now(start * 1000000)
+{
+}
+
+std::chrono::steady_clock::time_point ManualClock::Steady() const
+{
+    return FromNs<std::chrono::steady_clock::time_point>(
+        m_now.load(std::memory_order_acquire));
+}
+
+std::chrono::system_clock::time_point ManualClock::System() const
+{
+    return FromNs<std::chrono::system_clock::time_point>(
+        m_now.load(std::memory_order_acquire));
+}
+
+void ManualClock::Set(int64_t ms)
+{
+    const int64_t ns = ms * 1000000;
+    int64_t now = m_now.load(std::memory_order_relaxed);
+    while (ns > now
+        && !m_now.compare_exchange_weak(now, ns, std::memory_order_release)) { }
+}
+
+void ManualClock::Advance(std::chrono::nanoseconds d)
+{
+    if (d.count() > 0) {
+        m_now.fetch_add(d.count(), std::memory_order_release);
+    }
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,232 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "cpa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// Meters per degree of latitude
+constexpr double METERS_PER_DEGREE = 60.0 * 1852.0;
+/// Value of the unknown data
+constexpr double UNKNOWN = std::numeric_limits<double>::quiet_NaN();
+/// Change of the own ship velocity vector (m/s) triggering recomputation of
+/// all the targets
+constexpr double VELOCITY_CHANGE = 0.1;
+/// Distance (m) the own ship moves before all the targets are recomputed
+constexpr double POSITION_CHANGE = 50.0;
+}
+
+CPAEngine::CPAEngine(size_t capacity)
+    : m_own_lat(UNKNOWN)
+    , m_own_lon(UNKNOWN)
+    , m_own_vx(UNKNOWN)
+    , m_own_vy(UNKNOWN)
+    , m_full_vx(UNKNOWN)
+    , m_full_vy(UNKNOWN)
+    , m_full_lat(UNKNOWN)
+    , m_full_lon(UNKNOWN)
+    , m_own_mmsi(0)
+    , m_limit_distance(926.0)
+    , m_limit_time(600.0)
+{
+    m_vx.assign(capacity, UNKNOWN);
+    m_vy.assign(capacity, UNKNOWN);
+    m_cpa.assign(capacity, UNKNOWN);
+    m_tcpa.assign(capacity, UNKNOWN);
+    m_inside.assign(capacity, 0);
+    m_alarm.assign(capacity, 0);
+    m_mmsi.assign(capacity, 0);
+    m_touched.assign(capacity, 0);
+    m_dirty.reserve(capacity);
+    m_changed.reserve(capacity);
+}
+
+void CPAEngine::SetLimits(double distance, double time)
+{
+    m_limit_distance = distance;
+    m_limit_time = time;
+    // Force recomputation of everything
+    m_full_vx = UNKNOWN;
+}
+
+void CPAEngine::SetOwnPosition(double lat, double lon)
+{
+    m_own_lat = lat;
+    m_own_lon = lon;
+}
+
+void CPAEngine::SetOwnVelocity(double sog, double cog)
+{
+    m_own_vx = sog * std::sin(cog);
+    m_own_vy = sog * std::cos(cog);
+}
+
+void CPAEngine::Touch(uint32_t slot, const AISTargets& targets)
+{
+    if (m_mmsi[slot] != targets.Mmsi()[slot]) {
+        // The slot has been reused for another target
+        if (m_alarm[slot]) {
+            m_gone.push_back(m_mmsi[slot]);
+        }
+        m_mmsi[slot] = targets.Mmsi()[slot];
+        m_alarm[slot] = 0;
+    }
+    const double sog = targets.Sog()[slot];
+    const double cog = targets.Cog()[slot];
+    m_vx[slot] = sog * std::sin(cog);
+    m_vy[slot] = sog * std::cos(cog);
+    if (!m_touched[slot]) {
+        m_touched[slot] = 1;
+        m_dirty.push_back(slot);
+    }
+}
+
+void CPAEngine::ComputeRange(const AISTargets& targets, size_t from, size_t to)
+{
+    const double* __restrict lat = targets.Lat().data();
+    const double* __restrict lon = targets.Lon().data();
+    const double* __restrict tvx = m_vx.data();
+    const double* __restrict tvy = m_vy.data();
+    double* __restrict cpa = m_cpa.data();
+    double* __restrict tcpa = m_tcpa.data();
+    uint8_t* __restrict inside = m_inside.data();
+
+    const double kx = METERS_PER_DEGREE * std::cos(deg2rad(m_own_lat));
+    const double ky = METERS_PER_DEGREE;
+    const double olat = m_own_lat;
+    const double olon = m_own_lon;
+    const double ovx = m_own_vx;
+    const double ovy = m_own_vy;
+    const double max_d2 = m_limit_distance * m_limit_distance;
+    const double max_t = m_limit_time;
+
+    for (size_t i = from; i < to; ++i) {
+        double dl = lon[i] - olon;
+        dl = dl > 180.0 ? dl - 360.0 : (dl < -180.0 ? dl + 360.0 : dl);
+        const double dx = dl * kx;
+        const double dy = (lat[i] - olat) * ky;
+        const double vx = tvx[i] - ovx;
+        const double vy = tvy[i] - ovy;
+        const double v2 = vx * vx + vy * vy;
+        const double t = v2 > 1e-9 ? -(dx * vx + dy * vy) / v2 : 0.0;
+        const double tc = t > 0.0 ? t : 0.0;
+        const double cx = dx + vx * tc;
+        const double cy = dy + vy * tc;
+        const double d2 = cx * cx + cy * cy;
+        cpa[i] = std::sqrt(d2);
+        tcpa[i] = t;
+        inside[i] = (d2 <= max_d2) & (t >= 0.0) & (t <= max_t);
+    }
+}
+
+void CPAEngine::UpdateAlarm(uint32_t slot)
+{
+    if (m_inside[slot] != m_alarm[slot]) {
+        m_alarm[slot] = m_inside[slot];
+        m_changed.push_back(slot);
+    }
+}
+
+size_t CPAEngine::Compute(const AISTargets& targets)
+{
+    m_changed.clear();
+    // The alarms of the expired targets are cleared right away, the targets
+    // are not in the table to be recomputed any more
+    for (uint32_t slot = 0; slot < m_alarm.size(); ++slot) {
+        if (m_alarm[slot] && !targets.Active(slot)) {
+            m_gone.push_back(m_mmsi[slot]);
+            m_alarm[slot] = 0;
+            m_inside[slot] = 0;
+            m_mmsi[slot] = 0;
+        }
+    }
+    m_expired.clear();
+    m_expired.swap(m_gone);
+    if (std::isnan(m_own_lat) || std::isnan(m_own_vx)) {
+        return 0;
+    }
+    // Exclude our own AIS transponder
+    const uint32_t own_slot
+        = m_own_mmsi != 0 ? targets.Find(m_own_mmsi) : AISTargets::NONE;
+    auto clear_own = [&]() {
+        if (own_slot != AISTargets::NONE) {
+            m_cpa[own_slot] = UNKNOWN;
+            m_tcpa[own_slot] = UNKNOWN;
+            m_inside[own_slot] = 0;
+        }
+    };
+
+    // The targets reporting rarely are re-evaluated against the current own
+    // position once the own ship moved far enough
+    const double moved_x = (m_own_lon - m_full_lon) * METERS_PER_DEGREE
+        * std::cos(deg2rad(m_own_lat));
+    const double moved_y = (m_own_lat - m_full_lat) * METERS_PER_DEGREE;
+    const bool full = std::isnan(m_full_vx) || std::isnan(m_full_lat)
+        || std::abs(m_own_vx - m_full_vx) > VELOCITY_CHANGE
+        || std::abs(m_own_vy - m_full_vy) > VELOCITY_CHANGE
+        || moved_x * moved_x + moved_y * moved_y
+            > POSITION_CHANGE * POSITION_CHANGE;
+    size_t processed;
+    if (full) {
+        m_full_vx = m_own_vx;
+        m_full_vy = m_own_vy;
+        m_full_lat = m_own_lat;
+        m_full_lon = m_own_lon;
+        for (auto slot : m_dirty) {
+            m_touched[slot] = 0;
+        }
+        m_dirty.clear();
+        ComputeRange(targets, 0, m_cpa.size());
+        clear_own();
+        for (uint32_t slot = 0; slot < m_cpa.size(); ++slot) {
+            if (!targets.Active(slot)) {
+                m_inside[slot] = 0;
+                m_mmsi[slot] = 0;
+            }
+            UpdateAlarm(slot);
+        }
+        processed = m_cpa.size();
+    } else {
+        for (auto slot : m_dirty) {
+            m_touched[slot] = 0;
+            ComputeRange(targets, slot, slot + 1);
+        }
+        clear_own();
+        for (auto slot : m_dirty) {
+            UpdateAlarm(slot);
+        }
+        processed = m_dirty.size();
+        m_dirty.clear();
+    }
+    return processed;
+}
+
+PLUGIN_END_NAMESPACE
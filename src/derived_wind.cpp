@@ -0,0 +1,188 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "derived_wind.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/// @brief Normalize the angle to [0, 2PI)
+double Normalize(double a)
+{
+    a = std::fmod(a, 2.0 * PI);
+    return a < 0.0 ? a + 2.0 * PI : a;
+}
+}
+
+DerivedWind::DerivedWind()
+    : m_dirty(false)
+    , m_enabled(true)
+    , m_max_age(10000)
+    , m_has_water(false)
+    , m_has_ground(false)
+    , m_angle_true_water(NaN)
+    , m_speed_true(NaN)
+    , m_angle_true_ground(NaN)
+    , m_speed_over_ground(NaN)
+    , m_direction_true(NaN)
+{
+    m_inputs.fill(NaN);
+}
+
+void DerivedWind::Set(
+    input in, double value, std::chrono::steady_clock::time_point now)
+{
+    // Refreshing an unchanged value only extends its life
+    m_dirty = m_dirty || m_inputs[in] != value;
+    m_inputs[in] = value;
+    m_updated[in] = now;
+}
+
+bool DerivedWind::Fresh(
+    input in, std::chrono::steady_clock::time_point now) const
+{
+    return !std::isnan(m_inputs[in]) && now - m_updated[in] <= m_max_age;
+}
+
+double DerivedWind::Upwash(double angle) const
+{
+    const double a = std::fabs(angle);
+    auto it = std::lower_bound(m_upwash.begin(), m_upwash.end(), a,
+        [](const std::pair<double, double>& e, double v) {
+            return e.first < v;
+        });
+    double c;
+    if (it == m_upwash.begin()) {
+        c = it->second;
+    } else if (it == m_upwash.end()) {
+        c = m_upwash.back().second;
+    } else {
+        const auto& lo = *(it - 1);
+        const double f = (a - lo.first) / (it->first - lo.first);
+        c = lo.second + f * (it->second - lo.second);
+    }
+    return angle < 0.0 ? -c : c;
+}
+
+bool DerivedWind::Compute(std::chrono::steady_clock::time_point now)
+{
+    if (!m_enabled || !m_dirty || !Fresh(APPARENT_ANGLE, now)
+        || !Fresh(APPARENT_SPEED, now)) {
+        return false;
+    }
+    m_dirty = false;
+
+    // MWV reports the angle in 0..2PI, the correction is mirrored for port so
+    // it needs (-PI, PI]
+    double awa = std::remainder(m_inputs[APPARENT_ANGLE], 2.0 * PI);
+    if (!m_upwash.empty()) {
+        awa += Upwash(awa);
+    }
+    const double aws = m_inputs[APPARENT_SPEED];
+    // Apparent wind vector in the boat frame (x to the bow, y to starboard)
+    const double ax = aws * std::cos(awa);
+    const double ay = aws * std::sin(awa);
+
+    m_has_water = Fresh(SPEED_THROUGH_WATER, now);
+    if (m_has_water) {
+        const double tx = ax - m_inputs[SPEED_THROUGH_WATER];
+        m_angle_true_water = std::atan2(ay, tx);
+        m_speed_true = std::hypot(tx, ay);
+    }
+
+    m_has_ground = Fresh(SPEED_OVER_GROUND, now) && Fresh(HEADING, now);
+    if (m_has_ground) {
+        // Without the course the boat is assumed to move along its heading
+        const double drift = Fresh(COURSE_OVER_GROUND, now)
+            ? m_inputs[COURSE_OVER_GROUND] - m_inputs[HEADING]
+            : 0.0;
+        const double sog = m_inputs[SPEED_OVER_GROUND];
+        const double gx = ax - sog * std::cos(drift);
+        const double gy = ay - sog * std::sin(drift);
+        m_angle_true_ground = std::atan2(gy, gx);
+        m_speed_over_ground = std::hypot(gx, gy);
+        m_direction_true = Normalize(m_inputs[HEADING] + m_angle_true_ground);
+    }
+    return m_has_water || m_has_ground;
+}
+
+void DerivedWind::SetUpwash(const std::vector<std::pair<double, double>>& table)
+{
+    m_upwash = table;
+    std::sort(m_upwash.begin(), m_upwash.end());
+    m_dirty = true;
+}
+
+void DerivedWind::FromJSON(const Value& v)
+{
+    if (!v.IsObject()) {
+        return;
+    }
+    if (v.HasMember("enabled") && v["enabled"].IsBool()) {
+        m_enabled = v["enabled"].GetBool();
+    }
+    if (v.HasMember("max_age") && v["max_age"].IsNumber()) {
+        m_max_age = std::chrono::milliseconds(
+            static_cast<int64_t>(v["max_age"].GetDouble() * 1000.0));
+    }
+    if (v.HasMember("upwash") && v["upwash"].IsArray()) {
+        std::vector<std::pair<double, double>> table;
+        for (const auto& e : v["upwash"].GetArray()) {
+            if (e.IsArray() && e.Size() == 2 && e[0].IsNumber()
+                && e[1].IsNumber()) {
+                table.emplace_back(
+                    deg2rad(e[0].GetDouble()), deg2rad(e[1].GetDouble()));
+            }
+        }
+        SetUpwash(table);
+    }
+}
+
+Value DerivedWind::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("enabled", m_enabled, allocator);
+    v.AddMember("max_age", m_max_age.count() / 1000.0, allocator);
+    Value upwash(kArrayType);
+    for (const auto& e : m_upwash) {
+        Value entry(kArrayType);
+        entry.PushBack(rad2deg(e.first), allocator);
+        entry.PushBack(rad2deg(e.second), allocator);
+        upwash.PushBack(entry, allocator);
+    }
+    v.AddMember("upwash", upwash, allocator);
+    return v;
+}
+
+PLUGIN_END_NAMESPACE
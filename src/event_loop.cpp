@@ -0,0 +1,120 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "event_loop.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+PLUGIN_BEGIN_NAMESPACE
+
+EventLoop::EventLoop()
+    : m_epoll(epoll_create1(EPOLL_CLOEXEC))
+    , m_wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (m_epoll >= 0 && m_wake >= 0) {
+        epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wake;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    if (m_wake >= 0) {
+        close(m_wake);
+    }
+    if (m_epoll >= 0) {
+        close(m_epoll);
+    }
+}
+
+bool EventLoop::Add(int fd, uint32_t events, handler h)
+{
+    epoll_event ev {};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        return false;
+    }
+    m_handlers[fd] = std::make_shared<handler>(std::move(h));
+    return true;
+}
+
+bool EventLoop::Modify(int fd, uint32_t events)
+{
+    epoll_event ev {};
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EventLoop::Remove(int fd)
+{
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    m_handlers.erase(fd);
+}
+
+void EventLoop::Wake()
+{
+    const uint64_t one = 1;
+    [[maybe_unused]] auto r = write(m_wake, &one, sizeof(one));
+}
+
+int EventLoop::Poll(int timeout_ms)
+{
+    epoll_event events[MAX_EVENTS];
+    const int n = epoll_wait(m_epoll, events, MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    int handled = 0;
+    for (int i = 0; i < n; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == m_wake) {
+            uint64_t count;
+            [[maybe_unused]] auto r = read(m_wake, &count, sizeof(count));
+            continue;
+        }
+        // The handler may remove itself or other descriptors
+        auto it = m_handlers.find(fd);
+        if (it != m_handlers.end()) {
+            auto h = it->second;
+            (*h)(events[i].events);
+            ++handled;
+        }
+    }
+    return handled;
+}
+
+PLUGIN_END_NAMESPACE
+
+#endif // __linux__
@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "time_base.h"
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+FlightRecorder::FlightRecorder(size_t capacity)
+    : m_capacity(0)
+    , m_next(0)
+    , m_current()
+{
+    Resize(capacity);
+}
+
+void FlightRecorder::Resize(size_t capacity)
+{
+    m_slots.reset(
+        capacity > 0 ? new Seqlock<flight_record>[capacity] : nullptr);
+    m_capacity = capacity;
+    m_next = 0;
+    m_current = flight_record();
+}
+
+void FlightRecorder::Record(std::string_view stc, int64_t time)
+{
+    if (m_capacity == 0) {
+        return;
+    }
+    const uint64_t sequence = m_next.load(std::memory_order_relaxed);
+    m_current.sequence = sequence;
+    m_current.time = time;
+    m_current.delta_size = 0;
+    m_current.delta_hash = 0;
+    m_current.length = static_cast<uint32_t>(
+        std::min(stc.size(), flight_record::MAX_SENTENCE));
+    std::memcpy(m_current.sentence, stc.data(), m_current.length);
+    m_slots[sequence % m_capacity].Store(m_current);
+    m_next.store(sequence + 1, std::memory_order_release);
+}
+
+void FlightRecorder::Delta(std::string_view json)
+{
+    if (m_capacity == 0 || m_next.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    m_current.delta_size += static_cast<uint32_t>(json.size());
+    m_current.delta_hash = Hash(json,
+        m_current.delta_hash != 0 ? m_current.delta_hash
+                                  : 0xcbf29ce484222325ull);
+    m_slots[m_current.sequence % m_capacity].Store(m_current);
+}
+
+std::vector<flight_record> FlightRecorder::Records() const
+{
+    std::vector<flight_record> records;
+    const uint64_t next = m_next.load(std::memory_order_acquire);
+    if (m_capacity == 0) {
+        return records;
+    }
+    const uint64_t first = next > m_capacity ? next - m_capacity : 0;
+    records.reserve(next - first);
+    for (uint64_t seq = first; seq < next; ++seq) {
+        const flight_record r = m_slots[seq % m_capacity].Load();
+        // Skip the slots overwritten while copying
+        if (r.sequence == seq) {
+            records.push_back(r);
+        }
+    }
+    return records;
+}
+
+size_t FlightRecorder::Dump(std::ostream& out) const
+{
+    const auto records = Records();
+    for (const auto& r : records) {
+        char header[96];
+        std::snprintf(header, sizeof(header),
+            "#NSK %s %" PRId64 " %" PRIu32 " %016" PRIx64 "\n",
+            TimeBase::Format(r.time).c_str(), r.time, r.delta_size,
+            r.delta_hash);
+        out << header;
+        out.write(r.sentence, r.length);
+        out << "\r\n";
+    }
+    return records.size();
+}
+
+bool FlightRecorder::Dump(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        return false;
+    }
+    Dump(out);
+    return out.good();
+}
+
+std::vector<flight_record> FlightRecorder::Load(std::istream& in)
+{
+    std::vector<flight_record> records;
+    flight_record r {};
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.compare(0, 5, "#NSK ") == 0) {
+            char iso[40];
+            std::sscanf(line.c_str(),
+                "#NSK %39s %" SCNd64 " %" SCNu32 " %" SCNx64, iso, &r.time,
+                &r.delta_size, &r.delta_hash);
+        } else if (!line.empty() && (line[0] == '$' || line[0] == '!')) {
+            r.length = static_cast<uint32_t>(
+                std::min(line.size(), flight_record::MAX_SENTENCE));
+            std::memcpy(r.sentence, line.data(), r.length);
+            r.sequence = records.size();
+            records.push_back(r);
+            r = flight_record {};
+        }
+    }
+    return records;
+}
+
+uint64_t FlightRecorder::Hash(std::string_view data, uint64_t hash)
+{
+    for (const char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void FlightRecorder::FromJSON(const Value& v)
+{
+    if (v.IsObject() && v.HasMember("size") && v["size"].IsUint()
+        && v["size"].GetUint() != m_capacity) {
+        Resize(v["size"].GetUint());
+    }
+}
+
+Value FlightRecorder::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("size", static_cast<unsigned>(m_capacity), allocator);
+    return v;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,268 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "magnetic_variation.h"
+
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// WGS84 semi-major axis in km
+constexpr double WGS84_A = 6378.137;
+/// WGS84 flattening
+constexpr double WGS84_F = 1.0 / 298.257223563;
+/// Geomagnetic reference radius in km
+constexpr double REFERENCE_RADIUS = 6371.2;
+
+constexpr size_t Idx(int n, int m)
+{
+    return static_cast<size_t>(n * (MagneticModel::MAX_DEGREE + 1) + m);
+}
+}
+
+MagneticModel::MagneticModel()
+    : m_degree(0)
+    , m_epoch(0.0)
+{
+    m_g.fill(0.0);
+    m_h.fill(0.0);
+    m_gdot.fill(0.0);
+    m_hdot.fill(0.0);
+}
+
+bool MagneticModel::Load(const std::string& path)
+{
+    std::ifstream in(path);
+    return in.is_open() && Load(in);
+}
+
+bool MagneticModel::Load(std::istream& in)
+{
+    std::string line;
+    if (!std::getline(in, line)) {
+        return false;
+    }
+    std::istringstream header(line);
+    double epoch;
+    std::string name;
+    if (!(header >> epoch >> name)) {
+        return false;
+    }
+    MagneticModel model;
+    model.m_epoch = epoch;
+    model.m_name = name;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 4, "9999") == 0) {
+            break;
+        }
+        std::istringstream row(line);
+        int n;
+        int m;
+        double g;
+        double h;
+        double gdot;
+        double hdot;
+        if (!(row >> n >> m >> g >> h >> gdot >> hdot)) {
+            continue;
+        }
+        if (n < 1 || n > MAX_DEGREE || m < 0 || m > n) {
+            continue;
+        }
+        model.m_g[Idx(n, m)] = g;
+        model.m_h[Idx(n, m)] = h;
+        model.m_gdot[Idx(n, m)] = gdot;
+        model.m_hdot[Idx(n, m)] = hdot;
+        model.m_degree = std::max(model.m_degree, n);
+    }
+    if (model.m_degree == 0) {
+        return false;
+    }
+    *this = model;
+    return true;
+}
+
+double MagneticModel::Declination(
+    double lat, double lon, double alt, double year) const
+{
+    if (!Valid()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    // Geodetic to geocentric spherical coordinates
+    const double phi = deg2rad(lat);
+    const double lambda = deg2rad(lon);
+    const double e2 = WGS84_F * (2.0 - WGS84_F);
+    const double sin_phi = std::sin(phi);
+    const double cos_phi = std::cos(phi);
+    const double rc = WGS84_A / std::sqrt(1.0 - e2 * sin_phi * sin_phi);
+    const double p = (rc + alt) * cos_phi;
+    const double z = (rc * (1.0 - e2) + alt) * sin_phi;
+    const double r = std::sqrt(p * p + z * z);
+    const double phi_c = std::asin(z / r);
+    // Colatitude, kept away from the poles where the east component is
+    // undefined
+    const double theta = PI / 2.0 - phi_c;
+    const double ct = std::cos(theta);
+    const double st = std::max(std::sin(theta), 1e-10);
+
+    // Schmidt semi-normalized associated Legendre functions and their
+    // derivatives by colatitude
+    std::array<double, (MAX_DEGREE + 1) * (MAX_DEGREE + 1)> pnm {};
+    std::array<double, (MAX_DEGREE + 1) * (MAX_DEGREE + 1)> dpnm {};
+    pnm[Idx(0, 0)] = 1.0;
+    for (int n = 1; n <= m_degree; ++n) {
+        for (int m = 0; m <= n; ++m) {
+            if (n == m) {
+                const double k
+                    = n == 1 ? 1.0 : std::sqrt((2.0 * n - 1) / (2.0 * n));
+                pnm[Idx(n, n)] = k * st * pnm[Idx(n - 1, n - 1)];
+                dpnm[Idx(n, n)] = k
+                    * (st * dpnm[Idx(n - 1, n - 1)]
+                        + ct * pnm[Idx(n - 1, n - 1)]);
+            } else {
+                const double a
+                    = (2.0 * n - 1) / std::sqrt(double(n * n - m * m));
+                const double b = n - 1 > m
+                    ? std::sqrt(double((n - 1) * (n - 1) - m * m)
+                          / double(n * n - m * m))
+                    : 0.0;
+                pnm[Idx(n, m)] = a * ct * pnm[Idx(n - 1, m)]
+                    - (n - 1 > m ? b * pnm[Idx(n - 2, m)] : 0.0);
+                dpnm[Idx(n, m)]
+                    = a * (ct * dpnm[Idx(n - 1, m)] - st * pnm[Idx(n - 1, m)])
+                    - (n - 1 > m ? b * dpnm[Idx(n - 2, m)] : 0.0);
+            }
+        }
+    }
+
+    const double dt = year - m_epoch;
+    double bt = 0.0;
+    double bp = 0.0;
+    double br = 0.0;
+    double ar = std::pow(REFERENCE_RADIUS / r, 2);
+    for (int n = 1; n <= m_degree; ++n) {
+        ar *= REFERENCE_RADIUS / r;
+        for (int m = 0; m <= n; ++m) {
+            const double g = m_g[Idx(n, m)] + dt * m_gdot[Idx(n, m)];
+            const double h = m_h[Idx(n, m)] + dt * m_hdot[Idx(n, m)];
+            const double cm = std::cos(m * lambda);
+            const double sm = std::sin(m * lambda);
+            const double t1 = g * cm + h * sm;
+            const double t2 = g * sm - h * cm;
+            bt -= ar * t1 * dpnm[Idx(n, m)];
+            bp += ar * m * t2 * pnm[Idx(n, m)];
+            br += ar * (n + 1) * t1 * pnm[Idx(n, m)];
+        }
+    }
+    bp /= st;
+
+    // North and east components rotated back to the geodetic frame
+    const double psi = phi_c - phi;
+    const double x = -bt * std::cos(psi) - br * std::sin(psi);
+    const double y = bp;
+    return std::atan2(y, x);
+}
+
+MagneticVariation::MagneticVariation()
+    : m_hits(0)
+    , m_misses(0)
+{
+}
+
+bool MagneticVariation::Load(const std::string& path)
+{
+    m_cells.fill(cell());
+    return m_model.Load(path);
+}
+
+bool MagneticVariation::Load(std::istream& in)
+{
+    m_cells.fill(cell());
+    return m_model.Load(in);
+}
+
+double MagneticVariation::DecimalYear(std::chrono::system_clock::time_point t)
+{
+    const time_t tt = std::chrono::system_clock::to_time_t(t);
+    std::tm tm {};
+#ifdef _WIN32
+    gmtime_s(&tm, &tt);
+#else
+    gmtime_r(&tt, &tm);
+#endif
+    const int year = tm.tm_year + 1900;
+    const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    const double day = tm.tm_yday + (tm.tm_hour + tm.tm_min / 60.0) / 24.0;
+    return year + day / (leap ? 366.0 : 365.0);
+}
+
+double MagneticVariation::Variation(double lat, double lon, double year)
+{
+    if (!m_model.Valid() || std::isnan(lat) || std::isnan(lon)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    lat = std::max(-89.999, std::min(89.999, lat));
+    lon = std::remainder(lon, 360.0);
+    const double lat0 = std::floor(lat);
+    const double lon0 = std::floor(lon);
+    const auto epoch = static_cast<uint32_t>(
+        std::max(0.0, std::round((year - m_model.Epoch()) * 10.0)));
+    const uint32_t key = ((epoch & 0x3ff) << 17)
+        | static_cast<uint32_t>((lat0 + 90.0) * 360.0 + (lon0 + 180.0));
+    cell& c = m_cells[(key * 2654435761u) >> 24 & (CELLS - 1)];
+    if (c.key == key) {
+        ++m_hits;
+    } else {
+        ++m_misses;
+        const double y = m_model.Epoch() + epoch / 10.0;
+        c.key = key;
+        c.corners[0]
+            = static_cast<float>(m_model.Declination(lat0, lon0, 0, y));
+        c.corners[1]
+            = static_cast<float>(m_model.Declination(lat0, lon0 + 1, 0, y));
+        c.corners[2]
+            = static_cast<float>(m_model.Declination(lat0 + 1, lon0, 0, y));
+        c.corners[3] = static_cast<float>(
+            m_model.Declination(lat0 + 1, lon0 + 1, 0, y));
+    }
+    // Interpolate the angles relative to the first corner so that cells
+    // where the variation crosses +-180 degrees work too
+    const double fx = lon - lon0;
+    const double fy = lat - lat0;
+    auto rel = [&c](int i) {
+        return std::remainder(double(c.corners[i]) - c.corners[0], 2.0 * PI);
+    };
+    const double south = rel(1) * fx;
+    const double north = rel(2) + (rel(3) - rel(2)) * fx;
+    return std::remainder(
+        c.corners[0] + south + (north - south) * fy, 2.0 * PI);
+}
+
+PLUGIN_END_NAMESPACE
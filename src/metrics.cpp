@@ -0,0 +1,117 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "metrics.h"
+
+#include <algorithm>
+
+PLUGIN_BEGIN_NAMESPACE
+
+void latency_histogram::Record(std::chrono::nanoseconds d)
+{
+    auto ns = static_cast<uint64_t>(std::max<int64_t>(d.count(), 1));
+    size_t bucket = 0;
+    while (ns > 1 && bucket < BUCKETS - 1) {
+        ns >>= 1;
+        ++bucket;
+    }
+    ++buckets[bucket];
+}
+
+uint64_t latency_histogram::Count() const
+{
+    uint64_t count = 0;
+    for (auto b : buckets) {
+        count += b;
+    }
+    return count;
+}
+
+std::chrono::nanoseconds latency_histogram::Percentile(double p) const
+{
+    const uint64_t count = Count();
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const auto rank = static_cast<uint64_t>(
+        std::max(1.0, std::min(p, 100.0) / 100.0 * static_cast<double>(count)));
+    uint64_t seen = 0;
+    size_t bucket = 0;
+    for (; bucket < BUCKETS - 1; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    return std::chrono::nanoseconds(uint64_t(1) << (bucket + 1));
+}
+
+PipelineMetrics::PipelineMetrics()
+    : m_live()
+{
+}
+
+void PipelineMetrics::CountSentence(std::string_view stc)
+{
+    // "$GPGGA,..." or "!AIVDM,...", the tag follows the talker ID
+    if (stc.size() < 6) {
+        return;
+    }
+    const std::string_view tag = stc.substr(3, 3);
+    const auto used = static_cast<size_t>(m_live.sentence_count);
+    for (size_t i = 0; i < used; ++i) {
+        sentence_counter& c = m_live.sentences[i];
+        if (tag.compare(0, tag.size(), c.tag, 3) == 0) {
+            ++c.count;
+            return;
+        }
+    }
+    if (used == m_live.sentences.size()) {
+        return;
+    }
+    sentence_counter& c = m_live.sentences[used];
+    std::memset(c.tag, 0, sizeof(c.tag));
+    std::memcpy(c.tag, tag.data(), tag.size());
+    c.count = 1;
+    ++m_live.sentence_count;
+}
+
+void PipelineMetrics::Allocated(size_t bytes)
+{
+    m_live.allocated = bytes;
+    m_live.allocated_peak = std::max<uint64_t>(m_live.allocated_peak, bytes);
+}
+
+void PipelineMetrics::Publish(std::chrono::steady_clock::time_point now)
+{
+    m_published = now;
+    m_live.taken = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch())
+                       .count();
+    m_snapshot.Store(m_live);
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,161 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_framer.h"
+#include "byte_scan.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+NMEAFramer::NMEAFramer(size_t max_sentence)
+    : m_max_sentence(max_sentence)
+    , m_pos(0)
+    , m_in_sentence(false)
+    , m_carried(false)
+    , m_start(0)
+    , m_carry_out(false)
+    , m_sentences(0)
+    , m_discarded(0)
+    , m_truncated(0)
+    , m_overlong(0)
+{
+    m_carry.reserve(max_sentence);
+}
+
+void NMEAFramer::Feed(std::string_view data)
+{
+    if (m_carry_out) {
+        m_carry.clear();
+        m_carry_out = false;
+    }
+    m_data = data;
+    m_pos = 0;
+    m_start = 0;
+    m_carried = m_in_sentence;
+}
+
+void NMEAFramer::Drop(size_t length)
+{
+    m_discarded += length;
+    m_in_sentence = false;
+    m_carried = false;
+    m_carry.clear();
+}
+
+bool NMEAFramer::Next(std::string_view& sentence)
+{
+    if (m_carry_out) {
+        m_carry.clear();
+        m_carry_out = false;
+    }
+    const auto& kernels = ByteScan::Best();
+    while (m_pos < m_data.size()) {
+        const size_t next = m_pos
+            + kernels.boundary(m_data.data() + m_pos, m_data.size() - m_pos);
+        if (!m_in_sentence) {
+            m_discarded += next - m_pos;
+            if (next < m_data.size()
+                && (m_data[next] == '$' || m_data[next] == '!')) {
+                m_in_sentence = true;
+                m_start = next;
+            }
+            m_pos = next + 1;
+            continue;
+        }
+        const size_t length
+            = m_carried ? m_carry.size() + next : next - m_start;
+        if (length > m_max_sentence) {
+            ++m_overlong;
+            Drop(length);
+            m_pos = next;
+            continue;
+        }
+        if (next == m_data.size()) {
+            break;
+        }
+        if (m_data[next] == '$' || m_data[next] == '!') {
+            ++m_truncated;
+            Drop(length);
+            m_in_sentence = true;
+            m_start = next;
+            m_pos = next + 1;
+            continue;
+        }
+        // End of the line
+        m_in_sentence = false;
+        m_pos = next + 1;
+        if (m_carried) {
+            m_carried = false;
+            m_carry.append(m_data.data(), next);
+            m_carry_out = true;
+            sentence = m_carry;
+        } else {
+            sentence = m_data.substr(m_start, length);
+        }
+        ++m_sentences;
+        return true;
+    }
+    // Keep the beginning of the sentence for the next piece
+    if (m_in_sentence) {
+        if (m_carried) {
+            m_carry.append(m_data.data(), m_data.size());
+        } else {
+            m_carry.assign(m_data.data() + m_start, m_data.size() - m_start);
+        }
+        m_carried = true;
+    }
+    m_data = std::string_view();
+    m_pos = 0;
+    return false;
+}
+
+bool NMEAFramer::Flush(std::string_view& sentence)
+{
+    if (m_carry_out) {
+        m_carry.clear();
+        m_carry_out = false;
+    }
+    if (!m_in_sentence || !m_carried) {
+        return false;
+    }
+    m_in_sentence = false;
+    m_carried = false;
+    m_carry_out = true;
+    sentence = m_carry;
+    ++m_sentences;
+    return true;
+}
+
+void NMEAFramer::Reset()
+{
+    m_in_sentence = false;
+    m_carried = false;
+    m_carry.clear();
+    m_carry_out = false;
+    m_data = std::string_view();
+    m_pos = 0;
+}
+
+PLUGIN_END_NAMESPACE
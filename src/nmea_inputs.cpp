@@ -0,0 +1,461 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_inputs.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// Longest time the thread of the inputs sleeps
+constexpr std::chrono::milliseconds MAX_WAIT(1000);
+/// Datagrams read from an UDP input per readiness
+constexpr size_t MAX_DATAGRAMS = 64;
+
+/// @brief Return the termios speed of a baud rate, B0 if not supported
+speed_t Speed(uint32_t baud)
+{
+    switch (baud) {
+    case 1200:
+        return B1200;
+    case 2400:
+        return B2400;
+    case 4800:
+        return B4800;
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    case 230400:
+        return B230400;
+    default:
+        return B0;
+    }
+}
+
+/// @brief Resolve the address of a TCP or UDP input
+addrinfo* Resolve(const input_config& cfg, int socktype)
+{
+    addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = socktype;
+    hints.ai_flags = cfg.host.empty() ? AI_PASSIVE : 0;
+    addrinfo* res = nullptr;
+    const std::string port = std::to_string(cfg.port);
+    if (getaddrinfo(cfg.host.empty() ? nullptr : cfg.host.c_str(),
+            port.c_str(), &hints, &res)
+        != 0) {
+        return nullptr;
+    }
+    return res;
+}
+}
+
+input_config input_config::FromJSON(const Value& v)
+{
+    input_config cfg;
+    if (!v.IsObject()) {
+        return cfg;
+    }
+    if (v.HasMember("type") && v["type"].IsString()) {
+        cfg.type = v["type"].GetString();
+    }
+    if (v.HasMember("path") && v["path"].IsString()) {
+        cfg.path = v["path"].GetString();
+    }
+    if (v.HasMember("baud") && v["baud"].IsUint()) {
+        cfg.baud = v["baud"].GetUint();
+    }
+    if (v.HasMember("host") && v["host"].IsString()) {
+        cfg.host = v["host"].GetString();
+    }
+    if (v.HasMember("port") && v["port"].IsUint()) {
+        cfg.port = static_cast<uint16_t>(v["port"].GetUint());
+    }
+    if (v.HasMember("reconnect") && v["reconnect"].IsUint()) {
+        cfg.reconnect = std::chrono::milliseconds(v["reconnect"].GetUint());
+    }
+    if (v.HasMember("max_sentence") && v["max_sentence"].IsUint()) {
+        cfg.max_sentence = std::max(16u, v["max_sentence"].GetUint());
+    }
+    return cfg;
+}
+
+Value input_config::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("type", type, allocator);
+    if (!path.empty()) {
+        v.AddMember("path", path, allocator);
+        v.AddMember("baud", baud, allocator);
+    }
+    if (!host.empty()) {
+        v.AddMember("host", host, allocator);
+    }
+    if (port != 0) {
+        v.AddMember("port", port, allocator);
+    }
+    v.AddMember(
+        "reconnect", static_cast<uint64_t>(reconnect.count()), allocator);
+    v.AddMember("max_sentence", static_cast<uint64_t>(max_sentence), allocator);
+    return v;
+}
+
+NMEAInputs::NMEAInputs(handler h)
+    : m_handler(std::move(h))
+    , m_stop(false)
+    , m_buffer(BURST)
+{
+}
+
+NMEAInputs::~NMEAInputs() { Stop(); }
+
+size_t NMEAInputs::Add(const input_config& cfg)
+{
+    m_inputs.push_back(std::make_unique<input>(cfg));
+    return m_inputs.size() - 1;
+}
+
+void NMEAInputs::Clear() { m_inputs.clear(); }
+
+bool NMEAInputs::Start()
+{
+    if (Running()) {
+        return true;
+    }
+    m_loop = std::make_unique<EventLoop>();
+    if (!m_loop->Valid()) {
+        m_loop.reset();
+        return false;
+    }
+    for (size_t i = 0; i < m_inputs.size(); ++i) {
+        Open(i);
+    }
+    m_stop = false;
+    m_thread = std::thread(&NMEAInputs::Run, this);
+    return true;
+}
+
+void NMEAInputs::Stop()
+{
+    if (!Running()) {
+        return;
+    }
+    m_stop = true;
+    m_loop->Wake();
+    m_thread.join();
+    for (size_t i = 0; i < m_inputs.size(); ++i) {
+        Close(i, false);
+    }
+    m_loop.reset();
+}
+
+input_stats NMEAInputs::Stats(size_t index) const
+{
+    const input& in = *m_inputs[index];
+    input_stats s;
+    s.open = in.open;
+    s.bytes = in.bytes;
+    s.datagrams = in.datagrams;
+    s.sentences = in.sentences;
+    s.discarded = in.discarded;
+    s.broken = in.broken;
+    s.opens = in.opens;
+    s.errors = in.errors;
+    s.kernel_drops = in.kernel_drops;
+    s.backlog = in.backlog;
+    return s;
+}
+
+void NMEAInputs::Run()
+{
+    while (!m_stop) {
+        const int wait = Retry();
+        m_loop->Poll(wait < 0 ? static_cast<int>(MAX_WAIT.count())
+                              : std::min(wait,
+                                  static_cast<int>(MAX_WAIT.count())));
+    }
+}
+
+bool NMEAInputs::Open(size_t index)
+{
+    input& in = *m_inputs[index];
+    int fd = -1;
+    if (in.cfg.type == "serial") {
+        fd = OpenSerial(in);
+    } else if (in.cfg.type == "tcp") {
+        fd = OpenTCP(in);
+    } else if (in.cfg.type == "udp") {
+        fd = OpenUDP(in);
+    }
+    if (fd < 0) {
+        ++in.errors;
+        in.retry = std::chrono::steady_clock::now() + in.cfg.reconnect;
+        return false;
+    }
+    in.fd = fd;
+    in.framer.Reset();
+    const uint32_t events = in.connecting ? EPOLLOUT : EPOLLIN;
+    if (!m_loop->Add(
+            fd, events, [this, index](uint32_t ev) { OnEvent(index, ev); })) {
+        Close(index, true);
+        return false;
+    }
+    if (!in.connecting) {
+        in.open = true;
+        ++in.opens;
+    }
+    return true;
+}
+
+int NMEAInputs::OpenSerial(input& in)
+{
+    const int fd
+        = open(in.cfg.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        const speed_t speed = Speed(in.cfg.baud);
+        if (speed != B0) {
+            cfsetispeed(&tio, speed);
+            cfsetospeed(&tio, speed);
+        }
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+int NMEAInputs::OpenTCP(input& in)
+{
+    addrinfo* res = Resolve(in.cfg, SOCK_STREAM);
+    if (res == nullptr) {
+        return -1;
+    }
+    int fd = socket(res->ai_family,
+        res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+    if (fd >= 0) {
+        if (connect(fd, res->ai_addr, res->ai_addrlen) == 0) {
+            in.connecting = false;
+        } else if (errno == EINPROGRESS) {
+            in.connecting = true;
+        } else {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int NMEAInputs::OpenUDP(input& in)
+{
+    addrinfo* res = Resolve(in.cfg, SOCK_DGRAM);
+    if (res == nullptr) {
+        return -1;
+    }
+    int fd = socket(res->ai_family,
+        res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+    if (fd >= 0) {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        // Report the number of the datagrams dropped by the kernel
+        setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+        if (bind(fd, res->ai_addr, res->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) {
+        sockaddr_in addr {};
+        socklen_t len = sizeof(addr);
+        if (getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+            in.port = ntohs(addr.sin_port);
+        }
+    }
+    return fd;
+}
+
+void NMEAInputs::Close(size_t index, bool failed)
+{
+    input& in = *m_inputs[index];
+    if (in.fd >= 0) {
+        m_loop->Remove(in.fd);
+        close(in.fd);
+        in.fd = -1;
+    }
+    if (failed) {
+        ++in.errors;
+    }
+    in.open = false;
+    in.connecting = false;
+    in.port = 0;
+    in.backlog = 0;
+    in.framer.Reset();
+    in.retry = std::chrono::steady_clock::now() + in.cfg.reconnect;
+}
+
+void NMEAInputs::OnEvent(size_t index, uint32_t events)
+{
+    input& in = *m_inputs[index];
+    if (in.connecting) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(in.fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0
+            || error != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+            Close(index, true);
+            return;
+        }
+        in.connecting = false;
+        in.open = true;
+        ++in.opens;
+        m_loop->Modify(in.fd, EPOLLIN);
+        return;
+    }
+    // Read what is left before handling the hang up
+    const bool ok = in.cfg.type == "udp" ? ReadDatagrams(in, index)
+                                         : ReadStream(in, index);
+    if (!ok || ((events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN))) {
+        Close(index, true);
+        return;
+    }
+    int pending = 0;
+    if (ioctl(in.fd, FIONREAD, &pending) == 0) {
+        in.backlog = static_cast<uint64_t>(pending);
+    }
+}
+
+bool NMEAInputs::ReadStream(input& in, size_t index)
+{
+    const ssize_t n = read(in.fd, m_buffer.data(), m_buffer.size());
+    if (n > 0) {
+        in.bytes += static_cast<uint64_t>(n);
+        Frame(in, index, std::string_view(m_buffer.data(), n), false);
+        return true;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return true;
+    }
+    // End of the stream or a failure (EIO of a hung up terminal)
+    return false;
+}
+
+bool NMEAInputs::ReadDatagrams(input& in, size_t index)
+{
+    char control[CMSG_SPACE(sizeof(uint32_t))];
+    for (size_t i = 0; i < MAX_DATAGRAMS; ++i) {
+        iovec iov { m_buffer.data(), m_buffer.size() };
+        msghdr msg {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        const ssize_t n = recvmsg(in.fd, &msg, 0);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr;
+             c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t dropped;
+                std::memcpy(&dropped, CMSG_DATA(c), sizeof(dropped));
+                in.kernel_drops = dropped;
+            }
+        }
+        ++in.datagrams;
+        in.bytes += static_cast<uint64_t>(n);
+        Frame(in, index, std::string_view(m_buffer.data(), n), true);
+    }
+    return true;
+}
+
+void NMEAInputs::Frame(
+    input& in, size_t index, std::string_view data, bool datagram)
+{
+    in.framer.Feed(data);
+    std::string_view stc;
+    while (in.framer.Next(stc)) {
+        in.sentences.store(in.framer.Sentences(), std::memory_order_relaxed);
+        m_handler(index, stc);
+    }
+    if (datagram && in.framer.Flush(stc)) {
+        in.sentences.store(in.framer.Sentences(), std::memory_order_relaxed);
+        m_handler(index, stc);
+    }
+    in.discarded = in.framer.Discarded();
+    in.broken = in.framer.Truncated() + in.framer.Overlong();
+}
+
+int NMEAInputs::Retry()
+{
+    const auto now = std::chrono::steady_clock::now();
+    int wait = -1;
+    for (size_t i = 0; i < m_inputs.size(); ++i) {
+        input& in = *m_inputs[i];
+        if (in.fd >= 0) {
+            continue;
+        }
+        if (in.retry <= now) {
+            if (Open(i)) {
+                continue;
+            }
+        }
+        const auto due = std::chrono::duration_cast<std::chrono::milliseconds>(
+            in.retry - now);
+        const int ms = static_cast<int>(std::max<int64_t>(1, due.count()));
+        wait = wait < 0 ? ms : std::min(wait, ms);
+    }
+    return wait;
+}
+
+PLUGIN_END_NAMESPACE
+
+#endif // __linux__
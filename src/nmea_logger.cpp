@@ -0,0 +1,592 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_logger.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#ifdef NSK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "time_base.h"
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// How often the worker thread without work wakes up
+constexpr std::chrono::milliseconds IDLE_PERIOD(100);
+/// Room for the time and the separators of a line
+constexpr size_t LINE_OVERHEAD = 24;
+/// Size of the chunks read from a segment
+constexpr size_t READ_CHUNK = 16 * 1024;
+
+/// @brief Return the time as a compact ISO 8601 string usable in a file name
+std::string FileTime(int64_t ms)
+{
+    std::string iso = TimeBase::Format(ms);
+    iso.erase(iso.find('.'), 4);
+    iso.erase(std::remove_if(iso.begin(), iso.end(),
+                  [](char c) { return c == '-' || c == ':'; }),
+        iso.end());
+    return iso;
+}
+
+/// @brief Return whether the file name is a segment written by the logger
+bool IsSegment(const std::string& name)
+{
+    auto ends_with = [&name](std::string_view suffix) {
+        return name.size() > suffix.size()
+            && name.compare(name.size() - suffix.size(), suffix.size(),
+                   suffix.data(), suffix.size())
+            == 0;
+    };
+    return name.compare(0, 5, "nmea-") == 0
+        && (ends_with(".log") || ends_with(".log.gz"));
+}
+
+/// @brief Return the name of the segment without the extension, which sorts
+/// the segments by their start
+std::string SegmentStem(const std::string& path)
+{
+    return path.substr(0, path.find(".log", path.find_last_of("/\\") + 1));
+}
+
+/// @brief Parse the lines of a decompressed block
+void ParseLines(std::string& pending, int64_t from, int64_t to,
+    std::vector<logged_sentence>& out)
+{
+    size_t start = 0;
+    size_t eol;
+    while ((eol = pending.find('\n', start)) != std::string::npos) {
+        std::string_view line(pending.data() + start, eol - start);
+        start = eol + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        const size_t space = line.find(' ');
+        if (space == std::string_view::npos) {
+            continue;
+        }
+        int64_t time = 0;
+        if (std::from_chars(line.data(), line.data() + space, time).ec
+            != std::errc()) {
+            continue;
+        }
+        if (time >= from && time <= to) {
+            out.push_back({ time, std::string(line.substr(space + 1)) });
+        }
+    }
+    pending.erase(0, start);
+}
+}
+
+#ifdef NSK_HAVE_ZLIB
+struct NMEALogger::deflater {
+    z_stream stream {};
+    bool initialized = false;
+    /// Compressed block
+    std::vector<unsigned char> out;
+
+    ~deflater()
+    {
+        if (initialized) {
+            deflateEnd(&stream);
+        }
+    }
+
+    /// @brief Compress data into a complete gzip member
+    bool Compress(const std::string& data, int level)
+    {
+        if (!initialized) {
+            // 15 + 16 selects the gzip wrapper with the largest window
+            if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+                    Z_DEFAULT_STRATEGY)
+                != Z_OK) {
+                return false;
+            }
+            initialized = true;
+        } else if (deflateReset(&stream) != Z_OK) {
+            return false;
+        }
+        out.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+        stream.next_in = reinterpret_cast<Bytef*>(
+            const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+        if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+            return false;
+        }
+        out.resize(out.size() - stream.avail_out);
+        return true;
+    }
+};
+#else
+/// Without zlib the blocks are written as they are
+struct NMEALogger::deflater {
+    /// Block
+    std::vector<unsigned char> out;
+
+    /// @brief Copy the data
+    bool Compress(const std::string& data, int /*level*/)
+    {
+        out.assign(data.begin(), data.end());
+        return true;
+    }
+};
+#endif
+
+logger_config logger_config::FromJSON(const Value& v)
+{
+    logger_config cfg;
+    if (!v.IsObject()) {
+        return cfg;
+    }
+    if (v.HasMember("enabled") && v["enabled"].IsBool()) {
+        cfg.enabled = v["enabled"].GetBool();
+    }
+    if (v.HasMember("directory") && v["directory"].IsString()) {
+        cfg.directory = v["directory"].GetString();
+    }
+    if (v.HasMember("block_bytes") && v["block_bytes"].IsUint()) {
+        cfg.block_bytes = std::max(1024u, v["block_bytes"].GetUint());
+    }
+    if (v.HasMember("flush_interval") && v["flush_interval"].IsUint()) {
+        cfg.flush_interval
+            = std::chrono::milliseconds(v["flush_interval"].GetUint());
+    }
+    if (v.HasMember("segment_bytes") && v["segment_bytes"].IsUint64()) {
+        cfg.segment_bytes = v["segment_bytes"].GetUint64();
+    }
+    if (v.HasMember("segment_duration") && v["segment_duration"].IsUint()) {
+        cfg.segment_duration
+            = std::chrono::seconds(v["segment_duration"].GetUint());
+    }
+    if (v.HasMember("segments") && v["segments"].IsUint()) {
+        cfg.segments = v["segments"].GetUint();
+    }
+    if (v.HasMember("queue") && v["queue"].IsUint()) {
+        cfg.queue = std::max(1u, v["queue"].GetUint());
+    }
+    if (v.HasMember("level") && v["level"].IsInt()) {
+        cfg.level = std::clamp(v["level"].GetInt(), 0, 9);
+    }
+    return cfg;
+}
+
+Value logger_config::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("enabled", enabled, allocator);
+    if (!directory.empty()) {
+        v.AddMember("directory", directory, allocator);
+    }
+    v.AddMember("block_bytes", static_cast<uint64_t>(block_bytes), allocator);
+    v.AddMember("flush_interval",
+        static_cast<uint64_t>(flush_interval.count()), allocator);
+    v.AddMember(
+        "segment_bytes", static_cast<uint64_t>(segment_bytes), allocator);
+    v.AddMember("segment_duration",
+        static_cast<uint64_t>(segment_duration.count()), allocator);
+    v.AddMember("segments", static_cast<uint64_t>(segments), allocator);
+    v.AddMember("queue", static_cast<uint64_t>(queue), allocator);
+    v.AddMember("level", level, allocator);
+    return v;
+}
+
+NMEALogger::NMEALogger()
+    : m_busy(false)
+    , m_stop(false)
+    , m_running(false)
+    , m_deflater(new deflater())
+    , m_segment_size(0)
+    , m_segment_start(0)
+    , m_logged(0)
+    , m_written(0)
+    , m_dropped(0)
+    , m_errors(0)
+    , m_segment_count(0)
+{
+}
+
+NMEALogger::~NMEALogger() { Stop(); }
+
+void NMEALogger::Configure(const logger_config& cfg)
+{
+    Stop();
+    m_cfg = cfg;
+    Start();
+}
+
+void NMEALogger::SetDefaultDirectory(const std::string& directory)
+{
+    m_default_directory = directory;
+}
+
+std::string NMEALogger::Directory() const
+{
+    return m_cfg.directory.empty() ? m_default_directory : m_cfg.directory;
+}
+
+void NMEALogger::Start()
+{
+    if (!m_cfg.enabled || Directory().empty() || m_thread.joinable()) {
+        return;
+    }
+    m_stop = false;
+    m_current.data.reserve(m_cfg.block_bytes);
+    ScanSegments();
+    PruneSegments();
+    m_running = true;
+    m_thread = std::thread(&NMEALogger::Run, this);
+}
+
+void NMEALogger::Stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        Seal();
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void NMEALogger::Log(std::string_view stc, int64_t time)
+{
+    if (!m_running.load(std::memory_order_relaxed)) {
+        return;
+    }
+    char stamp[24];
+    const auto stamped = std::to_chars(stamp, stamp + sizeof(stamp), time);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_logged;
+    if (m_current.count != 0
+        && m_current.data.size() + stc.size() + LINE_OVERHEAD
+            > m_cfg.block_bytes) {
+        Seal();
+    }
+    if (m_current.count == 0) {
+        m_current.first = time;
+        m_current.started = std::chrono::steady_clock::now();
+    }
+    m_current.data.append(stamp, stamped.ptr);
+    m_current.data.push_back(' ');
+    m_current.data.append(stc);
+    m_current.data.append("\r\n");
+    ++m_current.count;
+}
+
+void NMEALogger::Seal()
+{
+    if (m_current.count == 0) {
+        return;
+    }
+    if (m_queue.size() < m_cfg.queue) {
+        m_queue.push_back(std::move(m_current));
+        m_cv.notify_one();
+    } else {
+        // The disk is behind, keep what is queued contiguous
+        m_dropped += m_current.count;
+    }
+    m_current.data.clear();
+    if (m_current.data.capacity() == 0) {
+        if (!m_spare.empty()) {
+            m_current.data.swap(m_spare.back());
+            m_spare.pop_back();
+        } else {
+            m_current.data.reserve(m_cfg.block_bytes);
+        }
+    }
+    m_current.count = 0;
+}
+
+void NMEALogger::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable()) {
+        return;
+    }
+    Seal();
+    m_cv.notify_one();
+    m_idle.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+}
+
+std::string NMEALogger::Segment() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_segment_path;
+}
+
+bool NMEALogger::OpenSegment(int64_t time)
+{
+    CloseSegment();
+    const std::string base = Directory() + "nmea-" + FileTime(time);
+    std::string path = base + Extension();
+    // Segments started within the same second (or by an earlier run) get a
+    // suffix
+    for (int n = 1; std::find(m_segment_paths.begin(), m_segment_paths.end(),
+                        path)
+         != m_segment_paths.end();
+         ++n) {
+        path = base + "-" + std::to_string(n) + Extension();
+    }
+    m_segment.open(path, std::ios::binary | std::ios::trunc);
+    m_index.open(IndexPath(path), std::ios::trunc);
+    if (!m_segment.is_open() || !m_index.is_open()) {
+        CloseSegment();
+        return false;
+    }
+    m_segment_size = 0;
+    m_segment_start = time;
+    ++m_segment_count;
+    m_segment_paths.push_back(path);
+    PruneSegments();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_segment_path = std::move(path);
+    return true;
+}
+
+void NMEALogger::ScanSegments()
+{
+    m_segment_paths.clear();
+    std::error_code ec;
+    std::filesystem::directory_iterator it(Directory(), ec);
+    for (; !ec && it != std::filesystem::directory_iterator();
+         it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (IsSegment(name)) {
+            // Keep the path in the form OpenSegment builds it
+            m_segment_paths.push_back(Directory() + name);
+        }
+    }
+    std::sort(m_segment_paths.begin(), m_segment_paths.end(),
+        [](const std::string& a, const std::string& b) {
+            return SegmentStem(a) < SegmentStem(b);
+        });
+}
+
+void NMEALogger::PruneSegments()
+{
+    while (m_cfg.segments != 0 && m_segment_paths.size() > m_cfg.segments) {
+        std::remove(m_segment_paths.front().c_str());
+        std::remove(IndexPath(m_segment_paths.front()).c_str());
+        m_segment_paths.pop_front();
+    }
+}
+
+void NMEALogger::CloseSegment()
+{
+    m_segment.close();
+    m_index.close();
+    m_segment.clear();
+    m_index.clear();
+}
+
+void NMEALogger::Write(block& b)
+{
+    const auto span = std::chrono::milliseconds(b.first - m_segment_start);
+    if (!m_segment.is_open() || m_segment_size >= m_cfg.segment_bytes
+        || span >= m_cfg.segment_duration
+        || span < std::chrono::milliseconds::zero()) {
+        OpenSegment(b.first);
+    }
+    if (!m_segment.is_open() || !m_deflater->Compress(b.data, m_cfg.level)) {
+        m_dropped += b.count;
+        ++m_errors;
+        return;
+    }
+    const auto& out = m_deflater->out;
+    m_segment.write(reinterpret_cast<const char*>(out.data()), out.size());
+    m_segment.flush();
+    if (!m_segment.good()) {
+        // Most likely the disk is full, try a new segment with the next block
+        CloseSegment();
+        m_dropped += b.count;
+        ++m_errors;
+        return;
+    }
+    char entry[64];
+    std::snprintf(entry, sizeof(entry), "%" PRId64 " %" PRIu64 " %" PRIu32 "\n",
+        b.first, m_segment_size, b.count);
+    m_index << entry;
+    m_index.flush();
+    m_segment_size += out.size();
+    m_written += b.count;
+}
+
+void NMEALogger::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (!m_queue.empty()) {
+            block b = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_busy = true;
+            lock.unlock();
+            Write(b);
+            lock.lock();
+            m_busy = false;
+            b.data.clear();
+            m_spare.push_back(std::move(b.data));
+            continue;
+        }
+        m_idle.notify_all();
+        if (m_stop) {
+            break;
+        }
+        m_cv.wait_for(lock, IDLE_PERIOD);
+        if (m_current.count != 0
+            && std::chrono::steady_clock::now() - m_current.started
+                >= m_cfg.flush_interval) {
+            Seal();
+        }
+    }
+    lock.unlock();
+    CloseSegment();
+}
+
+const char* NMEALogger::Extension()
+{
+#ifdef NSK_HAVE_ZLIB
+    return ".log.gz";
+#else
+    return ".log";
+#endif
+}
+
+std::string NMEALogger::IndexPath(const std::string& segment)
+{
+    return segment + ".idx";
+}
+
+std::vector<log_index_entry> NMEALogger::Index(const std::string& segment)
+{
+    std::vector<log_index_entry> index;
+    std::ifstream in(IndexPath(segment));
+    std::string line;
+    while (std::getline(in, line)) {
+        log_index_entry e {};
+        if (std::sscanf(line.c_str(), "%" SCNd64 " %" SCNu64 " %" SCNu32,
+                &e.time, &e.offset, &e.count)
+            == 3) {
+            index.push_back(e);
+        }
+    }
+    return index;
+}
+
+std::vector<logged_sentence> NMEALogger::Read(
+    const std::string& segment, int64_t from, int64_t to)
+{
+    std::vector<logged_sentence> out;
+    std::ifstream in(segment, std::ios::binary);
+    if (!in.is_open()) {
+        return out;
+    }
+    // Read from the last block starting before the range up to the
+    // first block starting after it
+    uint64_t begin = 0;
+    uint64_t end = std::numeric_limits<uint64_t>::max();
+    for (const auto& e : Index(segment)) {
+        if (e.time <= from) {
+            begin = e.offset;
+        } else if (e.time > to) {
+            end = e.offset;
+            break;
+        }
+    }
+    in.seekg(static_cast<std::streamoff>(begin));
+    uint64_t remaining = end - begin;
+    std::vector<char> input(READ_CHUNK);
+    std::string pending;
+    const bool gzip = segment.size() > 3
+        && segment.compare(segment.size() - 3, 3, ".gz") == 0;
+    if (!gzip) {
+        while (remaining > 0 && in) {
+            in.read(input.data(),
+                static_cast<std::streamsize>(std::min<uint64_t>(
+                    input.size(), remaining)));
+            const auto n = static_cast<size_t>(in.gcount());
+            if (n == 0) {
+                break;
+            }
+            remaining -= n;
+            pending.append(input.data(), n);
+            ParseLines(pending, from, to, out);
+        }
+        return out;
+    }
+#ifdef NSK_HAVE_ZLIB
+    z_stream stream {};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        return out;
+    }
+    std::vector<char> output(READ_CHUNK * 4);
+    while (remaining > 0 && in) {
+        in.read(input.data(),
+            static_cast<std::streamsize>(std::min<uint64_t>(
+                input.size(), remaining)));
+        const auto n = static_cast<size_t>(in.gcount());
+        if (n == 0) {
+            break;
+        }
+        remaining -= n;
+        stream.next_in = reinterpret_cast<Bytef*>(input.data());
+        stream.avail_in = static_cast<uInt>(n);
+        do {
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            const int ret = inflate(&stream, Z_NO_FLUSH);
+            pending.append(output.data(), output.size() - stream.avail_out);
+            if (ret == Z_STREAM_END) {
+                // The next block is a new gzip member
+                inflateReset(&stream);
+            } else if (ret == Z_BUF_ERROR) {
+                break;
+            } else if (ret != Z_OK) {
+                remaining = 0;
+                break;
+            }
+        } while (stream.avail_in > 0 || stream.avail_out == 0);
+        ParseLines(pending, from, to, out);
+    }
+    inflateEnd(&stream);
+#endif
+    return out;
+}
+
+PLUGIN_END_NAMESPACE
@@ -31,6 +31,8 @@
 #include <fstream>
 
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -52,41 +54,49 @@ using namespace rapidjson;
 using namespace marnav;
 using namespace nmea;
 
-namespace {
-void AddNumber(rapidjson::Value& values_array,
+/// Maximum number of the distinct unparseable sentence addresses kept
+constexpr size_t MAX_UNKNOWN = 256;
+
+/// @brief Return the time of the day of a sentence in milliseconds
+inline int64_t MsOfDay(const nmea::time& t)
+{
+    return ((t.hour() * 60 + t.minutes()) * 60 + t.seconds()) * 1000LL
+        + t.milliseconds();
+}
+
+void NSK::AddUnknown(const std::string& stc)
+{
+    if (m_unknown.size() < MAX_UNKNOWN) {
+        m_unknown.emplace(stc.substr(0, 6));
+    }
+}
+
+void NSK::AddNumber(rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator, const char* path,
     double value)
 {
+    if (!m_subscriptions.Wanted(path)) {
+        return;
+    }
     Value val(kObjectType);
-    val.AddMember("path", Value(path, allocator), allocator);
+    val.AddMember("path", StringRef(path), allocator);
     val.AddMember("value", value, allocator);
     values_array.PushBack(val, allocator);
 }
 
-void AddString(rapidjson::Value& values_array,
+void NSK::AddString(rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator, const char* path,
     const std::string& value)
 {
+    if (!m_subscriptions.Wanted(path)) {
+        return;
+    }
     Value val(kObjectType);
-    val.AddMember("path", Value(path, allocator), allocator);
+    val.AddMember("path", StringRef(path), allocator);
     val.AddMember(
         "value", Value(value.c_str(), value.length(), allocator), allocator);
     values_array.PushBack(val, allocator);
 }
-}
-
-/**
- * Generate a UTC ISO8601-formatted timestamp
- * and return as std::string
- */
-inline std::string currentISO8601TimeUTC()
-{
-    auto now = std::chrono::system_clock::now();
-    auto itt = std::chrono::system_clock::to_time_t(now);
-    std::ostringstream ss;
-    ss << std::put_time(gmtime(&itt), "%FT%TZ");
-    return ss.str();
-}
 
 // Sentence processing implementations
 void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gga> s,
@@ -95,7 +105,8 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gga> s,
 {
     Value val(kObjectType);
     Value pos(kObjectType);
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted("navigation.position")) {
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
         pos.AddMember("longitude", s->get_lon()->get(), allocator);
         if (s->get_altitude().has_value()) {
@@ -105,7 +116,11 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gga> s,
         val.AddMember("value", pos, allocator);
         values_array.PushBack(val, allocator);
     }
-    if (s->get_time().has_value()) {
+    if (s->get_time().has_value() && s->get_lat().has_value()) {
+        m_time.SyncTimeOfDay(MsOfDay(*s->get_time()), m_clock->Steady());
+    }
+    if (s->get_time().has_value()
+        && m_subscriptions.Wanted("environment.time")) {
         Value utc(kObjectType);
         utc.AddMember("path", "environment.time", allocator);
         utc.AddMember("value", to_string(s->get_time()), allocator);
@@ -119,7 +134,8 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gll> s,
 {
     Value val(kObjectType);
     Value pos(kObjectType);
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted("navigation.position")) {
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
         pos.AddMember("longitude", s->get_lon()->get(), allocator);
 
@@ -133,13 +149,15 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gsa> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_hdop().has_value()) {
+    if (s->get_hdop().has_value()
+        && m_subscriptions.Wanted("navigation.gnss.horizontalDilution")) {
         Value val(kObjectType);
         val.AddMember("path", "navigation.gnss.horizontalDilution", allocator);
         val.AddMember("value", s->get_hdop().value(), allocator);
         values_array.PushBack(val, allocator);
     }
-    if (s->get_pdop().has_value()) {
+    if (s->get_pdop().has_value()
+        && m_subscriptions.Wanted("navigation.gnss.positionDilution")) {
         Value val(kObjectType);
         val.AddMember("path", "navigation.gnss.positionDilution", allocator);
         val.AddMember("value", s->get_pdop().value(), allocator);
@@ -152,6 +170,9 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gsv> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
+    if (!m_subscriptions.Wanted("navigation.gnss.satellites")) {
+        return;
+    }
     Value val(kObjectType);
     val.AddMember("path", "navigation.gnss.satellites", allocator);
     val.AddMember("value", s->get_n_satellites_in_view(), allocator);
@@ -162,7 +183,15 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::rmc> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_time_utc().has_value() && s->get_date().has_value()
+        && s->get_lat().has_value()) {
+        const auto& date = *s->get_date();
+        m_time.Sync(static_cast<int>(date.year()),
+            static_cast<int>(date.mon()), static_cast<int>(date.day()),
+            MsOfDay(*s->get_time_utc()), m_clock->Steady());
+    }
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted("navigation.position")) {
         Value val(kObjectType);
         Value pos(kObjectType);
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
@@ -171,22 +200,29 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::rmc> s,
         val.AddMember("value", pos, allocator);
         values_array.PushBack(val, allocator);
     }
+    // RMC carries the track made good, not the heading
     if (s->get_heading().has_value()) {
-        Value hdg(kObjectType);
-        hdg.AddMember("path", "navigation.headingTrue", allocator);
-        hdg.AddMember("value", deg2rad(*s->get_heading()), allocator);
-        values_array.PushBack(hdg, allocator);
+        m_own_cog = deg2rad(*s->get_heading());
+    }
+    if (s->get_heading().has_value()
+        && m_subscriptions.Wanted("navigation.courseOverGroundTrue")) {
+        Value cog(kObjectType);
+        cog.AddMember("path", "navigation.courseOverGroundTrue", allocator);
+        cog.AddMember("value", deg2rad(*s->get_heading()), allocator);
+        values_array.PushBack(cog, allocator);
     }
 
     auto rmc_sog = s->get_sog();
-    if (rmc_sog.has_value()) {
+    if (rmc_sog.has_value()
+        && m_subscriptions.Wanted("navigation.speedOverGround")) {
         Value sog(kObjectType);
         sog.AddMember("path", "navigation.speedOverGround", allocator);
         sog.AddMember("value",
             kn2ms(rmc_sog->get<marnav::units::knots>().value()), allocator);
         values_array.PushBack(sog, allocator);
     }
-    if (s->get_time_utc().has_value()) {
+    if (s->get_time_utc().has_value()
+        && m_subscriptions.Wanted("navigation.datetime")) {
         Value utc(kObjectType);
         utc.AddMember("path", "navigation.datetime", allocator);
         utc.AddMember("value", to_string(s->get_time_utc()), allocator);
@@ -199,17 +235,26 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::vtg> s,
     rapidjson::Document::AllocatorType& allocator)
 {
     if (s->get_track_true().has_value()) {
-        Value hdt(kObjectType);
-        hdt.AddMember("path", "navigation.headingTrue", allocator);
-        hdt.AddMember("value", deg2rad(s->get_track_true().value()), allocator);
-        values_array.PushBack(hdt, allocator);
+        m_own_cog = deg2rad(s->get_track_true().value());
     }
-    if (s->get_track_magn().has_value()) {
+    if (s->get_track_true().has_value()
+        && m_subscriptions.Wanted("navigation.courseOverGroundTrue")) {
+        Value trt(kObjectType);
+        trt.AddMember("path", "navigation.courseOverGroundTrue", allocator);
+        trt.AddMember("value", deg2rad(s->get_track_true().value()), allocator);
+        values_array.PushBack(trt, allocator);
+    }
+    if (s->get_track_magn().has_value()
+        && m_subscriptions.Wanted("navigation.courseOverGroundMagnetic")) {
         Value trm(kObjectType);
-        trm.AddMember("path", "navigation.headingMagnetic", allocator);
+        trm.AddMember(
+            "path", "navigation.courseOverGroundMagnetic", allocator);
         trm.AddMember("value", deg2rad(s->get_track_magn().value()), allocator);
         values_array.PushBack(trm, allocator);
     }
+    if (!m_subscriptions.Wanted("navigation.speedOverGround")) {
+        return;
+    }
     if (s->get_speed_kn().has_value()) {
         Value sog(kObjectType);
         sog.AddMember("path", "navigation.speedOverGround", allocator);
@@ -227,6 +272,9 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::dbt> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
+    if (!m_subscriptions.Wanted("environment.depth.belowTransducer")) {
+        return;
+    }
     if (s->get_depth_meter().has_value()) {
         Value dbt(kObjectType);
         dbt.AddMember("path", "environment.depth.belowTransducer", allocator);
@@ -305,7 +353,8 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::gns> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted("navigation.position")) {
         Value pos(kObjectType);
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
         pos.AddMember("longitude", s->get_lon()->get(), allocator);
@@ -450,7 +499,9 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::rmb> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted(
+            "navigation.courseRhumbline.nextPoint.position")) {
         Value pos(kObjectType);
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
         pos.AddMember("longitude", s->get_lon()->get(), allocator);
@@ -517,7 +568,8 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::vdr> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_degrees_true().has_value() && s->get_speed().has_value()) {
+    if (s->get_degrees_true().has_value() && s->get_speed().has_value()
+        && m_subscriptions.Wanted("environment.current")) {
         Value cur(kObjectType);
         cur.AddMember("setTrue", deg2rad(*s->get_degrees_true()), allocator);
         cur.AddMember("drift",
@@ -635,6 +687,10 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::zda> s,
     rapidjson::Document::AllocatorType& allocator)
 {
     if (s->get_time_utc().has_value() && s->get_date().has_value()) {
+        const auto& date = *s->get_date();
+        m_time.Sync(static_cast<int>(date.year()),
+            static_cast<int>(date.mon()), static_cast<int>(date.day()),
+            MsOfDay(*s->get_time_utc()), m_clock->Steady());
         AddString(values_array, allocator, "navigation.datetime",
             to_string(*s->get_date()) + "T" + to_string(*s->get_time_utc())
                 + "Z");
@@ -661,7 +717,9 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::bwc> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted(
+            "navigation.courseGreatCircle.nextPoint.position")) {
         Value pos(kObjectType);
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
         pos.AddMember("longitude", s->get_lon()->get(), allocator);
@@ -692,7 +750,9 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::bwr> s,
     rapidjson::Value& values_array,
     rapidjson::Document::AllocatorType& allocator)
 {
-    if (s->get_lat().has_value() && s->get_lon().has_value()) {
+    if (s->get_lat().has_value() && s->get_lon().has_value()
+        && m_subscriptions.Wanted(
+            "navigation.courseRhumbline.nextPoint.position")) {
         Value pos(kObjectType);
         pos.AddMember("latitude", s->get_lat()->get(), allocator);
         pos.AddMember("longitude", s->get_lon()->get(), allocator);
@@ -755,16 +815,298 @@ void NSK::ProcessSentence(std::unique_ptr<marnav::nmea::apb> s,
 
 // --- End of sentence processing implementations
 
-void NSK::ProcessNMEASentence(
-    const std::string& stc, rapidjson::Document* outdoc)
+void NSK::CountIncoming()
 {
-    if (chrono::system_clock::now() - m_counters_start > 5s) {
-        m_counters_start = chrono::system_clock::now();
+    const auto now = m_clock->System();
+    if (now - m_counters_start > 5s) {
+        m_counters_start = now;
         m_nmea_received = 0;
         m_sk_produced = 0;
     }
     ++m_nmea_received;
     ++m_nmea_received_total;
+}
+
+void NSK::PublishMetrics(std::chrono::steady_clock::time_point now)
+{
+    if (!m_metrics.Due(now)) {
+        return;
+    }
+    metrics_snapshot& m = m_metrics.Live();
+    m.nmea_total = m_nmea_received_total;
+    m.sk_total = m_sk_produced_total;
+    m.errors = m_nmea_errors;
+    m.ignored = m_ignored;
+    m.skipped = m_subscriptions.Skipped();
+    m.suppressed = m_priorities.Suppressed();
+    m.dropped = 0;
+    m.queue_depth = 0;
+    for (const auto& sink : m_sinks.Sinks()) {
+        m.dropped += sink->Dropped();
+        m.queue_depth += sink->QueueDepth();
+    }
+    m_metrics.Publish(now);
+    m_traffic.Publish(now);
+}
+
+void NSK::SendDelta(rapidjson::Document& d, rapidjson::Document* outdoc)
+{
+    m_metrics.Allocated(d.GetAllocator().Size());
+    {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_state.Update(d);
+    }
+    if (outdoc != nullptr) {
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        d.Accept(writer);
+        outdoc->Parse<0>(buffer.GetString());
+    }
+    // The consumers expect a single delta in a message, the deltas of a batch
+    // are published one by one
+    if (d.IsArray()) {
+        for (const auto& delta : d.GetArray()) {
+            PublishDelta(delta);
+        }
+    } else {
+        PublishDelta(d);
+    }
+}
+
+void NSK::PublishDelta(const rapidjson::Value& delta)
+{
+    ++m_sk_produced;
+    ++m_sk_produced_total;
+    const auto start = std::chrono::steady_clock::now();
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    delta.Accept(writer);
+    const auto serialized = std::chrono::steady_clock::now();
+    m_metrics.Record(pipeline_stage::SERIALIZE, serialized - start);
+    const std::string_view json(buffer.GetString(), buffer.GetSize());
+    m_recorder.Delta(json);
+    m_sinks.Publish(delta, json, m_clock->Steady());
+    m_metrics.Record(pipeline_stage::PUBLISH,
+        std::chrono::steady_clock::now() - serialized);
+}
+
+void NSK::SendSnapshot(rapidjson::Document* outdoc)
+{
+    std::string snapshot = m_state.Snapshot();
+    if (outdoc != nullptr) {
+        outdoc->Parse<0>(snapshot.c_str());
+    }
+    SendPluginMessage("NSK_PI_SIGNALK_SNAPSHOT", snapshot);
+}
+
+void NSK::ProcessSubscription(const std::string& request)
+{
+    Document d;
+    d.Parse(request.c_str());
+    if (d.HasParseError() || !d.IsObject()) {
+        return;
+    }
+    // The plugins are kept apart from each other and from the sinks, so that
+    // one plugin unsubscribing can't drop the paths another one asked for
+    std::string consumer = "plugin.";
+    if (d.HasMember("consumer") && d["consumer"].IsString()) {
+        consumer += d["consumer"].GetString();
+    } else if (d.HasMember("sender") && d["sender"].IsString()) {
+        consumer += d["sender"].GetString();
+    } else {
+        consumer += "anonymous";
+    }
+    if (d.HasMember("unsubscribe") && d["unsubscribe"].IsArray()) {
+        for (const auto& u : d["unsubscribe"].GetArray()) {
+            if (u.IsObject() && u.HasMember("path") && u["path"].IsString()) {
+                m_subscriptions.Unsubscribe(consumer, u["path"].GetString());
+            }
+        }
+    }
+    if (d.HasMember("subscribe") && d["subscribe"].IsArray()) {
+        for (const auto& sub : d["subscribe"].GetArray()) {
+            if (sub.IsObject() && sub.HasMember("path")
+                && sub["path"].IsString()) {
+                m_subscriptions.Subscribe(consumer, sub["path"].GetString());
+            }
+        }
+    }
+}
+
+void NSK::ArbitrateSources(rapidjson::Value& values_array,
+    const std::string& talker_tag, const std::string& tag,
+    std::chrono::steady_clock::time_point now)
+{
+    const auto tt_id = m_priorities.Source(talker_tag);
+    const auto tag_id = m_priorities.Source(tag);
+    for (auto it = values_array.Begin(); it != values_array.End();) {
+        const auto path = SKPaths::Find((*it)["path"].GetString());
+        if (m_priorities.Accept(path, tt_id, tag_id, now)) {
+            ++it;
+        } else {
+            it = values_array.Erase(it);
+        }
+    }
+}
+
+void NSK::FilterValues(rapidjson::Value& values_array,
+    rapidjson::Value& filtered, rapidjson::Document::AllocatorType& allocator,
+    std::chrono::steady_clock::time_point now)
+{
+    if (m_filters.Empty()) {
+        return;
+    }
+    for (auto& v : values_array.GetArray()) {
+        if (!v["value"].IsNumber()) {
+            continue;
+        }
+        const auto path = SKPaths::Find(v["path"].GetString());
+        const auto& config = m_filters.Config(path);
+        if (config.type == filter_type::NONE) {
+            continue;
+        }
+        const double damped
+            = m_filters.Apply(path, v["value"].GetDouble(), now);
+        if (config.raw) {
+            Value val(kObjectType);
+            val.AddMember("path", Value(v["path"], allocator), allocator);
+            val.AddMember("value", damped, allocator);
+            filtered.PushBack(val, allocator);
+        } else {
+            v["value"].SetDouble(damped);
+        }
+    }
+}
+
+void NSK::DeriveMagnetic(const rapidjson::Value& values_array,
+    rapidjson::Value& derived, rapidjson::Document::AllocatorType& allocator,
+    std::chrono::steady_clock::time_point now)
+{
+    if (!m_magnetic.Model().Valid() || std::isnan(m_own_lat)) {
+        return;
+    }
+    double heading = std::numeric_limits<double>::quiet_NaN();
+    double direction = std::numeric_limits<double>::quiet_NaN();
+    bool heading_true = false;
+    bool direction_true = false;
+    for (const auto& v : values_array.GetArray()) {
+        const char* path = v["path"].GetString();
+        if (std::strcmp(path, "navigation.headingMagnetic") == 0) {
+            heading = v["value"].GetDouble();
+        } else if (std::strcmp(path, "environment.wind.directionMagnetic")
+            == 0) {
+            direction = v["value"].GetDouble();
+        } else if (std::strcmp(path, "navigation.headingTrue") == 0) {
+            heading_true = true;
+        } else if (std::strcmp(path, "environment.wind.directionTrue") == 0) {
+            direction_true = true;
+        }
+    }
+    if (std::isnan(heading) && std::isnan(direction)) {
+        return;
+    }
+    const double variation = m_magnetic.Variation(m_own_lat, m_own_lon,
+        MagneticVariation::DecimalYear(m_clock->System()));
+    if (std::isnan(variation)) {
+        return;
+    }
+    auto to_true = [variation](double angle) {
+        angle = std::fmod(angle + variation, 2.0 * PI);
+        return angle < 0.0 ? angle + 2.0 * PI : angle;
+    };
+    AddNumber(derived, allocator, "navigation.magneticVariation", variation);
+    if (!std::isnan(heading) && !heading_true) {
+        AddNumber(
+            derived, allocator, "navigation.headingTrue", to_true(heading));
+        if (m_wind.Enabled()) {
+            m_wind.Set(DerivedWind::HEADING, to_true(heading), now);
+        }
+    }
+    if (!std::isnan(direction) && !direction_true) {
+        AddNumber(derived, allocator, "environment.wind.directionTrue",
+            to_true(direction));
+    }
+}
+
+void NSK::DeriveWind(const rapidjson::Value& values_array,
+    rapidjson::Value& derived, rapidjson::Document::AllocatorType& allocator,
+    std::chrono::steady_clock::time_point now)
+{
+    if (!m_wind.Enabled()) {
+        return;
+    }
+    for (const auto& v : values_array.GetArray()) {
+        const char* path = v["path"].GetString();
+        const auto& value = v["value"];
+        if (std::strcmp(path, "environment.wind.angleApparent") == 0) {
+            m_wind.Set(DerivedWind::APPARENT_ANGLE, value.GetDouble(), now);
+        } else if (std::strcmp(path, "environment.wind.speedApparent") == 0) {
+            m_wind.Set(DerivedWind::APPARENT_SPEED, value.GetDouble(), now);
+        } else if (std::strcmp(path, "navigation.speedThroughWater") == 0) {
+            m_wind.Set(
+                DerivedWind::SPEED_THROUGH_WATER, value.GetDouble(), now);
+        } else if (std::strcmp(path, "navigation.headingTrue") == 0) {
+            m_wind.Set(DerivedWind::HEADING, value.GetDouble(), now);
+        } else if (std::strcmp(path, "navigation.speedOverGround") == 0) {
+            m_wind.Set(DerivedWind::SPEED_OVER_GROUND, value.GetDouble(), now);
+        } else if (std::strcmp(path, "navigation.courseOverGroundTrue") == 0) {
+            m_wind.Set(
+                DerivedWind::COURSE_OVER_GROUND, value.GetDouble(), now);
+        }
+    }
+    if (!m_wind.Compute(now)) {
+        return;
+    }
+    if (m_wind.HasWater()) {
+        AddNumber(derived, allocator, "environment.wind.angleTrueWater",
+            m_wind.AngleTrueWater());
+        AddNumber(derived, allocator, "environment.wind.speedTrue",
+            m_wind.SpeedTrue());
+    }
+    if (m_wind.HasGround()) {
+        AddNumber(derived, allocator, "environment.wind.angleTrueGround",
+            m_wind.AngleTrueGround());
+        AddNumber(derived, allocator, "environment.wind.speedOverGround",
+            m_wind.SpeedOverGround());
+        AddNumber(derived, allocator, "environment.wind.directionTrue",
+            m_wind.DirectionTrue());
+    }
+}
+
+void NSK::UpdateOwnShip(const rapidjson::Value& values_array)
+{
+    bool velocity = false;
+    for (const auto& v : values_array.GetArray()) {
+        const char* path = v["path"].GetString();
+        if (std::strcmp(path, "navigation.position") == 0) {
+            m_own_lat = v["value"]["latitude"].GetDouble();
+            m_own_lon = v["value"]["longitude"].GetDouble();
+            m_cpa.SetOwnPosition(m_own_lat, m_own_lon);
+        } else if (std::strcmp(path, "navigation.speedOverGround") == 0) {
+            // The course comes from the same sentence, see ProcessSentence
+            m_own_sog = v["value"].GetDouble();
+            velocity = true;
+        }
+    }
+    if (velocity && !std::isnan(m_own_sog) && !std::isnan(m_own_cog)) {
+        m_cpa.SetOwnVelocity(m_own_sog, m_own_cog);
+    }
+}
+
+void NSK::ProcessNMEASentence(
+    const std::string& stc, rapidjson::Document* outdoc)
+{
+    CountIncoming();
+    m_metrics.CountSentence(stc);
+    const auto now = m_clock->Steady();
+    const auto traffic = m_traffic.Sentence(stc, now);
+    const int64_t received = m_time.Now(now);
+    m_recorder.Record(stc, received);
+    m_logger.Log(stc, received);
+    FlushAISTargets(now);
+    m_sinks.Tick(now);
+    m_sinks.UpdateSubscriptions(m_subscriptions);
+    PublishMetrics(now);
     try {
         Document d;
         Value src(kObjectType);
@@ -774,7 +1116,12 @@ void NSK::ProcessNMEASentence(
         rapidjson::Document::AllocatorType& allocator = d.GetAllocator();
 
         bool processed = true;
+        const auto skipped = m_subscriptions.Skipped();
+        const auto suppressed = m_priorities.Suppressed();
+        const auto start = std::chrono::steady_clock::now();
         auto s = make_sentence(stc);
+        const auto parsed = std::chrono::steady_clock::now();
+        m_metrics.Record(pipeline_stage::PARSE, parsed - start);
         known_sentence ks(*s);
         auto ksit = m_known.find(ks);
         if (ksit == m_known.end() || ksit->enabled) {
@@ -892,9 +1239,19 @@ void NSK::ProcessNMEASentence(
                 m_unimplemented.emplace(s->tag());
                 processed = false;
             }
-            if (values
-                    .Empty()) { // Processing this known sentence did not yield
-                                // any values (Probably we don't have a fix)
+            if (!m_priorities.Empty()) {
+                ArbitrateSources(values, ks.talker_tag, s->tag(), now);
+            }
+            if (values.Empty()
+                && (m_subscriptions.Skipped() != skipped
+                    || m_priorities.Suppressed() != suppressed)) {
+                // Nobody is interested in the values of this sentence or
+                // a preferred source provides them
+                m_known.emplace(ks);
+                processed = false;
+            } else if (values.Empty()) {
+                // Processing this known sentence did not yield any values
+                // (Probably we don't have a fix)
                 processed = false;
                 ++m_ignored;
             }
@@ -904,33 +1261,369 @@ void NSK::ProcessNMEASentence(
         }
 
         if (processed) {
+            Value filtered(kArrayType);
+            FilterValues(values, filtered, allocator, now);
+            UpdateOwnShip(values);
+            Value derived(kArrayType);
+            DeriveMagnetic(values, derived, allocator, now);
+            DeriveWind(values, derived, allocator, now);
+            FilterValues(derived, filtered, allocator, now);
+            m_traffic.Values(
+                traffic, values.Size() + derived.Size() + filtered.Size());
             m_known.emplace(ks);
             Value updates(kArrayType);
+            const auto& timestamp = m_time.Stamp(now);
             src.AddMember("label", "NSK", allocator);
             src.AddMember("type", "NMEA0183", allocator);
             upd.AddMember("source", src, allocator);
-            upd.AddMember("timestamp", currentISO8601TimeUTC(), allocator);
+            upd.AddMember("timestamp", timestamp, allocator);
             upd.AddMember("values", values, allocator);
             updates.PushBack(upd, allocator);
+            // The values computed by NSK come in updates of their own
+            auto add_update = [&](const char* type, Value& extra) {
+                if (extra.Empty()) {
+                    return;
+                }
+                Value xsrc(kObjectType);
+                xsrc.AddMember("label", "NSK", allocator);
+                xsrc.AddMember("type", StringRef(type), allocator);
+                Value xupd(kObjectType);
+                xupd.AddMember("source", xsrc, allocator);
+                xupd.AddMember("timestamp", timestamp, allocator);
+                xupd.AddMember("values", extra, allocator);
+                updates.PushBack(xupd, allocator);
+            };
+            add_update("derived", derived);
+            add_update("filtered", filtered);
             d.AddMember("updates", updates, allocator);
-            StringBuffer buffer;
-            Writer<StringBuffer> writer(buffer);
-            d.Accept(writer);
-            // std::cout << buffer.GetString() << std::endl;
-            ++m_sk_produced;
-            ++m_sk_produced_total;
-            if (outdoc != nullptr) {
-                outdoc->Parse<0>(buffer.GetString());
-            }
-            SendPluginMessage("NSK_PI_SIGNALK", buffer.GetString());
+            m_metrics.Record(pipeline_stage::CONVERT,
+                std::chrono::steady_clock::now() - parsed);
+            SendDelta(d, outdoc);
         }
     } catch (...) {
         // std::cout << "Exception while processing " << sentence.c_str() <<
         // std::endl;
-        m_unknown.emplace(stc.substr(0, 6));
+        AddUnknown(stc);
+        ++m_nmea_errors;
+        m_traffic.Error(traffic);
+        return;
+    }
+}
+
+void NSK::ProcessAISTarget(uint32_t slot, uint8_t flags,
+    rapidjson::Value& values_array, rapidjson::Value& notifications,
+    rapidjson::Document::AllocatorType& allocator)
+{
+    const auto& t = m_ais_targets;
+    const auto& st = t.Static()[slot];
+    Value vessel(kObjectType);
+    vessel.AddMember("mmsi", std::to_string(t.Mmsi()[slot]), allocator);
+    if ((flags & AISTargets::DIRTY_STATIC) && st.name[0] != '\0') {
+        vessel.AddMember("name", Value(st.name.data(), allocator), allocator);
+    }
+    Value val(kObjectType);
+    val.AddMember("path", "", allocator);
+    val.AddMember("value", vessel, allocator);
+    values_array.PushBack(val, allocator);
+    AddString(values_array, allocator, "sensors.ais.class",
+        std::string(1, t.Class()[slot]));
+
+    if (flags & AISTargets::DIRTY_DYNAMIC) {
+        if (!std::isnan(t.Lat()[slot])
+            && m_subscriptions.Wanted("navigation.position")) {
+            Value pos(kObjectType);
+            pos.AddMember("latitude", t.Lat()[slot], allocator);
+            pos.AddMember("longitude", t.Lon()[slot], allocator);
+            Value posval(kObjectType);
+            posval.AddMember("path", "navigation.position", allocator);
+            posval.AddMember("value", pos, allocator);
+            values_array.PushBack(posval, allocator);
+        }
+        if (!std::isnan(t.Cog()[slot])) {
+            AddNumber(values_array, allocator,
+                "navigation.courseOverGroundTrue", t.Cog()[slot]);
+        }
+        if (!std::isnan(t.Sog()[slot])) {
+            AddNumber(values_array, allocator, "navigation.speedOverGround",
+                t.Sog()[slot]);
+        }
+        if (!std::isnan(t.Heading()[slot])) {
+            AddNumber(values_array, allocator, "navigation.headingTrue",
+                t.Heading()[slot]);
+        }
+        if (!std::isnan(t.Rot()[slot])) {
+            AddNumber(values_array, allocator, "navigation.rateOfTurn",
+                t.Rot()[slot]);
+        }
+        const char* state = AISNavState(t.NavStatus()[slot]);
+        if (t.Class()[slot] == 'A' && state != nullptr) {
+            AddString(values_array, allocator, "navigation.state", state);
+        }
+    }
+
+    if ((flags & (AISTargets::DIRTY_DYNAMIC | AISTargets::DIRTY_CPA))
+        && !std::isnan(m_cpa.Cpa()[slot])
+        && m_subscriptions.Wanted("navigation.closestApproach")) {
+        Value ca(kObjectType);
+        ca.AddMember("distance", m_cpa.Cpa()[slot], allocator);
+        ca.AddMember("timeTo", m_cpa.Tcpa()[slot], allocator);
+        Value caval(kObjectType);
+        caval.AddMember("path", "navigation.closestApproach", allocator);
+        caval.AddMember("value", ca, allocator);
+        values_array.PushBack(caval, allocator);
+    }
+    if ((flags & AISTargets::DIRTY_CPA)
+        && m_subscriptions.Wanted(
+            "notifications.navigation.closestApproach")) {
+        std::ostringstream message;
+        message << std::fixed << std::setprecision(2) << "CPA "
+                << m_cpa.Cpa()[slot] / NM2METER << " NM in "
+                << std::setprecision(1) << m_cpa.Tcpa()[slot] / 60.0
+                << " min with "
+                << (st.name[0] != '\0' ? st.name.data()
+                                       : std::to_string(t.Mmsi()[slot]));
+        AddCPANotification(notifications, allocator, t.Mmsi()[slot],
+            m_cpa.Alarm()[slot] != 0, message.str());
+    }
+
+    if (flags & AISTargets::DIRTY_STATIC) {
+        if (st.callsign[0] != '\0') {
+            AddString(values_array, allocator, "communication.callsignVhf",
+                st.callsign.data());
+        }
+        if (st.imo != 0) {
+            AddString(values_array, allocator, "registrations.imo",
+                "IMO " + std::to_string(st.imo));
+        }
+        if (st.ship_type != 0 && m_subscriptions.Wanted("design.aisShipType")) {
+            Value type(kObjectType);
+            type.AddMember("id", st.ship_type, allocator);
+            const char* name = AISShipTypeName(st.ship_type);
+            if (name != nullptr) {
+                type.AddMember("name", Value(name, allocator), allocator);
+            }
+            Value typeval(kObjectType);
+            typeval.AddMember("path", "design.aisShipType", allocator);
+            typeval.AddMember("value", type, allocator);
+            values_array.PushBack(typeval, allocator);
+        }
+        if (st.to_bow + st.to_stern > 0
+            && m_subscriptions.Wanted("design.length")) {
+            Value length(kObjectType);
+            length.AddMember("overall", st.to_bow + st.to_stern, allocator);
+            Value lenval(kObjectType);
+            lenval.AddMember("path", "design.length", allocator);
+            lenval.AddMember("value", length, allocator);
+            values_array.PushBack(lenval, allocator);
+        }
+        if (st.to_bow + st.to_stern > 0) {
+            AddNumber(
+                values_array, allocator, "sensors.ais.fromBow", st.to_bow);
+        }
+        if (st.to_port + st.to_starboard > 0) {
+            AddNumber(values_array, allocator, "design.beam",
+                st.to_port + st.to_starboard);
+            AddNumber(values_array, allocator, "sensors.ais.fromCenter",
+                (st.to_starboard - st.to_port) / 2.0);
+        }
+        if (st.draught != 0 && m_subscriptions.Wanted("design.draft")) {
+            Value draft(kObjectType);
+            draft.AddMember("current", st.draught / 10.0, allocator);
+            Value draftval(kObjectType);
+            draftval.AddMember("path", "design.draft", allocator);
+            draftval.AddMember("value", draft, allocator);
+            values_array.PushBack(draftval, allocator);
+        }
+        if (st.destination[0] != '\0') {
+            AddString(values_array, allocator,
+                "navigation.destination.commonName", st.destination.data());
+        }
+    }
+}
+
+void NSK::AddCPANotification(rapidjson::Value& notifications,
+    rapidjson::Document::AllocatorType& allocator, uint32_t mmsi, bool alarm,
+    const std::string& message)
+{
+    Value notification(kObjectType);
+    notification.AddMember(
+        "state", StringRef(alarm ? "alarm" : "normal"), allocator);
+    Value method(kArrayType);
+    if (alarm) {
+        method.PushBack("visual", allocator);
+        method.PushBack("sound", allocator);
+    }
+    notification.AddMember("method", method, allocator);
+    notification.AddMember("message", message, allocator);
+    // The notification belongs to the own vessel, one per target
+    Value nval(kObjectType);
+    nval.AddMember("path",
+        "notifications.navigation.closestApproach.urn:mrn:imo:mmsi:"
+            + std::to_string(mmsi),
+        allocator);
+    nval.AddMember("value", notification, allocator);
+    notifications.PushBack(nval, allocator);
+}
+
+void NSK::FlushAISTargets(
+    std::chrono::steady_clock::time_point now, rapidjson::Document* outdoc)
+{
+    if (now - m_ais_flushed < m_ais_flush_interval) {
+        return;
+    }
+    m_ais_flushed = now;
+    m_ais_targets.Expire(now);
+    m_cpa.Compute(m_ais_targets);
+    for (auto slot : m_cpa.Changed()) {
+        if (m_ais_targets.Active(slot)) {
+            m_ais_targets.MarkDirty(slot, AISTargets::DIRTY_CPA);
+        }
+    }
+
+    Document d;
+    d.SetArray();
+    rapidjson::Document::AllocatorType& allocator = d.GetAllocator();
+    const auto& timestamp = m_time.Stamp(now);
+    auto source = [&allocator]() {
+        Value src(kObjectType);
+        src.AddMember("sentence", "VDM", allocator);
+        src.AddMember("talker", "AI", allocator);
+        src.AddMember("label", "NSK", allocator);
+        src.AddMember("type", "NMEA0183", allocator);
+        return src;
+    };
+    Value notifications(kArrayType);
+    if (m_subscriptions.Wanted("notifications.navigation.closestApproach")) {
+        for (auto mmsi : m_cpa.Expired()) {
+            AddCPANotification(notifications, allocator, mmsi, false,
+                "Lost AIS target " + std::to_string(mmsi));
+        }
+    }
+    m_ais_targets.ForEachDirty([&](uint32_t slot, uint8_t flags) {
+        Value values(kArrayType);
+        ProcessAISTarget(slot, flags, values, notifications, allocator);
+        if (values.Size() < 2) {
+            // Nothing but the identity of the vessel is wanted
+            return;
+        }
+        Value src = source();
+        Value upd(kObjectType);
+        upd.AddMember("source", src, allocator);
+        upd.AddMember("timestamp", timestamp, allocator);
+        upd.AddMember("values", values, allocator);
+        Value updates(kArrayType);
+        updates.PushBack(upd, allocator);
+        Value delta(kObjectType);
+        delta.AddMember("context",
+            "vessels.urn:mrn:imo:mmsi:"
+                + std::to_string(m_ais_targets.Mmsi()[slot]),
+            allocator);
+        delta.AddMember("updates", updates, allocator);
+        d.PushBack(delta, allocator);
+    });
+    if (!notifications.Empty()) {
+        Value upd(kObjectType);
+        upd.AddMember("source", source(), allocator);
+        upd.AddMember("timestamp", timestamp, allocator);
+        upd.AddMember("values", notifications, allocator);
+        Value updates(kArrayType);
+        updates.PushBack(upd, allocator);
+        Value delta(kObjectType);
+        delta.AddMember("context", "vessels.self", allocator);
+        delta.AddMember("updates", updates, allocator);
+        d.PushBack(delta, allocator);
+    }
+    if (!d.Empty()) {
+        SendDelta(d, outdoc);
+    }
+}
+
+void NSK::ProcessData(std::string_view data)
+{
+    m_framer.Feed(data);
+    std::string_view stc;
+    while (m_framer.Next(stc)) {
+        ProcessFramedSentence(stc);
+    }
+}
+
+void NSK::ProcessFramedSentence(std::string_view stc)
+{
+    if (stc.empty()) {
+        return;
+    }
+    m_framed.assign(stc.data(), stc.size());
+    if (stc[0] == '!') {
+        ProcessAISSentence(m_framed);
+    } else {
+        ProcessNMEASentence(m_framed);
+    }
+}
+
+void NSK::ProcessAISSentence(
+    const std::string& stc, rapidjson::Document* outdoc)
+{
+    CountIncoming();
+    m_metrics.CountSentence(stc);
+    const auto now = m_clock->Steady();
+    const auto traffic = m_traffic.Sentence(stc, now);
+    const int64_t received = m_time.Now(now);
+    m_recorder.Record(stc, received);
+    m_logger.Log(stc, received);
+    m_sinks.Tick(now);
+    m_sinks.UpdateSubscriptions(m_subscriptions);
+    PublishMetrics(now);
+    if (stc.size() < 6) {
+        ++m_nmea_errors;
+        m_traffic.Error(traffic);
+        return;
+    }
+    known_sentence ks(stc.substr(1, 5), true);
+    auto ksit = m_known.find(ks);
+    if (ksit != m_known.end() && !ksit->enabled) {
+        ++m_ignored;
+        return;
+    }
+    switch (m_ais.Decode(stc, now)) {
+    case ais_result::incomplete:
+        return;
+    case ais_result::unsupported:
+        ++m_ignored;
+        return;
+    case ais_result::error:
+        AddUnknown(stc);
         ++m_nmea_errors;
+        m_traffic.Error(traffic);
         return;
+    case ais_result::decoded:
+        break;
+    }
+    m_known.emplace(ks);
+    const ais_message& msg = m_ais.Message();
+    if (msg.own) {
+        m_cpa.SetOwnMmsi(msg.mmsi);
+    }
+    const uint32_t slot = m_ais_targets.Update(msg, now);
+    if (slot != AISTargets::NONE && !msg.own) {
+        m_cpa.Touch(slot, m_ais_targets);
+    }
+    FlushAISTargets(now, outdoc);
+}
+
+void NSK::StartInputs()
+{
+#ifdef __linux__
+    if (m_inputs.Size() != 0) {
+        m_inputs.Start();
     }
+#endif
+}
+
+void NSK::StopInputs()
+{
+#ifdef __linux__
+    m_inputs.Stop();
+#endif
 }
 
 void NSK::LoadConfig(const std::string& path)
@@ -946,6 +1639,11 @@ void NSK::LoadConfig(const std::string& path)
 
     Document d {};
     d.ParseStream(isw);
+    // Nothing may be processed while the configuration changes
+#ifdef __linux__
+    const bool running = m_inputs.Running();
+    m_inputs.Stop();
+#endif
     if (d.HasMember("known_sentences") && d["known_sentences"].IsArray()) {
         m_known.clear();
         for (auto& stc : d["known_sentences"].GetArray()) {
@@ -953,6 +1651,71 @@ void NSK::LoadConfig(const std::string& path)
                 stc["talker_tag"].GetString(), stc["enabled"].GetBool()));
         }
     }
+    if (d.HasMember("ais") && d["ais"].IsObject()) {
+        const auto& ais = d["ais"];
+        if (ais.HasMember("flush_interval") && ais["flush_interval"].IsUint()) {
+            m_ais_flush_interval
+                = std::chrono::milliseconds(ais["flush_interval"].GetUint());
+        }
+        if (ais.HasMember("expiry") && ais["expiry"].IsUint()) {
+            m_ais_targets.SetExpiry(
+                std::chrono::seconds(ais["expiry"].GetUint()));
+        }
+    }
+#ifdef __linux__
+    if (d.HasMember("inputs") && d["inputs"].IsArray()) {
+        m_inputs.Clear();
+        for (const auto& cfg : d["inputs"].GetArray()) {
+            m_inputs.Add(input_config::FromJSON(cfg));
+        }
+    }
+#endif
+    if (d.HasMember("sinks") && d["sinks"].IsArray()) {
+        m_sinks.Clear();
+        m_sinks.UpdateSubscriptions(m_subscriptions);
+        for (const auto& cfg : d["sinks"].GetArray()) {
+            m_sinks.Add(OutputSinks::Create(sink_config::FromJSON(cfg)));
+        }
+    }
+    if (d.HasMember("derived_wind")) {
+        m_wind.FromJSON(d["derived_wind"]);
+    }
+    if (d.HasMember("time")) {
+        m_time.FromJSON(d["time"]);
+    }
+    if (d.HasMember("flight_recorder")) {
+        m_recorder.FromJSON(d["flight_recorder"]);
+    }
+    if (d.HasMember("logger")) {
+        m_logger.Configure(logger_config::FromJSON(d["logger"]));
+    }
+    if (d.HasMember("filters")) {
+        m_filters.FromJSON(d["filters"]);
+    }
+    if (d.HasMember("magnetic_model") && d["magnetic_model"].IsObject()
+        && d["magnetic_model"].HasMember("file")
+        && d["magnetic_model"]["file"].IsString()) {
+        m_magnetic_file = d["magnetic_model"]["file"].GetString();
+        m_magnetic.Load(m_magnetic_file);
+    }
+    if (d.HasMember("source_priorities")) {
+        m_priorities.FromJSON(d["source_priorities"]);
+    }
+    if (d.HasMember("cpa") && d["cpa"].IsObject()) {
+        const auto& cpa = d["cpa"];
+        m_cpa.SetLimits(
+            cpa.HasMember("distance") && cpa["distance"].IsNumber()
+                ? cpa["distance"].GetDouble()
+                : m_cpa.DistanceLimit(),
+            cpa.HasMember("time") && cpa["time"].IsNumber()
+                ? cpa["time"].GetDouble()
+                : m_cpa.TimeLimit());
+    }
+#ifdef __linux__
+    if (running) {
+        StartInputs();
+    }
+#endif
 }
 
 void NSK::SaveConfig(const std::string& path)
@@ -968,6 +1731,43 @@ void NSK::SaveConfig(const std::string& path)
         values.PushBack(sentence, allocator);
     }
     d.AddMember("known_sentences", values, allocator);
+    Value ais(kObjectType);
+    ais.AddMember("flush_interval",
+        static_cast<unsigned>(m_ais_flush_interval.count()), allocator);
+    ais.AddMember("expiry",
+        static_cast<unsigned>(std::chrono::duration_cast<std::chrono::seconds>(
+            m_ais_targets.Expiry())
+                                  .count()),
+        allocator);
+    d.AddMember("ais", ais, allocator);
+    Value cpa(kObjectType);
+    cpa.AddMember("distance", m_cpa.DistanceLimit(), allocator);
+    cpa.AddMember("time", m_cpa.TimeLimit(), allocator);
+    d.AddMember("cpa", cpa, allocator);
+    d.AddMember("source_priorities", m_priorities.ToJSON(allocator), allocator);
+    d.AddMember("derived_wind", m_wind.ToJSON(allocator), allocator);
+    d.AddMember("filters", m_filters.ToJSON(allocator), allocator);
+    d.AddMember("time", m_time.ToJSON(allocator), allocator);
+    d.AddMember(
+        "flight_recorder", m_recorder.ToJSON(allocator), allocator);
+    d.AddMember("logger", m_logger.Config().ToJSON(allocator), allocator);
+    if (!m_magnetic_file.empty()) {
+        Value magnetic(kObjectType);
+        magnetic.AddMember("file", m_magnetic_file, allocator);
+        d.AddMember("magnetic_model", magnetic, allocator);
+    }
+    Value sinks(kArrayType);
+    for (const auto& sink : m_sinks.Sinks()) {
+        sinks.PushBack(sink->Config().ToJSON(allocator), allocator);
+    }
+    d.AddMember("sinks", sinks, allocator);
+#ifdef __linux__
+    Value inputs(kArrayType);
+    for (size_t i = 0; i < m_inputs.Size(); ++i) {
+        inputs.PushBack(m_inputs.Config(i).ToJSON(allocator), allocator);
+    }
+    d.AddMember("inputs", inputs, allocator);
+#endif
 
     rapidjson::StringBuffer buf;
     rapidjson::Writer<StringBuffer> writer(buf);
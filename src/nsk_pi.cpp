@@ -31,10 +31,13 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 
+#include "byte_scan.h"
 #include "nsk_pi.h"
 #include "nskguiimpl.h"
+#include <wx/datetime.h>
 #include <wx/filename.h>
 
 PLUGIN_BEGIN_NAMESPACE
@@ -67,6 +70,7 @@ extern "C" DECL_EXP void destroy_pi(opencpn_plugin* p) { delete p; }
 nsk_pi::nsk_pi(void* ppimgr)
     : opencpn_plugin_118(ppimgr)
     , m_color_scheme(PI_GLOBAL_COLOR_SCHEME_RGB)
+    , m_dispatch(m_nsk)
 {
     if (!wxDirExists(GetDataDir())) {
         wxFileName::Mkdir(GetDataDir(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
@@ -80,6 +84,9 @@ nsk_pi::~nsk_pi() { }
 int nsk_pi::Init()
 {
     LoadConfig();
+    m_nsk.StartInputs();
+    // The plugin messages may only be sent from the main thread
+    m_dispatch.Start(50);
 
     wxString _svg_nsk = GetDataDir() + "nsk_pi.svg";
     AddLocaleCatalog(_T("opencpn-nsk_pi"));
@@ -90,7 +97,11 @@ int nsk_pi::Init()
 
 bool nsk_pi::DeInit()
 {
+    m_dispatch.Stop();
+    m_nsk.StopInputs();
+    m_nsk.DispatchMessages();
     SaveConfig();
+    m_nsk.Logger().Stop();
     return true;
 }
 
@@ -137,6 +148,14 @@ void nsk_pi::SetColorScheme(PI_ColorScheme cs)
 
 void nsk_pi::LoadConfig()
 {
+    // The World Magnetic Model coefficients are distributed by NOAA as
+    // WMM.COF, the configuration may point to a different file
+    m_nsk.Magnetic().Load(GetDataDir().ToStdString() + "WMM.COF");
+    wxString logs = GetDataDir() + "logs" + wxFileName::GetPathSeparator();
+    if (!wxDirExists(logs)) {
+        wxFileName::Mkdir(logs, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    }
+    m_nsk.Logger().SetDefaultDirectory(logs.ToStdString());
     m_nsk.LoadConfig(GetDataDir().ToStdString() + "nsk.json");
 }
 void nsk_pi::SaveConfig()
@@ -147,14 +166,17 @@ void nsk_pi::SaveConfig()
 void nsk_pi::SetNMEASentence(wxString& sentence)
 {
     std::string stc = sentence.ToStdString();
-    stc.erase(std::remove(stc.begin(), stc.end(), '\n'), stc.cend());
-    stc.erase(std::remove(stc.begin(), stc.end(), '\r'), stc.cend());
+    stc.resize(ByteScan::EOL(stc));
+    std::lock_guard<std::mutex> lock(m_nsk.Mutex());
     m_nsk.ProcessNMEASentence(stc);
 }
 
 void nsk_pi::SetAISSentence(wxString& sentence)
 {
-    // TODO
+    std::string stc = sentence.ToStdString();
+    stc.resize(ByteScan::EOL(stc));
+    std::lock_guard<std::mutex> lock(m_nsk.Mutex());
+    m_nsk.ProcessAISSentence(stc);
 }
 
 void nsk_pi::SetPluginMessage(wxString& message_id, wxString& message_body)
@@ -164,6 +186,21 @@ void nsk_pi::SetPluginMessage(wxString& message_id, wxString& message_body)
         // "OCPN_CORE_SIGNALK", be prepared for other future
         // sources following common naming convention
         // TODO: If contains "self" and we do not have self configured, set it
+    } else if (message_id.IsSameAs("NSK_PI_SIGNALK_SNAPSHOT_REQUEST")) {
+        std::lock_guard<std::mutex> lock(m_nsk.Mutex());
+        m_nsk.SendSnapshot();
+    } else if (message_id.IsSameAs("NSK_PI_SIGNALK_SUBSCRIBE")) {
+        std::lock_guard<std::mutex> lock(m_nsk.Mutex());
+        m_nsk.ProcessSubscription(message_body.ToStdString());
+    } else if (message_id.IsSameAs("NSK_PI_FLIGHT_RECORDER_DUMP")) {
+        // The body is the path to the dump, by default a file named by the
+        // current time in the data directory
+        wxString path = message_body;
+        if (path.IsEmpty()) {
+            path = GetDataDir() + "flight-recorder-"
+                + wxDateTime::UNow().Format("%Y%m%d-%H%M%S") + ".nmea";
+        }
+        m_nsk.Recorder().Dump(path.ToStdString());
     }
 }
 
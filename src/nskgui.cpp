@@ -80,6 +80,25 @@ NSKPreferencesDialog::NSKPreferencesDialog(wxWindow* parent, wxWindowID id,
 
     bSizerMain->Add(bSizerSentences, 1, wxEXPAND, 5);
 
+    wxStaticBoxSizer* sbSizerStats;
+    sbSizerStats = new wxStaticBoxSizer(
+        new wxStaticBox(this, wxID_ANY, _("Statistics")), wxVERTICAL);
+
+    m_tStats = new wxTextCtrl(sbSizerStats->GetStaticBox(), wxID_ANY,
+        wxEmptyString, wxDefaultPosition, wxDefaultSize,
+        wxTE_DONTWRAP | wxTE_MULTILINE | wxTE_READONLY);
+    m_tStats->SetFont(wxFont(wxNORMAL_FONT->GetPointSize(),
+        wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL, false,
+        wxEmptyString));
+
+    sbSizerStats->Add(m_tStats, 1, wxALL | wxEXPAND, 5);
+
+    m_btnDump = new wxButton(sbSizerStats->GetStaticBox(), wxID_ANY,
+        _("Save flight recorder..."), wxDefaultPosition, wxDefaultSize, 0);
+    sbSizerStats->Add(m_btnDump, 0, wxALL, 5);
+
+    bSizerMain->Add(sbSizerStats, 1, wxEXPAND, 5);
+
     m_sdbSizerButtons = new wxStdDialogButtonSizer();
     m_sdbSizerButtonsOK = new wxButton(this, wxID_OK);
     m_sdbSizerButtons->AddButton(m_sdbSizerButtonsOK);
@@ -91,6 +110,8 @@ NSKPreferencesDialog::NSKPreferencesDialog(wxWindow* parent, wxWindowID id,
 
     this->SetSizer(bSizerMain);
     this->Layout();
+    m_timerStats.SetOwner(this, m_timerStats.GetId());
+    m_timerStats.Start(1000);
 
     this->Centre(wxBOTH);
 
@@ -103,6 +124,11 @@ NSKPreferencesDialog::NSKPreferencesDialog(wxWindow* parent, wxWindowID id,
         wxCommandEventHandler(
             NSKPreferencesDialog::m_sdbSizerButtonsOnOKButtonClick),
         NULL, this);
+    m_btnDump->Connect(wxEVT_COMMAND_BUTTON_CLICKED,
+        wxCommandEventHandler(NSKPreferencesDialog::m_btnDumpOnButtonClick),
+        NULL, this);
+    this->Connect(m_timerStats.GetId(), wxEVT_TIMER,
+        wxTimerEventHandler(NSKPreferencesDialog::m_timerStatsOnTimer));
 }
 
 NSKPreferencesDialog::~NSKPreferencesDialog()
@@ -116,4 +142,9 @@ NSKPreferencesDialog::~NSKPreferencesDialog()
         wxCommandEventHandler(
             NSKPreferencesDialog::m_sdbSizerButtonsOnOKButtonClick),
         NULL, this);
+    m_btnDump->Disconnect(wxEVT_COMMAND_BUTTON_CLICKED,
+        wxCommandEventHandler(NSKPreferencesDialog::m_btnDumpOnButtonClick),
+        NULL, this);
+    this->Disconnect(m_timerStats.GetId(), wxEVT_TIMER,
+        wxTimerEventHandler(NSKPreferencesDialog::m_timerStatsOnTimer));
 }
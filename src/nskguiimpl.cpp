@@ -26,6 +26,11 @@
 
 #include "nskguiimpl.h"
 
+#include <cstring>
+#include <mutex>
+#include <wx/filedlg.h>
+#include <wx/msgdlg.h>
+
 PLUGIN_BEGIN_NAMESPACE
 
 NSKPreferencesDialogImpl::NSKPreferencesDialogImpl(NSK* nsk, wxWindow* parent,
@@ -34,6 +39,9 @@ NSKPreferencesDialogImpl::NSKPreferencesDialogImpl(NSK* nsk, wxWindow* parent,
     : NSKPreferencesDialog(parent, id, title, pos, size, style)
     , m_nsk(nsk)
 {
+    // The statistics are safe to read from any thread, the rest needs the
+    // lock while the inputs run
+    std::lock_guard<std::mutex> lock(m_nsk->Mutex());
     m_tUnimplemented->SetValue(m_nsk->Unimplemented());
     m_stTotalUnimplemented->SetLabelText(
         wxString::Format("%lu", m_nsk->TotalUnimplemented()));
@@ -44,24 +52,115 @@ NSKPreferencesDialogImpl::NSKPreferencesDialogImpl(NSK* nsk, wxWindow* parent,
         m_clKnown->Append(known.talker_tag);
         m_clKnown->Check(m_clKnown->GetCount() - 1, known.enabled);
     }
-    auto format
-        = "Input data rate: %lu sentences/s, output data rate: %lu deltas/s";
-    auto sz
-        = std::snprintf(nullptr, 0, format, m_nsk->NMEARate(), m_nsk->SKRate());
-    std::string output(sz + 1, '\0');
-    std::sprintf(&output[0], format, m_nsk->NMEARate(), m_nsk->SKRate());
-    m_stDataRate->SetLabelText(output);
-    format = "Input total: %lu, Deltas total: %lu";
-    sz = std::snprintf(
-        nullptr, 0, format, m_nsk->NMEATotal(), m_nsk->SKTotal());
-    output.resize(sz + 1, '\0');
-    std::sprintf(&output[0], format, m_nsk->NMEATotal(), m_nsk->SKTotal());
-    m_stTotals->SetLabelText(output);
+    m_previous = m_nsk->Metrics().Snapshot();
+    UpdateStatistics();
+}
+
+void NSKPreferencesDialogImpl::UpdateStatistics()
+{
+    const metrics_snapshot m = m_nsk->Metrics().Snapshot();
+    const double period = (m.taken - m_previous.taken) / 1000.0;
+    auto rate = [period](uint64_t current, uint64_t previous) {
+        return period > 0.0 ? (current - previous) / period : 0.0;
+    };
+    m_stDataRate->SetLabelText(wxString::Format(
+        _("Input data rate: %.0f sentences/s, output data rate: %.0f "
+          "deltas/s"),
+        rate(m.nmea_total, m_previous.nmea_total),
+        rate(m.sk_total, m_previous.sk_total)));
+    m_stTotals->SetLabelText(
+        wxString::Format(_("Input total: %llu, Deltas total: %llu"),
+            static_cast<unsigned long long>(m.nmea_total),
+            static_cast<unsigned long long>(m.sk_total)));
+
+    wxString text;
+    text << wxString::Format(
+        _("Errors %llu, ignored %llu, values skipped %llu, suppressed %llu\n"),
+        static_cast<unsigned long long>(m.errors),
+        static_cast<unsigned long long>(m.ignored),
+        static_cast<unsigned long long>(m.skipped),
+        static_cast<unsigned long long>(m.suppressed));
+    text << wxString::Format(_("Sinks: dropped %llu, queued %llu\n"),
+        static_cast<unsigned long long>(m.dropped),
+        static_cast<unsigned long long>(m.queue_depth));
+    text << wxString::Format(_("Delta memory: last %llu B, peak %llu B\n\n"),
+        static_cast<unsigned long long>(m.allocated),
+        static_cast<unsigned long long>(m.allocated_peak));
+
+    const wxString stages[]
+        = { _("parse"), _("convert"), _("serialize"), _("publish") };
+    text << wxString::Format("%-10s %10s %10s %10s %10s\n", _("Stage"),
+        _("count"), _("p50 us"), _("p99 us"), _("p99.9 us"));
+    for (size_t i = 0; i < m.latency.size(); ++i) {
+        const auto& h = m.latency[i];
+        text << wxString::Format("%-10s %10llu %10.1f %10.1f %10.1f\n",
+            stages[i], static_cast<unsigned long long>(h.Count()),
+            h.Percentile(50.0).count() / 1000.0,
+            h.Percentile(99.0).count() / 1000.0,
+            h.Percentile(99.9).count() / 1000.0);
+    }
+
+    text << wxString::Format("\n%-10s %10s %10s\n", _("Sentence"),
+        _("total"), _("per s"));
+    for (size_t i = 0; i < m.sentence_count; ++i) {
+        const auto& c = m.sentences[i];
+        uint64_t previous = 0;
+        for (size_t j = 0; j < m_previous.sentence_count; ++j) {
+            if (std::strcmp(m_previous.sentences[j].tag, c.tag) == 0) {
+                previous = m_previous.sentences[j].count;
+                break;
+            }
+        }
+        text << wxString::Format("%-10s %10llu %10.1f\n", c.tag,
+            static_cast<unsigned long long>(c.count),
+            rate(c.count, previous));
+    }
+
+    const traffic_snapshot t = m_nsk->Traffic().Snapshot();
+    text << wxString::Format("\n%-8s %9s %7s %9s %9s %8s %7s %9s\n",
+        _("Talker"), _("total"), _("per s"), _("every ms"), _("jitter ms"),
+        _("seen s"), _("errors"), _("values"));
+    for (size_t i = 0; i < t.size; ++i) {
+        const auto& e = t.entries[i];
+        text << wxString::Format(
+            "%-8s %9llu %7.1f %9.0f %9.1f %8.1f %7llu %9llu\n", e.name,
+            static_cast<unsigned long long>(e.count), e.Rate(t.taken),
+            e.interval * 1000.0, e.jitter * 1000.0,
+            (t.taken - e.last_seen) / 1000.0,
+            static_cast<unsigned long long>(e.errors),
+            static_cast<unsigned long long>(e.values));
+    }
+    if (t.overflow != 0) {
+        text << wxString::Format(_("%llu sentences of other talkers\n"),
+            static_cast<unsigned long long>(t.overflow));
+    }
+    m_tStats->ChangeValue(text);
+    m_previous = m;
+}
+
+void NSKPreferencesDialogImpl::m_btnDumpOnButtonClick(wxCommandEvent& event)
+{
+    wxFileDialog dlg(this, _("Save flight recorder"), wxEmptyString,
+        "flight-recorder.nmea", _("NMEA logs (*.nmea)|*.nmea|All files|*"),
+        wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (dlg.ShowModal() != wxID_OK) {
+        return;
+    }
+    if (!m_nsk->Recorder().Dump(dlg.GetPath().ToStdString())) {
+        wxMessageBox(_("Can't write the flight recorder file"),
+            _("Save flight recorder"), wxOK | wxICON_ERROR, this);
+    }
+}
+
+void NSKPreferencesDialogImpl::m_timerStatsOnTimer(wxTimerEvent& event)
+{
+    UpdateStatistics();
 }
 
 void NSKPreferencesDialogImpl::m_sdbSizerButtonsOnOKButtonClick(
     wxCommandEvent& event)
 {
+    std::lock_guard<std::mutex> lock(m_nsk->Mutex());
     size_t i = 0;
     for (auto item : m_clKnown->GetStrings()) {
         m_nsk->UpdateKnown(
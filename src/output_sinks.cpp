@@ -0,0 +1,833 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "output_sinks.h"
+#include "signalk_server.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <ocpn_plugin.h>
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// How often a worker thread without work wakes up
+constexpr std::chrono::milliseconds IDLE_PERIOD(100);
+/// How often a sink retries to open a destination that failed
+constexpr std::chrono::seconds REOPEN_PERIOD(5);
+/// Maximum data waiting to be sent to a TCP client before it is disconnected
+constexpr size_t MAX_CLIENT_PENDING = 1024 * 1024;
+/// Default UDP datagram size limit, fits in an Ethernet frame
+constexpr size_t UDP_BATCH_BYTES = 1400;
+/// Most plugin messages waiting for the main thread, seconds of a busy bus
+constexpr size_t MAX_PENDING_MESSAGES = 4096;
+
+/// @brief Return the content of a JSON array without the brackets, or the
+/// whole value if it is not an array
+std::string_view Inner(std::string_view json)
+{
+    if (json.size() >= 2 && json.front() == '[' && json.back() == ']') {
+        return json.substr(1, json.size() - 2);
+    }
+    return json;
+}
+
+/// @brief Return the name of the policy
+const char* PolicyName(sink_policy p)
+{
+    switch (p) {
+    case sink_policy::drop_newest:
+        return "drop_newest";
+    case sink_policy::merge:
+        return "merge";
+    default:
+        return "drop_oldest";
+    }
+}
+}
+
+sink_config sink_config::FromJSON(const Value& v)
+{
+    sink_config cfg;
+    if (!v.IsObject()) {
+        return cfg;
+    }
+    if (v.HasMember("type") && v["type"].IsString()) {
+        cfg.type = v["type"].GetString();
+    }
+    if (cfg.type == "udp") {
+        cfg.batch_bytes = UDP_BATCH_BYTES;
+    }
+    if (v.HasMember("encoding") && v["encoding"].IsString()) {
+        cfg.encoding = DeltaEncodingFromName(v["encoding"].GetString());
+    }
+    if (v.HasMember("batch") && v["batch"].IsUint()) {
+        cfg.batch = std::max(1u, v["batch"].GetUint());
+    }
+    if (v.HasMember("interval") && v["interval"].IsUint()) {
+        cfg.interval = std::chrono::milliseconds(v["interval"].GetUint());
+    }
+    if (v.HasMember("batch_bytes") && v["batch_bytes"].IsUint()) {
+        cfg.batch_bytes = v["batch_bytes"].GetUint();
+    }
+    if (v.HasMember("queue") && v["queue"].IsUint()) {
+        cfg.queue = std::max(1u, v["queue"].GetUint());
+    }
+    if (v.HasMember("policy") && v["policy"].IsString()) {
+        const std::string p = v["policy"].GetString();
+        if (p == "drop_newest") {
+            cfg.policy = sink_policy::drop_newest;
+        } else if (p == "merge") {
+            cfg.policy = sink_policy::merge;
+        } else {
+            cfg.policy = sink_policy::drop_oldest;
+        }
+    }
+    if (v.HasMember("path") && v["path"].IsString()) {
+        cfg.path = v["path"].GetString();
+    }
+    if (v.HasMember("host") && v["host"].IsString()) {
+        cfg.host = v["host"].GetString();
+    }
+    if (v.HasMember("port") && v["port"].IsUint()
+        && v["port"].GetUint() <= UINT16_MAX) {
+        cfg.port = static_cast<uint16_t>(v["port"].GetUint());
+    }
+    return cfg;
+}
+
+Value sink_config::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("type", type, allocator);
+    v.AddMember("encoding", StringRef(DeltaEncodingName(encoding)), allocator);
+    v.AddMember("batch", static_cast<uint64_t>(batch), allocator);
+    v.AddMember("interval", static_cast<uint64_t>(interval.count()), allocator);
+    v.AddMember("batch_bytes", static_cast<uint64_t>(batch_bytes), allocator);
+    v.AddMember("queue", static_cast<uint64_t>(queue), allocator);
+    v.AddMember("policy", StringRef(PolicyName(policy)), allocator);
+    if (!path.empty()) {
+        v.AddMember("path", path, allocator);
+    }
+    if (!host.empty()) {
+        v.AddMember("host", host, allocator);
+    }
+    if (port != 0) {
+        v.AddMember("port", port, allocator);
+    }
+    return v;
+}
+
+OutputSink::OutputSink(const sink_config& cfg, bool stream, bool threaded)
+    : m_cfg(cfg)
+    , m_clock(&Clock::Real())
+    , m_state(nullptr)
+    , m_state_mutex(nullptr)
+    , m_stream(stream)
+    , m_threaded(threaded)
+    , m_stop(true)
+    , m_open(false)
+    , m_accepted(0)
+    , m_delivered(0)
+    , m_batches(0)
+    , m_dropped(0)
+    , m_errors(0)
+    , m_depth(0)
+{
+}
+
+// Derived classes stop the sink in their destructors, the worker thread calls
+// their virtual methods
+OutputSink::~OutputSink() = default;
+
+void OutputSink::Append(std::string_view data)
+{
+    auto& d = m_current.data;
+    if (m_cfg.encoding == delta_encoding::cbor) {
+        d.append(data);
+    } else if (m_stream) {
+        d.append(data);
+        d.push_back('\n');
+    } else if (m_current.count == 0) {
+        d.assign(data);
+    } else {
+        if (m_current.count == 1) {
+            // Turn the single delta into an array of deltas
+            if (!d.empty() && d.front() == '[') {
+                d.pop_back();
+            } else {
+                d.insert(d.begin(), '[');
+            }
+        } else {
+            d.pop_back();
+        }
+        d.push_back(',');
+        d.append(Inner(data));
+        d.push_back(']');
+    }
+    ++m_current.count;
+}
+
+void OutputSink::Seal(batch* out)
+{
+    if (m_current.count == 0) {
+        return;
+    }
+    if (!m_threaded) {
+        std::swap(*out, m_current);
+    } else if (m_queue.size() < m_cfg.queue) {
+        m_queue.push_back(std::move(m_current));
+    } else if (m_cfg.policy == sink_policy::drop_oldest) {
+        m_dropped += m_queue.front().count;
+        m_queue.pop_front();
+        m_queue.push_back(std::move(m_current));
+    } else {
+        m_dropped += m_current.count;
+    }
+    m_depth = m_queue.size();
+    m_current.data.clear();
+    m_current.count = 0;
+    m_cv.notify_one();
+}
+
+bool OutputSink::Congested() const
+{
+    return m_threaded && m_queue.size() >= m_cfg.queue
+        && m_cfg.policy == sink_policy::merge;
+}
+
+void OutputSink::PushDocument(
+    const Value& d, std::chrono::steady_clock::time_point now)
+{
+    Reopen(now);
+    ++m_accepted;
+    if (m_open && WriteDocument(d)) {
+        ++m_delivered;
+        ++m_batches;
+    } else {
+        ++m_dropped;
+        ++m_errors;
+    }
+}
+
+void OutputSink::Push(
+    std::string_view data, std::chrono::steady_clock::time_point now)
+{
+    if (data.empty() || data == "[]") {
+        return;
+    }
+    Reopen(now);
+    batch out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_accepted;
+        const bool congested = Congested();
+        if (congested
+            && m_current.data.size() + data.size() > m_cfg.batch_bytes) {
+            ++m_dropped;
+            return;
+        }
+        if (m_current.count == 0) {
+            m_current.started = now;
+        }
+        Append(data);
+        if (!congested
+            && (m_current.count >= m_cfg.batch
+                || m_current.data.size() >= m_cfg.batch_bytes
+                || m_cfg.interval.count() == 0)) {
+            Seal(&out);
+        }
+    }
+    if (out.count != 0) {
+        Deliver(out);
+    }
+}
+
+void OutputSink::Tick(std::chrono::steady_clock::time_point now)
+{
+    Reopen(now);
+    batch out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_current.count != 0 && now - m_current.started >= m_cfg.interval
+            && !Congested()) {
+            Seal(&out);
+        }
+    }
+    if (out.count != 0) {
+        Deliver(out);
+    }
+}
+
+void OutputSink::Deliver(batch& b)
+{
+    if (m_open && Write(b.data)) {
+        m_delivered += b.count;
+        ++m_batches;
+    } else {
+        m_dropped += b.count;
+        ++m_errors;
+    }
+}
+
+void OutputSink::Reopen(std::chrono::steady_clock::time_point now)
+{
+    if (m_threaded || m_stop || m_open || now - m_opened < REOPEN_PERIOD) {
+        return;
+    }
+    m_opened = now;
+    m_open = Open();
+    if (!m_open) {
+        ++m_errors;
+    }
+}
+
+void OutputSink::Start()
+{
+    if (m_threaded) {
+        if (!m_thread.joinable()) {
+            m_stop = false;
+            m_thread = std::thread(&OutputSink::Run, this);
+        }
+    } else if (!m_open) {
+        m_stop = false;
+        m_opened = m_clock->Steady();
+        m_open = Open();
+        if (!m_open) {
+            ++m_errors;
+        }
+    }
+}
+
+void OutputSink::Stop()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    } else if (!m_threaded) {
+        batch out;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Seal(&out);
+        }
+        if (out.count != 0) {
+            Deliver(out);
+        }
+        if (m_open) {
+            Close();
+            m_open = false;
+        }
+        m_stop = true;
+    }
+}
+
+bool OutputSink::Snapshot(Document& d) const
+{
+    if (m_state == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(*m_state_mutex);
+    m_state->Snapshot(d);
+    return true;
+}
+
+bool OutputSink::Interest(
+    uint64_t& generation, std::vector<std::string>& patterns) const
+{
+    if (generation == 0) {
+        return false;
+    }
+    generation = 0;
+    patterns.assign(1, "*");
+    return true;
+}
+
+void OutputSink::Run()
+{
+    m_open = Open();
+    if (!m_open) {
+        ++m_errors;
+    }
+    auto opened = m_clock->Steady();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (!m_queue.empty()) {
+            batch b = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_depth = m_queue.size();
+            lock.unlock();
+            Deliver(b);
+            lock.lock();
+            continue;
+        }
+        if (m_stop) {
+            break;
+        }
+        auto now = m_clock->Steady();
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            IDLE_PERIOD);
+        if (m_current.count != 0 && m_cfg.interval.count() != 0) {
+            wait = std::min(wait,
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    m_current.started + m_cfg.interval - now));
+        }
+        if (wait.count() > 0) {
+            m_cv.wait_for(lock, wait);
+        }
+        now = m_clock->Steady();
+        if (m_current.count != 0
+            && now - m_current.started >= m_cfg.interval) {
+            Seal(nullptr);
+        }
+        if (m_queue.empty() && !m_stop) {
+            lock.unlock();
+            if (!m_open && now - opened >= REOPEN_PERIOD) {
+                m_open = Open();
+                opened = now;
+                if (!m_open) {
+                    ++m_errors;
+                }
+            }
+            if (m_open) {
+                Idle();
+            }
+            lock.lock();
+        }
+    }
+    // Write what is left before exiting
+    if (m_current.count != 0) {
+        m_queue.push_back(std::move(m_current));
+        m_current.data.clear();
+        m_current.count = 0;
+    }
+    while (!m_queue.empty()) {
+        batch b = std::move(m_queue.front());
+        m_queue.pop_front();
+        Deliver(b);
+    }
+    m_depth = 0;
+    lock.unlock();
+    if (m_open) {
+        Close();
+        m_open = false;
+    }
+}
+
+PluginMessageSink::PluginMessageSink(
+    const sink_config& cfg, std::string message_id)
+    : OutputSink(
+        [&cfg]() {
+            sink_config c = cfg;
+            // Plugin messages are text
+            c.encoding = delta_encoding::json;
+            return c;
+        }(),
+        false, false)
+    , m_message_id(std::move(message_id))
+    , m_batch_id(m_message_id + "_BATCH")
+    , m_owner(std::this_thread::get_id())
+{
+}
+
+PluginMessageSink::~PluginMessageSink()
+{
+    Stop();
+    Dispatch();
+}
+
+bool PluginMessageSink::Interest(
+    uint64_t& generation, std::vector<std::string>& patterns) const
+{
+    if (generation == 0) {
+        return false;
+    }
+    generation = 0;
+    patterns.clear();
+    return true;
+}
+
+bool PluginMessageSink::Write(const std::string& data)
+{
+    const std::string* id
+        = !data.empty() && data.front() == '[' ? &m_batch_id : &m_message_id;
+    if (std::this_thread::get_id() != m_owner) {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        if (m_pending.size() >= MAX_PENDING_MESSAGES) {
+            return false;
+        }
+        m_pending.emplace_back(id, data);
+        return true;
+    }
+    // Keep the order of the messages queued before
+    Dispatch();
+    SendPluginMessage(*id, data);
+    return true;
+}
+
+void PluginMessageSink::Dispatch()
+{
+    if (std::this_thread::get_id() != m_owner) {
+        return;
+    }
+    std::deque<std::pair<const std::string*, std::string>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        pending.swap(m_pending);
+    }
+    for (const auto& m : pending) {
+        SendPluginMessage(*m.first, m.second);
+    }
+}
+
+CallbackSink::CallbackSink(
+    const sink_config& cfg, callback cb, bool threaded, bool stream)
+    : OutputSink(cfg, stream, threaded)
+    , m_cb(std::move(cb))
+{
+}
+
+CallbackSink::~CallbackSink() { Stop(); }
+
+bool CallbackSink::Write(const std::string& data) { return m_cb(data); }
+
+FileSink::FileSink(const sink_config& cfg)
+    : OutputSink(cfg, true, true)
+{
+}
+
+FileSink::~FileSink() { Stop(); }
+
+bool FileSink::Open()
+{
+    m_file.open(
+        Config().path, std::ios::out | std::ios::app | std::ios::binary);
+    return m_file.is_open();
+}
+
+void FileSink::Close() { m_file.close(); }
+
+bool FileSink::Write(const std::string& data)
+{
+    m_file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    m_file.flush();
+    if (!m_file.good()) {
+        m_file.clear();
+        return false;
+    }
+    return true;
+}
+
+UdpSink::UdpSink(const sink_config& cfg)
+    : OutputSink(cfg, false, true)
+    , m_socket(INVALID_SOCKET_HANDLE)
+    , m_addr {}
+    , m_addr_len(0)
+{
+}
+
+UdpSink::~UdpSink() { Stop(); }
+
+bool UdpSink::Open()
+{
+    NetInit();
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* res = nullptr;
+    const std::string port = std::to_string(Config().port);
+    if (getaddrinfo(Config().host.empty() ? "127.0.0.1" : Config().host.c_str(),
+            port.c_str(), &hints, &res)
+            != 0
+        || res == nullptr) {
+        return false;
+    }
+    m_socket = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (m_socket != INVALID_SOCKET_HANDLE) {
+        std::memcpy(&m_addr, res->ai_addr, res->ai_addrlen);
+        m_addr_len = static_cast<socklen_t>(res->ai_addrlen);
+        int broadcast = 1;
+        setsockopt(m_socket, SOL_SOCKET, SO_BROADCAST,
+            reinterpret_cast<const char*>(&broadcast), sizeof(broadcast));
+    }
+    freeaddrinfo(res);
+    return m_socket != INVALID_SOCKET_HANDLE;
+}
+
+void UdpSink::Close()
+{
+    if (m_socket != INVALID_SOCKET_HANDLE) {
+        CloseSocket(m_socket);
+        m_socket = INVALID_SOCKET_HANDLE;
+    }
+}
+
+bool UdpSink::Write(const std::string& data)
+{
+    return sendto(m_socket, data.data(), static_cast<int>(data.size()), 0,
+               reinterpret_cast<const sockaddr*>(&m_addr), m_addr_len)
+        == static_cast<int>(data.size());
+}
+
+TcpSink::TcpSink(const sink_config& cfg)
+    : OutputSink(cfg, true, true)
+    , m_listen(INVALID_SOCKET_HANDLE)
+    , m_client_count(0)
+    , m_port(cfg.port)
+{
+}
+
+TcpSink::~TcpSink() { Stop(); }
+
+bool TcpSink::Open()
+{
+    NetInit();
+    addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    const std::string port = std::to_string(Config().port);
+    if (getaddrinfo(Config().host.empty() ? nullptr : Config().host.c_str(),
+            port.c_str(), &hints, &res)
+            != 0
+        || res == nullptr) {
+        return false;
+    }
+    m_listen = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (m_listen != INVALID_SOCKET_HANDLE) {
+        int reuse = 1;
+        setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR,
+            reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        if (bind(m_listen, res->ai_addr, static_cast<int>(res->ai_addrlen))
+                != 0
+            || listen(m_listen, 16) != 0 || !SetNonBlocking(m_listen)) {
+            CloseSocket(m_listen);
+            m_listen = INVALID_SOCKET_HANDLE;
+        }
+    }
+    freeaddrinfo(res);
+    if (m_listen == INVALID_SOCKET_HANDLE) {
+        return false;
+    }
+    sockaddr_in addr {};
+    socklen_t len = sizeof(addr);
+    if (getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        m_port = ntohs(addr.sin_port);
+    }
+    return true;
+}
+
+void TcpSink::Close()
+{
+    for (auto& c : m_clients) {
+        Flush(c);
+        CloseSocket(c.socket);
+    }
+    m_clients.clear();
+    m_client_count = 0;
+    if (m_listen != INVALID_SOCKET_HANDLE) {
+        CloseSocket(m_listen);
+        m_listen = INVALID_SOCKET_HANDLE;
+    }
+}
+
+void TcpSink::Accept()
+{
+    while (true) {
+        socket_t s = accept(m_listen, nullptr, nullptr);
+        if (s == INVALID_SOCKET_HANDLE) {
+            break;
+        }
+        SetNonBlocking(s);
+        int nodelay = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY,
+            reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+#ifdef SO_NOSIGPIPE
+        int nosigpipe = 1;
+        setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe, sizeof(nosigpipe));
+#endif
+        m_clients.push_back({ s, std::string() });
+    }
+    m_client_count = m_clients.size();
+}
+
+bool TcpSink::Flush(client& c)
+{
+    while (!c.pending.empty()) {
+        const auto n = send(c.socket, c.pending.data(),
+            static_cast<int>(c.pending.size()), SEND_FLAGS);
+        if (n > 0) {
+            c.pending.erase(0, static_cast<size_t>(n));
+        } else {
+            return n < 0 && WouldBlock();
+        }
+    }
+    return true;
+}
+
+void TcpSink::Idle()
+{
+    Accept();
+    char buf[512];
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+                        [&](client& c) {
+                            // The stream is one way, whatever the client sends
+                            // is discarded, we only need to detect the
+                            // disconnection
+                            const auto n = recv(c.socket, buf, sizeof(buf), 0);
+                            if (n == 0 || (n < 0 && !WouldBlock())
+                                || !Flush(c)) {
+                                CloseSocket(c.socket);
+                                return true;
+                            }
+                            return false;
+                        }),
+        m_clients.end());
+    m_client_count = m_clients.size();
+}
+
+bool TcpSink::Write(const std::string& data)
+{
+    Accept();
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+                        [&](client& c) {
+                            if (c.pending.size() + data.size()
+                                > MAX_CLIENT_PENDING) {
+                                // The client does not keep up
+                                CloseSocket(c.socket);
+                                return true;
+                            }
+                            c.pending.append(data);
+                            if (!Flush(c)) {
+                                CloseSocket(c.socket);
+                                return true;
+                            }
+                            return false;
+                        }),
+        m_clients.end());
+    m_client_count = m_clients.size();
+    return true;
+}
+
+OutputSinks::~OutputSinks() { Clear(); }
+
+std::unique_ptr<OutputSink> OutputSinks::Create(const sink_config& cfg)
+{
+    if (cfg.type == "plugin") {
+        return std::make_unique<PluginMessageSink>(cfg);
+    } else if (cfg.type == "file") {
+        return std::make_unique<FileSink>(cfg);
+    } else if (cfg.type == "udp") {
+        return std::make_unique<UdpSink>(cfg);
+    } else if (cfg.type == "tcp") {
+        return std::make_unique<TcpSink>(cfg);
+#ifdef __linux__
+    } else if (cfg.type == "signalk") {
+        return std::make_unique<SignalKServer>(cfg);
+#endif
+    }
+    return nullptr;
+}
+
+OutputSink* OutputSinks::Add(std::unique_ptr<OutputSink> sink)
+{
+    if (!sink) {
+        return nullptr;
+    }
+    sink->SetClock(*m_clock);
+    if (m_state != nullptr) {
+        sink->SetState(*m_state, *m_state_mutex);
+    }
+    sink->Start();
+    m_sinks.push_back(std::move(sink));
+    m_generations.push_back(UINT64_MAX);
+    return m_sinks.back().get();
+}
+
+void OutputSinks::Clear()
+{
+    for (auto& s : m_sinks) {
+        s->Stop();
+    }
+    m_sinks.clear();
+    m_generations.clear();
+}
+
+void OutputSinks::Publish(const Value& d, std::string_view json,
+    std::chrono::steady_clock::time_point now)
+{
+    const std::string* cbor = nullptr;
+    for (auto& s : m_sinks) {
+        if (s->TakesDocuments()) {
+            s->PushDocument(d, now);
+        } else if (s->Config().encoding == delta_encoding::cbor) {
+            if (cbor == nullptr) {
+                cbor = &m_encoder.Encode(d, delta_encoding::cbor);
+            }
+            s->Push(*cbor, now);
+        } else {
+            s->Push(json, now);
+        }
+    }
+}
+
+void OutputSinks::UpdateSubscriptions(SKSubscriptions& subscriptions)
+{
+    std::vector<std::string> patterns;
+    for (size_t i = 0; i < m_sinks.size(); ++i) {
+        if (m_sinks[i]->Interest(m_generations[i], patterns)) {
+            subscriptions.Set("sink." + std::to_string(i), patterns);
+        }
+    }
+    // Forget the sinks removed since the last update
+    for (size_t i = m_sinks.size(); i < m_reported; ++i) {
+        subscriptions.Set("sink." + std::to_string(i), {});
+    }
+    m_reported = m_sinks.size();
+}
+
+void OutputSinks::Dispatch()
+{
+    for (auto& s : m_sinks) {
+        s->Dispatch();
+    }
+}
+
+void OutputSinks::Tick(std::chrono::steady_clock::time_point now)
+{
+    for (auto& s : m_sinks) {
+        s->Tick(now);
+    }
+}
+
+PLUGIN_END_NAMESPACE
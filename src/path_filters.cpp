@@ -0,0 +1,274 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "path_filters.h"
+
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// Names of the filter types in the configuration
+const char* TYPE_NAMES[] = { "none", "ema", "circular", "kalman" };
+
+/// Angular path produced by NSK (SignalK unit rad)
+struct angle_path {
+    /// SignalK path
+    const char* path;
+    /// The angle is in (-PI, PI] rather than [0, 2 * PI)
+    bool signed_angle;
+};
+
+/// The angular paths, filtered as angles whatever the filter type
+const angle_path ANGLE_PATHS[] = {
+    { "environment.wind.angleApparent", true },
+    { "environment.wind.angleTrueGround", true },
+    { "environment.wind.angleTrueWater", true },
+    { "environment.wind.directionMagnetic", false },
+    { "environment.wind.directionTrue", false },
+    { "navigation.courseGreatCircle.bearingTrackMagnetic", false },
+    { "navigation.courseGreatCircle.bearingTrackTrue", false },
+    { "navigation.courseOverGroundMagnetic", false },
+    { "navigation.courseOverGroundTrue", false },
+    { "navigation.courseRhumbline.bearingTrackMagnetic", false },
+    { "navigation.courseRhumbline.bearingTrackTrue", false },
+    { "navigation.courseRhumbline.nextPoint.bearingTrue", false },
+    { "navigation.headingMagnetic", false },
+    { "navigation.headingTrue", false },
+    { "navigation.magneticVariation", true },
+    { "steering.autopilot.target.headingMagnetic", false },
+    { "steering.autopilot.target.headingTrue", false },
+    { "steering.rudderAngle", true },
+};
+
+/// @brief Return the angular path entry of the path
+/// @return Entry or nullptr if the path is not an angle
+const angle_path* FindAngle(const std::string& path)
+{
+    for (const auto& a : ANGLE_PATHS) {
+        if (path == a.path) {
+            return &a;
+        }
+    }
+    return nullptr;
+}
+
+/// @brief Wrap an angle to the range of the filter
+double Wrap(double angle, bool signed_angle)
+{
+    angle = std::remainder(angle, 2.0 * PI);
+    if (!signed_angle && angle < 0.0) {
+        angle += 2.0 * PI;
+    }
+    return angle;
+}
+}
+
+filter_config filter_config::FromJSON(const Value& v)
+{
+    filter_config c;
+    if (!v.IsObject()) {
+        return c;
+    }
+    if (v.HasMember("type") && v["type"].IsString()) {
+        for (size_t i = 0; i < std::size(TYPE_NAMES); ++i) {
+            if (std::strcmp(v["type"].GetString(), TYPE_NAMES[i]) == 0) {
+                c.type = static_cast<filter_type>(i);
+            }
+        }
+    }
+    if (v.HasMember("time_constant") && v["time_constant"].IsNumber()) {
+        c.time_constant = v["time_constant"].GetDouble();
+    }
+    if (v.HasMember("process_noise") && v["process_noise"].IsNumber()) {
+        c.process_noise = v["process_noise"].GetDouble();
+    }
+    if (v.HasMember("measurement_noise")
+        && v["measurement_noise"].IsNumber()) {
+        c.measurement_noise = v["measurement_noise"].GetDouble();
+    }
+    if (v.HasMember("angle") && v["angle"].IsBool()) {
+        c.angle = v["angle"].GetBool();
+    }
+    if (v.HasMember("signed") && v["signed"].IsBool()) {
+        c.signed_angle = v["signed"].GetBool();
+    }
+    if (v.HasMember("raw") && v["raw"].IsBool()) {
+        c.raw = v["raw"].GetBool();
+    }
+    return c;
+}
+
+Value filter_config::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("type", StringRef(TYPE_NAMES[static_cast<size_t>(type)]),
+        allocator);
+    if (type == filter_type::KALMAN) {
+        v.AddMember("process_noise", process_noise, allocator);
+        v.AddMember("measurement_noise", measurement_noise, allocator);
+    } else {
+        v.AddMember("time_constant", time_constant, allocator);
+    }
+    v.AddMember("angle", angle, allocator);
+    v.AddMember("signed", signed_angle, allocator);
+    v.AddMember("raw", raw, allocator);
+    return v;
+}
+
+PathFilters::PathFilters()
+    : m_configured(0)
+    , m_filtered(0)
+{
+}
+
+void PathFilters::Set(const std::string& path, const filter_config& config)
+{
+    const auto id = SKPaths::Id(path);
+    if (id == SKPaths::NONE) {
+        return;
+    }
+    if (m_records.empty()) {
+        m_records.resize(SKPaths::MAX_PATHS);
+    }
+    record& r = m_records[id];
+    m_configured -= r.config.type != filter_type::NONE;
+    r = record();
+    r.config = config;
+    r.config.angle |= config.type == filter_type::CIRCULAR;
+    if (const angle_path* a = FindAngle(path)) {
+        r.config.angle = true;
+        r.config.signed_angle |= a->signed_angle;
+    }
+    m_configured += r.config.type != filter_type::NONE;
+}
+
+void PathFilters::Clear()
+{
+    m_records.clear();
+    m_configured = 0;
+}
+
+const filter_config& PathFilters::Config(sk_path_id path) const
+{
+    static const filter_config none;
+    return path < m_records.size() ? m_records[path].config : none;
+}
+
+double PathFilters::Apply(
+    sk_path_id path, double value, std::chrono::steady_clock::time_point now)
+{
+    if (path >= m_records.size() || std::isnan(value)) {
+        return value;
+    }
+    record& r = m_records[path];
+    const filter_config& c = r.config;
+    if (c.type == filter_type::NONE) {
+        return value;
+    }
+    ++m_filtered;
+    const double dt = r.initialized
+        ? std::chrono::duration<double>(now - r.last).count()
+        : 0.0;
+    r.last = now;
+    if (!r.initialized) {
+        r.initialized = true;
+        r.x = value;
+        r.s = std::sin(value);
+        r.c = std::cos(value);
+        r.p = c.measurement_noise;
+        return value;
+    }
+    switch (c.type) {
+    case filter_type::EMA:
+    case filter_type::CIRCULAR: {
+        const double alpha = c.time_constant > 0.0
+            ? 1.0 - std::exp(-dt / c.time_constant)
+            : 1.0;
+        if (c.angle) {
+            r.s += alpha * (std::sin(value) - r.s);
+            r.c += alpha * (std::cos(value) - r.c);
+            if (r.s == 0.0 && r.c == 0.0) {
+                // Exactly opposite samples, nothing to average
+                return value;
+            }
+            return Wrap(std::atan2(r.s, r.c), c.signed_angle);
+        }
+        r.x += alpha * (value - r.x);
+        return r.x;
+    }
+    case filter_type::KALMAN: {
+        r.p += c.process_noise * dt;
+        const double k = r.p / (r.p + c.measurement_noise);
+        const double innovation = c.angle
+            ? std::remainder(value - r.x, 2.0 * PI)
+            : value - r.x;
+        r.x += k * innovation;
+        r.p *= 1.0 - k;
+        if (c.angle) {
+            r.x = Wrap(r.x, c.signed_angle);
+        }
+        return r.x;
+    }
+    default:
+        return value;
+    }
+}
+
+void PathFilters::FromJSON(const Value& v)
+{
+    Clear();
+    if (!v.IsObject() || !v.HasMember("paths") || !v["paths"].IsObject()) {
+        return;
+    }
+    for (const auto& p : v["paths"].GetObject()) {
+        Set(p.name.GetString(), filter_config::FromJSON(p.value));
+    }
+}
+
+Value PathFilters::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    Value paths(kObjectType);
+    for (size_t id = 0; id < m_records.size(); ++id) {
+        const record& r = m_records[id];
+        if (r.config.type == filter_type::NONE) {
+            continue;
+        }
+        paths.AddMember(
+            Value(SKPaths::Name(static_cast<sk_path_id>(id)).c_str(),
+                allocator),
+            r.config.ToJSON(allocator), allocator);
+    }
+    v.AddMember("paths", paths, allocator);
+    return v;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,1046 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "signalk_server.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <ctime>
+
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// SignalK specification version implemented
+constexpr const char* SK_VERSION = "1.7.0";
+/// Magic string of the WebSocket handshake (RFC 6455)
+constexpr const char* WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+/// Maximum size of a HTTP request header or a WebSocket message
+constexpr size_t MAX_INPUT = 64 * 1024;
+/// Maximum output waiting for a client before the deltas for it are dropped
+constexpr size_t MAX_CLIENT_PENDING = 4 * 1024 * 1024;
+/// Maximum number of connections
+constexpr size_t MAX_CLIENTS = 256;
+/// Longest time the server thread sleeps
+constexpr std::chrono::milliseconds MAX_WAIT(1000);
+/// Default update period of the subscriptions
+constexpr std::chrono::milliseconds DEFAULT_PERIOD(1000);
+
+/// WebSocket opcodes
+constexpr uint8_t WS_CONTINUATION = 0x0;
+constexpr uint8_t WS_TEXT = 0x1;
+constexpr uint8_t WS_CLOSE = 0x8;
+constexpr uint8_t WS_PING = 0x9;
+constexpr uint8_t WS_PONG = 0xA;
+
+/// @brief SHA-1 digest of the data (needed by the WebSocket handshake only)
+std::array<uint8_t, 20> Sha1(std::string_view data)
+{
+    uint32_t h[5]
+        = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string msg(data);
+    const uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) {
+        msg.push_back('\0');
+    }
+    for (int i = 7; i >= 0; --i) {
+        msg.push_back(static_cast<char>(bits >> (i * 8)));
+    }
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p
+                = reinterpret_cast<const uint8_t*>(msg.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16)
+                | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            const uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    std::array<uint8_t, 20> out;
+    for (int i = 0; i < 20; ++i) {
+        out[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+    return out;
+}
+
+/// @brief Base64 encoding of the data
+std::string Base64(const uint8_t* data, size_t len)
+{
+    static const char* table
+        = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < len) {
+            v |= uint32_t(data[i + 1]) << 8;
+        }
+        if (i + 2 < len) {
+            v |= data[i + 2];
+        }
+        out.push_back(table[(v >> 18) & 0x3f]);
+        out.push_back(table[(v >> 12) & 0x3f]);
+        out.push_back(i + 1 < len ? table[(v >> 6) & 0x3f] : '=');
+        out.push_back(i + 2 < len ? table[v & 0x3f] : '=');
+    }
+    return out;
+}
+
+/// @brief Build a WebSocket frame sent by the server (not masked)
+std::string WsFrame(uint8_t opcode, std::string_view payload)
+{
+    std::string f;
+    f.reserve(payload.size() + 10);
+    f.push_back(static_cast<char>(0x80 | opcode));
+    if (payload.size() < 126) {
+        f.push_back(static_cast<char>(payload.size()));
+    } else if (payload.size() <= UINT16_MAX) {
+        f.push_back(126);
+        f.push_back(static_cast<char>(payload.size() >> 8));
+        f.push_back(static_cast<char>(payload.size()));
+    } else {
+        f.push_back(127);
+        for (int i = 7; i >= 0; --i) {
+            f.push_back(static_cast<char>(
+                static_cast<uint64_t>(payload.size()) >> (i * 8)));
+        }
+    }
+    f.append(payload);
+    return f;
+}
+
+/// @brief Serialize a JSON value
+std::string Serialize(const Value& v)
+{
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    v.Accept(writer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+/// @brief Build a HTTP response
+std::string HttpResponse(std::string_view status, std::string_view body)
+{
+    std::string r = "HTTP/1.1 ";
+    r.append(status);
+    r.append("\r\nContent-Type: application/json\r\n"
+             "Access-Control-Allow-Origin: *\r\n"
+             "Connection: close\r\nContent-Length: ");
+    r.append(std::to_string(body.size()));
+    r.append("\r\n\r\n");
+    r.append(body);
+    return r;
+}
+
+/// @brief Return the value of the HTTP header (case insensitive name)
+std::string_view Header(std::string_view headers, std::string_view name)
+{
+    size_t pos = 0;
+    while ((pos = headers.find("\r\n", pos)) != std::string_view::npos) {
+        pos += 2;
+        if (headers.size() - pos <= name.size()
+            || headers[pos + name.size()] != ':') {
+            continue;
+        }
+        bool same = true;
+        for (size_t i = 0; i < name.size() && same; ++i) {
+            same = std::tolower(static_cast<unsigned char>(headers[pos + i]))
+                == std::tolower(static_cast<unsigned char>(name[i]));
+        }
+        if (!same) {
+            continue;
+        }
+        size_t start = pos + name.size() + 1;
+        size_t end = headers.find("\r\n", start);
+        if (end == std::string_view::npos) {
+            end = headers.size();
+        }
+        while (start < end && headers[start] == ' ') {
+            ++start;
+        }
+        while (end > start && headers[end - 1] == ' ') {
+            --end;
+        }
+        return headers.substr(start, end - start);
+    }
+    return {};
+}
+
+/// @brief Current time in ISO 8601 format
+std::string Now()
+{
+    const auto t = std::chrono::system_clock::to_time_t(
+        std::chrono::system_clock::now());
+    std::tm tm {};
+    gmtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf;
+}
+}
+
+SignalKServer::SignalKServer(const sink_config& cfg)
+    : OutputSink(
+        [&cfg]() {
+            sink_config c = cfg;
+            // The deltas are distributed to the clients one by one
+            c.encoding = delta_encoding::json;
+            c.batch = 1;
+            c.interval = std::chrono::milliseconds(0);
+            return c;
+        }(),
+        false, false)
+    , m_stop(false)
+    , m_listen(-1)
+    , m_ws_clients(0)
+    , m_port(cfg.port)
+    , m_client_drops(0)
+    , m_interest_generation(0)
+{
+}
+
+SignalKServer::~SignalKServer() { Stop(); }
+
+bool SignalKServer::Open()
+{
+    addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    const std::string port = std::to_string(Config().port);
+    if (getaddrinfo(Config().host.empty() ? nullptr : Config().host.c_str(),
+            port.c_str(), &hints, &res)
+            != 0
+        || res == nullptr) {
+        return false;
+    }
+    m_listen = socket(res->ai_family,
+        res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+    if (m_listen >= 0) {
+        int reuse = 1;
+        setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(m_listen, res->ai_addr, res->ai_addrlen) != 0
+            || listen(m_listen, 64) != 0) {
+            close(m_listen);
+            m_listen = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (m_listen < 0) {
+        return false;
+    }
+    sockaddr_in addr {};
+    socklen_t len = sizeof(addr);
+    if (getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        m_port = ntohs(addr.sin_port);
+    }
+    m_loop = std::make_unique<EventLoop>();
+    if (!m_loop->Valid()
+        || !m_loop->Add(m_listen, EPOLLIN, [this](uint32_t) { Accept(); })) {
+        m_loop.reset();
+        close(m_listen);
+        m_listen = -1;
+        return false;
+    }
+    m_stop = false;
+    m_thread = std::thread(&SignalKServer::Run, this);
+    return true;
+}
+
+void SignalKServer::Close()
+{
+    if (m_thread.joinable()) {
+        m_stop = true;
+        m_loop->Wake();
+        m_thread.join();
+    }
+    std::vector<int> fds;
+    for (const auto& c : m_clients) {
+        fds.push_back(c.first);
+    }
+    for (int fd : fds) {
+        Drop(fd);
+    }
+    if (m_listen >= 0) {
+        close(m_listen);
+        m_listen = -1;
+    }
+    m_loop.reset();
+}
+
+bool SignalKServer::Write(const std::string& data)
+{
+    Document d;
+    d.Parse<kParseFullPrecisionFlag>(data.c_str(), data.size());
+    if (d.HasParseError()) {
+        return false;
+    }
+    return Queue(std::move(d));
+}
+
+bool SignalKServer::WriteDocument(const Value& d)
+{
+    Document copy;
+    copy.CopyFrom(d, copy.GetAllocator());
+    return Queue(std::move(copy));
+}
+
+bool SignalKServer::Queue(Document&& d)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_inbox_mutex);
+        if (m_inbox.size() >= Config().queue) {
+            return false;
+        }
+        m_inbox.push_back(std::move(d));
+    }
+    m_loop->Wake();
+    return true;
+}
+
+void SignalKServer::Run()
+{
+    while (!m_stop) {
+        const auto wait = SendPeriodic(SinkClock().Steady());
+        Sweep();
+        m_loop->Poll(static_cast<int>(wait.count()));
+        ProcessInbox();
+        Sweep();
+    }
+}
+
+void SignalKServer::Accept()
+{
+    while (true) {
+        const int fd = accept4(m_listen, nullptr, nullptr,
+            SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            break;
+        }
+        if (m_clients.size() >= MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        auto c = std::make_unique<client>();
+        c->fd = fd;
+        m_clients[fd] = std::move(c);
+        m_loop->Add(fd, EPOLLIN, [this, fd](uint32_t ev) { OnClient(fd, ev); });
+    }
+}
+
+void SignalKServer::Drop(int fd)
+{
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end()) {
+        return;
+    }
+    const bool websocket = it->second->websocket;
+    m_loop->Remove(fd);
+    close(fd);
+    m_clients.erase(it);
+    if (websocket) {
+        --m_ws_clients;
+        InterestChanged();
+    }
+}
+
+void SignalKServer::Sweep()
+{
+    std::vector<int> broken;
+    for (const auto& c : m_clients) {
+        if (c.second->broken) {
+            broken.push_back(c.first);
+        }
+    }
+    for (int fd : broken) {
+        Drop(fd);
+    }
+}
+
+void SignalKServer::OnClient(int fd, uint32_t events)
+{
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end()) {
+        return;
+    }
+    client& c = *it->second;
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        c.broken = true;
+        return;
+    }
+    if (events & EPOLLIN) {
+        char buf[16384];
+        while (true) {
+            const auto n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c.in.append(buf, static_cast<size_t>(n));
+                if (c.in.size() > 2 * MAX_INPUT) {
+                    c.broken = true;
+                    return;
+                }
+            } else if (n == 0 || !WouldBlock()) {
+                c.broken = true;
+                return;
+            } else {
+                break;
+            }
+        }
+        if (!(c.websocket ? HandleFrames(c) : HandleHttp(c))) {
+            c.broken = true;
+            return;
+        }
+    }
+    Flush(c);
+}
+
+bool SignalKServer::Flush(client& c)
+{
+    while (!c.out.empty()) {
+        const auto n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out.erase(0, static_cast<size_t>(n));
+        } else if (n < 0 && WouldBlock()) {
+            break;
+        } else {
+            c.broken = true;
+            return false;
+        }
+    }
+    if (c.out.empty() && c.close_after_write) {
+        c.broken = true;
+        return false;
+    }
+    const bool want_out = !c.out.empty();
+    if (want_out != c.want_out) {
+        c.want_out = want_out;
+        m_loop->Modify(c.fd, want_out ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    }
+    return true;
+}
+
+void SignalKServer::Send(client& c, std::string_view data, bool droppable)
+{
+    if (c.broken) {
+        return;
+    }
+    if (droppable && c.out.size() > MAX_CLIENT_PENDING) {
+        ++m_client_drops;
+        return;
+    }
+    const bool idle = c.out.empty();
+    c.out.append(data);
+    if (idle) {
+        Flush(c);
+    }
+}
+
+bool SignalKServer::HandleHttp(client& c)
+{
+    const size_t end = c.in.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        return c.in.size() <= MAX_INPUT;
+    }
+    const std::string request = c.in.substr(0, end + 2);
+    c.in.erase(0, end + 4);
+
+    const size_t line_end = request.find("\r\n");
+    const std::string_view line(request.data(), line_end);
+    const std::string_view headers(
+        request.data() + line_end, request.size() - line_end);
+    const size_t sp1 = line.find(' ');
+    const size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp1 == std::string_view::npos || sp2 == std::string_view::npos) {
+        Send(c, HttpResponse("400 Bad Request", "{}"), false);
+        c.close_after_write = true;
+        return true;
+    }
+    const std::string_view method = line.substr(0, sp1);
+    std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view query;
+    if (const size_t q = target.find('?'); q != std::string_view::npos) {
+        query = target.substr(q + 1);
+        target = target.substr(0, q);
+    }
+    while (target.size() > 1 && target.back() == '/') {
+        target.remove_suffix(1);
+    }
+    if (method != "GET") {
+        Send(c, HttpResponse("405 Method Not Allowed", "{}"), false);
+        c.close_after_write = true;
+        return true;
+    }
+
+    if (target == "/signalk/v1/stream") {
+        const auto key = Header(headers, "Sec-WebSocket-Key");
+        if (key.empty()) {
+            Send(c, HttpResponse("400 Bad Request", "{}"), false);
+            c.close_after_write = true;
+            return true;
+        }
+        const auto digest = Sha1(std::string(key) + WS_GUID);
+        std::string resp = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: ";
+        resp += Base64(digest.data(), digest.size());
+        resp += "\r\n\r\n";
+        Send(c, resp, false);
+        c.websocket = true;
+        ++m_ws_clients;
+
+        std::string_view mode = "self";
+        if (const size_t p = query.find("subscribe=");
+            p != std::string_view::npos) {
+            mode = query.substr(p + 10);
+            mode = mode.substr(0, mode.find('&'));
+        }
+        if (mode == "all") {
+            c.subs.push_back(
+                { "*", "*", std::chrono::milliseconds(0), {} });
+        } else if (mode != "none") {
+            c.subs.push_back(
+                { "vessels.self", "*", std::chrono::milliseconds(0), {} });
+        }
+        SubscriptionsChanged(c);
+        Send(c, WsFrame(WS_TEXT, Hello()), false);
+        return HandleFrames(c);
+    }
+
+    if (target == "/signalk") {
+        std::string host(Header(headers, "Host"));
+        if (host.empty()) {
+            host = "localhost:" + std::to_string(m_port);
+        }
+        Document d;
+        d.SetObject();
+        auto& a = d.GetAllocator();
+        Value v1(kObjectType);
+        v1.AddMember("version", StringRef(SK_VERSION), a);
+        v1.AddMember(
+            "signalk-http", "http://" + host + "/signalk/v1/api/", a);
+        v1.AddMember("signalk-ws", "ws://" + host + "/signalk/v1/stream", a);
+        Value endpoints(kObjectType);
+        endpoints.AddMember("v1", v1, a);
+        Value server(kObjectType);
+        server.AddMember("id", "nsk", a);
+        server.AddMember("version", StringRef(SK_VERSION), a);
+        d.AddMember("endpoints", endpoints, a);
+        d.AddMember("server", server, a);
+        Send(c, HttpResponse("200 OK", Serialize(d)), false);
+        c.close_after_write = true;
+        return true;
+    }
+
+    const std::string_view api = "/signalk/v1/api";
+    if (target.compare(0, api.size(), api) == 0
+        && (target.size() == api.size() || target[api.size()] == '/')) {
+        Document d;
+        const Value* node = Snapshot(d) ? &d : nullptr;
+        std::string_view rest = target.substr(api.size());
+        while (node != nullptr && !rest.empty()) {
+            rest.remove_prefix(1);
+            const std::string seg(rest.substr(0, rest.find('/')));
+            rest = rest.substr(std::min(rest.size(), seg.size()));
+            if (!node->IsObject()) {
+                node = nullptr;
+                break;
+            }
+            auto it = node->FindMember(seg.c_str());
+            node = it == node->MemberEnd() ? nullptr : &it->value;
+        }
+        if (node == nullptr) {
+            Send(c, HttpResponse("404 Not Found", "{}"), false);
+        } else {
+            Send(c, HttpResponse("200 OK", Serialize(*node)), false);
+        }
+        c.close_after_write = true;
+        return true;
+    }
+
+    Send(c, HttpResponse("404 Not Found", "{}"), false);
+    c.close_after_write = true;
+    return true;
+}
+
+bool SignalKServer::HandleFrames(client& c)
+{
+    size_t pos = 0;
+    while (c.in.size() - pos >= 2 && !c.close_after_write) {
+        const auto* p = reinterpret_cast<const uint8_t*>(c.in.data() + pos);
+        const size_t avail = c.in.size() - pos;
+        const bool fin = p[0] & 0x80;
+        const uint8_t opcode = p[0] & 0x0f;
+        const bool masked = p[1] & 0x80;
+        uint64_t len = p[1] & 0x7f;
+        size_t hs = 2;
+        if (len == 126) {
+            if (avail < 4) {
+                break;
+            }
+            len = (uint64_t(p[2]) << 8) | p[3];
+            hs = 4;
+        } else if (len == 127) {
+            if (avail < 10) {
+                break;
+            }
+            len = 0;
+            for (int i = 0; i < 8; ++i) {
+                len = (len << 8) | p[2 + i];
+            }
+            hs = 10;
+        }
+        if (!masked || len > MAX_INPUT) {
+            // Client frames have to be masked (RFC 6455 5.1)
+            return false;
+        }
+        if (avail < hs + 4 + len) {
+            break;
+        }
+        const uint8_t* mask = p + hs;
+        std::string payload(reinterpret_cast<const char*>(p + hs + 4), len);
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<char>(payload[i] ^ mask[i % 4]);
+        }
+        pos += hs + 4 + len;
+
+        switch (opcode) {
+        case WS_CLOSE:
+            Send(c, WsFrame(WS_CLOSE, payload.substr(0, 2)), false);
+            c.close_after_write = true;
+            break;
+        case WS_PING:
+            Send(c, WsFrame(WS_PONG, payload), false);
+            break;
+        case WS_PONG:
+            break;
+        default:
+            if (opcode != WS_CONTINUATION) {
+                c.message_opcode = opcode;
+                c.message.clear();
+            }
+            c.message += payload;
+            if (c.message.size() > MAX_INPUT) {
+                return false;
+            }
+            if (fin) {
+                if (c.message_opcode == WS_TEXT) {
+                    HandleMessage(c, c.message);
+                }
+                c.message.clear();
+            }
+        }
+    }
+    c.in.erase(0, pos);
+    return true;
+}
+
+void SignalKServer::HandleMessage(client& c, const std::string& msg)
+{
+    Document d;
+    d.Parse(msg.c_str(), msg.size());
+    if (d.HasParseError() || !d.IsObject()) {
+        return;
+    }
+    const std::string context = d.HasMember("context")
+            && d["context"].IsString()
+        ? d["context"].GetString()
+        : "vessels.self";
+    if (d.HasMember("unsubscribe") && d["unsubscribe"].IsArray()) {
+        for (const auto& u : d["unsubscribe"].GetArray()) {
+            const std::string path = u.IsObject() && u.HasMember("path")
+                    && u["path"].IsString()
+                ? u["path"].GetString()
+                : "*";
+            c.subs.erase(std::remove_if(c.subs.begin(), c.subs.end(),
+                             [&](const subscription& s) {
+                                 return (context == "*" || s.context == context)
+                                     && (path == "*" || s.path == path);
+                             }),
+                c.subs.end());
+        }
+    }
+    if (d.HasMember("subscribe") && d["subscribe"].IsArray()) {
+        const auto now = SinkClock().Steady();
+        for (const auto& s : d["subscribe"].GetArray()) {
+            if (!s.IsObject()) {
+                continue;
+            }
+            subscription sub;
+            sub.context = context;
+            sub.path = s.HasMember("path") && s["path"].IsString()
+                ? s["path"].GetString()
+                : "*";
+            sub.period = DEFAULT_PERIOD;
+            if (s.HasMember("period") && s["period"].IsUint()) {
+                sub.period = std::chrono::milliseconds(s["period"].GetUint());
+            }
+            if (s.HasMember("policy") && s["policy"].IsString()
+                && std::strcmp(s["policy"].GetString(), "instant") == 0) {
+                // Changes are sent immediately, at most once per minPeriod
+                sub.period = std::chrono::milliseconds(
+                    s.HasMember("minPeriod") && s["minPeriod"].IsUint()
+                        ? s["minPeriod"].GetUint()
+                        : 0);
+            }
+            sub.due = now + sub.period;
+            c.subs.erase(std::remove_if(c.subs.begin(), c.subs.end(),
+                             [&](const subscription& e) {
+                                 return e.context == sub.context
+                                     && e.path == sub.path;
+                             }),
+                c.subs.end());
+            c.subs.push_back(std::move(sub));
+        }
+    }
+    SubscriptionsChanged(c);
+}
+
+void SignalKServer::SubscriptionsChanged(client& c)
+{
+    c.match.assign(c.match.size(), -2);
+    for (auto id : c.dirty) {
+        c.is_dirty[id] = 0;
+    }
+    c.dirty.clear();
+    c.all = c.subs.size() == 1 && c.subs[0].path == "*"
+        && c.subs[0].period.count() == 0
+        && SKPatternMatch(c.subs[0].context, "vessels.self");
+    InterestChanged();
+}
+
+void SignalKServer::InterestChanged()
+{
+    std::vector<std::string> patterns;
+    for (const auto& c : m_clients) {
+        if (!c.second->websocket) {
+            continue;
+        }
+        for (const auto& sub : c.second->subs) {
+            patterns.push_back(sub.path);
+        }
+    }
+    std::sort(patterns.begin(), patterns.end());
+    patterns.erase(
+        std::unique(patterns.begin(), patterns.end()), patterns.end());
+    std::lock_guard<std::mutex> lock(m_interest_mutex);
+    if (patterns != m_interest) {
+        m_interest = std::move(patterns);
+        ++m_interest_generation;
+    }
+}
+
+bool SignalKServer::Interest(
+    uint64_t& generation, std::vector<std::string>& patterns) const
+{
+    if (generation == m_interest_generation) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_interest_mutex);
+    generation = m_interest_generation;
+    patterns = m_interest;
+    return true;
+}
+
+int SignalKServer::Match(client& c, std::string_view context, sk_path_id id)
+{
+    const bool self = context == "vessels.self";
+    if (self && id < c.match.size() && c.match[id] != -2) {
+        return c.match[id];
+    }
+    const int found = Match(c, context, SKPaths::Name(id));
+    if (self) {
+        if (id >= c.match.size()) {
+            c.match.resize(SKPaths::Count(), -2);
+        }
+        c.match[id] = static_cast<int16_t>(found);
+    }
+    return found;
+}
+
+int SignalKServer::Match(
+    const client& c, std::string_view context, std::string_view path)
+{
+    for (size_t i = 0; i < c.subs.size(); ++i) {
+        if (SKPatternMatch(c.subs[i].context, context)
+            && SKPatternMatch(c.subs[i].path, path)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void SignalKServer::ProcessInbox()
+{
+    std::deque<Document> inbox;
+    {
+        std::lock_guard<std::mutex> lock(m_inbox_mutex);
+        inbox.swap(m_inbox);
+    }
+    for (const auto& d : inbox) {
+        if (d.IsArray()) {
+            for (const auto& delta : d.GetArray()) {
+                Distribute(delta);
+            }
+        } else {
+            Distribute(d);
+        }
+    }
+}
+
+void SignalKServer::Distribute(const Value& delta)
+{
+    if (!delta.IsObject() || !delta.HasMember("updates")
+        || !delta["updates"].IsArray()) {
+        return;
+    }
+    const std::string context
+        = delta.HasMember("context") && delta["context"].IsString()
+        ? delta["context"].GetString()
+        : "vessels.self";
+    const bool self = context == "vessels.self";
+
+    // Serialize the values once for all the clients
+    std::vector<std::pair<sk_path_id, item>> items;
+    // Values of the paths which are not registered (the CPA notifications of
+    // the AIS targets), sent as they come and not remembered
+    std::vector<std::pair<std::string, item>> unregistered;
+    for (const auto& upd : delta["updates"].GetArray()) {
+        if (!upd.IsObject() || !upd.HasMember("values")
+            || !upd["values"].IsArray()) {
+            continue;
+        }
+        auto source = std::make_shared<const std::string>(
+            upd.HasMember("source") ? Serialize(upd["source"]) : "");
+        const std::string timestamp
+            = upd.HasMember("timestamp") && upd["timestamp"].IsString()
+            ? upd["timestamp"].GetString()
+            : "";
+        for (const auto& v : upd["values"].GetArray()) {
+            if (!v.IsObject() || !v.HasMember("path")
+                || !v["path"].IsString()) {
+                continue;
+            }
+            const auto id = SKPaths::Id(v["path"].GetString());
+            if (id == SKPaths::NONE) {
+                unregistered.push_back({ v["path"].GetString(),
+                    { Serialize(v), source, timestamp } });
+                continue;
+            }
+            items.push_back({ id, { Serialize(v), source, timestamp } });
+        }
+    }
+    if (self) {
+        if (m_latest.size() < SKPaths::Count()) {
+            m_latest.resize(SKPaths::Count());
+        }
+        for (const auto& i : items) {
+            m_latest[i.first] = i.second;
+        }
+    }
+
+    std::string frame;
+    std::vector<const item*> instant;
+    for (auto& cp : m_clients) {
+        client& c = *cp.second;
+        if (!c.websocket || c.broken || c.subs.empty()) {
+            continue;
+        }
+        if (c.all && self) {
+            if (frame.empty()) {
+                frame = WsFrame(WS_TEXT, Serialize(delta));
+            }
+            Send(c, frame);
+            continue;
+        }
+        instant.clear();
+        for (const auto& i : items) {
+            const int s = Match(c, context, i.first);
+            if (s < 0) {
+                continue;
+            }
+            if (!self || c.subs[s].period.count() == 0) {
+                instant.push_back(&i.second);
+            } else if (!c.is_dirty.size() || i.first >= c.is_dirty.size()
+                || !c.is_dirty[i.first]) {
+                if (i.first >= c.is_dirty.size()) {
+                    c.is_dirty.resize(SKPaths::Count(), 0);
+                }
+                c.is_dirty[i.first] = 1;
+                c.dirty.push_back(i.first);
+            }
+        }
+        for (const auto& u : unregistered) {
+            if (Match(c, context, u.first) >= 0) {
+                instant.push_back(&u.second);
+            }
+        }
+        if (!instant.empty()) {
+            Send(c, WsFrame(WS_TEXT, BuildDelta(context, instant)));
+        }
+    }
+}
+
+std::chrono::milliseconds SignalKServer::SendPeriodic(
+    std::chrono::steady_clock::time_point now)
+{
+    auto next = now + MAX_WAIT;
+    std::vector<const item*> items;
+    for (auto& cp : m_clients) {
+        client& c = *cp.second;
+        if (!c.websocket || c.broken || c.all) {
+            continue;
+        }
+        for (size_t s = 0; s < c.subs.size(); ++s) {
+            auto& sub = c.subs[s];
+            if (sub.period.count() == 0) {
+                continue;
+            }
+            if (sub.due <= now) {
+                items.clear();
+                auto keep = c.dirty.begin();
+                for (auto id : c.dirty) {
+                    if (Match(c, "vessels.self", id) == static_cast<int>(s)) {
+                        items.push_back(&m_latest[id]);
+                        c.is_dirty[id] = 0;
+                    } else {
+                        *keep++ = id;
+                    }
+                }
+                c.dirty.erase(keep, c.dirty.end());
+                if (!items.empty()) {
+                    Send(c,
+                        WsFrame(WS_TEXT, BuildDelta("vessels.self", items)));
+                }
+                sub.due += sub.period;
+                if (sub.due <= now) {
+                    sub.due = now + sub.period;
+                }
+            }
+            next = std::min(next, sub.due);
+        }
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(next - now)
+        + std::chrono::milliseconds(1);
+}
+
+std::string SignalKServer::BuildDelta(
+    std::string_view context, const std::vector<const item*>& items)
+{
+    std::string d = "{\"context\":\"";
+    d.append(context);
+    d.append("\",\"updates\":[");
+    for (size_t i = 0; i < items.size(); ++i) {
+        const item* it = items[i];
+        const bool first = i == 0;
+        const bool same = !first && items[i - 1]->source == it->source
+            && items[i - 1]->timestamp == it->timestamp;
+        if (same) {
+            d.push_back(',');
+        } else {
+            if (!first) {
+                d.append("]},");
+            }
+            d.push_back('{');
+            if (it->source && !it->source->empty()) {
+                d.append("\"source\":");
+                d.append(*it->source);
+                d.push_back(',');
+            }
+            if (!it->timestamp.empty()) {
+                d.append("\"timestamp\":\"");
+                d.append(it->timestamp);
+                d.append("\",");
+            }
+            d.append("\"values\":[");
+        }
+        d.append(it->value);
+    }
+    if (!items.empty()) {
+        d.append("]}");
+    }
+    d.append("]}");
+    return d;
+}
+
+std::string SignalKServer::Hello() const
+{
+    std::string h = "{\"name\":\"NSK\",\"version\":\"";
+    h.append(SK_VERSION);
+    h.append("\",\"self\":\"vessels.self\",\"roles\":[\"master\",\"main\"],"
+             "\"timestamp\":\"");
+    h.append(Now());
+    h.append("\"}");
+    return h;
+}
+
+PLUGIN_END_NAMESPACE
+
+#endif // __linux__
@@ -0,0 +1,413 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "sk_encoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// CBOR major types
+constexpr uint8_t MT_UINT = 0;
+constexpr uint8_t MT_NINT = 1;
+constexpr uint8_t MT_BYTES = 2;
+constexpr uint8_t MT_TEXT = 3;
+constexpr uint8_t MT_ARRAY = 4;
+constexpr uint8_t MT_MAP = 5;
+constexpr uint8_t MT_TAG = 6;
+constexpr uint8_t MT_SIMPLE = 7;
+/// Stringref namespace tag
+constexpr uint64_t TAG_STRINGREF_NAMESPACE = 256;
+/// Stringref tag
+constexpr uint64_t TAG_STRINGREF = 25;
+/// Maximum nesting of the decoded document
+constexpr int MAX_DEPTH = 64;
+/// Initial size of the string index (power of two)
+constexpr size_t INITIAL_INDEX_SIZE = 256;
+
+/// @brief FNV-1a hash of the string
+size_t StringHash(std::string_view s)
+{
+    uint32_t h = 2166136261u;
+    for (char c : s) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/// @brief Minimum length of a string added to the stringref table, so that
+/// the reference is always shorter than the string itself
+/// @param index Index the string would get in the table
+size_t StringrefMinLength(size_t index)
+{
+    if (index < 24) {
+        return 3;
+    } else if (index < 256) {
+        return 4;
+    } else if (index < 65536) {
+        return 5;
+    } else if (index < 4294967296ull) {
+        return 7;
+    }
+    return 11;
+}
+
+/// @brief Convert IEEE 754 half precision number to double
+double HalfToDouble(uint16_t h)
+{
+    const int exp = (h >> 10) & 0x1f;
+    const int mant = h & 0x3ff;
+    double val;
+    if (exp == 0) {
+        val = std::ldexp(mant, -24);
+    } else if (exp != 31) {
+        val = std::ldexp(mant + 1024, exp - 25);
+    } else {
+        val = mant == 0 ? INFINITY : NAN;
+    }
+    return (h & 0x8000) ? -val : val;
+}
+}
+
+delta_encoding DeltaEncodingFromName(std::string_view name, delta_encoding def)
+{
+    if (name == "json") {
+        return delta_encoding::json;
+    } else if (name == "cbor") {
+        return delta_encoding::cbor;
+    }
+    return def;
+}
+
+const char* DeltaEncodingName(delta_encoding enc)
+{
+    switch (enc) {
+    case delta_encoding::cbor:
+        return "cbor";
+    default:
+        return "json";
+    }
+}
+
+const std::string& DeltaEncoder::Encode(const Value& v, delta_encoding enc)
+{
+    m_out.clear();
+    if (enc == delta_encoding::json) {
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        v.Accept(writer);
+        m_out.assign(buffer.GetString(), buffer.GetSize());
+        return m_out;
+    }
+    m_strings.clear();
+    if (m_index.empty()) {
+        m_index.assign(INITIAL_INDEX_SIZE, 0);
+    } else {
+        std::fill(m_index.begin(), m_index.end(), 0);
+    }
+    Head(MT_TAG, TAG_STRINGREF_NAMESPACE);
+    Cbor(v);
+    return m_out;
+}
+
+void DeltaEncoder::Head(uint8_t major, uint64_t arg)
+{
+    const uint8_t mt = static_cast<uint8_t>(major << 5);
+    if (arg < 24) {
+        m_out.push_back(static_cast<char>(mt | arg));
+    } else if (arg <= UINT8_MAX) {
+        m_out.push_back(static_cast<char>(mt | 24));
+        m_out.push_back(static_cast<char>(arg));
+    } else if (arg <= UINT16_MAX) {
+        m_out.push_back(static_cast<char>(mt | 25));
+        m_out.push_back(static_cast<char>(arg >> 8));
+        m_out.push_back(static_cast<char>(arg));
+    } else if (arg <= UINT32_MAX) {
+        m_out.push_back(static_cast<char>(mt | 26));
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            m_out.push_back(static_cast<char>(arg >> shift));
+        }
+    } else {
+        m_out.push_back(static_cast<char>(mt | 27));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            m_out.push_back(static_cast<char>(arg >> shift));
+        }
+    }
+}
+
+void DeltaEncoder::String(const char* s, size_t len)
+{
+    const std::string_view str(s, len);
+    const size_t mask = m_index.size() - 1;
+    size_t slot = StringHash(str) & mask;
+    while (m_index[slot] != 0) {
+        const uint32_t idx = m_index[slot] - 1;
+        if (m_strings[idx] == str) {
+            Head(MT_TAG, TAG_STRINGREF);
+            Head(MT_UINT, idx);
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (len >= StringrefMinLength(m_strings.size())) {
+        m_strings.push_back(str);
+        m_index[slot] = static_cast<uint32_t>(m_strings.size());
+        if (m_strings.size() * 2 > m_index.size()) {
+            // Keep the load factor under one half
+            m_index.assign(m_index.size() * 2, 0);
+            const size_t m = m_index.size() - 1;
+            for (size_t i = 0; i < m_strings.size(); ++i) {
+                size_t sl = StringHash(m_strings[i]) & m;
+                while (m_index[sl] != 0) {
+                    sl = (sl + 1) & m;
+                }
+                m_index[sl] = static_cast<uint32_t>(i + 1);
+            }
+        }
+    }
+    Head(MT_TEXT, len);
+    m_out.append(s, len);
+}
+
+void DeltaEncoder::Cbor(const Value& v)
+{
+    switch (v.GetType()) {
+    case kNullType:
+        m_out.push_back(static_cast<char>(0xf6));
+        break;
+    case kFalseType:
+        m_out.push_back(static_cast<char>(0xf4));
+        break;
+    case kTrueType:
+        m_out.push_back(static_cast<char>(0xf5));
+        break;
+    case kStringType:
+        String(v.GetString(), v.GetStringLength());
+        break;
+    case kArrayType:
+        Head(MT_ARRAY, v.Size());
+        for (const auto& e : v.GetArray()) {
+            Cbor(e);
+        }
+        break;
+    case kObjectType:
+        Head(MT_MAP, v.MemberCount());
+        for (const auto& m : v.GetObject()) {
+            String(m.name.GetString(), m.name.GetStringLength());
+            Cbor(m.value);
+        }
+        break;
+    case kNumberType:
+        if (v.IsUint64()) {
+            Head(MT_UINT, v.GetUint64());
+        } else if (v.IsInt64()) {
+            Head(MT_NINT, static_cast<uint64_t>(-(v.GetInt64() + 1)));
+        } else {
+            const double d = v.GetDouble();
+            const float f = static_cast<float>(d);
+            if (static_cast<double>(f) == d) {
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                m_out.push_back(static_cast<char>(0xfa));
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    m_out.push_back(static_cast<char>(bits >> shift));
+                }
+            } else {
+                uint64_t bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                m_out.push_back(static_cast<char>(0xfb));
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    m_out.push_back(static_cast<char>(bits >> shift));
+                }
+            }
+        }
+        break;
+    }
+}
+
+bool DeltaDecoder::Decode(
+    const char* data, size_t len, delta_encoding enc, Document& doc)
+{
+    if (enc == delta_encoding::json) {
+        doc.Parse<kParseFullPrecisionFlag>(data, len);
+        return !doc.HasParseError();
+    }
+    m_pos = reinterpret_cast<const uint8_t*>(data);
+    m_end = m_pos + len;
+    m_strings.clear();
+    doc.SetNull();
+    return Cbor(doc, doc.GetAllocator(), 0) && m_pos == m_end;
+}
+
+bool DeltaDecoder::Head(uint8_t& major, uint8_t& info, uint64_t& arg)
+{
+    if (m_pos >= m_end) {
+        return false;
+    }
+    major = *m_pos >> 5;
+    info = *m_pos & 0x1f;
+    ++m_pos;
+    size_t n;
+    if (info < 24) {
+        arg = info;
+        return true;
+    } else if (info == 24) {
+        n = 1;
+    } else if (info == 25) {
+        n = 2;
+    } else if (info == 26) {
+        n = 4;
+    } else if (info == 27) {
+        n = 8;
+    } else {
+        // Indefinite lengths are not produced by the encoder
+        return false;
+    }
+    if (static_cast<size_t>(m_end - m_pos) < n) {
+        return false;
+    }
+    arg = 0;
+    for (size_t i = 0; i < n; ++i) {
+        arg = (arg << 8) | *m_pos++;
+    }
+    return true;
+}
+
+bool DeltaDecoder::Cbor(
+    Value& v, Document::AllocatorType& allocator, int depth)
+{
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+    uint8_t major;
+    uint8_t info;
+    uint64_t arg;
+    if (!Head(major, info, arg)) {
+        return false;
+    }
+    switch (major) {
+    case MT_UINT:
+        v.SetUint64(arg);
+        return true;
+    case MT_NINT:
+        if (arg > static_cast<uint64_t>(INT64_MAX)) {
+            return false;
+        }
+        v.SetInt64(-static_cast<int64_t>(arg) - 1);
+        return true;
+    case MT_TEXT: {
+        if (static_cast<uint64_t>(m_end - m_pos) < arg) {
+            return false;
+        }
+        const std::string_view str(reinterpret_cast<const char*>(m_pos), arg);
+        m_pos += arg;
+        if (arg >= StringrefMinLength(m_strings.size())) {
+            m_strings.push_back(str);
+        }
+        v.SetString(str.data(), static_cast<SizeType>(str.size()), allocator);
+        return true;
+    }
+    case MT_ARRAY:
+        if (arg > static_cast<uint64_t>(m_end - m_pos)) {
+            return false;
+        }
+        v.SetArray();
+        v.Reserve(static_cast<SizeType>(arg), allocator);
+        for (uint64_t i = 0; i < arg; ++i) {
+            Value e;
+            if (!Cbor(e, allocator, depth + 1)) {
+                return false;
+            }
+            v.PushBack(e, allocator);
+        }
+        return true;
+    case MT_MAP:
+        if (arg > static_cast<uint64_t>(m_end - m_pos)) {
+            return false;
+        }
+        v.SetObject();
+        for (uint64_t i = 0; i < arg; ++i) {
+            Value name;
+            Value val;
+            if (!Cbor(name, allocator, depth + 1) || !name.IsString()
+                || !Cbor(val, allocator, depth + 1)) {
+                return false;
+            }
+            v.AddMember(name, val, allocator);
+        }
+        return true;
+    case MT_TAG:
+        if (arg == TAG_STRINGREF) {
+            uint8_t m;
+            uint64_t idx;
+            if (!Head(m, info, idx) || m != MT_UINT
+                || idx >= m_strings.size()) {
+                return false;
+            }
+            v.SetString(m_strings[idx].data(),
+                static_cast<SizeType>(m_strings[idx].size()), allocator);
+            return true;
+        }
+        // Namespaces and unknown tags are transparent
+        return Cbor(v, allocator, depth + 1);
+    case MT_SIMPLE:
+        if (info == 20) {
+            v.SetBool(false);
+        } else if (info == 21) {
+            v.SetBool(true);
+        } else if (info == 22 || info == 23) {
+            v.SetNull();
+        } else if (info == 25) {
+            v.SetDouble(HalfToDouble(static_cast<uint16_t>(arg)));
+        } else if (info == 26) {
+            const uint32_t bits = static_cast<uint32_t>(arg);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            v.SetDouble(f);
+        } else if (info == 27) {
+            double d;
+            std::memcpy(&d, &arg, sizeof(d));
+            v.SetDouble(d);
+        } else {
+            return false;
+        }
+        return true;
+    case MT_BYTES:
+    default:
+        return false;
+    }
+}
+
+PLUGIN_END_NAMESPACE
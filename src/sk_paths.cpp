@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "sk_paths.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// @brief FNV-1a hash of the path
+size_t PathHash(std::string_view path)
+{
+    uint32_t h = 2166136261u;
+    for (char c : path) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/// Name returned for unknown identifiers
+const std::string EMPTY;
+}
+
+SKPaths::SKPaths()
+    : m_count(0)
+{
+    for (auto& slot : m_table) {
+        slot.store(NONE, std::memory_order_relaxed);
+    }
+}
+
+SKPaths& SKPaths::Instance()
+{
+    static SKPaths instance;
+    return instance;
+}
+
+size_t SKPaths::Slot(std::string_view path, size_t hash) const
+{
+    size_t slot = hash & (TABLE_SIZE - 1);
+    sk_path_id id;
+    while ((id = m_table[slot].load(std::memory_order_acquire)) != NONE
+        && m_names[id] != path) {
+        slot = (slot + 1) & (TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+sk_path_id SKPaths::Lookup(std::string_view path, size_t hash) const
+{
+    // The acquire load of the slot makes the name stored before it visible
+    return m_table[Slot(path, hash)].load(std::memory_order_acquire);
+}
+
+sk_path_id SKPaths::Id(std::string_view path)
+{
+    auto& r = Instance();
+    const size_t hash = PathHash(path);
+    const sk_path_id found = r.Lookup(path, hash);
+    if (found != NONE) {
+        return found;
+    }
+    if (path.find(".urn:") != std::string_view::npos) {
+        // One path per AIS target would exhaust the registry
+        return NONE;
+    }
+    std::lock_guard<std::mutex> lock(r.m_mutex);
+    // Another thread may have registered the path in the meantime
+    const size_t slot = r.Slot(path, hash);
+    const sk_path_id id = r.m_table[slot].load(std::memory_order_relaxed);
+    if (id != NONE) {
+        return id;
+    }
+    const size_t count = r.m_count.load(std::memory_order_relaxed);
+    if (count >= MAX_PATHS) {
+        return NONE;
+    }
+    r.m_names[count] = path;
+    r.m_table[slot].store(
+        static_cast<sk_path_id>(count), std::memory_order_release);
+    r.m_count.store(count + 1, std::memory_order_release);
+    return static_cast<sk_path_id>(count);
+}
+
+sk_path_id SKPaths::Find(std::string_view path)
+{
+    return Instance().Lookup(path, PathHash(path));
+}
+
+const std::string& SKPaths::Name(sk_path_id id)
+{
+    auto& r = Instance();
+    if (id >= r.m_count.load(std::memory_order_acquire)) {
+        return EMPTY;
+    }
+    return r.m_names[id];
+}
+
+size_t SKPaths::Count()
+{
+    return Instance().m_count.load(std::memory_order_acquire);
+}
+
+PLUGIN_END_NAMESPACE
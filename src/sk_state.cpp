@@ -0,0 +1,308 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "sk_state.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// SignalK specification version the snapshot declares
+constexpr const char* SK_VERSION = "1.7.0";
+
+/// @brief Return the string member of an object or an empty string
+std::string_view StringMember(const Value& obj, const char* name)
+{
+    if (!obj.IsObject()) {
+        return {};
+    }
+    auto it = obj.FindMember(name);
+    if (it == obj.MemberEnd() || !it->value.IsString()) {
+        return {};
+    }
+    return { it->value.GetString(), it->value.GetStringLength() };
+}
+
+/// @brief Return the member of the object, adding an empty object if it does
+/// not exist
+Value& Child(Value& parent, std::string_view name,
+    Document::AllocatorType& allocator)
+{
+    auto it = parent.FindMember(
+        Value(StringRef(name.data(), name.size())).Move());
+    if (it != parent.MemberEnd()) {
+        return it->value;
+    }
+    parent.AddMember(Value(name.data(), name.size(), allocator).Move(),
+        Value(kObjectType).Move(), allocator);
+    return (parent.MemberEnd() - 1)->value;
+}
+}
+
+void SKState::Update(const Value& delta)
+{
+    if (delta.IsArray()) {
+        for (const auto& d : delta.GetArray()) {
+            Update(d);
+        }
+        return;
+    }
+    if (!delta.IsObject() || !delta.HasMember("updates")
+        || !delta["updates"].IsArray()) {
+        return;
+    }
+    auto context = StringMember(delta, "context");
+    if (!context.empty() && context != "vessels.self") {
+        return;
+    }
+    for (const auto& upd : delta["updates"].GetArray()) {
+        if (!upd.IsObject() || !upd.HasMember("values")
+            || !upd["values"].IsArray()) {
+            continue;
+        }
+        uint16_t source = 0;
+        if (upd.HasMember("source")) {
+            const auto& src = upd["source"];
+            source = SourceId(StringMember(src, "label"),
+                StringMember(src, "talker"), StringMember(src, "type"));
+        } else {
+            source = SourceId("", "", "");
+        }
+        const auto timestamp = StringMember(upd, "timestamp");
+        for (const auto& v : upd["values"].GetArray()) {
+            if (!v.IsObject() || !v.HasMember("value")) {
+                continue;
+            }
+            const auto path = StringMember(v, "path");
+            SetValue(SKPaths::Id(path), v["value"], timestamp, source);
+        }
+    }
+}
+
+void SKState::SetValue(sk_path_id id, const Value& value,
+    std::string_view timestamp, uint16_t source)
+{
+    if (id == SKPaths::NONE) {
+        return;
+    }
+    if (id >= m_values.size()) {
+        m_values.resize(SKPaths::Count());
+    }
+    auto& v = m_values[id];
+    if (v.type == sk_value_type::none) {
+        m_present.push_back(id);
+    }
+    if (value.IsNumber()) {
+        v.type = sk_value_type::number;
+        v.number = value.GetDouble();
+    } else if (value.IsBool()) {
+        v.type = sk_value_type::boolean;
+        v.number = value.GetBool() ? 1.0 : 0.0;
+    } else if (value.IsString()) {
+        v.type = sk_value_type::string;
+        v.text.assign(value.GetString(), value.GetStringLength());
+    } else if (value.IsNull()) {
+        v.type = sk_value_type::null;
+    } else if (value.IsObject() && value.HasMember("latitude")
+        && value.HasMember("longitude") && value["latitude"].IsNumber()
+        && value["longitude"].IsNumber()
+        && value.MemberCount() == (value.HasMember("altitude") ? 3u : 2u)) {
+        v.type = sk_value_type::position;
+        v.number = value["latitude"].GetDouble();
+        v.longitude = value["longitude"].GetDouble();
+        v.altitude = value.HasMember("altitude") && value["altitude"].IsNumber()
+            ? value["altitude"].GetDouble()
+            : std::numeric_limits<double>::quiet_NaN();
+    } else {
+        v.type = sk_value_type::json;
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        value.Accept(writer);
+        v.text.assign(buffer.GetString(), buffer.GetSize());
+    }
+    const size_t len = std::min(timestamp.size(), v.timestamp.size() - 1);
+    std::memcpy(v.timestamp.data(), timestamp.data(), len);
+    v.timestamp[len] = '\0';
+    v.source = source;
+}
+
+uint16_t SKState::SourceId(
+    std::string_view label, std::string_view talker, std::string_view type)
+{
+    for (size_t i = 0; i < m_sources.size(); ++i) {
+        if (m_sources[i].label == label && m_sources[i].talker == talker
+            && m_sources[i].type == type) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+    sk_source s;
+    s.label = label;
+    s.talker = talker;
+    s.type = type;
+    s.ref = s.label;
+    if (!talker.empty()) {
+        s.ref.append(".").append(talker);
+    }
+    m_sources.push_back(std::move(s));
+    return static_cast<uint16_t>(m_sources.size() - 1);
+}
+
+const sk_value* SKState::Get(sk_path_id id) const
+{
+    if (id >= m_values.size() || m_values[id].type == sk_value_type::none) {
+        return nullptr;
+    }
+    return &m_values[id];
+}
+
+void SKState::Clear()
+{
+    for (auto id : m_present) {
+        m_values[id].type = sk_value_type::none;
+    }
+    m_present.clear();
+}
+
+Value SKState::ToJSON(const sk_value& v, Document::AllocatorType& allocator)
+{
+    switch (v.type) {
+    case sk_value_type::number:
+        return Value(v.number);
+    case sk_value_type::boolean:
+        return Value(v.number != 0.0);
+    case sk_value_type::string:
+        return Value(v.text.c_str(), v.text.size(), allocator);
+    case sk_value_type::position: {
+        Value pos(kObjectType);
+        pos.AddMember("latitude", v.number, allocator);
+        pos.AddMember("longitude", v.longitude, allocator);
+        if (!std::isnan(v.altitude)) {
+            pos.AddMember("altitude", v.altitude, allocator);
+        }
+        return pos;
+    }
+    case sk_value_type::json: {
+        Document tmp;
+        tmp.Parse(v.text.c_str(), v.text.size());
+        return Value(tmp, allocator);
+    }
+    default:
+        return Value(kNullType);
+    }
+}
+
+void SKState::Snapshot(Document& doc) const
+{
+    doc.SetObject();
+    auto& allocator = doc.GetAllocator();
+    Value vessel(kObjectType);
+    for (auto id : m_present) {
+        const auto& v = m_values[id];
+        const auto& path = SKPaths::Name(id);
+        if (path.empty()) {
+            // Values without path belong directly to the vessel object
+            Value obj = ToJSON(v, allocator);
+            if (obj.IsObject()) {
+                for (auto& m : obj.GetObject()) {
+                    vessel.RemoveMember(m.name);
+                    vessel.AddMember(m.name, m.value, allocator);
+                }
+            }
+            continue;
+        }
+        Value* node = &vessel;
+        size_t start = 0;
+        size_t dot;
+        while ((dot = path.find('.', start)) != std::string::npos) {
+            node = &Child(*node,
+                std::string_view(path).substr(start, dot - start), allocator);
+            start = dot + 1;
+        }
+        Value& leaf
+            = Child(*node, std::string_view(path).substr(start), allocator);
+        leaf.RemoveMember("value");
+        leaf.RemoveMember("timestamp");
+        leaf.RemoveMember("$source");
+        leaf.AddMember("value", ToJSON(v, allocator), allocator);
+        if (v.timestamp[0] != '\0') {
+            leaf.AddMember(
+                "timestamp", Value(v.timestamp.data(), allocator), allocator);
+        }
+        leaf.AddMember("$source",
+            Value(m_sources[v.source].ref.c_str(), allocator), allocator);
+    }
+
+    Value sources(kObjectType);
+    for (const auto& s : m_sources) {
+        if (s.label.empty()) {
+            continue;
+        }
+        Value& label = Child(sources, s.label, allocator);
+        if (!label.HasMember("label")) {
+            label.AddMember("label", Value(s.label.c_str(), allocator),
+                allocator);
+            if (!s.type.empty()) {
+                label.AddMember(
+                    "type", Value(s.type.c_str(), allocator), allocator);
+            }
+        }
+        if (!s.talker.empty()) {
+            Value& talker = Child(label, s.talker, allocator);
+            if (!talker.HasMember("talker")) {
+                talker.AddMember("talker", Value(s.talker.c_str(), allocator),
+                    allocator);
+            }
+        }
+    }
+
+    Value vessels(kObjectType);
+    vessels.AddMember("self", vessel, allocator);
+    doc.AddMember("version", StringRef(SK_VERSION), allocator);
+    doc.AddMember("self", "vessels.self", allocator);
+    doc.AddMember("vessels", vessels, allocator);
+    doc.AddMember("sources", sources, allocator);
+}
+
+std::string SKState::Snapshot() const
+{
+    Document doc;
+    Snapshot(doc);
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+PLUGIN_END_NAMESPACE
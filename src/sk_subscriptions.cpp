@@ -0,0 +1,171 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "sk_subscriptions.h"
+
+#include <algorithm>
+
+PLUGIN_BEGIN_NAMESPACE
+
+bool SKPatternMatch(std::string_view pattern, std::string_view s)
+{
+    if (pattern == "*") {
+        return true;
+    }
+    if (pattern.find('*') == std::string_view::npos) {
+        return s.size() >= pattern.size()
+            && s.compare(0, pattern.size(), pattern) == 0
+            && (s.size() == pattern.size() || s[pattern.size()] == '.');
+    }
+    // Glob matching with backtracking to the last star
+    size_t p = 0;
+    size_t i = 0;
+    size_t star = std::string_view::npos;
+    size_t mark = 0;
+    while (i < s.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            mark = i;
+        } else if (p < pattern.size() && pattern[p] == s[i]) {
+            ++p;
+            ++i;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            i = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+SKSubscriptions::SKSubscriptions()
+    : m_everything(true)
+    , m_skipped(0)
+{
+    m_literals.fill({ nullptr, SKPaths::NONE });
+}
+
+void SKSubscriptions::Set(
+    const std::string& consumer, const std::vector<std::string>& patterns)
+{
+    if (patterns.empty()) {
+        m_consumers.erase(consumer);
+    } else {
+        m_consumers[consumer] = patterns;
+    }
+    Changed();
+}
+
+void SKSubscriptions::Subscribe(
+    const std::string& consumer, const std::string& pattern)
+{
+    auto& patterns = m_consumers[consumer];
+    if (std::find(patterns.begin(), patterns.end(), pattern)
+        == patterns.end()) {
+        patterns.push_back(pattern);
+    }
+    Changed();
+}
+
+void SKSubscriptions::Unsubscribe(
+    const std::string& consumer, const std::string& pattern)
+{
+    auto it = m_consumers.find(consumer);
+    if (it == m_consumers.end()) {
+        return;
+    }
+    auto& patterns = it->second;
+    if (pattern == "*") {
+        patterns.clear();
+    } else {
+        patterns.erase(std::remove(patterns.begin(), patterns.end(), pattern),
+            patterns.end());
+    }
+    if (patterns.empty()) {
+        m_consumers.erase(it);
+    }
+    Changed();
+}
+
+void SKSubscriptions::Require(const std::string& pattern)
+{
+    m_required.push_back(pattern);
+    Changed();
+}
+
+void SKSubscriptions::Changed()
+{
+    m_everything = m_consumers.empty();
+    for (const auto& c : m_consumers) {
+        for (const auto& p : c.second) {
+            m_everything |= p == "*" || p.empty();
+        }
+    }
+    m_resolved.reset();
+    m_wanted.reset();
+}
+
+bool SKSubscriptions::Resolve(sk_path_id id)
+{
+    const auto& path = SKPaths::Name(id);
+    bool wanted = false;
+    for (const auto& p : m_required) {
+        wanted = wanted || SKPatternMatch(p, path);
+    }
+    for (auto c = m_consumers.begin(); !wanted && c != m_consumers.end();
+         ++c) {
+        for (const auto& p : c->second) {
+            wanted = wanted || SKPatternMatch(p, path);
+        }
+    }
+    m_resolved[id] = true;
+    m_wanted[id] = wanted;
+    return wanted;
+}
+
+sk_path_id SKSubscriptions::LiteralId(const char* path)
+{
+    const auto key = reinterpret_cast<uintptr_t>(path);
+    const size_t slot
+        = (static_cast<uint64_t>(key >> 3) * 0x9E3779B97F4A7C15ull) >> 55;
+    for (size_t i = 0; i < LITERALS; ++i) {
+        auto& entry = m_literals[(slot + i) & (LITERALS - 1)];
+        if (entry.first == path) {
+            return entry.second;
+        }
+        if (entry.first == nullptr) {
+            entry = { path, SKPaths::Id(path) };
+            return entry.second;
+        }
+    }
+    return SKPaths::Id(path);
+}
+
+PLUGIN_END_NAMESPACE
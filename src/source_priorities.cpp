@@ -0,0 +1,155 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "source_priorities.h"
+
+#include <algorithm>
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+SourcePriorities::SourcePriorities()
+    : m_configured(0)
+    , m_timeout(5000)
+    , m_suppressed(0)
+{
+}
+
+void SourcePriorities::Set(
+    const std::string& path, const std::vector<std::string>& sources)
+{
+    const auto id = SKPaths::Id(path);
+    if (id == SKPaths::NONE) {
+        return;
+    }
+    if (m_records.empty()) {
+        m_records.resize(SKPaths::MAX_PATHS);
+    }
+    record& r = m_records[id];
+    m_configured -= r.count != 0;
+    r = record();
+    for (const auto& name : sources) {
+        if (r.count == MAX_SOURCES) {
+            break;
+        }
+        auto it = std::find(m_sources.begin(), m_sources.end(), name);
+        if (it == m_sources.end()) {
+            it = m_sources.insert(m_sources.end(), name);
+        }
+        r.sources[r.count++]
+            = static_cast<uint16_t>(std::distance(m_sources.begin(), it));
+    }
+    m_configured += r.count != 0;
+}
+
+void SourcePriorities::Clear()
+{
+    m_records.clear();
+    m_sources.clear();
+    m_configured = 0;
+}
+
+uint16_t SourcePriorities::Source(std::string_view name) const
+{
+    const auto it = std::find(m_sources.begin(), m_sources.end(), name);
+    return it == m_sources.end()
+        ? NONE
+        : static_cast<uint16_t>(std::distance(m_sources.begin(), it));
+}
+
+bool SourcePriorities::Accept(sk_path_id path, uint16_t talker_tag,
+    uint16_t tag, std::chrono::steady_clock::time_point now)
+{
+    if (path >= m_records.size() || m_records[path].count == 0) {
+        return true;
+    }
+    record& r = m_records[path];
+    uint8_t rank = 0;
+    while (rank < r.count && r.sources[rank] != talker_tag
+        && r.sources[rank] != tag) {
+        ++rank;
+    }
+    if (rank <= r.winner || now - r.seen > m_timeout) {
+        r.winner = rank;
+        r.seen = now;
+        return true;
+    }
+    ++m_suppressed;
+    return false;
+}
+
+void SourcePriorities::FromJSON(const Value& v)
+{
+    Clear();
+    if (!v.IsObject()) {
+        return;
+    }
+    if (v.HasMember("timeout") && v["timeout"].IsNumber()) {
+        m_timeout = std::chrono::milliseconds(
+            static_cast<int64_t>(v["timeout"].GetDouble() * 1000.0));
+    }
+    if (v.HasMember("paths") && v["paths"].IsObject()) {
+        for (const auto& p : v["paths"].GetObject()) {
+            if (!p.value.IsArray()) {
+                continue;
+            }
+            std::vector<std::string> sources;
+            for (const auto& s : p.value.GetArray()) {
+                if (s.IsString()) {
+                    sources.emplace_back(s.GetString());
+                }
+            }
+            Set(p.name.GetString(), sources);
+        }
+    }
+}
+
+Value SourcePriorities::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("timeout", m_timeout.count() / 1000.0, allocator);
+    Value paths(kObjectType);
+    for (size_t id = 0; id < m_records.size(); ++id) {
+        const record& r = m_records[id];
+        if (r.count == 0) {
+            continue;
+        }
+        Value sources(kArrayType);
+        for (size_t i = 0; i < r.count; ++i) {
+            sources.PushBack(
+                Value(m_sources[r.sources[i]].c_str(), allocator), allocator);
+        }
+        paths.AddMember(
+            Value(SKPaths::Name(static_cast<sk_path_id>(id)).c_str(),
+                allocator),
+            sources, allocator);
+    }
+    v.AddMember("paths", paths, allocator);
+    return v;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,220 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "time_base.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+using namespace rapidjson;
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+constexpr int64_t MS_PER_DAY = 86400000;
+/// Difference from the locked time after which the time base relocks
+constexpr int64_t STEP_THRESHOLD = 1000;
+/// Names of the modes in the configuration
+const char* MODE_NAMES[] = { "system", "live", "replay" };
+
+int64_t SteadyMs(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        t.time_since_epoch())
+        .count();
+}
+
+/// @brief Floor division
+int64_t FloorDiv(int64_t a, int64_t b)
+{
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+}
+
+TimeBase::TimeBase()
+    : m_clock(&Clock::Real())
+    , m_mode(time_mode::LIVE)
+    , m_locked(false)
+    , m_offset(0)
+    , m_gnss(0)
+    , m_last(INT64_MIN)
+    , m_stamp_second(INT64_MIN)
+{
+}
+
+void TimeBase::SetClock(const Clock& clock) { m_clock = &clock; }
+
+void TimeBase::SetMode(time_mode mode)
+{
+    m_mode = mode;
+    m_locked = false;
+    m_last = INT64_MIN;
+}
+
+int64_t TimeBase::DaysFromCivil(int year, int month, int day)
+{
+    // Days before the month counted from March, so that the leap day is the
+    // last day of the year
+    year -= month <= 2;
+    const int64_t era = FloorDiv(year, 400);
+    const int64_t yoe = year - era * 400;
+    const int64_t doy
+        = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+std::string TimeBase::Format(int64_t ms)
+{
+    const int64_t days = FloorDiv(ms, MS_PER_DAY);
+    const int64_t ms_of_day = ms - days * MS_PER_DAY;
+    // Inverse of DaysFromCivil
+    const int64_t z = days + 719468;
+    const int64_t era = FloorDiv(z, 146097);
+    const int64_t doe = z - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    const int64_t day = doy - (153 * mp + 2) / 5 + 1;
+    const int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t year = yoe + era * 400 + (month <= 2);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+        static_cast<int>(year), static_cast<int>(month), static_cast<int>(day),
+        static_cast<int>(ms_of_day / 3600000),
+        static_cast<int>(ms_of_day / 60000 % 60),
+        static_cast<int>(ms_of_day / 1000 % 60),
+        static_cast<int>(ms_of_day % 1000));
+    return buf;
+}
+
+void TimeBase::Sync(int year, int month, int day, int64_t ms_of_day,
+    std::chrono::steady_clock::time_point now)
+{
+    if (month < 1 || month > 12 || day < 1 || day > 31 || ms_of_day < 0
+        || ms_of_day >= MS_PER_DAY) {
+        return;
+    }
+    if (year < 100) {
+        year += 2000;
+    }
+    Apply(DaysFromCivil(year, month, day) * MS_PER_DAY + ms_of_day, now);
+}
+
+void TimeBase::SyncTimeOfDay(
+    int64_t ms_of_day, std::chrono::steady_clock::time_point now)
+{
+    if (ms_of_day < 0 || ms_of_day >= MS_PER_DAY) {
+        return;
+    }
+    const int64_t estimate = m_locked ? Now(now) : m_clock->SystemMs();
+    int64_t t = FloorDiv(estimate, MS_PER_DAY) * MS_PER_DAY + ms_of_day;
+    // Around midnight the time may belong to the neighbouring day
+    if (t - estimate > MS_PER_DAY / 2) {
+        t -= MS_PER_DAY;
+    } else if (estimate - t > MS_PER_DAY / 2) {
+        t += MS_PER_DAY;
+    }
+    Apply(t, now);
+}
+
+void TimeBase::Apply(int64_t gnss, std::chrono::steady_clock::time_point now)
+{
+    if (m_mode == time_mode::SYSTEM) {
+        return;
+    }
+    const int64_t offset = gnss - SteadyMs(now);
+    if (!m_locked || std::llabs(offset - m_offset) > STEP_THRESHOLD
+        || (m_mode == time_mode::REPLAY && gnss < m_gnss)) {
+        // Lock or relock, the stamps may go back this once
+        m_locked = true;
+        m_offset = offset;
+        m_last = INT64_MIN;
+    } else {
+        // Smooth the jitter of the latency of the sentences
+        m_offset += (offset - m_offset) / 8;
+    }
+    m_gnss = gnss;
+}
+
+int64_t TimeBase::Now(std::chrono::steady_clock::time_point now)
+{
+    int64_t t;
+    if (!m_locked) {
+        t = m_clock->SystemMs();
+    } else if (m_mode == time_mode::REPLAY) {
+        t = m_gnss;
+    } else {
+        t = SteadyMs(now) + m_offset;
+    }
+    if (m_locked && t < m_last) {
+        t = m_last;
+    }
+    m_last = t;
+    return t;
+}
+
+const std::string& TimeBase::Stamp(std::chrono::steady_clock::time_point now)
+{
+    const int64_t t = Now(now);
+    const int64_t second = FloorDiv(t, 1000);
+    if (second != m_stamp_second) {
+        m_stamp_second = second;
+        m_stamp = Format(second * 1000);
+    }
+    // Only the milliseconds (at the fixed position before the "Z") change
+    // within the second
+    const auto ms = static_cast<int>(t - second * 1000);
+    char* p = &m_stamp[m_stamp.size() - 4];
+    p[0] = static_cast<char>('0' + ms / 100);
+    p[1] = static_cast<char>('0' + ms / 10 % 10);
+    p[2] = static_cast<char>('0' + ms % 10);
+    return m_stamp;
+}
+
+void TimeBase::FromJSON(const Value& v)
+{
+    if (!v.IsObject() || !v.HasMember("mode") || !v["mode"].IsString()) {
+        return;
+    }
+    for (size_t i = 0; i < std::size(MODE_NAMES); ++i) {
+        if (std::strcmp(v["mode"].GetString(), MODE_NAMES[i]) == 0) {
+            SetMode(static_cast<time_mode>(i));
+        }
+    }
+}
+
+Value TimeBase::ToJSON(Document::AllocatorType& allocator) const
+{
+    Value v(kObjectType);
+    v.AddMember("mode", StringRef(MODE_NAMES[static_cast<size_t>(m_mode)]),
+        allocator);
+    return v;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,134 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2026 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "traffic_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+PLUGIN_BEGIN_NAMESPACE
+
+namespace {
+/// Marks an empty index slot
+constexpr uint8_t EMPTY = UINT8_MAX;
+/// Gain of the moving averages
+constexpr double GAIN = 1.0 / 16.0;
+
+int64_t Ms(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        t.time_since_epoch())
+        .count();
+}
+}
+
+double traffic_entry::Rate(int64_t now) const
+{
+    if (count < 2 || interval <= 0.0) {
+        return 0.0;
+    }
+    // Once the talker is late, its rate falls with the time of silence
+    return 1.0 / std::max(interval, (now - last_seen) / 1000.0);
+}
+
+TrafficStats::TrafficStats()
+    : m_live()
+{
+    m_keys.fill(0);
+    m_index.fill(EMPTY);
+}
+
+size_t TrafficStats::Sentence(
+    std::string_view stc, std::chrono::steady_clock::time_point now)
+{
+    // The name is what is between the "$" or "!" and the first comma
+    uint64_t key = 0;
+    size_t len = 0;
+    while (len < 7 && len + 1 < stc.size() && stc[len + 1] != ',') {
+        key = key << 8 | static_cast<uint8_t>(stc[len + 1]);
+        ++len;
+    }
+    if (len == 0) {
+        return NONE;
+    }
+    size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 57)
+        & (INDEX_SIZE - 1);
+    while (m_index[slot] != EMPTY && m_keys[m_index[slot]] != key) {
+        slot = (slot + 1) & (INDEX_SIZE - 1);
+    }
+    const int64_t ms = Ms(now);
+    if (m_index[slot] == EMPTY) {
+        if (m_live.size == traffic_snapshot::CAPACITY) {
+            ++m_live.overflow;
+            return NONE;
+        }
+        const auto id = static_cast<uint8_t>(m_live.size++);
+        m_index[slot] = id;
+        m_keys[id] = key;
+        traffic_entry& e = m_live.entries[id];
+        e = traffic_entry();
+        std::memcpy(e.name, stc.data() + 1, len);
+        e.count = 1;
+        e.last_seen = ms;
+        return id;
+    }
+    const uint8_t id = m_index[slot];
+    traffic_entry& e = m_live.entries[id];
+    const double interval = (ms - e.last_seen) / 1000.0;
+    if (e.count == 1) {
+        e.interval = interval;
+    } else {
+        const double deviation = std::abs(interval - e.interval);
+        e.interval += GAIN * (interval - e.interval);
+        e.jitter += GAIN * (deviation - e.jitter);
+    }
+    ++e.count;
+    e.last_seen = ms;
+    return id;
+}
+
+void TrafficStats::Error(size_t id)
+{
+    if (id < m_live.size) {
+        ++m_live.entries[id].errors;
+    }
+}
+
+void TrafficStats::Values(size_t id, size_t values)
+{
+    if (id < m_live.size) {
+        m_live.entries[id].values += values;
+    }
+}
+
+void TrafficStats::Publish(std::chrono::steady_clock::time_point now)
+{
+    m_live.taken = Ms(now);
+    m_snapshot.Store(m_live);
+}
+
+PLUGIN_END_NAMESPACE
@@ -53,7 +53,7 @@ TEST_CASE("DBK sentence produces belowKeel depth")
 {
     NSK n;
     Document d;
-    n.ProcessNMEASentence("$SDDBK,7.2,f,2.2,M,1.2,F*3B", &d);
+    n.ProcessNMEASentence("$SDDBK,7.2,f,2.2,M,1.2,F*1F", &d);
 
     REQUIRE(d.IsObject());
     REQUIRE(d.HasMember("updates"));
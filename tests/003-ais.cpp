@@ -0,0 +1,149 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "ais.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using Catch::Approx;
+
+TEST_CASE("AIS message type 1 decoding")
+{
+    AISDecoder dec;
+    REQUIRE(dec.Decode("!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C")
+        == ais_result::decoded);
+    const auto& m = dec.Message();
+    REQUIRE(m.type == 1);
+    REQUIRE(m.mmsi == 477553000);
+    REQUIRE(m.nav_status == 5);
+    REQUIRE(m.sog == 0);
+    REQUIRE(m.lon / 600000.0 == Approx(-122.345833).margin(1e-6));
+    REQUIRE(m.lat / 600000.0 == Approx(47.582833).margin(1e-6));
+    REQUIRE(m.cog == 510);
+    REQUIRE(m.heading == 181);
+    REQUIRE_FALSE(m.own);
+}
+
+TEST_CASE("AIS message type 5 reassembly")
+{
+    AISDecoder dec;
+    REQUIRE(dec.Decode("!AIVDM,2,1,1,A,55?MbV02;H;s<HtKR20EHE:0@T4@Dn2222222216"
+                       "L961O5Gf0NSQEp6ClRp8,0*1C")
+        == ais_result::incomplete);
+    REQUIRE(dec.Decode("!AIVDM,2,2,1,A,88888888880,2*25")
+        == ais_result::decoded);
+    const auto& m = dec.Message();
+    REQUIRE(m.type == 5);
+    REQUIRE(m.mmsi == 351759000);
+    REQUIRE(m.imo == 9134270);
+    REQUIRE(std::string(m.callsign.data()) == "3FOF8");
+    REQUIRE(std::string(m.name.data()) == "EVER DIADEM");
+    REQUIRE(std::string(m.destination.data()) == "NEW YORK");
+    REQUIRE(m.ship_type == 70);
+    REQUIRE(m.to_bow == 225);
+    REQUIRE(m.to_stern == 70);
+    REQUIRE(m.to_port == 1);
+    REQUIRE(m.to_starboard == 31);
+    REQUIRE(m.draught == 122);
+}
+
+TEST_CASE("AIS fragments expire")
+{
+    AISDecoder dec(std::chrono::seconds(2));
+    auto now = std::chrono::steady_clock::now();
+    REQUIRE(dec.Decode("!AIVDM,2,1,1,A,55?MbV02;H;s<HtKR20EHE:0@T4@Dn2222222216"
+                       "L961O5Gf0NSQEp6ClRp8,0*1C",
+                now)
+        == ais_result::incomplete);
+    REQUIRE(dec.Decode("!AIVDM,2,2,1,A,88888888880,2*25",
+                now + std::chrono::seconds(3))
+        == ais_result::error);
+    REQUIRE(dec.Dropped() == 2);
+}
+
+TEST_CASE("AIS sentence with bad checksum is rejected")
+{
+    AISDecoder dec;
+    REQUIRE(dec.Decode("!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5D")
+        == ais_result::error);
+    REQUIRE(dec.Errors() == 1);
+}
+
+TEST_CASE("AIS class B messages decoding")
+{
+    AISDecoder dec;
+    REQUIRE(dec.Decode("!AIVDM,1,1,,A,B52K>;h00Fc>jpUlNV@ikwpUoP06,0*4C")
+        == ais_result::decoded);
+    REQUIRE(dec.Message().type == 18);
+    REQUIRE(dec.Message().ais_class == 'B');
+    REQUIRE(dec.Message().mmsi == 338087471);
+    REQUIRE(dec.Message().sog == 1);
+    REQUIRE(dec.Message().cog == 796);
+
+    REQUIRE(dec.Decode("!AIVDM,1,1,,A,H42O55i18tMET00000000000000,2*6D")
+        == ais_result::decoded);
+    REQUIRE(dec.Message().type == 24);
+    REQUIRE(dec.Message().part == 0);
+    REQUIRE(std::string(dec.Message().name.data()) == "PROGUY");
+
+    REQUIRE(dec.Decode("!AIVDM,1,1,,A,H42O55lti4hhhilD3nink000?050,0*40")
+        == ais_result::decoded);
+    REQUIRE(dec.Message().part == 1);
+    REQUIRE(dec.Message().ship_type == 60);
+    REQUIRE(std::string(dec.Message().callsign.data()) == "TC6163");
+}
+
+TEST_CASE("AIS sentence produces delta in vessel context")
+{
+    NSK n;
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    Document d;
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C", &d);
+
+    REQUIRE(d.IsArray());
+    REQUIRE(d.Size() == 1);
+    REQUIRE(d[0].HasMember("context"));
+    REQUIRE(std::string(d[0]["context"].GetString())
+        == "vessels.urn:mrn:imo:mmsi:477553000");
+    REQUIRE(d[0]["updates"].IsArray());
+    REQUIRE(d[0]["updates"].Size() > 0);
+    bool has_position = false;
+    for (auto& v : d[0]["updates"][0]["values"].GetArray()) {
+        if (std::string(v["path"].GetString()) == "navigation.position") {
+            has_position = true;
+            REQUIRE(v["value"]["latitude"].GetDouble()
+                == Approx(47.582833).margin(1e-6));
+        }
+    }
+    REQUIRE(has_position);
+    REQUIRE(n.SKTotal() == 1);
+}
@@ -0,0 +1,176 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "ais_targets.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using Catch::Approx;
+
+namespace {
+ais_message Position(uint32_t mmsi, double lat, double lon)
+{
+    ais_message m;
+    m.type = 1;
+    m.mmsi = mmsi;
+    m.has_position_report = true;
+    m.lat = static_cast<int32_t>(lat * 600000);
+    m.lon = static_cast<int32_t>(lon * 600000);
+    m.sog = 100;
+    m.cog = 900;
+    return m;
+}
+}
+
+TEST_CASE("AIS targets are tracked per MMSI")
+{
+    AISTargets t(16);
+    const auto now = std::chrono::steady_clock::now();
+    const auto a = t.Update(Position(211000001, 50.0, 14.0), now);
+    const auto b = t.Update(Position(211000002, 50.1, 14.1), now);
+    REQUIRE(a != b);
+    REQUIRE(t.Size() == 2);
+    REQUIRE(t.Find(211000001) == a);
+    REQUIRE(t.Update(Position(211000001, 50.2, 14.2), now) == a);
+    REQUIRE(t.Size() == 2);
+    REQUIRE(t.Lat()[a] == Approx(50.2));
+    REQUIRE(t.Sog()[a] == Approx(10.0 * 1852.0 / 3600.0));
+    REQUIRE(t.Cog()[a] == Approx(PI / 2));
+    REQUIRE(t.Find(211000003) == AISTargets::NONE);
+}
+
+TEST_CASE("AIS static data are merged")
+{
+    AISTargets t(16);
+    const auto now = std::chrono::steady_clock::now();
+    ais_message a;
+    a.type = 24;
+    a.mmsi = 271041815;
+    a.ais_class = 'B';
+    a.has_static_data = true;
+    a.part = 0;
+    std::snprintf(a.name.data(), a.name.size(), "PROGUY");
+    ais_message b = a;
+    b.part = 1;
+    b.name = {};
+    b.ship_type = 60;
+    b.to_stern = 15;
+    const auto slot = t.Update(a, now);
+    t.Update(b, now);
+    REQUIRE(std::string(t.Static()[slot].name.data()) == "PROGUY");
+    REQUIRE(t.Static()[slot].ship_type == 60);
+    REQUIRE(t.Static()[slot].to_stern == 15);
+}
+
+TEST_CASE("AIS targets range query")
+{
+    AISTargets t(64);
+    const auto now = std::chrono::steady_clock::now();
+    t.Update(Position(1, 50.0, 14.0), now);
+    t.Update(Position(2, 50.01, 14.01), now);
+    t.Update(Position(3, 50.5, 14.0), now);
+    t.Update(Position(4, -50.0, 14.0), now);
+    t.Update(Position(5, 0.0, 179.99), now);
+    t.Update(Position(6, 0.0, -179.99), now);
+    std::vector<uint32_t> found;
+    t.Query(50.0, 14.0, 5000.0, found);
+    REQUIRE(found.size() == 2);
+    t.Query(50.0, 14.0, 100000.0, found);
+    REQUIRE(found.size() == 3);
+    // Across the antimeridian
+    t.Query(0.0, 180.0, 5000.0, found);
+    REQUIRE(found.size() == 2);
+}
+
+TEST_CASE("AIS targets expire")
+{
+    AISTargets t(16, std::chrono::minutes(5));
+    const auto start = std::chrono::steady_clock::now();
+    t.Update(Position(1, 50.0, 14.0), start);
+    t.Update(Position(2, 50.0, 14.0), start);
+    REQUIRE(t.Expire(start + std::chrono::minutes(3)) == 0);
+    t.Update(Position(2, 50.0, 14.0), start + std::chrono::minutes(3));
+    REQUIRE(t.Expire(start + std::chrono::minutes(6)) == 1);
+    REQUIRE(t.Find(1) == AISTargets::NONE);
+    REQUIRE(t.Find(2) != AISTargets::NONE);
+    REQUIRE(t.Expire(start + std::chrono::hours(1)) == 1);
+    REQUIRE(t.Size() == 0);
+    std::vector<uint32_t> found;
+    t.Query(50.0, 14.0, 5000.0, found);
+    REQUIRE(found.empty());
+}
+
+TEST_CASE("AIS table capacity is bounded")
+{
+    AISTargets t(4);
+    const auto now = std::chrono::steady_clock::now();
+    for (uint32_t mmsi = 1; mmsi <= 10; ++mmsi) {
+        t.Update(Position(mmsi, 50.0, 14.0), now);
+    }
+    REQUIRE(t.Size() == 4);
+    REQUIRE(t.Overflows() == 6);
+}
+
+TEST_CASE("Changed AIS targets are sent together")
+{
+    NSK n;
+    Document d;
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C", &d);
+    REQUIRE(n.SKTotal() == 1);
+    n.SetAISFlushInterval(std::chrono::hours(1));
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,A,B52K>;h00Fc>jpUlNV@ikwpUoP06,0*4C", &d);
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,A,H42O55i18tMET00000000000000,2*6D", &d);
+    REQUIRE(n.SKTotal() == 1);
+    REQUIRE(n.AISTargetTable().Size() == 3);
+
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    StartCapturingMessages();
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,A,H42O55lti4hhhilD3nink000?050,0*40", &d);
+    const auto messages = StopCapturingMessages();
+    // Counted per delta, not per flush
+    REQUIRE(n.SKTotal() == 3);
+    REQUIRE(d.IsArray());
+    REQUIRE(d.Size() == 2);
+    // Each target is sent in a message of its own
+    REQUIRE(messages.size() == 2);
+    for (const auto& m : messages) {
+        REQUIRE(m.message_id == "NSK_PI_SIGNALK");
+        Document delta;
+        delta.Parse(m.message_body.c_str());
+        REQUIRE(delta.IsObject());
+        REQUIRE(delta.HasMember("context"));
+    }
+}
@@ -0,0 +1,274 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "cpa.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using Catch::Approx;
+
+namespace {
+ais_message Target(uint32_t mmsi, double lat, double lon, double sog_kn,
+    double cog_deg)
+{
+    ais_message m;
+    m.type = 1;
+    m.mmsi = mmsi;
+    m.has_position_report = true;
+    m.lat = static_cast<int32_t>(lat * 600000);
+    m.lon = static_cast<int32_t>(lon * 600000);
+    m.sog = static_cast<uint16_t>(sog_kn * 10);
+    m.cog = static_cast<uint16_t>(cog_deg * 10);
+    return m;
+}
+
+uint32_t Add(AISTargets& t, CPAEngine& c, const ais_message& m)
+{
+    const auto slot = t.Update(m, std::chrono::steady_clock::now());
+    c.Touch(slot, t);
+    return slot;
+}
+}
+
+TEST_CASE("CPA of a head-on target")
+{
+    AISTargets t(16);
+    CPAEngine c(16);
+    c.SetOwnPosition(50.0, 0.0);
+    c.SetOwnVelocity(10.0 * 1852.0 / 3600.0, 0.0);
+    // 2 NM north, heading south at 10 knots, 0.1 NM to the east
+    const auto a = Add(t, c, Target(211000001, 50.0 + 2.0 / 60.0,
+                                   0.1 / 60.0 / std::cos(deg2rad(50.0)), 10.0,
+                                   180.0));
+    // 5 NM south, going away
+    const auto b = Add(t, c, Target(211000002, 50.0 - 5.0 / 60.0, 0.0, 5.0,
+                                   180.0));
+    REQUIRE(c.Compute(t) == 16);
+    REQUIRE(c.Cpa()[a] == Approx(0.1 * 1852.0).margin(1.0));
+    REQUIRE(c.Tcpa()[a] == Approx(360.0).margin(1.0));
+    REQUIRE(c.Alarm()[a] == 1);
+    REQUIRE(c.Tcpa()[b] < 0.0);
+    REQUIRE(c.Alarm()[b] == 0);
+    REQUIRE(c.Changed().size() == 1);
+    REQUIRE(c.Changed()[0] == a);
+}
+
+TEST_CASE("CPA is recomputed only for the changed targets")
+{
+    AISTargets t(16);
+    CPAEngine c(16);
+    c.SetOwnPosition(50.0, 0.0);
+    c.SetOwnVelocity(5.0, 0.0);
+    const auto a = Add(t, c, Target(211000001, 50.1, 0.0, 10.0, 180.0));
+    Add(t, c, Target(211000002, 50.2, 0.0, 10.0, 180.0));
+    REQUIRE(c.Compute(t) == 16);
+    REQUIRE(c.Compute(t) == 0);
+    // The target turns away
+    Add(t, c, Target(211000001, 50.1, 0.0, 10.0, 0.0));
+    REQUIRE(c.Compute(t) == 1);
+    REQUIRE(c.Tcpa()[a] < 0.0);
+    // Small change of the own velocity does not trigger full recomputation
+    c.SetOwnVelocity(5.05, 0.0);
+    REQUIRE(c.Compute(t) == 0);
+    c.SetOwnVelocity(2.0, 0.0);
+    REQUIRE(c.Compute(t) == 16);
+}
+
+TEST_CASE("CPA of all the targets follows the own ship motion")
+{
+    AISTargets t(16);
+    CPAEngine c(16);
+    c.SetOwnPosition(50.0, 0.0);
+    c.SetOwnVelocity(0.0, 0.0);
+    // Anchored 1 NM north, reporting rarely
+    const auto a = Add(t, c, Target(211000001, 50.0 + 1.0 / 60.0, 0.0, 0.0,
+                                   0.0));
+    REQUIRE(c.Compute(t) == 16);
+    REQUIRE(c.Alarm()[a] == 0);
+    // The own ship starts moving towards the target
+    c.SetOwnVelocity(5.0, 0.0);
+    REQUIRE(c.Compute(t) == 16);
+    REQUIRE(c.Alarm()[a] == 1);
+    REQUIRE(c.Tcpa()[a] == Approx(1852.0 / 5.0).margin(1.0));
+    // GNSS noise does not recompute everything
+    c.SetOwnPosition(50.0 + 10.0 / 1852.0 / 60.0, 0.0);
+    REQUIRE(c.Compute(t) == 0);
+    // Passing the target
+    c.SetOwnPosition(50.0 + 1.5 / 60.0, 0.0);
+    REQUIRE(c.Compute(t) == 16);
+    REQUIRE(c.Tcpa()[a] < 0.0);
+    REQUIRE(c.Alarm()[a] == 0);
+    REQUIRE(c.Changed().size() == 1);
+}
+
+TEST_CASE("Own AIS transponder is excluded from CPA")
+{
+    AISTargets t(16);
+    CPAEngine c(16);
+    c.SetOwnMmsi(211000001);
+    c.SetOwnPosition(50.0, 0.0);
+    c.SetOwnVelocity(0.0, 0.0);
+    const auto a = Add(t, c, Target(211000001, 50.0, 0.0, 0.0, 0.0));
+    c.Compute(t);
+    REQUIRE(std::isnan(c.Cpa()[a]));
+    REQUIRE(c.Alarm()[a] == 0);
+}
+
+TEST_CASE("NSK sends CPA notifications for AIS targets")
+{
+    NSK n;
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    Document d;
+    n.ProcessNMEASentence(
+        "$GPRMC,120000,A,4734.970,N,12221.000,W,10.0,090.0,191026,,,A*5C", &d);
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C", &d);
+
+    REQUIRE(d.IsArray());
+    REQUIRE(d.Size() == 2);
+    bool has_cpa = false;
+    for (auto& v : d[0]["updates"][0]["values"].GetArray()) {
+        const std::string path = v["path"].GetString();
+        if (path == "navigation.closestApproach") {
+            has_cpa = true;
+            REQUIRE(v["value"]["distance"].GetDouble() < 50.0);
+            REQUIRE(v["value"]["timeTo"].GetDouble() > 0.0);
+        }
+        REQUIRE(path.rfind("notifications.", 0) == std::string::npos);
+    }
+    REQUIRE(has_cpa);
+
+    // The notification is raised on the own vessel
+    REQUIRE(std::string(d[1]["context"].GetString()) == "vessels.self");
+    const auto& notification = d[1]["updates"][0]["values"][0];
+    REQUIRE(std::string(notification["path"].GetString())
+        == "notifications.navigation.closestApproach."
+           "urn:mrn:imo:mmsi:477553000");
+    REQUIRE(std::string(notification["value"]["state"].GetString())
+        == "alarm");
+}
+
+TEST_CASE("Alarm of an expired target is cleared")
+{
+    AISTargets t(16);
+    CPAEngine c(16);
+    c.SetOwnPosition(50.0, 0.0);
+    c.SetOwnVelocity(5.0, 0.0);
+    const auto start = std::chrono::steady_clock::now();
+    const auto a
+        = t.Update(Target(211000001, 50.0 + 1.0 / 60.0, 0.0, 0.0, 0.0), start);
+    c.Touch(a, t);
+    c.Compute(t);
+    REQUIRE(c.Alarm()[a] == 1);
+    REQUIRE(c.Expired().empty());
+
+    REQUIRE(t.Expire(start + std::chrono::hours(1)) == 1);
+    c.Compute(t);
+    REQUIRE(c.Alarm()[a] == 0);
+    REQUIRE(c.Changed().empty());
+    REQUIRE(c.Expired().size() == 1);
+    REQUIRE(c.Expired()[0] == 211000001);
+    // Reported only once
+    c.Compute(t);
+    REQUIRE(c.Expired().empty());
+}
+
+TEST_CASE("NSK clears the CPA notification of an expired target")
+{
+    const int64_t t0 = 1792404000000;
+    auto clock = std::make_shared<ManualClock>(t0);
+    NSK n(clock);
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    Document d;
+    n.ProcessNMEASentence(
+        "$GPRMC,120000,A,4734.970,N,12221.000,W,10.0,090.0,191026,,,A*5C", &d);
+    const size_t own_paths = n.State().Size();
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C", &d);
+    const std::string path = "notifications.navigation.closestApproach."
+                             "urn:mrn:imo:mmsi:477553000";
+    REQUIRE(d.Size() == 2);
+    REQUIRE(std::string(d[1]["updates"][0]["values"][0]["path"].GetString())
+        == path);
+
+    // The per-target paths are not kept with the paths of the own vessel
+    REQUIRE(SKPaths::Find(path) == SKPaths::NONE);
+    REQUIRE(n.State().Size() == own_paths);
+
+    // Another target arriving after the first one expired flushes the table
+    clock->Advance(std::chrono::minutes(11));
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,A,B52K>;h00Fc>jpUlNV@ikwpUoP06,0*4C", &d);
+    REQUIRE(d.IsArray());
+    bool cleared = false;
+    for (const auto& delta : d.GetArray()) {
+        if (std::string(delta["context"].GetString()) != "vessels.self") {
+            continue;
+        }
+        for (const auto& v : delta["updates"][0]["values"].GetArray()) {
+            if (v["path"].GetString() == path) {
+                cleared = true;
+                REQUIRE(std::string(v["value"]["state"].GetString())
+                    == "normal");
+            }
+        }
+    }
+    REQUIRE(cleared);
+}
+
+TEST_CASE("CPA benchmark", "[.][benchmark]")
+{
+    const size_t count = 2000;
+    AISTargets t(4096);
+    CPAEngine c(4096);
+    c.SetOwnPosition(50.0, 0.0);
+    for (uint32_t i = 0; i < count; ++i) {
+        Add(t, c,
+            Target(211000000 + i, 49.5 + (i % 100) * 0.01,
+                -0.5 + (i / 100) * 0.05, i % 20, (i * 7) % 360));
+    }
+    double speed = 1.0;
+    BENCHMARK("Full recomputation of 2000 targets")
+    {
+        // Change the own velocity to force recomputation of all the targets
+        speed = speed > 5.0 ? 1.0 : speed + 1.0;
+        c.SetOwnVelocity(speed, 0.0);
+        return c.Compute(t);
+    };
+    BENCHMARK("Incremental recomputation of 100 targets")
+    {
+        for (uint32_t i = 0; i < 100; ++i) {
+            c.Touch(i, t);
+        }
+        return c.Compute(t);
+    };
+}
@@ -0,0 +1,178 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include "sk_state.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using Catch::Approx;
+
+namespace {
+const char* DELTA_GP = R"({"updates":[{"source":{"sentence":"RMC",
+    "talker":"GP","label":"NSK","type":"NMEA0183"},
+    "timestamp":"2026-10-19T10:00:00Z","values":[
+    {"path":"navigation.position","value":{"latitude":50.1,"longitude":14.2}},
+    {"path":"navigation.speedOverGround","value":3.5},
+    {"path":"navigation.datetime","value":"10:00:00"}]}]})";
+
+const char* DELTA_II = R"({"updates":[{"source":{"sentence":"MWV",
+    "talker":"II","label":"NSK","type":"NMEA0183"},
+    "timestamp":"2026-10-19T10:00:01Z","values":[
+    {"path":"environment.wind.speedApparent","value":7.2},
+    {"path":"navigation.speedOverGround","value":3.6},
+    {"path":"design.length","value":{"overall":12.5}}]}]})";
+}
+
+TEST_CASE("Path identifiers are stable")
+{
+    const auto a = SKPaths::Id("navigation.test.pathA");
+    const auto b = SKPaths::Id("navigation.test.pathB");
+    REQUIRE(a != b);
+    REQUIRE(SKPaths::Id("navigation.test.pathA") == a);
+    REQUIRE(SKPaths::Find("navigation.test.pathB") == b);
+    REQUIRE(SKPaths::Find("navigation.test.unknown") == SKPaths::NONE);
+    REQUIRE(SKPaths::Name(a) == "navigation.test.pathA");
+    REQUIRE(SKPaths::Count() > b);
+}
+
+TEST_CASE("Paths are found while others are registered")
+{
+    // Readers look the paths up without the lock while writers register
+    std::vector<std::thread> threads;
+    std::vector<std::vector<sk_path_id>> ids(4);
+    for (size_t t = 0; t < ids.size(); ++t) {
+        threads.emplace_back([t, &ids]() {
+            for (int i = 0; i < 64; ++i) {
+                const std::string path
+                    = "navigation.concurrent.path" + std::to_string(i);
+                const auto id = SKPaths::Id(path);
+                ids[t].push_back(id);
+                if (SKPaths::Find(path) != id
+                    || SKPaths::Name(id) != path) {
+                    ids[t].push_back(SKPaths::NONE);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (const auto& v : ids) {
+        REQUIRE(v == ids[0]);
+        REQUIRE(v.size() == 64);
+    }
+}
+
+TEST_CASE("State is updated from deltas")
+{
+    SKState st;
+    Document d;
+    d.Parse(DELTA_GP);
+    st.Update(d);
+    REQUIRE(st.Size() == 3);
+    const auto* sog = st.Get("navigation.speedOverGround");
+    REQUIRE(sog != nullptr);
+    REQUIRE(sog->type == sk_value_type::number);
+    REQUIRE(sog->number == Approx(3.5));
+    REQUIRE(std::string(sog->timestamp.data()) == "2026-10-19T10:00:00Z");
+    REQUIRE(st.Source(sog->source).ref == "NSK.GP");
+    const auto* pos = st.Get("navigation.position");
+    REQUIRE(pos != nullptr);
+    REQUIRE(pos->type == sk_value_type::position);
+    REQUIRE(pos->longitude == Approx(14.2));
+
+    d.Parse(DELTA_II);
+    st.Update(d);
+    REQUIRE(st.Size() == 5);
+    sog = st.Get("navigation.speedOverGround");
+    REQUIRE(sog->number == Approx(3.6));
+    REQUIRE(st.Source(sog->source).ref == "NSK.II");
+    REQUIRE(st.Get("design.length")->type == sk_value_type::json);
+    REQUIRE(st.Get("environment.depth.belowKeel") == nullptr);
+}
+
+TEST_CASE("State ignores other vessels")
+{
+    SKState st;
+    Document d;
+    d.Parse(R"([{"context":"vessels.urn:mrn:imo:mmsi:211000001",
+        "updates":[{"values":[{"path":"navigation.speedOverGround",
+        "value":1.0}]}]}])");
+    st.Update(d);
+    REQUIRE(st.Size() == 0);
+}
+
+TEST_CASE("State snapshot is a full SignalK document")
+{
+    SKState st;
+    Document d;
+    d.Parse(DELTA_GP);
+    st.Update(d);
+    d.Parse(DELTA_II);
+    st.Update(d);
+
+    Document s;
+    s.Parse(st.Snapshot().c_str());
+    REQUIRE_FALSE(s.HasParseError());
+    REQUIRE(std::string(s["self"].GetString()) == "vessels.self");
+    const auto& self = s["vessels"]["self"];
+    REQUIRE(self["navigation"]["speedOverGround"]["value"].GetDouble()
+        == Approx(3.6));
+    REQUIRE(std::string(
+                self["navigation"]["speedOverGround"]["$source"].GetString())
+        == "NSK.II");
+    REQUIRE(std::string(
+                self["navigation"]["position"]["timestamp"].GetString())
+        == "2026-10-19T10:00:00Z");
+    REQUIRE(self["navigation"]["position"]["value"]["latitude"].GetDouble()
+        == Approx(50.1));
+    REQUIRE(self["design"]["length"]["value"]["overall"].GetDouble()
+        == Approx(12.5));
+    REQUIRE(s["sources"]["NSK"]["GP"]["talker"] == "GP");
+    REQUIRE(s["sources"]["NSK"]["II"]["talker"] == "II");
+}
+
+TEST_CASE("NSK keeps the state of the produced deltas")
+{
+    NSK n;
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    n.ProcessAISSentence("!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C");
+    REQUIRE(n.State().Size() == 0);
+    Document d;
+    n.ProcessNMEASentence("$IIMTW,17.5,C*10", nullptr);
+    n.SendSnapshot(&d);
+    REQUIRE(d["vessels"]["self"]["environment"]["water"]["temperature"]
+              ["value"]
+                  .GetDouble()
+        == Approx(290.65));
+}
@@ -0,0 +1,195 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "rapidjson/document.h"
+#include "sk_encoding.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+
+namespace {
+const char* DELTA = R"({"updates":[{"source":{"sentence":"RMC",
+    "talker":"GP","label":"NSK","type":"NMEA0183"},
+    "timestamp":"2026-10-19T10:00:00Z","values":[
+    {"path":"navigation.position","value":{"latitude":50.123456789,
+    "longitude":-14.2}},
+    {"path":"navigation.headingTrue","value":1.5707963267948966},
+    {"path":"navigation.speedOverGround","value":3.5},
+    {"path":"navigation.datetime","value":"10:00:00"},
+    {"path":"environment.depth.belowKeel","value":null},
+    {"path":"steering.autopilot.engaged","value":true},
+    {"path":"navigation.gnss.satellites","value":9},
+    {"path":"navigation.gnss.geoidalSeparation","value":-42}]}]})";
+
+/// @brief Build an array of deltas for count AIS targets
+std::string Batch(size_t count)
+{
+    std::string s = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i != 0) {
+            s += ",";
+        }
+        s += R"({"context":"vessels.urn:mrn:imo:mmsi:)"
+            + std::to_string(211000000 + i)
+            + R"(","updates":[{"source":{"sentence":"VDM","talker":"AI",
+            "label":"NSK","type":"NMEA0183"},
+            "timestamp":"2026-10-19T10:00:00Z","values":[
+            {"path":"navigation.position","value":{"latitude":)"
+            + std::to_string(50.0 + i * 0.001) + R"(,"longitude":)"
+            + std::to_string(14.0 - i * 0.001) + R"(}},
+            {"path":"navigation.courseOverGroundTrue","value":)"
+            + std::to_string(i * 0.01) + R"(},
+            {"path":"navigation.speedOverGround","value":)"
+            + std::to_string(i * 0.1) + "}]}]}";
+    }
+    return s + "]";
+}
+
+/// @brief Encode the document and decode it back
+Document RoundTrip(const Document& d, delta_encoding enc, size_t* size)
+{
+    DeltaEncoder e;
+    const std::string& data = e.Encode(d, enc);
+    *size = data.size();
+    DeltaDecoder dec;
+    Document out;
+    REQUIRE(dec.Decode(data.data(), data.size(), enc, out));
+    return out;
+}
+}
+
+TEST_CASE("Encoding names")
+{
+    REQUIRE(DeltaEncodingFromName("cbor") == delta_encoding::cbor);
+    REQUIRE(DeltaEncodingFromName("json") == delta_encoding::json);
+    REQUIRE(DeltaEncodingFromName("xml", delta_encoding::cbor)
+        == delta_encoding::cbor);
+    REQUIRE(std::string(DeltaEncodingName(delta_encoding::cbor)) == "cbor");
+}
+
+TEST_CASE("CBOR encoding of a simple document")
+{
+    Document d;
+    d.Parse(R"({"abc":[1,-2,0.5,"abc"]})");
+    DeltaEncoder e;
+    const std::string& data = e.Encode(d, delta_encoding::cbor);
+    const std::string expected("\xd9\x01\x00" // stringref namespace
+                               "\xa1\x63"
+                               "abc"
+                               "\x84\x01\x21"
+                               "\xfa\x3f\x00\x00\x00"
+                               "\xd8\x19\x00", // stringref 0
+        19);
+    REQUIRE(data == expected);
+}
+
+TEST_CASE("CBOR delta round trip")
+{
+    Document d;
+    d.Parse(DELTA);
+    REQUIRE_FALSE(d.HasParseError());
+    size_t json_size;
+    size_t cbor_size;
+    Document j = RoundTrip(d, delta_encoding::json, &json_size);
+    Document c = RoundTrip(d, delta_encoding::cbor, &cbor_size);
+    REQUIRE(j == d);
+    REQUIRE(c == d);
+    REQUIRE(c["updates"][0]["values"][0]["value"]["latitude"].GetDouble()
+        == 50.123456789);
+    REQUIRE(cbor_size < json_size);
+}
+
+TEST_CASE("CBOR shares the repeated strings")
+{
+    Document d;
+    d.Parse(Batch(100).c_str());
+    size_t json_size;
+    size_t cbor_size;
+    Document c = RoundTrip(d, delta_encoding::cbor, &cbor_size);
+    RoundTrip(d, delta_encoding::json, &json_size);
+    REQUIRE(c == d);
+    REQUIRE(cbor_size * 2 < json_size);
+}
+
+TEST_CASE("Malformed CBOR is rejected")
+{
+    Document d;
+    d.Parse(DELTA);
+    DeltaEncoder e;
+    const std::string data = e.Encode(d, delta_encoding::cbor);
+    DeltaDecoder dec;
+    Document out;
+    for (size_t len = 0; len < data.size(); ++len) {
+        REQUIRE_FALSE(dec.Decode(data.data(), len, delta_encoding::cbor, out));
+    }
+    REQUIRE_FALSE(dec.Decode("\xd8\x19\x05", 3, delta_encoding::cbor, out));
+    REQUIRE_FALSE(dec.Decode("\x9f\xff", 2, delta_encoding::cbor, out));
+    REQUIRE_FALSE(dec.Decode("\x9b\xff\xff\xff\xff\xff\xff\xff\xff", 9,
+        delta_encoding::cbor, out));
+}
+
+TEST_CASE("Delta encoding benchmark", "[.][benchmark]")
+{
+    Document d;
+    d.Parse(DELTA);
+    Document batch;
+    batch.Parse(Batch(200).c_str());
+    DeltaEncoder e;
+    DeltaDecoder dec;
+    const std::string json = e.Encode(batch, delta_encoding::json);
+    const std::string cbor = e.Encode(batch, delta_encoding::cbor);
+    WARN("Batch of 200 targets: JSON " << json.size() << " B, CBOR "
+                                       << cbor.size() << " B");
+
+    BENCHMARK("Encode delta JSON")
+    {
+        return e.Encode(d, delta_encoding::json).size();
+    };
+    BENCHMARK("Encode delta CBOR")
+    {
+        return e.Encode(d, delta_encoding::cbor).size();
+    };
+    BENCHMARK("Encode batch JSON")
+    {
+        return e.Encode(batch, delta_encoding::json).size();
+    };
+    BENCHMARK("Encode batch CBOR")
+    {
+        return e.Encode(batch, delta_encoding::cbor).size();
+    };
+    BENCHMARK("Decode batch JSON")
+    {
+        Document out;
+        return dec.Decode(json.data(), json.size(), delta_encoding::json, out);
+    };
+    BENCHMARK("Decode batch CBOR")
+    {
+        Document out;
+        return dec.Decode(cbor.data(), cbor.size(), delta_encoding::cbor, out);
+    };
+}
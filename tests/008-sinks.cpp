@@ -0,0 +1,383 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "output_sinks.h"
+#include "rapidjson/document.h"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+
+namespace {
+const std::string DELTA_A = R"({"updates":[{"values":[{"path":"a","value":1}]}]})";
+const std::string DELTA_B = R"({"updates":[{"values":[{"path":"b","value":2}]}]})";
+const std::string BATCH = "[" + DELTA_A + "," + DELTA_B + "]";
+
+/// @brief Wait until the condition holds or a second passes
+template <typename F> bool WaitFor(F cond)
+{
+    for (int i = 0; i < 200 && !cond(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return cond();
+}
+}
+
+TEST_CASE("Sink configuration round trip")
+{
+    Document d;
+    d.Parse(R"({"type":"udp","encoding":"cbor","batch":10,"interval":250,
+        "queue":8,"policy":"merge","host":"192.168.1.255","port":4123})");
+    const auto cfg = sink_config::FromJSON(d);
+    REQUIRE(cfg.type == "udp");
+    REQUIRE(cfg.encoding == delta_encoding::cbor);
+    REQUIRE(cfg.batch == 10);
+    REQUIRE(cfg.interval.count() == 250);
+    REQUIRE(cfg.batch_bytes == 1400);
+    REQUIRE(cfg.queue == 8);
+    REQUIRE(cfg.policy == sink_policy::merge);
+    REQUIRE(cfg.port == 4123);
+    Document out;
+    out.SetObject();
+    Value v = cfg.ToJSON(out.GetAllocator());
+    const auto cfg2 = sink_config::FromJSON(v);
+    REQUIRE(cfg2.host == cfg.host);
+    REQUIRE(cfg2.policy == cfg.policy);
+    REQUIRE(cfg2.batch_bytes == 1400);
+}
+
+TEST_CASE("Sink sends each delta when not batching")
+{
+    std::vector<std::string> out;
+    CallbackSink s(sink_config(), [&](const std::string& b) {
+        out.push_back(b);
+        return true;
+    });
+    s.Start();
+    s.Push(DELTA_A);
+    s.Push(DELTA_B);
+    REQUIRE(out.size() == 2);
+    REQUIRE(out[0] == DELTA_A);
+    REQUIRE(s.Delivered() == 2);
+}
+
+TEST_CASE("Sink batches deltas into an array")
+{
+    std::vector<std::string> out;
+    sink_config cfg;
+    cfg.batch = 3;
+    cfg.interval = std::chrono::milliseconds(1000);
+    CallbackSink s(cfg, [&](const std::string& b) {
+        out.push_back(b);
+        return true;
+    });
+    s.Start();
+    const auto t0 = std::chrono::steady_clock::now();
+    s.Push(DELTA_A, t0);
+    s.Push(BATCH, t0);
+    REQUIRE(out.empty());
+    s.Push(DELTA_B, t0);
+    REQUIRE(out.size() == 1);
+    REQUIRE(out[0] == "[" + DELTA_A + "," + DELTA_A + "," + DELTA_B + ","
+            + DELTA_B + "]");
+    Document d;
+    d.Parse(out[0].c_str());
+    REQUIRE(d.IsArray());
+    REQUIRE(d.Size() == 4);
+
+    // Interval elapsed
+    s.Push(DELTA_A, t0);
+    s.Tick(t0 + std::chrono::milliseconds(500));
+    REQUIRE(out.size() == 1);
+    s.Tick(t0 + std::chrono::milliseconds(1000));
+    REQUIRE(out.size() == 2);
+    REQUIRE(out[1] == DELTA_A);
+}
+
+TEST_CASE("Plugin messages carry a single delta")
+{
+    sink_config cfg;
+    cfg.batch = 2;
+    cfg.interval = std::chrono::milliseconds(1000);
+    PluginMessageSink s(cfg);
+    s.Start();
+    StartCapturingMessages();
+    const auto t0 = std::chrono::steady_clock::now();
+    s.Push(DELTA_A, t0);
+    s.Tick(t0 + std::chrono::milliseconds(1000));
+    s.Push(DELTA_A, t0);
+    s.Push(DELTA_B, t0);
+    const auto messages = StopCapturingMessages();
+    REQUIRE(messages.size() == 2);
+    REQUIRE(messages[0].message_id == "NSK_PI_SIGNALK");
+    REQUIRE(messages[0].message_body == DELTA_A);
+    // Batches have a message of their own
+    REQUIRE(messages[1].message_id == "NSK_PI_SIGNALK_BATCH");
+    REQUIRE(messages[1].message_body == "[" + DELTA_A + "," + DELTA_B + "]");
+}
+
+TEST_CASE("Plugin messages are sent from the main thread only")
+{
+    PluginMessageSink s { sink_config() };
+    s.Start();
+    StartCapturingMessages();
+    std::thread other([&s]() {
+        s.Push(DELTA_A);
+        s.Push(DELTA_B);
+        // Only the thread that created the sink sends the queued messages
+        s.Dispatch();
+    });
+    other.join();
+    REQUIRE(CapturedMessages() == 0);
+    REQUIRE(s.Delivered() == 2);
+    // The queued messages go out before the ones of the main thread
+    s.Push(DELTA_A);
+    const auto messages = StopCapturingMessages();
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[0].message_body == DELTA_A);
+    REQUIRE(messages[1].message_body == DELTA_B);
+    REQUIRE(messages[2].message_body == DELTA_A);
+    for (const auto& m : messages) {
+        REQUIRE(m.thread == std::this_thread::get_id());
+    }
+}
+
+TEST_CASE("Stream sink delimits deltas by newlines")
+{
+    std::vector<std::string> out;
+    sink_config cfg;
+    cfg.batch = 2;
+    cfg.interval = std::chrono::milliseconds(1000);
+    CallbackSink s(
+        cfg,
+        [&](const std::string& b) {
+            out.push_back(b);
+            return true;
+        },
+        false, true);
+    s.Start();
+    s.Push(DELTA_A);
+    s.Push(BATCH);
+    REQUIRE(out.size() == 1);
+    REQUIRE(out[0] == DELTA_A + "\n" + BATCH + "\n");
+}
+
+TEST_CASE("Worker thread times the batches by the clock of the sink")
+{
+    ManualClock clock(1792404000000);
+    std::atomic<size_t> delivered { 0 };
+    sink_config cfg;
+    cfg.batch = 10;
+    cfg.interval = std::chrono::milliseconds(1000);
+    CallbackSink s(
+        cfg,
+        [&](const std::string&) {
+            ++delivered;
+            return true;
+        },
+        true);
+    s.SetClock(clock);
+    s.Start();
+    s.Push(DELTA_A);
+    // The interval never elapses while the clock stands still
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    REQUIRE(delivered == 0);
+    clock.Advance(std::chrono::milliseconds(1000));
+    REQUIRE(WaitFor([&]() { return delivered == 1; }));
+    s.Stop();
+}
+
+TEST_CASE("Slow sink does not block and drops according to the policy")
+{
+    for (auto policy : { sink_policy::drop_oldest, sink_policy::drop_newest,
+             sink_policy::merge }) {
+        std::mutex gate;
+        std::vector<std::string> out;
+        sink_config cfg;
+        cfg.queue = 2;
+        cfg.policy = policy;
+        gate.lock();
+        CallbackSink s(
+            cfg,
+            [&](const std::string& b) {
+                std::lock_guard<std::mutex> lock(gate);
+                out.push_back(b);
+                return true;
+            },
+            true);
+        s.Start();
+        // The first one is taken by the worker, which blocks on the gate
+        s.Push(DELTA_A);
+        REQUIRE(WaitFor([&]() { return s.QueueDepth() == 0; }));
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 100; ++i) {
+            s.Push(i < 50 ? DELTA_A : DELTA_B);
+        }
+        REQUIRE(std::chrono::steady_clock::now() - start
+            < std::chrono::milliseconds(500));
+        // The batch interval elapsing does not seal the merged batch
+        s.Tick(std::chrono::steady_clock::now() + std::chrono::seconds(1));
+        REQUIRE(s.Accepted() == 101);
+        gate.unlock();
+        s.Stop();
+        REQUIRE(s.Delivered() + s.Dropped() == 101);
+        if (policy == sink_policy::drop_oldest) {
+            REQUIRE(out.size() == 3);
+            REQUIRE(out.back() == DELTA_B);
+            REQUIRE(s.Dropped() == 98);
+        } else if (policy == sink_policy::drop_newest) {
+            REQUIRE(out.size() == 3);
+            REQUIRE(out.back() == DELTA_A);
+            REQUIRE(s.Dropped() == 98);
+        } else {
+            // The deltas that did not fit in the queue were merged into one
+            // batch
+            REQUIRE(out.size() == 4);
+            REQUIRE(s.Dropped() == 0);
+            Document d;
+            d.Parse(out.back().c_str());
+            REQUIRE(d.IsArray());
+            REQUIRE(d.Size() == 98);
+        }
+    }
+}
+
+TEST_CASE("File sink writes newline delimited JSON")
+{
+    const std::string path = "nsk_test_sink.ndjson";
+    std::remove(path.c_str());
+    {
+        sink_config cfg;
+        cfg.type = "file";
+        cfg.path = path;
+        cfg.batch = 10;
+        cfg.interval = std::chrono::milliseconds(50);
+        auto s = OutputSinks::Create(cfg);
+        s->Start();
+        s->Push(DELTA_A);
+        s->Push(DELTA_B);
+        REQUIRE(WaitFor([&]() { return s->Delivered() == 2; }));
+    }
+    std::ifstream f(path);
+    std::string l1;
+    std::string l2;
+    std::getline(f, l1);
+    std::getline(f, l2);
+    REQUIRE(l1 == DELTA_A);
+    REQUIRE(l2 == DELTA_B);
+    f.close();
+    std::remove(path.c_str());
+}
+
+#ifndef _WIN32
+TEST_CASE("UDP sink sends datagrams")
+{
+    socket_t rx = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    sink_config cfg;
+    cfg.type = "udp";
+    cfg.host = "127.0.0.1";
+    cfg.port = ntohs(addr.sin_port);
+    auto s = OutputSinks::Create(cfg);
+    s->Start();
+    s->Push(DELTA_A);
+    char buf[2048];
+    const auto n = recv(rx, buf, sizeof(buf), 0);
+    REQUIRE(std::string(buf, n) == DELTA_A);
+    CloseSocket(rx);
+}
+
+TEST_CASE("TCP sink streams to the connected clients")
+{
+    sink_config cfg;
+    cfg.type = "tcp";
+    cfg.host = "127.0.0.1";
+    cfg.port = 0;
+    auto sink = OutputSinks::Create(cfg);
+    auto* tcp = static_cast<TcpSink*>(sink.get());
+    tcp->Start();
+    REQUIRE(WaitFor([&]() { return tcp->Port() != 0; }));
+
+    socket_t c = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(tcp->Port());
+    REQUIRE(connect(c, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(WaitFor([&]() { return tcp->Clients() == 1; }));
+    tcp->Push(DELTA_A);
+    tcp->Push(DELTA_B);
+    std::string received;
+    char buf[2048];
+    while (received.size() < DELTA_A.size() + DELTA_B.size() + 2) {
+        const auto n = recv(c, buf, sizeof(buf), 0);
+        REQUIRE(n > 0);
+        received.append(buf, n);
+    }
+    REQUIRE(received == DELTA_A + "\n" + DELTA_B + "\n");
+    CloseSocket(c);
+}
+#endif
+
+TEST_CASE("NSK publishes the deltas to all the sinks")
+{
+    NSK n;
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    std::vector<std::string> json;
+    std::vector<std::string> cbor;
+    sink_config cfg;
+    n.Sinks().Add(std::make_unique<CallbackSink>(cfg, [&](const std::string& b) {
+        json.push_back(b);
+        return true;
+    }));
+    cfg.encoding = delta_encoding::cbor;
+    n.Sinks().Add(std::make_unique<CallbackSink>(cfg, [&](const std::string& b) {
+        cbor.push_back(b);
+        return true;
+    }));
+    REQUIRE(n.Sinks().Sinks().size() == 3);
+    n.ProcessAISSentence("!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C");
+    REQUIRE(json.size() == 1);
+    REQUIRE(cbor.size() == 1);
+    DeltaDecoder dec;
+    Document d;
+    REQUIRE(dec.Decode(cbor[0].data(), cbor[0].size(), delta_encoding::cbor, d));
+    Document j;
+    j.Parse<kParseFullPrecisionFlag>(json[0].c_str());
+    REQUIRE(d == j);
+}
@@ -0,0 +1,376 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "signalk_server.h"
+#include <catch2/catch_test_macros.hpp>
+
+#ifdef __linux__
+
+#include "rapidjson/document.h"
+#include <arpa/inet.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+
+namespace {
+const std::string DELTA = R"({"updates":[{"source":{"label":"test"},)"
+                          R"("timestamp":"2026-01-01T00:00:00Z","values":[)"
+                          R"({"path":"navigation.speedOverGround","value":3.5},)"
+                          R"({"path":"environment.depth.belowTransducer",)"
+                          R"("value":12.5}]}]})";
+
+/// @brief Simple blocking client of the server
+class TestClient
+{
+public:
+    explicit TestClient(uint16_t port)
+    {
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        timeval tv { 2, 0 };
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        m_connected = connect(m_fd, reinterpret_cast<sockaddr*>(&addr),
+                          sizeof(addr))
+            == 0;
+    }
+    ~TestClient() { close(m_fd); }
+
+    bool Connected() const { return m_connected; }
+
+    void SendRaw(const std::string& data)
+    {
+        send(m_fd, data.data(), data.size(), MSG_NOSIGNAL);
+    }
+
+    /// @brief Read until the connection closes
+    std::string ReadAll()
+    {
+        std::string out;
+        char buf[4096];
+        ssize_t n;
+        while ((n = recv(m_fd, buf, sizeof(buf), 0)) > 0) {
+            out.append(buf, n);
+        }
+        return out;
+    }
+
+    /// @brief Read the response header of the request
+    std::string ReadHeader()
+    {
+        while (m_in.find("\r\n\r\n") == std::string::npos && Fill()) { }
+        const auto end = m_in.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            return {};
+        }
+        std::string h = m_in.substr(0, end + 4);
+        m_in.erase(0, end + 4);
+        return h;
+    }
+
+    /// @brief Open the stream and return the response header
+    std::string Upgrade(const std::string& query = "")
+    {
+        SendRaw("GET /signalk/v1/stream" + query
+            + " HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+              "Connection: Upgrade\r\n"
+              "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+              "Sec-WebSocket-Version: 13\r\n\r\n");
+        return ReadHeader();
+    }
+
+    /// @brief Send a masked text frame
+    void SendText(const std::string& text)
+    {
+        const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+        std::string f;
+        f.push_back(static_cast<char>(0x81));
+        if (text.size() < 126) {
+            f.push_back(static_cast<char>(0x80 | text.size()));
+        } else {
+            f.push_back(static_cast<char>(0x80 | 126));
+            f.push_back(static_cast<char>(text.size() >> 8));
+            f.push_back(static_cast<char>(text.size()));
+        }
+        f.append(reinterpret_cast<const char*>(mask), 4);
+        for (size_t i = 0; i < text.size(); ++i) {
+            f.push_back(static_cast<char>(text[i] ^ mask[i % 4]));
+        }
+        SendRaw(f);
+    }
+
+    /// @brief Read the next text message, empty on timeout
+    std::string ReadMessage()
+    {
+        while (true) {
+            if (m_in.size() >= 2) {
+                const auto* p = reinterpret_cast<const uint8_t*>(m_in.data());
+                size_t len = p[1] & 0x7f;
+                size_t hs = 2;
+                if (len == 126 && m_in.size() >= 4) {
+                    len = (size_t(p[2]) << 8) | p[3];
+                    hs = 4;
+                }
+                if (len != 126 && m_in.size() >= hs + len) {
+                    std::string m = m_in.substr(hs, len);
+                    m_in.erase(0, hs + len);
+                    return m;
+                }
+            }
+            if (!Fill()) {
+                return {};
+            }
+        }
+    }
+
+private:
+    bool Fill()
+    {
+        char buf[4096];
+        const auto n = recv(m_fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+        m_in.append(buf, n);
+        return true;
+    }
+
+    int m_fd;
+    bool m_connected;
+    std::string m_in;
+};
+
+/// @brief Wait until the condition holds or a second passes
+template <typename F> bool WaitFor(F cond)
+{
+    for (int i = 0; i < 200 && !cond(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return cond();
+}
+
+std::unique_ptr<SignalKServer> StartServer(const SKState* state = nullptr,
+    std::mutex* mutex = nullptr, uint16_t port = 0)
+{
+    sink_config cfg;
+    cfg.type = "signalk";
+    cfg.host = "127.0.0.1";
+    cfg.port = port;
+    auto sink = OutputSinks::Create(cfg);
+    auto server = std::unique_ptr<SignalKServer>(
+        static_cast<SignalKServer*>(sink.release()));
+    if (state != nullptr) {
+        server->SetState(*state, *mutex);
+    }
+    server->Start();
+    return server;
+}
+
+/// @brief Paths of all the values in the delta
+std::vector<std::string> Paths(const std::string& msg)
+{
+    std::vector<std::string> paths;
+    Document d;
+    d.Parse(msg.c_str());
+    if (!d.IsObject() || !d.HasMember("updates")) {
+        return paths;
+    }
+    for (const auto& u : d["updates"].GetArray()) {
+        for (const auto& v : u["values"].GetArray()) {
+            paths.emplace_back(v["path"].GetString());
+        }
+    }
+    return paths;
+}
+}
+
+TEST_CASE("SignalK path patterns")
+{
+    REQUIRE(SKPatternMatch("*", "navigation.position"));
+    REQUIRE(SKPatternMatch("navigation", "navigation.position"));
+    REQUIRE(SKPatternMatch("navigation.position", "navigation.position"));
+    REQUIRE_FALSE(SKPatternMatch("navigation.pos", "navigation.position"));
+    REQUIRE(SKPatternMatch("navigation.*", "navigation.position"));
+    REQUIRE(SKPatternMatch("environment.*.temperature",
+        "environment.outside.temperature"));
+    REQUIRE_FALSE(SKPatternMatch(
+        "environment.*.temperature", "environment.outside.pressure"));
+    REQUIRE(SKPatternMatch("vessels.*", "vessels.urn:mrn:imo:mmsi:230035780"));
+}
+
+TEST_CASE("SignalK server HTTP discovery and REST API")
+{
+    // The REST API serves the state shared by NSK
+    SKState state;
+    std::mutex mutex;
+    auto server = StartServer(&state, &mutex);
+    REQUIRE(WaitFor([&]() { return server->Port() != 0; }));
+    Document delta;
+    delta.Parse(DELTA.c_str());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        state.Update(delta);
+    }
+
+    {
+        TestClient c(server->Port());
+        REQUIRE(c.Connected());
+        c.SendRaw("GET /signalk HTTP/1.1\r\nHost: boat:3000\r\n\r\n");
+        const auto r = c.ReadAll();
+        REQUIRE(r.rfind("HTTP/1.1 200 OK", 0) == 0);
+        REQUIRE(r.find("ws://boat:3000/signalk/v1/stream")
+            != std::string::npos);
+    }
+    {
+        TestClient c(server->Port());
+        c.SendRaw("GET /signalk/v1/api/vessels/self/navigation/"
+                  "speedOverGround HTTP/1.1\r\n\r\n");
+        const auto r = c.ReadAll();
+        REQUIRE(r.rfind("HTTP/1.1 200 OK", 0) == 0);
+        Document d;
+        d.Parse(r.substr(r.find("\r\n\r\n") + 4).c_str());
+        REQUIRE(d["value"].GetDouble() == 3.5);
+    }
+    {
+        TestClient c(server->Port());
+        c.SendRaw("GET /signalk/v1/api/vessels/self/nothing HTTP/1.1\r\n\r\n");
+        REQUIRE(c.ReadAll().rfind("HTTP/1.1 404", 0) == 0);
+    }
+}
+
+TEST_CASE("SignalK server streams the deltas to the default subscription")
+{
+    auto server = StartServer();
+    REQUIRE(WaitFor([&]() { return server->Port() != 0; }));
+    TestClient c(server->Port());
+    const auto h = c.Upgrade();
+    REQUIRE(h.rfind("HTTP/1.1 101", 0) == 0);
+    REQUIRE(h.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=")
+        != std::string::npos);
+    Document hello;
+    hello.Parse(c.ReadMessage().c_str());
+    REQUIRE(hello["self"] == "vessels.self");
+    REQUIRE(WaitFor([&]() { return server->Clients() == 1; }));
+
+    server->Push(DELTA);
+    REQUIRE(Paths(c.ReadMessage()).size() == 2);
+
+    // The delta documents are queued without serializing them again
+    Document d;
+    d.Parse(DELTA.c_str());
+    server->PushDocument(d, std::chrono::steady_clock::now());
+    REQUIRE(Paths(c.ReadMessage()).size() == 2);
+    REQUIRE(server->Delivered() == 2);
+}
+
+TEST_CASE("SignalK server filters the deltas by the subscriptions")
+{
+    auto server = StartServer();
+    REQUIRE(WaitFor([&]() { return server->Port() != 0; }));
+    TestClient c(server->Port());
+    REQUIRE(c.Upgrade("?subscribe=none").rfind("HTTP/1.1 101", 0) == 0);
+    REQUIRE_FALSE(c.ReadMessage().empty());
+    c.SendText(R"({"context":"vessels.self","subscribe":[)"
+               R"({"path":"environment.depth.*","policy":"instant"}]})");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    server->Push(DELTA);
+    REQUIRE(Paths(c.ReadMessage())
+        == std::vector<std::string> { "environment.depth.belowTransducer" });
+
+    // Only the latest value is sent once per period
+    c.SendText(R"({"context":"*","unsubscribe":[{"path":"*"}]})");
+    c.SendText(R"({"context":"vessels.self","subscribe":[)"
+               R"({"path":"navigation.speedOverGround","period":200}]})");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    server->Push(DELTA);
+    server->Push(DELTA);
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(Paths(c.ReadMessage())
+        == std::vector<std::string> { "navigation.speedOverGround" });
+    REQUIRE(std::chrono::steady_clock::now() - start
+        >= std::chrono::milliseconds(100));
+
+    // The per-target notifications are not registered but still delivered
+    c.SendText(R"({"context":"*","unsubscribe":[{"path":"*"}]})");
+    c.SendText(R"({"context":"vessels.self","subscribe":[)"
+               R"({"path":"notifications.*","period":200}]})");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const std::string path = "notifications.navigation.closestApproach."
+                             "urn:mrn:imo:mmsi:477553000";
+    server->Push(R"({"context":"vessels.self","updates":[{"values":[)"
+                 R"({"path":")"
+        + path + R"(","value":{"state":"normal"}}]}]})");
+    REQUIRE(Paths(c.ReadMessage()) == std::vector<std::string> { path });
+    REQUIRE(SKPaths::Find(path) == SKPaths::NONE);
+}
+
+TEST_CASE("SignalK server retries to listen when the port was taken")
+{
+    auto first = StartServer();
+    REQUIRE(WaitFor([&]() { return first->Port() != 0; }));
+    const uint16_t port = first->Port();
+    auto second = StartServer(nullptr, nullptr, port);
+    REQUIRE_FALSE(second->Opened());
+    REQUIRE(second->Errors() == 1);
+
+    first.reset();
+    const auto now = std::chrono::steady_clock::now();
+    // Not retried before the period passes
+    second->Tick(now);
+    REQUIRE_FALSE(second->Opened());
+    second->Tick(now + std::chrono::seconds(10));
+    REQUIRE(second->Opened());
+    TestClient c(port);
+    REQUIRE(c.Upgrade().rfind("HTTP/1.1 101", 0) == 0);
+}
+
+TEST_CASE("SignalK server serves many clients")
+{
+    auto server = StartServer();
+    REQUIRE(WaitFor([&]() { return server->Port() != 0; }));
+    std::vector<std::unique_ptr<TestClient>> clients;
+    for (int i = 0; i < 60; ++i) {
+        clients.push_back(std::make_unique<TestClient>(server->Port()));
+        REQUIRE(clients.back()->Upgrade().rfind("HTTP/1.1 101", 0) == 0);
+        REQUIRE_FALSE(clients.back()->ReadMessage().empty());
+    }
+    REQUIRE(WaitFor([&]() { return server->Clients() == 60; }));
+    server->Push(DELTA);
+    for (auto& c : clients) {
+        REQUIRE(Paths(c->ReadMessage()).size() == 2);
+    }
+    REQUIRE(server->ClientDrops() == 0);
+}
+
+#endif
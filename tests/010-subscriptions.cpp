@@ -0,0 +1,172 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include "sk_subscriptions.h"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+
+namespace {
+/// @brief Return whether the delta contains a value with the path
+bool HasPath(const Value& delta, const char* path)
+{
+    for (const auto& u : delta["updates"].GetArray()) {
+        for (const auto& v : u["values"].GetArray()) {
+            if (std::strcmp(v["path"].GetString(), path) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+}
+
+TEST_CASE("Everything is produced until somebody subscribes")
+{
+    SKSubscriptions s;
+    REQUIRE(s.Everything());
+    REQUIRE(s.Wanted("navigation.gnss.differentialReference"));
+    s.Subscribe("a", "environment.depth");
+    REQUIRE_FALSE(s.Everything());
+    REQUIRE(s.Wanted("environment.depth.belowKeel"));
+    REQUIRE_FALSE(s.Wanted("environment.depthAlarm"));
+    REQUIRE_FALSE(s.Wanted("navigation.gnss.differentialReference"));
+    REQUIRE(s.Skipped() == 2);
+    s.Subscribe("b", "navigation.*.differentialReference");
+    REQUIRE(s.Wanted("navigation.gnss.differentialReference"));
+    s.Subscribe("c", "*");
+    REQUIRE(s.Everything());
+    s.Unsubscribe("c", "*");
+    s.Unsubscribe("b", "navigation.*.differentialReference");
+    REQUIRE_FALSE(s.Wanted("navigation.gnss.differentialReference"));
+    s.Set("a", {});
+    REQUIRE(s.Consumers().empty());
+    REQUIRE(s.Everything());
+}
+
+TEST_CASE("Required paths are always produced")
+{
+    SKSubscriptions s;
+    s.Require("navigation.position");
+    REQUIRE(s.Everything());
+    s.Subscribe("a", "environment");
+    REQUIRE(s.Wanted(SKPaths::Id("navigation.position")));
+    REQUIRE_FALSE(s.Wanted(SKPaths::Id("navigation.log")));
+}
+
+TEST_CASE("Unsubscribed AIS values are not produced")
+{
+    NSK n;
+    n.SetAISFlushInterval(std::chrono::milliseconds(0));
+    n.ProcessSubscription(R"({"consumer":"test","subscribe":[)"
+                          R"({"path":"navigation.speedOverGround"}]})");
+    Document d;
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C", &d);
+    REQUIRE(d.IsArray());
+    REQUIRE(HasPath(d[0], "navigation.speedOverGround"));
+    REQUIRE_FALSE(HasPath(d[0], "navigation.state"));
+    REQUIRE_FALSE(HasPath(d[0], "sensors.ais.class"));
+
+    // Nothing wanted from the static data report
+    const auto total = n.SKTotal();
+    n.ProcessAISSentence(
+        "!AIVDM,1,1,,A,H42O55i18tMET00000000000000,2*6D", &d);
+    REQUIRE(n.SKTotal() == total);
+
+    n.ProcessSubscription(R"({"consumer":"test","unsubscribe":[)"
+                          R"({"path":"*"}]})");
+    REQUIRE(n.Subscriptions().Everything());
+}
+
+TEST_CASE("Unsubscribed NMEA values are not produced")
+{
+    NSK n;
+    n.ProcessSubscription(R"({"consumer":"test","subscribe":[)"
+                          R"({"path":"environment.depth"}]})");
+    Document d;
+    n.ProcessNMEASentence("$SDDBT,7.8,f,2.4,M,1.3,F*0D", &d);
+    REQUIRE(HasPath(d, "environment.depth.belowTransducer"));
+    d.SetNull();
+    const auto total = n.SKTotal();
+    n.ProcessNMEASentence("$IIMTW,17.5,C*10", &d);
+    REQUIRE(n.SKTotal() == total);
+    REQUIRE(d.IsNull());
+}
+
+TEST_CASE("Sinks without subscriptions get every path")
+{
+    NSK n;
+    std::vector<std::string> out;
+    n.Sinks().Add(std::make_unique<CallbackSink>(
+        sink_config(), [&](const std::string& b) {
+            out.push_back(b);
+            return true;
+        }));
+    n.ProcessSubscription(R"({"consumer":"test","subscribe":[)"
+                          R"({"path":"environment.depth"}]})");
+    Document d;
+    n.ProcessNMEASentence("$IIMTW,17.5,C*10", &d);
+    REQUIRE(n.Subscriptions().Consumers().count("plugin.test") == 1);
+    REQUIRE(out.size() == 1);
+    REQUIRE(out[0].find("environment.water.temperature") != std::string::npos);
+
+    // Another plugin unsubscribing does not touch the first one
+    n.ProcessSubscription(R"({"consumer":"other","unsubscribe":[)"
+                          R"({"path":"*"}]})");
+    REQUIRE(n.Subscriptions().Consumers().count("plugin.test") == 1);
+    REQUIRE(n.Subscriptions().Consumers().count("plugin.other") == 0);
+
+    // Without the sink only the subscribed paths are left
+    n.Sinks().Clear();
+    const auto total = n.SKTotal();
+    n.ProcessNMEASentence("$IIMTW,17.5,C*10", &d);
+    REQUIRE_FALSE(n.Subscriptions().Everything());
+    REQUIRE(n.SKTotal() == total);
+}
+
+#ifdef __linux__
+TEST_CASE("Subscriptions of the SignalK server clients are applied")
+{
+    SKSubscriptions subs;
+    OutputSinks sinks;
+    sink_config cfg;
+    cfg.type = "signalk";
+    cfg.host = "127.0.0.1";
+    cfg.port = 0;
+    sinks.Add(OutputSinks::Create(cfg));
+    sinks.UpdateSubscriptions(subs);
+    REQUIRE(subs.Everything());
+    REQUIRE(subs.Consumers().empty());
+    sinks.Clear();
+    sinks.UpdateSubscriptions(subs);
+    REQUIRE(subs.Consumers().empty());
+}
+#endif
@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include "source_priorities.h"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using namespace std::chrono_literals;
+
+TEST_CASE("Preferred source wins and fails over when silent")
+{
+    SourcePriorities p;
+    p.SetTimeout(5s);
+    p.Set("navigation.headingTrue", { "HCHDT", "VHW" });
+    const auto path = SKPaths::Id("navigation.headingTrue");
+    const auto hdt = p.Source("HCHDT");
+    const auto vhw = p.Source("VHW");
+    const auto rmc = p.Source("RMC");
+    REQUIRE(rmc == SourcePriorities::NONE);
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Whatever comes first is used until something better appears
+    REQUIRE(p.Accept(path, rmc, rmc, t0));
+    REQUIRE(p.Accept(path, p.Source("IIVHW"), vhw, t0 + 100ms));
+    REQUIRE_FALSE(p.Accept(path, rmc, rmc, t0 + 200ms));
+    REQUIRE(p.Accept(path, hdt, p.Source("HDT"), t0 + 300ms));
+    REQUIRE_FALSE(p.Accept(path, p.Source("IIVHW"), vhw, t0 + 400ms));
+    REQUIRE(p.Accept(path, hdt, p.Source("HDT"), t0 + 1s));
+    REQUIRE(p.Suppressed() == 2);
+
+    // The gyro went silent
+    REQUIRE_FALSE(p.Accept(path, rmc, rmc, t0 + 5s));
+    REQUIRE(p.Accept(path, p.Source("IIVHW"), vhw, t0 + 6100ms));
+    REQUIRE_FALSE(p.Accept(path, rmc, rmc, t0 + 6200ms));
+    REQUIRE(p.Accept(path, hdt, p.Source("HDT"), t0 + 7s));
+
+    // Other paths are not arbitrated
+    REQUIRE(p.Accept(
+        SKPaths::Id("navigation.position"), rmc, rmc, t0 + 7100ms));
+}
+
+TEST_CASE("Source priorities configuration round trip")
+{
+    SourcePriorities p;
+    Document d;
+    d.Parse(R"({"timeout":2.5,"paths":{"navigation.position":)"
+            R"(["GPGGA","GNGGA","RMC"]}})");
+    p.FromJSON(d);
+    REQUIRE_FALSE(p.Empty());
+    REQUIRE(p.Timeout() == 2500ms);
+    Document out;
+    out.SetObject();
+    Value v = p.ToJSON(out.GetAllocator());
+    REQUIRE(v["paths"]["navigation.position"].Size() == 3);
+    REQUIRE(v["paths"]["navigation.position"][1] == "GNGGA");
+    p.Set("navigation.position", {});
+    REQUIRE(p.Empty());
+}
+
+TEST_CASE("NSK emits only the preferred source")
+{
+    NSK n;
+    n.Priorities().Set("navigation.headingTrue", { "HDT" });
+    Document d;
+    n.ProcessNMEASentence("$HCHDT,123.456,T*2E", &d);
+    REQUIRE(d["updates"][0]["values"].Size() == 1);
+    const auto total = n.SKTotal();
+    n.ProcessNMEASentence(
+        "$IIVHW,245.1,T,245.1,M,000.01,N,000.01,K*55", &d);
+    REQUIRE(n.SKTotal() == total + 1);
+    for (const auto& v : d["updates"][0]["values"].GetArray()) {
+        REQUIRE(std::string(v["path"].GetString())
+            != "navigation.headingTrue");
+    }
+}
@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "derived_wind.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using namespace std::chrono_literals;
+using Catch::Approx;
+
+namespace {
+/// @brief Feed the apparent wind resulting from the true wind and boat speed
+void Apparent(DerivedWind& w, double twa, double tws, double stw,
+    std::chrono::steady_clock::time_point now)
+{
+    const double x = tws * std::cos(twa) + stw;
+    const double y = tws * std::sin(twa);
+    w.Set(DerivedWind::APPARENT_ANGLE, std::atan2(y, x), now);
+    w.Set(DerivedWind::APPARENT_SPEED, std::hypot(x, y), now);
+}
+}
+
+TEST_CASE("True wind is derived from the apparent wind")
+{
+    DerivedWind w;
+    const auto now = std::chrono::steady_clock::now();
+    w.Set(DerivedWind::SPEED_THROUGH_WATER, 3.0, now);
+    w.Set(DerivedWind::SPEED_OVER_GROUND, 3.0, now);
+    w.Set(DerivedWind::HEADING, deg2rad(90.0), now);
+    Apparent(w, deg2rad(-45.0), 8.0, 3.0, now);
+    REQUIRE(w.Compute(now));
+    REQUIRE(w.HasWater());
+    REQUIRE(w.HasGround());
+    REQUIRE(w.AngleTrueWater() == Approx(deg2rad(-45.0)));
+    REQUIRE(w.SpeedTrue() == Approx(8.0));
+    REQUIRE(w.AngleTrueGround() == Approx(deg2rad(-45.0)));
+    REQUIRE(w.SpeedOverGround() == Approx(8.0));
+    REQUIRE(w.DirectionTrue() == Approx(deg2rad(45.0)));
+
+    // Nothing changed, nothing is recomputed
+    REQUIRE_FALSE(w.Compute(now));
+    w.Set(DerivedWind::HEADING, deg2rad(90.0), now + 1s);
+    REQUIRE_FALSE(w.Compute(now + 1s));
+    w.Set(DerivedWind::HEADING, deg2rad(300.0), now + 1s);
+    REQUIRE(w.Compute(now + 1s));
+    REQUIRE(w.DirectionTrue() == Approx(deg2rad(255.0)));
+}
+
+TEST_CASE("Ground wind accounts for the current")
+{
+    DerivedWind w;
+    const auto now = std::chrono::steady_clock::now();
+    // Drifting sideways with the current, not moving through the water
+    w.Set(DerivedWind::SPEED_THROUGH_WATER, 0.0, now);
+    w.Set(DerivedWind::HEADING, 0.0, now);
+    w.Set(DerivedWind::COURSE_OVER_GROUND, deg2rad(90.0), now);
+    w.Set(DerivedWind::SPEED_OVER_GROUND, 1.0, now);
+    w.Set(DerivedWind::APPARENT_ANGLE, 0.0, now);
+    w.Set(DerivedWind::APPARENT_SPEED, 5.0, now);
+    REQUIRE(w.Compute(now));
+    REQUIRE(w.SpeedTrue() == Approx(5.0));
+    REQUIRE(w.SpeedOverGround() == Approx(std::hypot(5.0, 1.0)));
+    REQUIRE(w.AngleTrueGround() == Approx(std::atan2(-1.0, 5.0)));
+}
+
+TEST_CASE("Stale inputs are not used")
+{
+    DerivedWind w;
+    w.SetMaxAge(5s);
+    const auto now = std::chrono::steady_clock::now();
+    w.Set(DerivedWind::SPEED_THROUGH_WATER, 3.0, now);
+    w.Set(DerivedWind::APPARENT_ANGLE, 0.5, now + 10s);
+    w.Set(DerivedWind::APPARENT_SPEED, 5.0, now + 10s);
+    REQUIRE_FALSE(w.Compute(now + 10s));
+}
+
+TEST_CASE("Upwash correction")
+{
+    Document d;
+    d.Parse(R"({"upwash":[[30,4],[90,2],[180,0]]})");
+    DerivedWind w;
+    w.FromJSON(d);
+    const auto now = std::chrono::steady_clock::now();
+    w.Set(DerivedWind::SPEED_THROUGH_WATER, 0.0, now);
+    w.Set(DerivedWind::APPARENT_ANGLE, deg2rad(-60.0), now);
+    w.Set(DerivedWind::APPARENT_SPEED, 5.0, now);
+    REQUIRE(w.Compute(now));
+    REQUIRE(w.AngleTrueWater() == Approx(deg2rad(-63.0)));
+    // Port wind as reported by MWV (0 to 360 degrees)
+    w.Set(DerivedWind::APPARENT_ANGLE, deg2rad(300.0), now + 1s);
+    REQUIRE(w.Compute(now + 1s));
+    REQUIRE(w.AngleTrueWater() == Approx(deg2rad(-63.0)));
+    w.Set(DerivedWind::APPARENT_ANGLE, deg2rad(60.0), now + 1s);
+    REQUIRE(w.Compute(now + 1s));
+    REQUIRE(w.AngleTrueWater() == Approx(deg2rad(63.0)));
+
+    Document out;
+    out.SetObject();
+    Value v = w.ToJSON(out.GetAllocator());
+    REQUIRE(v["upwash"].Size() == 3);
+    REQUIRE(v["upwash"][1][0].GetDouble() == Approx(90.0));
+}
+
+TEST_CASE("NSK adds the derived wind to the delta")
+{
+    NSK n;
+    Document d;
+    n.ProcessNMEASentence(
+        "$IIVHW,245.1,T,245.1,M,000.01,N,000.01,K*55", &d);
+    n.ProcessNMEASentence("$WIMWV,045.0,R,10.0,M,A*10", &d);
+    REQUIRE(d["updates"].Size() == 2);
+    REQUIRE(d["updates"][1]["source"]["type"] == "derived");
+}
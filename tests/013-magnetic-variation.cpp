@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "magnetic_variation.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <sstream>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using Catch::Approx;
+
+namespace {
+/// Synthetic model with a tilted dipole
+const char* TILTED_DIPOLE = "    2025.0            TEST          11/13/2024\n"
+                            "  1  0  -30000.0       0.0        0.0        0.0\n"
+                            "  1  1       0.0    5000.0        0.0       10.0\n"
+                            "99999999999999999999999999999999999999999999\n";
+}
+
+TEST_CASE("Model coefficients are loaded")
+{
+    MagneticModel m;
+    REQUIRE_FALSE(m.Valid());
+    REQUIRE(std::isnan(m.Declination(0.0, 0.0, 0.0, 2025.0)));
+    std::istringstream in(TILTED_DIPOLE);
+    REQUIRE(m.Load(in));
+    REQUIRE(m.Valid());
+    REQUIRE(m.Name() == "TEST");
+    REQUIRE(m.Epoch() == Approx(2025.0));
+
+    std::istringstream bad("nonsense\n");
+    REQUIRE_FALSE(m.Load(bad));
+    REQUIRE(m.Name() == "TEST");
+}
+
+TEST_CASE("Declination of a dipole")
+{
+    MagneticModel m;
+    std::istringstream axial(
+        "2025.0 AXIAL 01/01/2025\n1 0 -30000.0 0.0 0.0 0.0\n9999\n");
+    REQUIRE(m.Load(axial));
+    REQUIRE(m.Declination(45.0, 10.0, 0.0, 2025.0) == Approx(0.0).margin(1e-9));
+    REQUIRE(m.Declination(-30.0, -120.0, 0.0, 2025.0)
+        == Approx(0.0).margin(1e-9));
+
+    std::istringstream tilted(TILTED_DIPOLE);
+    REQUIRE(m.Load(tilted));
+    REQUIRE(m.Declination(0.0, 0.0, 0.0, 2025.0)
+        == Approx(std::atan2(-5000.0, 30000.0)));
+    // Secular variation
+    REQUIRE(m.Declination(0.0, 0.0, 0.0, 2030.0)
+        == Approx(std::atan2(-5050.0, 30000.0)));
+    // The east component changes sign on the opposite side of the globe
+    REQUIRE(m.Declination(0.0, 180.0, 0.0, 2025.0)
+        == Approx(std::atan2(5000.0, 30000.0)));
+}
+
+TEST_CASE("Cached variation matches the model")
+{
+    MagneticVariation v;
+    REQUIRE(std::isnan(v.Variation(10.0, 10.0, 2025.0)));
+    std::istringstream in(TILTED_DIPOLE);
+    REQUIRE(v.Load(in));
+    for (double lat = -60.0; lat <= 60.0; lat += 7.3) {
+        for (double lon = -179.0; lon <= 179.0; lon += 11.7) {
+            REQUIRE(v.Variation(lat, lon, 2025.02)
+                == Approx(v.Model().Declination(lat, lon, 0.0, 2025.0))
+                       .margin(deg2rad(0.05)));
+        }
+    }
+    v.Variation(41.2, 16.7, 2025.0);
+    const auto misses = v.Misses();
+    v.Variation(41.8, 16.1, 2025.03);
+    REQUIRE(v.Misses() == misses);
+    REQUIRE(v.Hits() > 0);
+}
+
+TEST_CASE("Decimal year")
+{
+    // 2024-07-02 00:00:00 UTC, day 183 of a leap year
+    const auto t = std::chrono::system_clock::from_time_t(1719878400);
+    REQUIRE(MagneticVariation::DecimalYear(t)
+        == Approx(2024.0 + 183.0 / 366.0));
+}
+
+TEST_CASE("NSK derives the true heading")
+{
+    NSK n;
+    std::istringstream in(TILTED_DIPOLE);
+    REQUIRE(n.Magnetic().Load(in));
+    Document d;
+    n.ProcessNMEASentence("$GPGLL,5000.000,N,00000.000,E,120000,A,A*41", &d);
+    n.ProcessNMEASentence("$HCHDM,100.0,M*28", &d);
+    REQUIRE(d["updates"].Size() == 2);
+    const auto& derived = d["updates"][1]["values"];
+    REQUIRE(derived[0]["path"] == "navigation.magneticVariation");
+    REQUIRE(derived[1]["path"] == "navigation.headingTrue");
+    REQUIRE(derived[1]["value"].GetDouble()
+        == Approx(deg2rad(100.0) + derived[0]["value"].GetDouble()));
+}
@@ -0,0 +1,179 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "path_filters.h"
+#include "rapidjson/document.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using namespace std::chrono_literals;
+using Catch::Approx;
+
+TEST_CASE("Moving average weighs the samples by time")
+{
+    PathFilters f;
+    filter_config c;
+    c.type = filter_type::EMA;
+    c.time_constant = 1.0;
+    f.Set("navigation.speedOverGround", c);
+    const auto id = SKPaths::Find("navigation.speedOverGround");
+    const auto t = std::chrono::steady_clock::now();
+    REQUIRE(f.Apply(id, 2.0, t) == Approx(2.0));
+    REQUIRE(f.Apply(id, 4.0, t + 1s)
+        == Approx(2.0 + 2.0 * (1.0 - std::exp(-1.0))));
+    // Samples a long time apart are not damped
+    REQUIRE(f.Apply(id, 6.0, t + 60s) == Approx(6.0));
+    REQUIRE(f.Filtered() == 3);
+    // Other paths are passed through
+    const auto other = SKPaths::Id("navigation.speedThroughWater");
+    REQUIRE(f.Apply(other, 1.5, t) == 1.5);
+}
+
+TEST_CASE("Circular mean wraps around north")
+{
+    PathFilters f;
+    filter_config c;
+    c.type = filter_type::CIRCULAR;
+    c.time_constant = 1.0;
+    f.Set("navigation.headingTrue", c);
+    const auto id = SKPaths::Find("navigation.headingTrue");
+    auto t = std::chrono::steady_clock::now();
+    double v = 0.0;
+    for (int i = 0; i < 50; ++i) {
+        t += 100ms;
+        v = f.Apply(id, deg2rad(i % 2 ? 359.0 : 1.0), t);
+        REQUIRE(v >= 0.0);
+        REQUIRE(v < 2.0 * PI);
+        REQUIRE(std::abs(std::remainder(v, 2.0 * PI)) < deg2rad(1.01));
+    }
+
+    c.signed_angle = true;
+    f.Set("environment.wind.angleApparent", c);
+    const auto awa = SKPaths::Find("environment.wind.angleApparent");
+    REQUIRE(f.Apply(awa, deg2rad(179.0), t) == Approx(deg2rad(179.0)));
+    v = f.Apply(awa, deg2rad(-179.0), t + 10s);
+    REQUIRE(std::abs(v) > deg2rad(179.0));
+}
+
+TEST_CASE("Kalman filter converges")
+{
+    PathFilters f;
+    filter_config c;
+    c.type = filter_type::KALMAN;
+    c.angle = true;
+    c.process_noise = 0.0001;
+    c.measurement_noise = 0.01;
+    f.Set("navigation.headingTrue", c);
+    const auto id = SKPaths::Find("navigation.headingTrue");
+    auto t = std::chrono::steady_clock::now();
+    f.Apply(id, deg2rad(350.0), t);
+    double v = 0.0;
+    for (int i = 0; i < 100; ++i) {
+        t += 100ms;
+        v = f.Apply(id, deg2rad(i % 2 ? 8.0 : 12.0), t);
+    }
+    REQUIRE(v == Approx(deg2rad(10.0)).margin(deg2rad(1.0)));
+}
+
+TEST_CASE("Angular paths are filtered as angles by every filter")
+{
+    PathFilters f;
+    filter_config c;
+    c.type = filter_type::EMA;
+    c.time_constant = 1.0;
+    f.Set("navigation.headingTrue", c);
+    f.Set("environment.wind.angleApparent", c);
+    f.Set("navigation.speedOverGround", c);
+    const auto hdg = SKPaths::Find("navigation.headingTrue");
+    const auto awa = SKPaths::Find("environment.wind.angleApparent");
+    REQUIRE(f.Config(hdg).angle);
+    REQUIRE_FALSE(f.Config(hdg).signed_angle);
+    REQUIRE(f.Config(awa).angle);
+    REQUIRE(f.Config(awa).signed_angle);
+    REQUIRE_FALSE(
+        f.Config(SKPaths::Find("navigation.speedOverGround")).angle);
+
+    // The moving average does not swing around the circle
+    auto t = std::chrono::steady_clock::now();
+    f.Apply(hdg, deg2rad(359.0), t);
+    const double v = f.Apply(hdg, deg2rad(1.0), t + 1s);
+    REQUIRE(std::abs(std::remainder(v, 2.0 * PI)) < deg2rad(1.0));
+    f.Apply(awa, deg2rad(179.0), t);
+    REQUIRE(std::abs(f.Apply(awa, deg2rad(-179.0), t + 1s))
+        > deg2rad(179.0));
+
+    c.type = filter_type::KALMAN;
+    f.Set("navigation.headingTrue", c);
+    REQUIRE(f.Config(hdg).angle);
+}
+
+TEST_CASE("Filter configuration round trip")
+{
+    Document d;
+    d.Parse(R"({"paths": {"navigation.headingTrue": {"type": "circular",
+        "time_constant": 3.0, "raw": true}, "navigation.speedOverGround":
+        {"type": "kalman", "process_noise": 0.5}, "navigation.log":
+        {"type": "none"}}})");
+    PathFilters f;
+    f.FromJSON(d);
+    REQUIRE_FALSE(f.Empty());
+    const auto& hdg = f.Config(SKPaths::Find("navigation.headingTrue"));
+    REQUIRE(hdg.type == filter_type::CIRCULAR);
+    REQUIRE(hdg.angle);
+    REQUIRE(hdg.raw);
+    REQUIRE(hdg.time_constant == Approx(3.0));
+
+    Document out;
+    out.SetObject();
+    Value v = f.ToJSON(out.GetAllocator());
+    REQUIRE(v["paths"].MemberCount() == 2);
+    REQUIRE(v["paths"]["navigation.speedOverGround"]["type"] == "kalman");
+    REQUIRE(v["paths"]["navigation.speedOverGround"]["process_noise"]
+                .GetDouble()
+        == Approx(0.5));
+}
+
+TEST_CASE("NSK emits the raw and damped heading")
+{
+    NSK n;
+    filter_config c;
+    c.type = filter_type::CIRCULAR;
+    c.raw = true;
+    n.Filters().Set("navigation.headingTrue", c);
+    Document d;
+    n.ProcessNMEASentence("$HCHDT,359.0,T*26", &d);
+    n.ProcessNMEASentence("$HCHDT,001.0,T*28", &d);
+    REQUIRE(d["updates"].Size() == 2);
+    REQUIRE(d["updates"][0]["values"][0]["value"].GetDouble()
+        == Approx(deg2rad(1.0)));
+    REQUIRE(d["updates"][1]["source"]["type"] == "filtered");
+    REQUIRE(d["updates"][1]["values"][0]["path"] == "navigation.headingTrue");
+}
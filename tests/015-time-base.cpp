@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "time_base.h"
+#include "rapidjson/document.h"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using namespace std::chrono_literals;
+
+TEST_CASE("Civil dates are converted")
+{
+    REQUIRE(TimeBase::DaysFromCivil(1970, 1, 1) == 0);
+    REQUIRE(TimeBase::DaysFromCivil(2000, 3, 1) == 11017);
+    REQUIRE(TimeBase::DaysFromCivil(1969, 12, 31) == -1);
+    REQUIRE(TimeBase::Format(0) == "1970-01-01T00:00:00.000Z");
+    REQUIRE(TimeBase::Format(951782400000 + 3723004)
+        == "2000-02-29T01:02:03.004Z");
+    REQUIRE(TimeBase::Format(1792404000000) == "2026-10-19T10:00:00.000Z");
+}
+
+TEST_CASE("Live time follows the GNSS time")
+{
+    TimeBase t;
+    const auto now = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(t.Locked());
+    t.Sync(26, 10, 19, 36000000, now);
+    REQUIRE(t.Locked());
+    REQUIRE(t.Stamp(now) == "2026-10-19T10:00:00.000Z");
+    REQUIRE(t.Stamp(now + 250ms) == "2026-10-19T10:00:00.250Z");
+    REQUIRE(t.Stamp(now + 1500ms) == "2026-10-19T10:00:01.500Z");
+    // The latency jitter is smoothed and the stamps do not go back
+    t.Sync(2026, 10, 19, 36001000, now + 1800ms);
+    REQUIRE(t.Now(now + 1800ms) >= 1792404001500);
+    REQUIRE(t.Now(now + 1800ms) < 1792404001800);
+    // A step relocks
+    t.SyncTimeOfDay(36100000, now + 2s);
+    REQUIRE(t.Stamp(now + 2s) == "2026-10-19T10:01:40.000Z");
+}
+
+TEST_CASE("Time of the day picks the closest date")
+{
+    TimeBase t;
+    const auto now = std::chrono::steady_clock::now();
+    t.Sync(2026, 10, 19, 86399500, now);
+    t.SyncTimeOfDay(200, now + 700ms);
+    REQUIRE(t.Stamp(now + 700ms) == "2026-10-20T00:00:00.200Z");
+}
+
+TEST_CASE("Replay time holds the log time")
+{
+    TimeBase t;
+    t.SetMode(time_mode::REPLAY);
+    const auto now = std::chrono::steady_clock::now();
+    t.Sync(2024, 6, 1, 43200000, now);
+    REQUIRE(t.Stamp(now + 5s) == "2024-06-01T12:00:00.000Z");
+    t.Sync(2024, 6, 1, 43260000, now + 10ms);
+    REQUIRE(t.Stamp(now + 10ms) == "2024-06-01T12:01:00.000Z");
+    // Restarting the log goes back
+    t.Sync(2024, 6, 1, 43200000, now + 20ms);
+    REQUIRE(t.Stamp(now + 20ms) == "2024-06-01T12:00:00.000Z");
+}
+
+TEST_CASE("System time ignores the sentences")
+{
+    TimeBase t;
+    Document d;
+    d.Parse(R"({"mode": "system"})");
+    t.FromJSON(d);
+    REQUIRE(t.Mode() == time_mode::SYSTEM);
+    t.Sync(2000, 1, 1, 0, std::chrono::steady_clock::now());
+    REQUIRE_FALSE(t.Locked());
+    Document out;
+    REQUIRE(t.ToJSON(out.GetAllocator())["mode"] == "system");
+}
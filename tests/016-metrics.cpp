@@ -0,0 +1,110 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "metrics.h"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <thread>
+
+using namespace NSKPlugin;
+using namespace std::chrono_literals;
+
+TEST_CASE("Latency percentiles")
+{
+    latency_histogram h;
+    REQUIRE(h.Percentile(50.0) == 0ns);
+    for (int i = 0; i < 98; ++i) {
+        h.Record(1500ns);
+    }
+    h.Record(100us);
+    h.Record(5ms);
+    REQUIRE(h.Count() == 100);
+    REQUIRE(h.Percentile(50.0) == 2048ns);
+    REQUIRE(h.Percentile(99.0) == 131072ns);
+    REQUIRE(h.Percentile(100.0) == 8388608ns);
+}
+
+TEST_CASE("Sentences are counted by tag")
+{
+    PipelineMetrics m;
+    m.CountSentence("$GPGGA,1");
+    m.CountSentence("$GNGGA,1");
+    m.CountSentence("!AIVDM,1");
+    m.CountSentence("$GP");
+    const auto& live = m.Live();
+    REQUIRE(live.sentence_count == 2);
+    REQUIRE(std::strcmp(live.sentences[0].tag, "GGA") == 0);
+    REQUIRE(live.sentences[0].count == 2);
+    REQUIRE(std::strcmp(live.sentences[1].tag, "VDM") == 0);
+}
+
+TEST_CASE("Snapshots are published periodically")
+{
+    PipelineMetrics m;
+    const auto now = std::chrono::steady_clock::now();
+    REQUIRE(m.Due(now));
+    m.Live().nmea_total = 10;
+    m.Publish(now);
+    m.Live().nmea_total = 20;
+    REQUIRE_FALSE(m.Due(now + 100ms));
+    REQUIRE(m.Snapshot().nmea_total == 10);
+    REQUIRE(m.Due(now + PipelineMetrics::PUBLISH_INTERVAL));
+    m.Publish(now + PipelineMetrics::PUBLISH_INTERVAL);
+    REQUIRE(m.Snapshot().nmea_total == 20);
+}
+
+TEST_CASE("Seqlock readers see consistent values")
+{
+    struct pair {
+        uint64_t a;
+        uint64_t b[15];
+    };
+    Seqlock<pair> lock;
+    std::atomic<bool> stop { false };
+    std::atomic<uint64_t> torn { 0 };
+    std::thread reader([&] {
+        while (!stop) {
+            const pair p = lock.Load();
+            for (auto b : p.b) {
+                torn += b != p.a;
+            }
+        }
+    });
+    for (uint64_t i = 1; i <= 100000; ++i) {
+        pair p;
+        p.a = i;
+        for (auto& b : p.b) {
+            b = i;
+        }
+        lock.Store(p);
+    }
+    stop = true;
+    reader.join();
+    REQUIRE(torn == 0);
+    REQUIRE(lock.Load().a == 100000);
+    REQUIRE(lock.Version() == 100001);
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "traffic_stats.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <string>
+
+using namespace NSKPlugin;
+using namespace std::chrono_literals;
+using Catch::Approx;
+
+TEST_CASE("Traffic is counted per talker and tag")
+{
+    TrafficStats t;
+    const auto now = std::chrono::steady_clock::now();
+    const auto gga = t.Sentence("$GPGGA,123519,4807.038,N", now);
+    const auto hdt = t.Sentence("$HCHDT,1.0,T*00", now);
+    REQUIRE(t.Sentence("$GPGGA,", now + 1s) == gga);
+    REQUIRE(t.Sentence("$GNGGA,", now + 1s) != gga);
+    REQUIRE(t.Sentence("$", now) == TrafficStats::NONE);
+    t.Error(hdt);
+    t.Values(gga, 3);
+    t.Values(TrafficStats::NONE, 3);
+    const auto& live = t.Live();
+    REQUIRE(live.size == 3);
+    REQUIRE(std::strcmp(live.entries[gga].name, "GPGGA") == 0);
+    REQUIRE(live.entries[gga].count == 2);
+    REQUIRE(live.entries[gga].values == 3);
+    REQUIRE(live.entries[hdt].errors == 1);
+}
+
+TEST_CASE("Inter-arrival mean, jitter and rate")
+{
+    TrafficStats t;
+    auto now = std::chrono::steady_clock::now();
+    size_t id = 0;
+    for (int i = 0; i < 200; ++i) {
+        now += i % 2 ? 90ms : 110ms;
+        id = t.Sentence("$IIMWV,045.0,R", now);
+    }
+    const auto& e = t.Live().entries[id];
+    REQUIRE(e.interval == Approx(0.1).margin(0.005));
+    REQUIRE(e.jitter == Approx(0.01).margin(0.002));
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch())
+                        .count();
+    REQUIRE(e.Rate(ms) == Approx(10.0).margin(0.5));
+    // A silent talker fades
+    REQUIRE(e.Rate(ms + 10000) == Approx(0.1));
+}
+
+TEST_CASE("Traffic table has a fixed capacity")
+{
+    TrafficStats t;
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < traffic_snapshot::CAPACITY + 5; ++i) {
+        t.Sentence("$P" + std::to_string(1000 + i) + ",", now);
+    }
+    REQUIRE(t.Live().size == traffic_snapshot::CAPACITY);
+    REQUIRE(t.Live().overflow == 5);
+    t.Publish(now);
+    REQUIRE(t.Snapshot().size == traffic_snapshot::CAPACITY);
+}
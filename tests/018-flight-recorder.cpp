@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "flight_recorder.h"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace NSKPlugin;
+
+TEST_CASE("Flight recorder keeps the last sentences")
+{
+    FlightRecorder r(4);
+    REQUIRE(r.Records().empty());
+    r.Delta("{}");
+    for (int i = 0; i < 6; ++i) {
+        r.Record("$IIDBT,," + std::to_string(i), 1000 * i);
+    }
+    const auto records = r.Records();
+    REQUIRE(records.size() == 4);
+    REQUIRE(records.front().Sentence() == "$IIDBT,,2");
+    REQUIRE(records.front().time == 2000);
+    REQUIRE(records.back().Sentence() == "$IIDBT,,5");
+    REQUIRE(records.back().sequence == 5);
+}
+
+TEST_CASE("Deltas are attached to the last sentence")
+{
+    FlightRecorder r(8);
+    r.Record("$IIDBT,1", 0);
+    r.Record("!AIVDM,1", 0);
+    r.Delta("{\"a\":1}");
+    r.Delta("{\"b\":2}");
+    const auto records = r.Records();
+    REQUIRE(records[0].delta_size == 0);
+    REQUIRE(records[0].delta_hash == 0);
+    REQUIRE(records[1].delta_size == 14);
+    const auto first = FlightRecorder::Hash("{\"a\":1}");
+    REQUIRE(records[1].delta_hash == FlightRecorder::Hash("{\"b\":2}", first));
+}
+
+TEST_CASE("Long sentences are truncated")
+{
+    FlightRecorder r(2);
+    r.Record(std::string(200, 'x'), 0);
+    REQUIRE(r.Records()[0].length == flight_record::MAX_SENTENCE);
+}
+
+TEST_CASE("Dump is read back")
+{
+    FlightRecorder r(8);
+    r.Record("$IIDBT,7.8,f,2.4,M,1.3,F*0D", 1792404000123);
+    r.Delta("{\"updates\":[]}");
+    r.Record("$IIMTW,17.5,C*10", 1792404000500);
+    std::stringstream dump;
+    REQUIRE(r.Dump(dump) == 2);
+    REQUIRE(dump.str().compare(0, 30, "#NSK 2026-10-19T10:00:00.123Z ") == 0);
+    const auto records = FlightRecorder::Load(dump);
+    REQUIRE(records.size() == 2);
+    REQUIRE(records[0].Sentence() == "$IIDBT,7.8,f,2.4,M,1.3,F*0D");
+    REQUIRE(records[0].time == 1792404000123);
+    REQUIRE(records[0].delta_size == 14);
+    REQUIRE(records[0].delta_hash == FlightRecorder::Hash("{\"updates\":[]}"));
+    REQUIRE(records[1].Sentence() == "$IIMTW,17.5,C*10");
+    REQUIRE(records[1].delta_size == 0);
+
+    std::istringstream plain("$IIMTW,17.5,C*10\r\n# comment\r\n\r\n");
+    REQUIRE(FlightRecorder::Load(plain).size() == 1);
+}
+
+TEST_CASE("Flight recorder can be dumped while recording")
+{
+    FlightRecorder r(64);
+    std::atomic<bool> stop { false };
+    std::thread writer([&] {
+        for (int64_t i = 0; !stop; ++i) {
+            const std::string stc = "$IIXDR," + std::to_string(i);
+            r.Record(stc, i);
+        }
+    });
+    for (int i = 0; i < 200; ++i) {
+        for (const auto& rec : r.Records()) {
+            REQUIRE(rec.Sentence() == "$IIXDR," + std::to_string(rec.time));
+        }
+    }
+    stop = true;
+    writer.join();
+}
@@ -0,0 +1,191 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_logger.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace NSKPlugin;
+
+namespace {
+constexpr int64_t T0 = 1792404000000; // 2026-10-19T10:00:00Z
+
+logger_config TestConfig()
+{
+    logger_config cfg;
+    cfg.enabled = true;
+    cfg.directory = "./";
+    cfg.block_bytes = 1024;
+    cfg.flush_interval = std::chrono::milliseconds(50);
+    return cfg;
+}
+
+void RemoveSegment(const std::string& segment)
+{
+    std::remove(segment.c_str());
+    std::remove(NMEALogger::IndexPath(segment).c_str());
+}
+}
+
+TEST_CASE("Logged sentences are read back")
+{
+    NMEALogger logger;
+    logger.Configure(TestConfig());
+    REQUIRE(logger.Running());
+    for (int i = 0; i < 100; ++i) {
+        logger.Log("$IIDBT,7.8,f,2.4,M,1.3,F*0D", T0 + 100 * i);
+    }
+    logger.Flush();
+    REQUIRE(logger.Logged() == 100);
+    REQUIRE(logger.Written() == 100);
+    REQUIRE(logger.Dropped() == 0);
+    const std::string segment = logger.Segment();
+    REQUIRE(segment
+        == std::string("./nmea-20261019T100000Z") + NMEALogger::Extension());
+    logger.Stop();
+
+    const auto index = NMEALogger::Index(segment);
+    // The blocks are 1 kB, so the sentences are split over several of them
+    REQUIRE(index.size() > 2);
+    REQUIRE(index.front().time == T0);
+    REQUIRE(index.front().offset == 0);
+    uint32_t count = 0;
+    for (const auto& e : index) {
+        count += e.count;
+    }
+    REQUIRE(count == 100);
+
+    const auto all = NMEALogger::Read(segment);
+    REQUIRE(all.size() == 100);
+    REQUIRE(all[42].time == T0 + 4200);
+    REQUIRE(all[42].sentence == "$IIDBT,7.8,f,2.4,M,1.3,F*0D");
+
+    const auto range = NMEALogger::Read(segment, T0 + 5000, T0 + 5999);
+    REQUIRE(range.size() == 10);
+    REQUIRE(range.front().time == T0 + 5000);
+    REQUIRE(range.back().time == T0 + 5900);
+    RemoveSegment(segment);
+}
+
+TEST_CASE("Segments rotate by time")
+{
+    auto cfg = TestConfig();
+    cfg.segment_duration = std::chrono::seconds(60);
+    cfg.segments = 1;
+    NMEALogger logger;
+    logger.Configure(cfg);
+    logger.Log("$IIMTW,17.5,C*10", T0);
+    logger.Flush();
+    const std::string first = logger.Segment();
+    logger.Log("$IIMTW,17.6,C*13", T0 + 61000);
+    logger.Flush();
+    const std::string second = logger.Segment();
+    logger.Stop();
+    REQUIRE(logger.Segments() == 2);
+    REQUIRE(first != second);
+    // Only the last segment is kept
+    REQUIRE_FALSE(std::ifstream(first).is_open());
+    const auto read = NMEALogger::Read(second);
+    REQUIRE(read.size() == 1);
+    REQUIRE(read[0].sentence == "$IIMTW,17.6,C*13");
+    RemoveSegment(second);
+}
+
+TEST_CASE("Segments of the earlier runs count towards the limit")
+{
+    const std::string ext = NMEALogger::Extension();
+    const std::vector<std::string> old { "./nmea-20261019T080000Z" + ext,
+        "./nmea-20261019T090000Z" + ext, "./nmea-20261019T090000Z-1" + ext };
+    for (const auto& segment : old) {
+        std::ofstream(segment) << "";
+        std::ofstream(NMEALogger::IndexPath(segment)) << "";
+    }
+    auto cfg = TestConfig();
+    cfg.segments = 2;
+    NMEALogger logger;
+    logger.Configure(cfg);
+    // The oldest segment is removed right away
+    REQUIRE_FALSE(std::ifstream(old[0]).is_open());
+    REQUIRE_FALSE(std::ifstream(NMEALogger::IndexPath(old[0])).is_open());
+    REQUIRE(std::ifstream(old[1]).is_open());
+    logger.Log("$IIMTW,17.5,C*10", T0);
+    logger.Flush();
+    const std::string segment = logger.Segment();
+    logger.Stop();
+    REQUIRE_FALSE(std::ifstream(old[1]).is_open());
+    REQUIRE(std::ifstream(old[2]).is_open());
+    REQUIRE(NMEALogger::Read(segment).size() == 1);
+    RemoveSegment(old[2]);
+    RemoveSegment(segment);
+}
+
+TEST_CASE("Sentences that can't be written are dropped")
+{
+    auto cfg = TestConfig();
+    cfg.directory = "./nsk-no-such-directory/";
+    NMEALogger logger;
+    logger.Configure(cfg);
+    for (int i = 0; i < 10; ++i) {
+        logger.Log("$IIMTW,17.5,C*10", T0 + i);
+    }
+    logger.Flush();
+    REQUIRE(logger.Logged() == 10);
+    REQUIRE(logger.Written() == 0);
+    REQUIRE(logger.Dropped() == 10);
+    REQUIRE(logger.Errors() == 1);
+}
+
+TEST_CASE("Disabled logger does nothing")
+{
+    NMEALogger logger;
+    logger.SetDefaultDirectory("./");
+    logger.Configure(logger_config());
+    REQUIRE_FALSE(logger.Running());
+    logger.Log("$IIMTW,17.5,C*10", T0);
+    logger.Flush();
+    REQUIRE(logger.Logged() == 0);
+    REQUIRE(logger.Segment().empty());
+}
+
+TEST_CASE("Logger configuration round trips")
+{
+    auto cfg = TestConfig();
+    cfg.segments = 7;
+    cfg.level = 9;
+    rapidjson::Document d;
+    d.SetObject();
+    auto v = cfg.ToJSON(d.GetAllocator());
+    const auto back = logger_config::FromJSON(v);
+    REQUIRE(back.enabled);
+    REQUIRE(back.directory == "./");
+    REQUIRE(back.block_bytes == 1024);
+    REQUIRE(back.flush_interval == std::chrono::milliseconds(50));
+    REQUIRE(back.segments == 7);
+    REQUIRE(back.level == 9);
+}
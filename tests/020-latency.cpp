@@ -0,0 +1,266 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+// End-to-end latency of the conversion, from the sentence entering
+// NSK::ProcessNMEASentence to the delta leaving through SendPluginMessage,
+// including the batching of the sinks and the hand over to their worker
+// threads. Every sentence carries its sequence number in the value, so the
+// deltas can be matched to the sentences however they are batched.
+
+#include "metrics.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/document.h"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+using namespace NSKPlugin;
+using namespace rapidjson;
+using namespace std::chrono_literals;
+
+namespace {
+/// Input load
+struct load_profile {
+    /// Name of the profile
+    const char* name;
+    /// Number of the sentences sent
+    size_t sentences;
+    /// Number of the sentences sent back to back
+    size_t burst;
+    /// Time between the bursts
+    std::chrono::microseconds period;
+};
+
+/// Steady 200 sentences per second
+constexpr load_profile CONSTANT { "constant 200/s", 200, 1, 5000us };
+/// The same amount of sentences in bursts of 50
+constexpr load_profile BURSTY { "bursts of 50 every 250 ms", 200, 50, 250ms };
+
+/// Path carrying the sequence number
+constexpr const char* PATH = "environment.water.temperature";
+
+/// @brief Return the MTW sentence with the sequence number in the temperature
+std::string Sentence(size_t seq)
+{
+    char body[32];
+    std::snprintf(body, sizeof(body), "IIMTW,%.2f,C", 10.0 + seq * 0.01);
+    uint8_t checksum = 0;
+    for (const char* c = body; *c != '\0'; ++c) {
+        checksum ^= static_cast<uint8_t>(*c);
+    }
+    char stc[48];
+    std::snprintf(stc, sizeof(stc), "$%s*%02X", body, checksum);
+    return stc;
+}
+
+/// @brief Return the sequence number of the temperature in Kelvin
+size_t Sequence(double kelvin)
+{
+    return static_cast<size_t>(std::lround((kelvin - 273.15 - 10.0) * 100));
+}
+
+/// Latencies measured in a run
+struct latency_report {
+    /// Number of the sentences sent
+    size_t sent = 0;
+    /// Number of the plugin messages captured
+    size_t messages = 0;
+    /// Number of the deltas of the sentences received more than once
+    size_t duplicates = 0;
+    /// Latency of every delta received
+    std::vector<std::chrono::nanoseconds> samples;
+    /// Distribution of the latencies
+    latency_histogram histogram;
+
+    /// @brief Return the exact percentile
+    std::chrono::nanoseconds Percentile(double p) const
+    {
+        if (samples.empty()) {
+            return {};
+        }
+        const auto rank = static_cast<size_t>(
+            std::ceil(p / 100.0 * static_cast<double>(samples.size())));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    }
+
+    /// @brief Print the percentiles and the histogram
+    void Print(const std::string& name) const
+    {
+        const auto us = [](std::chrono::nanoseconds d) {
+            return std::chrono::duration<double, std::micro>(d).count();
+        };
+        std::printf("%s: %zu sentences, %zu deltas in %zu messages\n",
+            name.c_str(), sent, samples.size(), messages);
+        std::printf("  p50 %.0f us, p90 %.0f us, p99 %.0f us, p99.9 %.0f us, "
+                    "max %.0f us\n",
+            us(Percentile(50)), us(Percentile(90)), us(Percentile(99)),
+            us(Percentile(99.9)), us(Percentile(100)));
+        for (size_t i = 0; i < latency_histogram::BUCKETS; ++i) {
+            if (histogram.buckets[i] != 0) {
+                std::printf("  < %10.0f us %6llu\n",
+                    us(std::chrono::nanoseconds(2ll << i)),
+                    static_cast<unsigned long long>(histogram.buckets[i]));
+            }
+        }
+        std::fflush(stdout);
+    }
+};
+
+/// @brief Return whether every delta accepted by the sinks left them
+bool Drained(NSK& nsk)
+{
+    for (const auto& sink : nsk.Sinks().Sinks()) {
+        if (sink->Delivered() + sink->Dropped() < sink->Accepted()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Feed the sentences to NSK following the profile and match the
+/// captured deltas to them
+latency_report Run(NSK& nsk, const load_profile& profile)
+{
+    latency_report report;
+    report.sent = profile.sentences;
+    std::vector<std::chrono::steady_clock::time_point> sent(profile.sentences);
+    std::vector<bool> received(profile.sentences, false);
+
+    StartCapturingMessages();
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < profile.sentences; ++i) {
+        if (i != 0 && i % profile.burst == 0) {
+            next += profile.period;
+            std::this_thread::sleep_until(next);
+        }
+        const std::string stc = Sentence(i);
+        sent[i] = std::chrono::steady_clock::now();
+        nsk.ProcessNMEASentence(stc);
+    }
+    // The batches still being built are sent by the next sentence or tick
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (!Drained(nsk) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+        nsk.Sinks().Tick();
+    }
+    const auto messages = StopCapturingMessages();
+
+    report.messages = messages.size();
+    for (const auto& m : messages) {
+        Document d;
+        d.Parse(m.message_body.c_str());
+        if (d.HasParseError()) {
+            continue;
+        }
+        const auto match = [&](const Value& delta) {
+            if (!delta.IsObject() || !delta.HasMember("updates")) {
+                return;
+            }
+            for (const auto& update : delta["updates"].GetArray()) {
+                for (const auto& v : update["values"].GetArray()) {
+                    if (v["path"] != PATH || !v["value"].IsNumber()) {
+                        continue;
+                    }
+                    const size_t seq = Sequence(v["value"].GetDouble());
+                    if (seq >= sent.size()) {
+                        continue;
+                    }
+                    if (received[seq]) {
+                        ++report.duplicates;
+                        continue;
+                    }
+                    received[seq] = true;
+                    const auto latency = m.time - sent[seq];
+                    report.samples.push_back(latency);
+                    report.histogram.Record(latency);
+                }
+            }
+        };
+        if (d.IsArray()) {
+            for (const auto& delta : d.GetArray()) {
+                match(delta);
+            }
+        } else {
+            match(d);
+        }
+    }
+    std::sort(report.samples.begin(), report.samples.end());
+    return report;
+}
+
+/// @brief Run the profile and check that every sentence made it through
+void Measure(NSK& nsk, const std::string& sinks, const load_profile& profile)
+{
+    const auto report = Run(nsk, profile);
+    report.Print(sinks + ", " + profile.name);
+    REQUIRE(report.samples.size() == report.sent);
+    REQUIRE(report.duplicates == 0);
+    REQUIRE(report.histogram.Count() == report.sent);
+    REQUIRE(report.Percentile(50) <= report.Percentile(99));
+    REQUIRE(report.Percentile(99) <= report.Percentile(100));
+}
+}
+
+TEST_CASE("Latency of the immediate delivery", "[latency]")
+{
+    NSK nsk;
+    SECTION("Constant load") { Measure(nsk, "immediate", CONSTANT); }
+    SECTION("Bursty load") { Measure(nsk, "immediate", BURSTY); }
+}
+
+TEST_CASE("Latency of the batched delivery", "[latency]")
+{
+    NSK nsk;
+    sink_config cfg;
+    cfg.batch = 20;
+    cfg.interval = 50ms;
+    nsk.Sinks().Clear();
+    nsk.Sinks().Add(OutputSinks::Create(cfg));
+    SECTION("Constant load") { Measure(nsk, "batched", CONSTANT); }
+    SECTION("Bursty load") { Measure(nsk, "batched", BURSTY); }
+}
+
+TEST_CASE("Latency of the delivery from a worker thread", "[latency]")
+{
+    NSK nsk;
+    sink_config cfg;
+    cfg.batch = 20;
+    cfg.interval = 20ms;
+    nsk.Sinks().Clear();
+    nsk.Sinks().Add(std::make_unique<CallbackSink>(
+        cfg,
+        [](const std::string& data) {
+            SendPluginMessage("NSK_PI_SIGNALK", data);
+            return true;
+        },
+        true));
+    SECTION("Constant load") { Measure(nsk, "worker thread", CONSTANT); }
+    SECTION("Bursty load") { Measure(nsk, "worker thread", BURSTY); }
+}
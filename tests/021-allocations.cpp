@@ -0,0 +1,167 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+// Heap allocations made by the conversion of a sentence once NSK is warmed
+// up. Allocation churn is the main cost of the conversion, so the count is
+// tracked per sentence type against a budget, which is to be lowered as the
+// handlers in src/nsk.cpp stop allocating, zero being the goal.
+
+#include "alloc_counter.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <vector>
+
+using namespace NSKPlugin;
+
+namespace {
+/// Maximum heap allocations allowed per sentence in the steady state
+constexpr uint64_t ALLOCATION_BUDGET = 64;
+/// Sentences converted before the counting starts
+constexpr int WARMUP = 20;
+/// Sentences counted
+constexpr int ROUNDS = 100;
+
+/// Sentence of a supported type
+struct sample {
+    const char* type;
+    const char* sentence;
+};
+
+// clang-format off
+const sample SAMPLES[] = {
+    { "GGA", "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47" },
+    { "GLL", "$GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41" },
+    { "GSA", "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39" },
+    { "GSV", "$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75" },
+    { "RMC", "$GPRMC,120000,A,4734.970,N,12221.000,W,10.0,090.0,191026,,,A*5C" },
+    { "VTG", "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25" },
+    { "DBT", "$SDDBT,7.8,f,2.4,M,1.3,F*0D" },
+    { "DBK", "$SDDBK,7.2,f,2.2,M,1.2,F*1F" },
+    { "DSC", "$CDDSC,20,3380210040,00,21,26,1394807410,2231,,,B,E*75" },
+    { "DPT", "$IIDPT,2.4,0.5*43" },
+    { "GNS", "$GPGNS,224749.00,3333.4268304,N,11153.3538273,W,D,19,0.6,406.110,-26.294,6.0,0138*15" },
+    { "HDG", "$HCHDG,98.3,0.0,E,12.6,W*57" },
+    { "HDM", "$HCHDM,100.0,M*28" },
+    { "HDT", "$HCHDT,123.456,T*2E" },
+    { "HSC", "$IIHSC,040.0,T,039.0,M*4F" },
+    { "MTA", "$IIMTA,17.5,C*06" },
+    { "MTW", "$IIMTW,17.5,C*10" },
+    { "MWD", "$WIMWD,270.0,T,268.0,M,10.0,N,5.1,M*66" },
+    { "MWV", "$WIMWV,045.0,R,10.0,M,A*10" },
+    { "RMB", "$GPRMB,A,0.66,L,003,004,4917.24,N,12309.57,W,001.3,052.5,000.5,V*20" },
+    { "ROT", "$HCROT,-12.3,A*30" },
+    { "RPM", "$IIRPM,E,1,1500.0,10.5,A*56" },
+    { "RSA", "$IIRSA,10.5,A,,V*4D" },
+    { "VDR", "$IIVDR,10.1,T,12.3,M,1.2,N*3A" },
+    { "VHW", "$IIVHW,245.1,T,245.1,M,000.01,N,000.01,K*55" },
+    { "VLW", "$IIVLW,7803.2,N,0.00,N*43" },
+    { "VPW", "$IIVPW,4.5,N,2.3,M*52" },
+    { "VWR", "$IIVWR,75,R,1.0,N,0.51,M,1.85,K*6C" },
+    { "XTE", "$GPXTE,A,A,0.67,L,N*6F" },
+    { "ZDA", "$GPZDA,160012.71,11,03,2004,-1,00*7D" },
+    { "BOD", "$GPBOD,099.3,T,105.6,M,POINTB,POINTA*45" },
+    { "BWC", "$GPBWC,220516,5130.02,N,00046.34,W,213.8,T,218.0,M,0004.6,N,EGLM*21" },
+    { "BWR", "$GPBWR,225444,4917.24,N,12309.57,W,051.9,T,031.6,M,001.3,N,004*38" },
+    { "APB", "$GPAPB,A,A,0.10,R,N,V,V,011,M,DEST,011,M,011,M*3C" },
+    { "VDM", "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C" },
+};
+// clang-format on
+
+/// Allocations measured for a sentence type
+struct allocation_result {
+    const char* type;
+    /// Whether the sample was converted (rather than rejected)
+    bool converted;
+    /// Heap allocations per sentence, rounded up
+    uint64_t per_sentence;
+};
+
+/// @brief Convert the sample, counting the allocations
+uint64_t Convert(NSK& nsk, const sample& s, int rounds)
+{
+    const std::string stc = s.sentence;
+    AllocationCounter counter;
+    for (int i = 0; i < rounds; ++i) {
+        if (stc[0] == '!') {
+            nsk.ProcessAISSentence(stc);
+        } else {
+            nsk.ProcessNMEASentence(stc);
+        }
+    }
+    return counter.Count();
+}
+
+/// @brief Measure the allocations of all the supported types and print them
+std::vector<allocation_result> Measure()
+{
+    NSK nsk;
+    std::vector<allocation_result> results;
+    std::printf("Heap allocations per sentence (%s counted):\n",
+        CountsMalloc() ? "malloc and operator new" : "operator new");
+    for (const auto& s : SAMPLES) {
+        const size_t unknown = nsk.TotalUnknown();
+        Convert(nsk, s, WARMUP);
+        const uint64_t count = Convert(nsk, s, ROUNDS);
+        results.push_back({ s.type, nsk.TotalUnknown() == unknown,
+            (count + ROUNDS - 1) / ROUNDS });
+        std::printf("  %s %6llu%s\n", s.type,
+            static_cast<unsigned long long>(results.back().per_sentence),
+            results.back().converted ? "" : " (rejected)");
+    }
+    std::fflush(stdout);
+    return results;
+}
+}
+
+TEST_CASE("Allocation counter counts the allocations", "[allocations]")
+{
+    AllocationCounter counter;
+    auto p = std::make_unique<int>(42);
+    std::vector<int> v(16);
+    REQUIRE(counter.Count() == 2);
+}
+
+TEST_CASE("Sentences are converted within the allocation budget",
+    "[allocations]")
+{
+    for (const auto& r : Measure()) {
+        INFO(r.type << ": " << r.per_sentence << " allocations per sentence");
+        // A rejected sample would measure the error path instead
+        CHECK(r.converted);
+        CHECK(r.per_sentence <= ALLOCATION_BUDGET);
+    }
+}
+
+TEST_CASE("Sentences are converted without allocations",
+    "[allocations][!mayfail]")
+{
+    for (const auto& r : Measure()) {
+        INFO(r.type << ": " << r.per_sentence << " allocations per sentence");
+        CHECK(r.per_sentence == 0);
+    }
+}
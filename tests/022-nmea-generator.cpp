@@ -0,0 +1,187 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "ais.h"
+#include "nmea_generator.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+#include <set>
+
+using namespace NSKPlugin;
+using Catch::Approx;
+
+namespace {
+/// @brief Return the sentence tag
+std::string Tag(const std::string& stc) { return stc.substr(3, 3); }
+
+/// @brief Generate the sentences of the simulated seconds
+std::vector<generated_sentence> Generate(
+    const generator_config& cfg, int seconds)
+{
+    NMEAGenerator gen(cfg);
+    std::vector<generated_sentence> out;
+    gen.Until(cfg.start + seconds * 1000 - 1, out);
+    return out;
+}
+}
+
+TEST_CASE("Every supported sentence is generated with a valid checksum")
+{
+    const auto out = Generate(generator_config::AllSentences(), 10);
+    std::set<std::string> tags;
+    for (const auto& g : out) {
+        INFO(g.sentence);
+        REQUIRE(NMEAGenerator::Valid(g.sentence));
+        tags.insert(Tag(g.sentence));
+    }
+    REQUIRE(tags.size() == NMEAGenerator::Tags().size());
+}
+
+TEST_CASE("Sentences follow their rates and talkers")
+{
+    generator_config cfg;
+    cfg.sentences = { { "HDT", { "HE", "GP" }, 10.0 },
+        { "DBT", { "SD" }, 1.0 }, { "GSV", { "GP" }, 1.0 },
+        { "VDM", { "AI" }, 0.5 } };
+    cfg.ais_targets = 4;
+    std::map<std::string, int> counts;
+    int64_t last = 0;
+    for (const auto& g : Generate(cfg, 10)) {
+        REQUIRE(g.time >= last);
+        last = g.time;
+        ++counts[g.sentence.substr(1, 5)];
+    }
+    REQUIRE(counts["HEHDT"] == 100);
+    REQUIRE(counts["GPHDT"] == 100);
+    REQUIRE(counts["SDDBT"] == 10);
+    // Three GSV sentences per epoch
+    REQUIRE(counts["GPGSV"] == 30);
+    REQUIRE(counts["AIVDM"] == 20);
+}
+
+TEST_CASE("Generated traffic is reproducible")
+{
+    auto cfg = generator_config::Boat();
+    const auto a = Generate(cfg, 5);
+    const auto b = Generate(cfg, 5);
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        REQUIRE(a[i].sentence == b[i].sentence);
+    }
+    cfg.seed = 2;
+    const auto c = Generate(cfg, 5);
+    bool differ = false;
+    for (size_t i = 0; i < std::min(a.size(), c.size()); ++i) {
+        differ |= a[i].sentence != c[i].sentence;
+    }
+    REQUIRE(differ);
+}
+
+TEST_CASE("Sentences are damaged as configured")
+{
+    auto cfg = generator_config::AllSentences();
+    cfg.checksum_errors = 1.0;
+    for (const auto& g : Generate(cfg, 2)) {
+        REQUIRE(g.sentence[g.sentence.size() - 3] == '*');
+        REQUIRE_FALSE(NMEAGenerator::Valid(g.sentence));
+    }
+    cfg.checksum_errors = 0.0;
+    cfg.truncated = 0.25;
+    size_t truncated = 0;
+    const auto out = Generate(cfg, 20);
+    for (const auto& g : out) {
+        truncated += NMEAGenerator::Valid(g.sentence) ? 0 : 1;
+    }
+    REQUIRE(truncated == Approx(out.size() * 0.25).epsilon(0.2));
+}
+
+TEST_CASE("Vessel follows the route")
+{
+    generator_config cfg = generator_config::Boat();
+    NMEAGenerator gen(cfg);
+    std::vector<generated_sentence> out;
+    // Two hours at 6 kn cover several 2 nm legs
+    gen.Until(cfg.start + 2 * 3600 * 1000, out);
+    const auto& v = gen.Vessel();
+    REQUIRE(v.leg >= 4);
+    REQUIRE(v.sog > 4.0);
+    REQUIRE(v.depth >= 4.0);
+    REQUIRE(gen.Time() == cfg.start + 2 * 3600 * 1000);
+}
+
+TEST_CASE("AIS targets are decodable")
+{
+    generator_config cfg;
+    cfg.sentences = { { "VDM", { "AI" }, 1.0 } };
+    cfg.ais_targets = 3;
+    cfg.lat = 50.75;
+    cfg.lon = -1.30;
+    AISDecoder dec;
+    std::set<uint32_t> mmsis;
+    for (const auto& g : Generate(cfg, 2)) {
+        INFO(g.sentence);
+        REQUIRE(dec.Decode(g.sentence) == ais_result::decoded);
+        const auto& m = dec.Message();
+        REQUIRE(m.type == 1);
+        REQUIRE(m.lat / 600000.0 == Approx(50.75).margin(0.2));
+        REQUIRE(m.lon / 600000.0 == Approx(-1.30).margin(0.3));
+        mmsis.insert(m.mmsi);
+    }
+    REQUIRE(mmsis.size() == 3);
+}
+
+TEST_CASE("Generated traffic is accepted by NSK")
+{
+    NSK nsk;
+    for (const auto& g : Generate(generator_config::AllSentences(), 10)) {
+        if (g.sentence[0] == '!') {
+            nsk.ProcessAISSentence(g.sentence);
+        } else {
+            nsk.ProcessNMEASentence(g.sentence);
+        }
+    }
+    REQUIRE(nsk.TotalUnknown() == 0);
+}
+
+TEST_CASE("Traffic generator throughput", "[benchmark]")
+{
+    // The soak tests and benchmarks need up to 100k sentences per second
+    auto cfg = generator_config::Boat();
+    cfg.scale = 2000.0;
+    NMEAGenerator gen(cfg);
+    BENCHMARK("Generate 1000 sentences")
+    {
+        size_t size = 0;
+        for (int i = 0; i < 1000; ++i) {
+            size += gen.Next().sentence.size();
+        }
+        return size;
+    };
+}
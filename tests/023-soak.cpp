@@ -0,0 +1,258 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+// Soak test: hours (or, with NSK_SOAK_HOURS set, days) of simulated boat
+// traffic with junk mixed in, fed to NSK as fast as it takes it with its
+// clock following the simulated time. The resident memory, the size of
+// the lists of the sentences seen and the conversion latency are sampled
+// over the run, their growth past the warm-up must stay bounded.
+
+#include "clock.h"
+#include "nmea_generator.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using namespace NSKPlugin;
+
+namespace {
+/// Number of the samples taken over the run
+constexpr size_t SAMPLES = 12;
+/// Samples of the warm-up the growth is measured from
+constexpr size_t WARMUP = SAMPLES / 4;
+/// Share of the junk in the input
+constexpr double JUNK = 0.02;
+/// Distinct unparseable addresses NSK keeps at most
+constexpr size_t MAX_UNKNOWN = 256;
+/// Resident memory growth allowed after the warm-up
+constexpr size_t RSS_SLACK = 16 * 1024 * 1024;
+
+/// @brief Return the simulated duration of the run in hours
+double SoakHours()
+{
+    const char* env = std::getenv("NSK_SOAK_HOURS");
+    return env != nullptr ? std::atof(env) : 1.0;
+}
+
+/// @brief Return the resident memory of the process in bytes, 0 if unknown
+size_t ResidentMemory()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0;
+    size_t resident = 0;
+    if (statm >> size >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+/// @brief Return the number of the lines of a string
+size_t Lines(const std::string& s)
+{
+    return static_cast<size_t>(std::count(s.begin(), s.end(), '\n'));
+}
+
+/// State of the run at one point
+struct soak_sample {
+    /// Simulated hours since the start
+    double hours;
+    /// Sentences fed so far
+    uint64_t sentences;
+    /// Resident memory in bytes
+    size_t rss;
+    /// Sizes of the lists of the sentences seen
+    size_t unknown;
+    size_t unimplemented;
+    size_t known;
+    /// Latencies of the conversion since the previous sample
+    std::chrono::nanoseconds p50;
+    std::chrono::nanoseconds p99;
+    std::chrono::nanoseconds max;
+};
+
+/// Source of the junk
+class Junk {
+public:
+    explicit Junk(uint32_t seed)
+        : m_rng(seed)
+    {
+    }
+
+    /// @brief Return whether the next input should be junk
+    bool Due() { return m_share(m_rng) < JUNK; }
+
+    /// @brief Return a piece of junk
+    std::string Next()
+    {
+        std::string s;
+        const size_t length = 1 + m_rng() % 100;
+        switch (m_rng() % 4) {
+        case 0:
+            // Line noise
+            for (size_t i = 0; i < length; ++i) {
+                s.push_back(static_cast<char>(1 + m_rng() % 255));
+            }
+            break;
+        case 1:
+            // Printable garbage starting like a sentence
+            s.push_back('$');
+            for (size_t i = 0; i < length; ++i) {
+                s.push_back(static_cast<char>(' ' + m_rng() % 95));
+            }
+            break;
+        case 2: {
+            // Well formed sentence of a random talker and tag
+            std::string body;
+            for (int i = 0; i < 5; ++i) {
+                body.push_back(static_cast<char>('A' + m_rng() % 26));
+            }
+            body += ",1,2.5,A,,";
+            s = "$" + body + "*" + NMEAGenerator::Checksum(body);
+            break;
+        }
+        default: {
+            // AIS sentence with a broken payload
+            std::string body = "AIVDM,1,1,,A,";
+            for (size_t i = 0; i < length % 40; ++i) {
+                body.push_back(static_cast<char>('0' + m_rng() % 72));
+            }
+            body += ",0";
+            s = "!" + body + "*" + NMEAGenerator::Checksum(body);
+            break;
+        }
+        }
+        return s;
+    }
+
+private:
+    std::mt19937 m_rng;
+    std::uniform_real_distribution<double> m_share { 0.0, 1.0 };
+};
+
+/// @brief Feed a sentence to NSK
+void Feed(NSK& nsk, const std::string& stc)
+{
+    if (!stc.empty() && stc[0] == '!') {
+        nsk.ProcessAISSentence(stc);
+    } else {
+        nsk.ProcessNMEASentence(stc);
+    }
+}
+
+/// @brief Take a sample, consuming the latencies
+soak_sample Sample(NSK& nsk, double hours, uint64_t sentences,
+    std::vector<std::chrono::nanoseconds>& latencies)
+{
+    soak_sample s { hours, sentences, ResidentMemory(), Lines(nsk.Unknown()),
+        Lines(nsk.Unimplemented()), nsk.Known().size(), {}, {}, {} };
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        s.p50 = latencies[latencies.size() / 2];
+        s.p99 = latencies[latencies.size() * 99 / 100];
+        s.max = latencies.back();
+    }
+    latencies.clear();
+    return s;
+}
+
+/// @brief Print the samples
+void Print(const std::vector<soak_sample>& samples)
+{
+    const auto us = [](std::chrono::nanoseconds d) {
+        return static_cast<long long>(d.count() / 1000);
+    };
+    std::printf("%8s %10s %8s %7s %7s %7s %8s %8s %8s\n", "hours", "sentences",
+        "RSS kB", "unknown", "unimpl", "known", "p50 us", "p99 us", "max us");
+    for (const auto& s : samples) {
+        std::printf("%8.2f %10llu %8zu %7zu %7zu %7zu %8lld %8lld %8lld\n",
+            s.hours, static_cast<unsigned long long>(s.sentences),
+            s.rss / 1024, s.unknown, s.unimplemented, s.known, us(s.p50),
+            us(s.p99), us(s.max));
+    }
+    std::fflush(stdout);
+}
+}
+
+TEST_CASE("Soak with simulated traffic and junk", "[soak]")
+{
+    const double hours = SoakHours();
+    auto cfg = generator_config::Boat();
+    cfg.checksum_errors = 0.005;
+    cfg.truncated = 0.005;
+    NMEAGenerator gen(cfg);
+    Junk junk(cfg.seed);
+    auto clock = std::make_shared<ManualClock>(cfg.start);
+    NSK nsk(clock);
+
+    const int64_t duration = static_cast<int64_t>(hours * 3600000.0);
+    const int64_t window = std::max<int64_t>(1, duration / SAMPLES);
+    int64_t next_sample = cfg.start + window;
+    std::vector<soak_sample> samples;
+    std::vector<std::chrono::nanoseconds> latencies;
+    uint64_t sentences = 0;
+    while (samples.size() < SAMPLES) {
+        const auto& g = gen.Next();
+        if (g.time >= next_sample) {
+            samples.push_back(Sample(nsk,
+                static_cast<double>(next_sample - cfg.start) / 3600000.0,
+                sentences, latencies));
+            next_sample += window;
+        }
+        clock->Set(g.time);
+        const std::string stc = junk.Due() ? junk.Next() : g.sentence;
+        const auto start = std::chrono::steady_clock::now();
+        Feed(nsk, stc);
+        latencies.push_back(std::chrono::steady_clock::now() - start);
+        ++sentences;
+    }
+    Print(samples);
+
+    const auto& warm = samples[WARMUP];
+    const auto& last = samples.back();
+    REQUIRE(last.unknown <= MAX_UNKNOWN);
+    // Every talker and sentence of the boat is seen during the warm-up
+    REQUIRE(last.known <= warm.known);
+    REQUIRE(last.unimplemented <= warm.unimplemented + MAX_UNKNOWN);
+    if (warm.rss != 0) {
+        REQUIRE(last.rss <= warm.rss + RSS_SLACK);
+    }
+    // Generous limits, the machine running the tests may be busy
+    REQUIRE(last.p50 <= 2 * warm.p50 + std::chrono::microseconds(20));
+    REQUIRE(last.p99 <= 4 * warm.p99 + std::chrono::microseconds(100));
+}
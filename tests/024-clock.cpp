@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "clock.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace NSKPlugin;
+
+namespace {
+constexpr int64_t T0 = 1792404000000; // 2026-10-19T10:00:00Z
+
+/// @brief Feed the same sentences at the same simulated times to a new NSK
+std::vector<std::string> Replay()
+{
+    auto clock = std::make_shared<ManualClock>(T0);
+    NSK nsk(clock);
+    std::vector<std::string> deltas;
+    for (int i = 0; i < 20; ++i) {
+        clock->Set(T0 + 1000 + i * 250);
+        rapidjson::Document d;
+        nsk.ProcessNMEASentence("$IIMTW,17.5,C*10", &d);
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        d.Accept(writer);
+        deltas.emplace_back(buffer.GetString());
+    }
+    return deltas;
+}
+}
+
+TEST_CASE("Manual clock moves only forward")
+{
+    ManualClock clock(T0);
+    REQUIRE(clock.SystemMs() == T0);
+    const auto steady = clock.Steady();
+    clock.Advance(std::chrono::milliseconds(1500));
+    REQUIRE(clock.SystemMs() == T0 + 1500);
+    REQUIRE(clock.Steady() - steady == std::chrono::milliseconds(1500));
+    clock.Set(T0);
+    REQUIRE(clock.SystemMs() == T0 + 1500);
+    clock.Advance(std::chrono::milliseconds(-10));
+    REQUIRE(clock.SystemMs() == T0 + 1500);
+    clock.Set(T0 + 7 * 86400000LL);
+    REQUIRE(clock.SystemMs() == T0 + 7 * 86400000LL);
+    REQUIRE(clock.Steady() - steady == std::chrono::hours(7 * 24));
+}
+
+TEST_CASE("Steady clock follows the wall clock")
+{
+    SteadyClock clock;
+    const auto diff = clock.SystemMs() - Clock::Real().SystemMs();
+    REQUIRE(diff > -1000);
+    REQUIRE(diff < 1000);
+}
+
+TEST_CASE("Rates are computed in the simulated time")
+{
+    auto clock = std::make_shared<ManualClock>(T0);
+    NSK nsk(clock);
+    REQUIRE(nsk.NMEARate() == 0);
+    for (int i = 0; i < 20; ++i) {
+        clock->Advance(std::chrono::milliseconds(100));
+        nsk.ProcessNMEASentence("$IIMTW,17.5,C*10");
+    }
+    REQUIRE(nsk.NMEARate() == 10);
+    REQUIRE(nsk.SKRate() == 10);
+}
+
+TEST_CASE("Replay with a manual clock is reproducible")
+{
+    const auto first = Replay();
+    const auto second = Replay();
+    REQUIRE(first == second);
+    rapidjson::Document d;
+    d.Parse(first.back().c_str());
+    REQUIRE(std::string(d["updates"][0]["timestamp"].GetString())
+        == "2026-10-19T10:00:05.750Z");
+}
@@ -0,0 +1,197 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "byte_scan.h"
+#include "nmea_generator.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace NSKPlugin;
+
+namespace {
+uint8_t ReferenceChecksum(const std::string& s, size_t from, size_t size)
+{
+    uint8_t c = 0;
+    for (size_t i = from; i < from + size; ++i) {
+        c ^= static_cast<uint8_t>(s[i]);
+    }
+    return c;
+}
+
+std::vector<uint32_t> ReferenceSeparators(
+    const std::string& s, size_t from, size_t size, size_t max)
+{
+    std::vector<uint32_t> positions;
+    for (size_t i = from; i < from + size && positions.size() < max; ++i) {
+        if (s[i] == ',' || s[i] == '*') {
+            positions.push_back(static_cast<uint32_t>(i - from));
+        }
+    }
+    return positions;
+}
+
+size_t ReferenceEOL(const std::string& s, size_t from, size_t size)
+{
+    for (size_t i = from; i < from + size; ++i) {
+        if (s[i] == '\r' || s[i] == '\n') {
+            return i - from;
+        }
+    }
+    return size;
+}
+
+size_t ReferenceBoundary(const std::string& s, size_t from, size_t size)
+{
+    for (size_t i = from; i < from + size; ++i) {
+        if (s[i] == '\r' || s[i] == '\n' || s[i] == '$' || s[i] == '!') {
+            return i - from;
+        }
+    }
+    return size;
+}
+
+/// @brief Return random bytes rich in the characters the kernels look for
+std::string RandomBytes(std::mt19937& rng, size_t size)
+{
+    static const char special[] = { ',', '*', '\r', '\n', '$', '!', '\0' };
+    std::string s(size, ' ');
+    for (auto& c : s) {
+        c = rng() % 4 == 0 ? special[rng() % sizeof(special)]
+                           : static_cast<char>(rng() % 256);
+    }
+    return s;
+}
+
+/// @brief Return the sentences of an hour of simulated traffic
+std::vector<std::string> Sentences()
+{
+    NMEAGenerator gen(generator_config::Boat());
+    std::vector<std::string> sentences;
+    for (int i = 0; i < 1000; ++i) {
+        sentences.push_back(gen.Next().sentence);
+    }
+    return sentences;
+}
+}
+
+TEST_CASE("The scalar kernels are always available")
+{
+    const auto levels = ByteScan::Supported();
+    REQUIRE(!levels.empty());
+    REQUIRE(levels.front() == simd_level::SCALAR);
+    REQUIRE(ByteScan::Kernels(simd_level::SCALAR) != nullptr);
+    REQUIRE(ByteScan::Kernels(levels.back()) == &ByteScan::Best());
+}
+
+TEST_CASE("Every kernel matches the reference")
+{
+    std::mt19937 rng(48);
+    const std::string data = RandomBytes(rng, 4096);
+    for (auto level : ByteScan::Supported()) {
+        const auto* k = ByteScan::Kernels(level);
+        REQUIRE(k != nullptr);
+        INFO(k->name);
+        // Every length around the vector widths at every alignment
+        for (size_t size = 0; size <= 130; ++size) {
+            for (size_t from = 0; from < 32; ++from) {
+                INFO("size " << size << " from " << from);
+                const char* p = data.data() + from;
+                REQUIRE(k->checksum(p, size)
+                    == ReferenceChecksum(data, from, size));
+                REQUIRE(k->eol(p, size) == ReferenceEOL(data, from, size));
+                REQUIRE(k->boundary(p, size)
+                    == ReferenceBoundary(data, from, size));
+                for (size_t max : { size_t(0), size_t(3), size_t(100) }) {
+                    std::vector<uint32_t> positions(max);
+                    positions.resize(
+                        k->separators(p, size, positions.data(), max));
+                    REQUIRE(positions
+                        == ReferenceSeparators(data, from, size, max));
+                }
+            }
+        }
+        // Long runs without a match
+        const std::string plain(1000, 'A');
+        REQUIRE(k->eol(plain.data(), plain.size()) == plain.size());
+        REQUIRE(k->boundary(plain.data(), plain.size()) == plain.size());
+        REQUIRE(k->checksum(plain.data(), plain.size()) == 0);
+        uint32_t position;
+        REQUIRE(k->separators(plain.data(), plain.size(), &position, 1) == 0);
+    }
+}
+
+TEST_CASE("Kernels agree on the NMEA 0183 sentences")
+{
+    for (const auto& stc : Sentences()) {
+        const auto star = stc.find('*');
+        REQUIRE(star != std::string::npos);
+        REQUIRE(ByteScan::Checksum(std::string_view(stc).substr(1, star - 1))
+            == std::stoi(stc.substr(star + 1, 2), nullptr, 16));
+        REQUIRE(ByteScan::EOL(stc + "\r\n") == stc.size());
+    }
+}
+
+TEST_CASE("Byte scanning benchmark", "[.][benchmark]")
+{
+    const auto sentences = Sentences();
+    std::string stream;
+    for (const auto& stc : sentences) {
+        stream += stc + "\r\n";
+    }
+    for (auto level : ByteScan::Supported()) {
+        const auto* k = ByteScan::Kernels(level);
+        const std::string name = k->name;
+        BENCHMARK("Checksum of 1000 sentences, " + name)
+        {
+            unsigned sum = 0;
+            for (const auto& stc : sentences) {
+                sum += k->checksum(stc.data() + 1, stc.size() - 4);
+            }
+            return sum;
+        };
+        BENCHMARK("Fields of 1000 sentences, " + name)
+        {
+            uint32_t positions[32];
+            size_t sum = 0;
+            for (const auto& stc : sentences) {
+                sum += k->separators(stc.data(), stc.size(), positions, 32);
+            }
+            return sum;
+        };
+        BENCHMARK("Framing of 1000 lines, " + name)
+        {
+            size_t lines = 0;
+            for (size_t i = 0; i < stream.size(); ++i) {
+                i += k->eol(stream.data() + i, stream.size() - i);
+                ++lines;
+            }
+            return lines;
+        };
+    }
+}
@@ -0,0 +1,179 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_framer.h"
+#include "nmea_generator.h"
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace NSKPlugin;
+
+namespace {
+/// @brief Frame a stream fed in pieces of the given sizes
+std::vector<std::string> Frame(NMEAFramer& framer, const std::string& stream,
+    const std::vector<size_t>& pieces)
+{
+    std::vector<std::string> sentences;
+    size_t pos = 0;
+    for (size_t i = 0; pos < stream.size(); ++i) {
+        const size_t size = std::min(
+            i < pieces.size() ? pieces[i] : stream.size(), stream.size() - pos);
+        framer.Feed(std::string_view(stream).substr(pos, size));
+        std::string_view stc;
+        while (framer.Next(stc)) {
+            sentences.emplace_back(stc);
+        }
+        pos += size;
+    }
+    return sentences;
+}
+
+std::vector<std::string> Generated(size_t count)
+{
+    NMEAGenerator gen(generator_config::Boat());
+    std::vector<std::string> sentences;
+    for (size_t i = 0; i < count; ++i) {
+        sentences.push_back(gen.Next().sentence);
+    }
+    return sentences;
+}
+}
+
+TEST_CASE("Sentences are framed without copying")
+{
+    const std::string stream = "$GPGLL,1*00\r\n!AIVDM,2*00\n$IIMTW,3*00\r";
+    NMEAFramer framer;
+    framer.Feed(stream);
+    std::vector<std::string_view> sentences;
+    std::string_view stc;
+    while (framer.Next(stc)) {
+        sentences.push_back(stc);
+    }
+    REQUIRE(sentences.size() == 3);
+    REQUIRE(sentences[0] == "$GPGLL,1*00");
+    REQUIRE(sentences[1] == "!AIVDM,2*00");
+    REQUIRE(sentences[2] == "$IIMTW,3*00");
+    for (auto s : sentences) {
+        REQUIRE(s.data() >= stream.data());
+        REQUIRE(s.data() + s.size() <= stream.data() + stream.size());
+    }
+    REQUIRE(framer.Sentences() == 3);
+    REQUIRE(framer.Discarded() == 0);
+}
+
+TEST_CASE("Sentences split between the reads are carried over")
+{
+    const std::string stream = "$GPGLL,1*00\r\n$IIMTW,3*00\r\n!AIVDM,2*00\r\n";
+    const std::vector<std::string> expected
+        = { "$GPGLL,1*00", "$IIMTW,3*00", "!AIVDM,2*00" };
+    for (size_t split = 1; split < stream.size(); ++split) {
+        NMEAFramer framer;
+        INFO("split " << split);
+        REQUIRE(Frame(framer, stream, { split }) == expected);
+        REQUIRE(framer.Discarded() == 0);
+    }
+    NMEAFramer framer;
+    REQUIRE(Frame(framer, stream, std::vector<size_t>(stream.size(), 1))
+        == expected);
+}
+
+TEST_CASE("Framer resynchronizes after the corrupted bytes")
+{
+    NMEAFramer framer(20);
+    const std::string stream = "noise\r\n$GPGGA,1,2$GPRMC,3*00\r\n"
+                               "$GPXXX,this one is too long*00\r\n"
+                               "!AIVDM,4*00\r\n\r\n";
+    REQUIRE(Frame(framer, stream, { 9, 1, 30 })
+        == std::vector<std::string> { "$GPRMC,3*00", "!AIVDM,4*00" });
+    REQUIRE(framer.Truncated() == 1);
+    REQUIRE(framer.Overlong() == 1);
+    REQUIRE(framer.Discarded() == 5 + 10 + 30);
+}
+
+TEST_CASE("Generated traffic survives random reads and line noise")
+{
+    const auto sentences = Generated(2000);
+    std::mt19937 rng(49);
+    std::string stream;
+    size_t noise = 0;
+    for (const auto& stc : sentences) {
+        if (rng() % 10 == 0) {
+            // Garbage between the lines, never containing a start
+            const size_t n = 1 + rng() % 20;
+            for (size_t i = 0; i < n; ++i) {
+                stream.push_back(static_cast<char>('A' + rng() % 26));
+            }
+            stream += "\r\n";
+            noise += n;
+        }
+        stream += stc + "\r\n";
+    }
+    std::vector<size_t> pieces;
+    for (size_t total = 0; total < stream.size();) {
+        pieces.push_back(1 + rng() % 300);
+        total += pieces.back();
+    }
+    NMEAFramer framer;
+    REQUIRE(Frame(framer, stream, pieces) == sentences);
+    REQUIRE(framer.Discarded() == noise);
+    REQUIRE(framer.Truncated() == 0);
+}
+
+TEST_CASE("NSK processes the raw byte stream")
+{
+    NSK nsk;
+    nsk.ProcessData("$IIMTW,17");
+    REQUIRE(nsk.Known().empty());
+    nsk.ProcessData(".5,C*10\r\n");
+    REQUIRE(nsk.Framer().Sentences() == 1);
+    REQUIRE(nsk.Known().size() == 1);
+}
+
+TEST_CASE("Framer benchmark", "[.][benchmark]")
+{
+    std::string stream;
+    for (const auto& stc : Generated(1000)) {
+        stream += stc + "\r\n";
+    }
+    NMEAFramer framer;
+    BENCHMARK("Framing of 1000 sentences in 4 KiB reads")
+    {
+        size_t count = 0;
+        for (size_t pos = 0; pos < stream.size(); pos += 4096) {
+            framer.Feed(std::string_view(stream).substr(pos, 4096));
+            std::string_view stc;
+            while (framer.Next(stc)) {
+                ++count;
+            }
+        }
+        return count;
+    };
+}
@@ -0,0 +1,364 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_inputs.h"
+#include <catch2/catch_test_macros.hpp>
+
+#ifdef __linux__
+
+#include "nsk.h"
+#include "opencpn_mock.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <condition_variable>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace NSKPlugin;
+
+namespace {
+const std::string MTW = "$IIMTW,17.5,C*10";
+
+/// Sentences received by the inputs
+class Received {
+public:
+    /// @brief Return the handler collecting the sentences
+    NMEAInputs::handler Handler()
+    {
+        return [this](size_t input, std::string_view stc) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sentences.emplace_back(stc);
+            m_inputs.push_back(input);
+            m_cv.notify_all();
+        };
+    }
+    /// @brief Wait until the number of the sentences is reached
+    bool WaitFor(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_cv.wait_for(lock, std::chrono::seconds(5),
+            [&] { return m_sentences.size() >= count; });
+    }
+    std::vector<std::string> Sentences()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sentences;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<std::string> m_sentences;
+    std::vector<size_t> m_inputs;
+};
+
+/// @brief Wait until a condition holds
+template <typename F> bool Eventually(F condition)
+{
+    for (int i = 0; i < 500; ++i) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+sockaddr_in Loopback(uint16_t port)
+{
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+/// @brief Open a listening TCP socket on a free loopback port
+int Listen(uint16_t& port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = Loopback(0);
+    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    listen(fd, 4);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+void WriteAll(int fd, const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+}
+
+TEST_CASE("Input configuration round trip")
+{
+    rapidjson::Document d;
+    d.Parse(R"({"type":"tcp","host":"192.168.1.1","port":10110,)"
+            R"("reconnect":2000,"max_sentence":100})");
+    const auto cfg = input_config::FromJSON(d);
+    REQUIRE(cfg.type == "tcp");
+    REQUIRE(cfg.host == "192.168.1.1");
+    REQUIRE(cfg.port == 10110);
+    REQUIRE(cfg.reconnect == std::chrono::milliseconds(2000));
+    REQUIRE(cfg.max_sentence == 100);
+    rapidjson::Document out;
+    out.SetObject();
+    const auto back = input_config::FromJSON(cfg.ToJSON(out.GetAllocator()));
+    REQUIRE(back.host == cfg.host);
+    REQUIRE(back.port == cfg.port);
+    REQUIRE(back.reconnect == cfg.reconnect);
+}
+
+TEST_CASE("UDP datagrams are read")
+{
+    Received received;
+    NMEAInputs inputs(received.Handler());
+    input_config cfg;
+    cfg.type = "udp";
+    cfg.host = "127.0.0.1";
+    inputs.Add(cfg);
+    REQUIRE(inputs.Start());
+    REQUIRE(inputs.Port(0) != 0);
+
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    const sockaddr_in addr = Loopback(inputs.Port(0));
+    // The line end of the last sentence of a datagram may be left out
+    const std::string datagram = MTW + "\r\n" + MTW;
+    for (int i = 0; i < 2; ++i) {
+        sendto(fd, datagram.data(), datagram.size(), 0,
+            reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    }
+    REQUIRE(received.WaitFor(4));
+    REQUIRE(received.Sentences() == std::vector<std::string>(4, MTW));
+    const auto stats = inputs.Stats(0);
+    REQUIRE(stats.open);
+    REQUIRE(stats.datagrams == 2);
+    REQUIRE(stats.bytes == 2 * datagram.size());
+    REQUIRE(stats.sentences == 4);
+    REQUIRE(stats.kernel_drops == 0);
+    close(fd);
+    inputs.Stop();
+    REQUIRE(!inputs.Stats(0).open);
+}
+
+TEST_CASE("TCP input reconnects")
+{
+    uint16_t port;
+    const int server = Listen(port);
+    Received received;
+    NMEAInputs inputs(received.Handler());
+    input_config cfg;
+    cfg.type = "tcp";
+    cfg.host = "127.0.0.1";
+    cfg.port = port;
+    cfg.reconnect = std::chrono::milliseconds(20);
+    inputs.Add(cfg);
+    REQUIRE(inputs.Start());
+
+    int conn = accept(server, nullptr, nullptr);
+    REQUIRE(conn >= 0);
+    // A sentence split between the writes
+    WriteAll(conn, "garbage\r\n" + MTW + "\r\n" + MTW.substr(0, 5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    WriteAll(conn, MTW.substr(5) + "\r\n");
+    REQUIRE(received.WaitFor(2));
+    close(conn);
+
+    conn = accept(server, nullptr, nullptr);
+    REQUIRE(conn >= 0);
+    WriteAll(conn, MTW + "\r\n");
+    REQUIRE(received.WaitFor(3));
+    REQUIRE(received.Sentences() == std::vector<std::string>(3, MTW));
+    REQUIRE(Eventually([&] { return inputs.Stats(0).opens == 2; }));
+    const auto stats = inputs.Stats(0);
+    REQUIRE(stats.discarded == 7);
+    REQUIRE(stats.errors >= 1);
+    inputs.Stop();
+    close(conn);
+    close(server);
+}
+
+TEST_CASE("Unreachable TCP server is retried")
+{
+    uint16_t port;
+    // Take a free port and close it again, nothing listens there
+    close(Listen(port));
+    NMEAInputs inputs([](size_t, std::string_view) { });
+    input_config cfg;
+    cfg.type = "tcp";
+    cfg.host = "127.0.0.1";
+    cfg.port = port;
+    cfg.reconnect = std::chrono::milliseconds(10);
+    inputs.Add(cfg);
+    REQUIRE(inputs.Start());
+    REQUIRE(Eventually([&] { return inputs.Stats(0).errors >= 3; }));
+    REQUIRE(!inputs.Stats(0).open);
+    REQUIRE(inputs.Stats(0).opens == 0);
+}
+
+TEST_CASE("Serial input reads a pseudo-terminal")
+{
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    REQUIRE(master >= 0);
+    REQUIRE(grantpt(master) == 0);
+    REQUIRE(unlockpt(master) == 0);
+    Received received;
+    NMEAInputs inputs(received.Handler());
+    input_config cfg;
+    cfg.type = "serial";
+    cfg.path = ptsname(master);
+    cfg.baud = 38400;
+    inputs.Add(cfg);
+    REQUIRE(inputs.Start());
+    REQUIRE(inputs.Stats(0).open);
+    WriteAll(master,
+        MTW + "\r\n!AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0*24\r\n");
+    REQUIRE(received.WaitFor(2));
+    const auto sentences = received.Sentences();
+    REQUIRE(sentences[0] == MTW);
+    REQUIRE(sentences[1].compare(0, 6, "!AIVDM") == 0);
+    inputs.Stop();
+    close(master);
+}
+
+TEST_CASE("A slow handler pushes back on the sender")
+{
+    uint16_t port;
+    const int server = Listen(port);
+    std::mutex gate;
+    std::atomic<size_t> count { 0 };
+    NMEAInputs inputs([&](size_t, std::string_view) {
+        std::lock_guard<std::mutex> lock(gate);
+        ++count;
+    });
+    // Released before the inputs are stopped, even on a failure
+    std::unique_lock<std::mutex> closed(gate);
+    input_config cfg;
+    cfg.type = "tcp";
+    cfg.host = "127.0.0.1";
+    cfg.port = port;
+    inputs.Add(cfg);
+    REQUIRE(inputs.Start());
+    const int conn = accept(server, nullptr, nullptr);
+    REQUIRE(conn >= 0);
+
+    // While the handler is blocked the sender fills the socket buffers
+    // and then has to wait, nothing piles up in the inputs
+    const std::string line = MTW + "\r\n";
+    std::string chunk;
+    for (int i = 0; i < 1000; ++i) {
+        chunk += line;
+    }
+    fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) | O_NONBLOCK);
+    size_t written = 0;
+    bool blocked = false;
+    for (int i = 0; i < 100000 && !blocked; ++i) {
+        const size_t offset = written % chunk.size();
+        const ssize_t n
+            = write(conn, chunk.data() + offset, chunk.size() - offset);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+        } else if (errno == EAGAIN) {
+            blocked = true;
+        }
+    }
+    REQUIRE(blocked);
+    REQUIRE(written < 64 * 1024 * 1024);
+    REQUIRE(inputs.Stats(0).bytes <= written);
+    // Let the handler run and complete the last sentence
+    closed.unlock();
+    fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) & ~O_NONBLOCK);
+    const size_t rest = (line.size() - written % line.size()) % line.size();
+    WriteAll(conn, line.substr(line.size() - rest));
+    written += rest;
+    REQUIRE(Eventually([&] { return count == written / line.size(); }));
+    REQUIRE(inputs.Stats(0).discarded == 0);
+    inputs.Stop();
+    close(conn);
+    close(server);
+}
+
+TEST_CASE("NSK is fed by the inputs")
+{
+    const std::string path = "./nsk-inputs.json";
+    {
+        std::ofstream of(path);
+        of << R"({"inputs":[{"type":"udp","host":"127.0.0.1"}]})";
+    }
+    NSK nsk;
+    nsk.LoadConfig(path);
+    REQUIRE(nsk.Inputs().Size() == 1);
+    StartCapturingMessages();
+    nsk.StartInputs();
+    REQUIRE(nsk.Inputs().Running());
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    const sockaddr_in addr = Loopback(nsk.Inputs().Port(0));
+    const std::string datagram = MTW + "\r\n";
+    // The main thread processes its sentences at the same time
+    for (int i = 0; i < 100; ++i) {
+        sendto(fd, datagram.data(), datagram.size(), 0,
+            reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+        std::lock_guard<std::mutex> lock(nsk.Mutex());
+        nsk.ProcessNMEASentence(MTW);
+    }
+    REQUIRE(Eventually(
+        [&] { return nsk.Inputs().Stats(0).sentences == 100; }));
+    nsk.StopInputs();
+    REQUIRE(nsk.NMEATotal() == 200);
+    close(fd);
+    // The plugin messages are sent from the main thread only
+    nsk.DispatchMessages();
+    const auto messages = StopCapturingMessages();
+    REQUIRE(messages.size() == 200);
+    for (const auto& m : messages) {
+        REQUIRE(m.thread == std::this_thread::get_id());
+    }
+
+    // The inputs are saved with the configuration
+    nsk.SaveConfig(path);
+    NSK loaded;
+    loaded.LoadConfig(path);
+    REQUIRE(loaded.Inputs().Size() == 1);
+    REQUIRE(loaded.Inputs().Config(0).type == "udp");
+    REQUIRE_FALSE(loaded.Inputs().Running());
+    std::remove(path.c_str());
+}
+
+#endif // __linux__
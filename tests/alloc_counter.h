@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _ALLOC_COUNTER_H_
+#define _ALLOC_COUNTER_H_
+
+#include <cstdint>
+
+// Counting of the heap allocations made by the code under test. The global
+// allocation functions are replaced in alloc_counter.cpp for the whole test
+// executable, the counters are kept per thread, so the worker threads of the
+// sinks and the logger don't disturb the measurements of the conversion.
+//
+// With glibc, malloc() and friends are interposed, which catches the C
+// allocations (RapidJSON's allocators) as well as operator new, elsewhere
+// only operator new is counted.
+
+// Return the number of the heap allocations made by the calling thread
+uint64_t HeapAllocations();
+// Return whether malloc() is counted as well as operator new
+bool CountsMalloc();
+
+// Number of the heap allocations made by the calling thread during the
+// lifetime of the object
+class AllocationCounter {
+public:
+    AllocationCounter()
+        : m_start(HeapAllocations())
+    {
+    }
+    uint64_t Count() const { return HeapAllocations() - m_start; }
+
+private:
+    uint64_t m_start;
+};
+
+#endif
@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+// Command line front end of the traffic generator, writes the sentences to
+// the standard output, eg. for a TCP connection of OpenCPN:
+//   generate-nmea -d 3600 -r | nc -l 10110
+
+#include "nmea_generator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+void Usage()
+{
+    std::fprintf(stderr,
+        "usage: generate-nmea [options]\n"
+        "  -d SECONDS  simulated duration (default 60)\n"
+        "  -x FACTOR   multiply all the rates (default 1)\n"
+        "  -s SEED     seed of the random numbers (default 1)\n"
+        "  -n SCALE    scale of the sensor noise (default 1, 0 for none)\n"
+        "  -c SHARE    share of the sentences with a bad checksum\n"
+        "  -t SHARE    share of the truncated sentences\n"
+        "  -a TARGETS  number of the AIS targets (default 10)\n"
+        "  -A          every supported sentence at 1/s instead of a boat\n"
+        "  -r          send the sentences in real time\n");
+}
+}
+
+int main(int argc, char** argv)
+{
+    generator_config cfg = generator_config::Boat();
+    double duration = 60.0;
+    bool realtime = false;
+    bool all = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "-r") {
+            realtime = true;
+        } else if (arg == "-A") {
+            all = true;
+        } else if (arg == "-d" && has_value) {
+            duration = std::atof(argv[++i]);
+        } else if (arg == "-x" && has_value) {
+            cfg.scale = std::atof(argv[++i]);
+        } else if (arg == "-s" && has_value) {
+            cfg.seed
+                = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "-n" && has_value) {
+            cfg.noise = std::atof(argv[++i]);
+        } else if (arg == "-c" && has_value) {
+            cfg.checksum_errors = std::atof(argv[++i]);
+        } else if (arg == "-t" && has_value) {
+            cfg.truncated = std::atof(argv[++i]);
+        } else if (arg == "-a" && has_value) {
+            cfg.ais_targets = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (all) {
+        cfg.sentences = generator_config::AllSentences().sentences;
+    }
+    NMEAGenerator gen(cfg);
+    const int64_t end = cfg.start + static_cast<int64_t>(duration * 1000.0);
+    const auto started = std::chrono::steady_clock::now();
+    while (true) {
+        const auto& g = gen.Next();
+        if (g.time > end || g.sentence.empty()) {
+            break;
+        }
+        if (realtime) {
+            std::fflush(stdout);
+            std::this_thread::sleep_until(
+                started + std::chrono::milliseconds(g.time - cfg.start));
+        }
+        std::fwrite(g.sentence.data(), 1, g.sentence.size(), stdout);
+        std::fputs("\r\n", stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,594 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "nmea_generator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+constexpr double DEG = PI / 180.0;
+/// Meters per second in a knot
+constexpr double MS = 0.514444;
+/// Length of a leg of the route in nautical miles
+constexpr double LEG = 2.0;
+/// Longest step of the simulation in seconds
+constexpr double STEP = 1.0;
+/// Set and drift of the current
+constexpr double CURRENT_SET = 200.0;
+constexpr double CURRENT_DRIFT = 0.5;
+/// Satellites in view, all used in the fix
+constexpr int SATELLITES = 12;
+constexpr int PRNS[SATELLITES] = { 2, 5, 7, 9, 13, 15, 18, 20, 23, 26, 29, 30 };
+
+double Norm360(double a)
+{
+    a = std::fmod(a, 360.0);
+    return a < 0 ? a + 360.0 : a;
+}
+
+double Norm180(double a)
+{
+    a = Norm360(a);
+    return a > 180.0 ? a - 360.0 : a;
+}
+
+/// Distance in nautical miles and bearing in degrees between two positions
+void Course(double lat1, double lon1, double lat2, double lon2,
+    double& distance, double& bearing)
+{
+    const double dy = (lat2 - lat1) * 60.0;
+    const double dx = (lon2 - lon1) * 60.0 * std::cos((lat1 + lat2) / 2 * DEG);
+    distance = std::hypot(dx, dy);
+    bearing = Norm360(std::atan2(dx, dy) / DEG);
+}
+
+/// Move a position by a distance in nautical miles on a bearing
+void Move(double& lat, double& lon, double distance, double bearing)
+{
+    lat += distance * std::cos(bearing * DEG) / 60.0;
+    lon += distance * std::sin(bearing * DEG) / (60.0 * std::cos(lat * DEG));
+}
+
+/// Format a latitude as "ddmm.mmmm,N"
+void Lat(double lat, char* out, size_t size)
+{
+    const double a = std::fabs(lat);
+    const int d = static_cast<int>(a);
+    std::snprintf(
+        out, size, "%02d%07.4f,%c", d, (a - d) * 60.0, lat < 0 ? 'S' : 'N');
+}
+
+/// Format a longitude as "dddmm.mmmm,E"
+void Lon(double lon, char* out, size_t size)
+{
+    const double a = std::fabs(lon);
+    const int d = static_cast<int>(a);
+    std::snprintf(
+        out, size, "%03d%07.4f,%c", d, (a - d) * 60.0, lon < 0 ? 'W' : 'E');
+}
+
+/// UTC date and time of the day
+struct utc {
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    double second;
+};
+
+utc Civil(int64_t ms)
+{
+    int64_t days = ms / 86400000;
+    int64_t rem = ms % 86400000;
+    if (rem < 0) {
+        rem += 86400000;
+        --days;
+    }
+    // Howard Hinnant's civil_from_days
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    utc t;
+    t.day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    t.month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    t.year = static_cast<int>(yoe + era * 400 + (t.month <= 2 ? 1 : 0));
+    t.hour = static_cast<int>(rem / 3600000);
+    t.minute = static_cast<int>(rem / 60000 % 60);
+    t.second = static_cast<double>(rem % 60000) / 1000.0;
+    return t;
+}
+
+/// Append bits to an AIS payload
+void Bits(std::vector<bool>& bits, int64_t value, int count)
+{
+    for (int i = count - 1; i >= 0; --i) {
+        bits.push_back(((value >> i) & 1) != 0);
+    }
+}
+
+/// Armor an AIS payload into the six bit characters
+std::string Armor(const std::vector<bool>& bits)
+{
+    std::string out;
+    for (size_t i = 0; i < bits.size(); i += 6) {
+        int v = 0;
+        for (size_t j = i; j < i + 6; ++j) {
+            v = (v << 1) | (j < bits.size() && bits[j] ? 1 : 0);
+        }
+        out.push_back(static_cast<char>(v < 40 ? v + 48 : v + 56));
+    }
+    return out;
+}
+}
+
+const std::vector<std::string>& NMEAGenerator::Tags()
+{
+    static const std::vector<std::string> tags { "GGA", "GLL", "GSA", "GSV",
+        "RMC", "VTG", "ZDA", "GNS", "DBT", "DBK", "DPT", "HDG", "HDM", "HDT",
+        "HSC", "ROT", "RSA", "RPM", "MTA", "MTW", "MWV", "VWR", "MWD", "VHW",
+        "VLW", "VPW", "VDR", "RMB", "XTE", "APB", "BOD", "BWC", "BWR", "DSC",
+        "VDM" };
+    return tags;
+}
+
+generator_config generator_config::Boat()
+{
+    generator_config cfg;
+    cfg.sentences = {
+        { "RMC", { "GP" }, 1.0 },
+        { "GGA", { "GP" }, 1.0 },
+        { "GSA", { "GP" }, 1.0 },
+        { "GSV", { "GP" }, 1.0 },
+        { "VTG", { "GP" }, 1.0 },
+        { "ZDA", { "GP" }, 1.0 },
+        { "DBT", { "SD" }, 1.0 },
+        { "DPT", { "SD" }, 1.0 },
+        { "HDG", { "HC" }, 10.0 },
+        // A satellite compass next to the gyro
+        { "HDT", { "HE", "GP" }, 5.0 },
+        { "ROT", { "TI" }, 2.0 },
+        { "RSA", { "AG" }, 5.0 },
+        { "RPM", { "ER" }, 1.0 },
+        { "MTA", { "WI" }, 0.1 },
+        { "MTW", { "YX" }, 0.5 },
+        { "MWV", { "WI" }, 4.0 },
+        { "MWD", { "WI" }, 1.0 },
+        { "VHW", { "VW" }, 1.0 },
+        { "VLW", { "VW" }, 0.1 },
+        { "RMB", { "GP" }, 1.0 },
+        { "XTE", { "GP" }, 1.0 },
+        { "APB", { "GP" }, 1.0 },
+        { "BOD", { "GP" }, 0.2 },
+        { "BWC", { "GP" }, 0.2 },
+        { "VDM", { "AI" }, 0.1 },
+    };
+    return cfg;
+}
+
+generator_config generator_config::AllSentences(double rate)
+{
+    generator_config cfg;
+    for (const auto& tag : NMEAGenerator::Tags()) {
+        cfg.sentences.push_back({ tag,
+            { tag == "VDM" ? "AI"
+                    : tag == "DSC" ? "CD"
+                                   : "GP" },
+            rate });
+    }
+    return cfg;
+}
+
+NMEAGenerator::NMEAGenerator(const generator_config& cfg)
+    : m_cfg(cfg)
+    , m_last { cfg.start, {} }
+    , m_vessel {}
+    , m_time(0.0)
+    , m_rng(cfg.seed)
+    , m_normal(0.0, 1.0)
+    , m_uniform(0.0, 1.0)
+{
+    auto& v = m_vessel;
+    v.lat = v.origin_lat = v.dest_lat = cfg.lat;
+    v.lon = v.origin_lon = v.dest_lon = cfg.lon;
+    Move(v.dest_lat, v.dest_lon, LEG, 45.0);
+    v.heading = v.cog = 45.0;
+    v.stw = v.sog = cfg.speed;
+    v.twd = 240.0;
+    v.tws = 12.0;
+    v.depth = 20.0;
+    v.water = 16.0;
+    v.air = 19.0;
+
+    for (size_t i = 0; i < cfg.ais_targets; ++i) {
+        target t;
+        t.mmsi = 232000000 + static_cast<uint32_t>(i) * 1111;
+        t.lat = cfg.lat;
+        t.lon = cfg.lon;
+        Move(t.lat, t.lon, 2.0 + 6.0 * m_uniform(m_rng),
+            360.0 * m_uniform(m_rng));
+        t.cog = 360.0 * m_uniform(m_rng);
+        t.sog = 15.0 * m_uniform(m_rng);
+        m_targets.push_back(t);
+    }
+    for (const auto& r : cfg.sentences) {
+        const double rate = r.rate * cfg.scale;
+        if (rate <= 0.0) {
+            continue;
+        }
+        const size_t copies = r.tag == "VDM" ? m_targets.size() : 1;
+        for (size_t i = 0; i < copies; ++i) {
+            for (const auto& talker : r.talkers) {
+                // Spread the AIS targets over the interval
+                m_streams.push_back({ r.tag, talker, 1.0 / rate,
+                    static_cast<double>(i) / rate / copies, i });
+            }
+        }
+    }
+}
+
+int64_t NMEAGenerator::Time() const
+{
+    return m_cfg.start + std::llround(m_time * 1000.0);
+}
+
+double NMEAGenerator::Noise(double sigma)
+{
+    return m_cfg.noise == 0.0 ? 0.0 : m_normal(m_rng) * sigma * m_cfg.noise;
+}
+
+void NMEAGenerator::Advance(double t)
+{
+    auto& v = m_vessel;
+    while (m_time < t) {
+        const double dt = std::min(STEP, t - m_time);
+        m_time += dt;
+        // Autopilot steering to the waypoint, a new leg when it is reached
+        double distance;
+        double bearing;
+        Course(v.lat, v.lon, v.dest_lat, v.dest_lon, distance, bearing);
+        if (distance < 0.05) {
+            v.origin_lat = v.dest_lat;
+            v.origin_lon = v.dest_lon;
+            Move(v.dest_lat, v.dest_lon, LEG,
+                Norm360(v.heading + 120.0 * m_uniform(m_rng) - 60.0));
+            ++v.leg;
+            Course(v.lat, v.lon, v.dest_lat, v.dest_lon, distance, bearing);
+        }
+        const double error = Norm180(bearing - v.heading);
+        const double turn = std::clamp(error, -3.0 * dt, 3.0 * dt);
+        v.heading = Norm360(v.heading + turn);
+        v.rot = turn / dt * 60.0;
+        v.rudder = std::clamp(error * 1.5, -30.0, 30.0);
+        // Water and ground track with the current
+        const double vx = v.stw * std::sin(v.heading * DEG)
+            + CURRENT_DRIFT * std::sin(CURRENT_SET * DEG);
+        const double vy = v.stw * std::cos(v.heading * DEG)
+            + CURRENT_DRIFT * std::cos(CURRENT_SET * DEG);
+        v.sog = std::hypot(vx, vy);
+        v.cog = Norm360(std::atan2(vx, vy) / DEG);
+        Move(v.lat, v.lon, v.sog * dt / 3600.0, v.cog);
+        v.log += v.stw * dt / 3600.0;
+        // The environment wanders around
+        const double root = std::sqrt(dt);
+        v.twd = Norm360(v.twd + m_normal(m_rng) * 0.5 * root);
+        v.tws = std::clamp(v.tws + m_normal(m_rng) * 0.2 * root, 2.0, 35.0);
+        v.depth = std::clamp(v.depth + m_normal(m_rng) * 0.1 * root, 4.0, 80.0);
+        v.water += m_normal(m_rng) * 0.002 * root;
+        v.air += m_normal(m_rng) * 0.005 * root;
+        for (auto& tg : m_targets) {
+            Move(tg.lat, tg.lon, tg.sog * dt / 3600.0, tg.cog);
+        }
+    }
+}
+
+std::string NMEAGenerator::Checksum(std::string_view body)
+{
+    uint8_t sum = 0;
+    for (const char c : body) {
+        sum ^= static_cast<uint8_t>(c);
+    }
+    char hex[3];
+    std::snprintf(hex, sizeof(hex), "%02X", sum);
+    return hex;
+}
+
+bool NMEAGenerator::Valid(std::string_view sentence)
+{
+    const size_t star = sentence.rfind('*');
+    if (sentence.size() < 4 || (sentence[0] != '$' && sentence[0] != '!')
+        || star == std::string_view::npos || star + 3 != sentence.size()) {
+        return false;
+    }
+    return Checksum(sentence.substr(1, star - 1)) == sentence.substr(star + 1);
+}
+
+void NMEAGenerator::Push(char start, const char* body)
+{
+    generated_sentence g { Time(), {} };
+    std::string& s = g.sentence;
+    s.reserve(96);
+    s.push_back(start);
+    s.append(body);
+    s.push_back('*');
+    std::string sum = Checksum(body);
+    if (m_cfg.checksum_errors > 0.0
+        && m_uniform(m_rng) < m_cfg.checksum_errors) {
+        sum[1] = sum[1] == '0' ? '1' : '0';
+    }
+    s.append(sum);
+    if (m_cfg.truncated > 0.0 && m_uniform(m_rng) < m_cfg.truncated) {
+        s.resize(1 + static_cast<size_t>(m_uniform(m_rng) * (s.size() - 2)));
+    }
+    m_pending.push_back(std::move(g));
+}
+
+void NMEAGenerator::Emit(const stream& s)
+{
+    const auto& v = m_vessel;
+    const char* id = s.talker.c_str();
+    const char* tag = s.tag.c_str();
+    const utc t = Civil(Time());
+    const double var = m_cfg.variation;
+    const char var_hem = var < 0 ? 'W' : 'E';
+    char time[16];
+    std::snprintf(
+        time, sizeof(time), "%02d%02d%05.2f", t.hour, t.minute, t.second);
+    char date[8];
+    std::snprintf(date, sizeof(date), "%02d%02d%02d", t.day, t.month,
+        t.year % 100);
+    char lat[20];
+    char lon[20];
+    Lat(v.lat + Noise(1e-5), lat, sizeof(lat));
+    Lon(v.lon + Noise(1e-5), lon, sizeof(lon));
+    const double heading = Norm360(v.heading + Noise(0.5));
+    const double cog = Norm360(v.cog + Noise(0.5));
+    const double sog = std::max(0.0, v.sog + Noise(0.05));
+    const double stw = std::max(0.0, v.stw + Noise(0.05));
+    const double depth = std::max(0.1, v.depth + Noise(0.05));
+    // Route
+    double range;
+    double to_dest;
+    double leg_bearing;
+    double leg_length;
+    Course(v.lat, v.lon, v.dest_lat, v.dest_lon, range, to_dest);
+    Course(v.origin_lat, v.origin_lon, v.dest_lat, v.dest_lon, leg_length,
+        leg_bearing);
+    double from_origin;
+    double origin_bearing;
+    Course(v.origin_lat, v.origin_lon, v.lat, v.lon, from_origin,
+        origin_bearing);
+    // Positive to the right of the track
+    const double xte
+        = from_origin * std::sin((origin_bearing - leg_bearing) * DEG);
+    const char steer = xte > 0 ? 'L' : 'R';
+    const double vmg = v.sog * std::cos((v.cog - to_dest) * DEG);
+    char dest_lat[20];
+    char dest_lon[20];
+    Lat(v.dest_lat, dest_lat, sizeof(dest_lat));
+    Lon(v.dest_lon, dest_lon, sizeof(dest_lon));
+    // Apparent wind from the true wind and the motion over ground
+    const double ax
+        = -v.tws * std::sin(v.twd * DEG) - v.sog * std::sin(v.cog * DEG);
+    const double ay
+        = -v.tws * std::cos(v.twd * DEG) - v.sog * std::cos(v.cog * DEG);
+    const double aws = std::max(0.0, std::hypot(ax, ay) + Noise(0.3));
+    const double awa
+        = Norm180(std::atan2(-ax, -ay) / DEG - v.heading + Noise(2.0));
+    const double twa = Norm180(v.twd - v.heading);
+
+    char b[256];
+    if (s.tag == "GGA") {
+        std::snprintf(b, sizeof(b), "%sGGA,%s,%s,%s,1,%02d,0.9,2.3,M,47.0,M,,",
+            id, time, lat, lon, SATELLITES);
+    } else if (s.tag == "GLL") {
+        std::snprintf(b, sizeof(b), "%sGLL,%s,%s,%s,A,A", id, lat, lon, time);
+    } else if (s.tag == "GSA") {
+        std::snprintf(b, sizeof(b),
+            "%sGSA,A,3,02,05,07,09,13,15,18,20,23,26,29,30,1.8,0.9,1.5", id);
+    } else if (s.tag == "GSV") {
+        const int messages = (SATELLITES + 3) / 4;
+        for (int m = 0; m < messages; ++m) {
+            int n = std::snprintf(b, sizeof(b), "%sGSV,%d,%d,%02d", id,
+                messages, m + 1, SATELLITES);
+            for (int i = m * 4; i < std::min(SATELLITES, m * 4 + 4); ++i) {
+                const int prn = PRNS[i];
+                const int elevation = 10 + (i * 37) % 75;
+                const int azimuth
+                    = static_cast<int>(Norm360(i * 97 + m_time * 0.004));
+                const int snr = std::clamp(
+                    static_cast<int>(30 + elevation / 5 + Noise(2.0)), 0, 99);
+                n += std::snprintf(b + n, sizeof(b) - n, ",%02d,%02d,%03d,%02d",
+                    prn, elevation, azimuth, snr);
+            }
+            Push('$', b);
+        }
+        return;
+    } else if (s.tag == "RMC") {
+        std::snprintf(b, sizeof(b), "%sRMC,%s,A,%s,%s,%.1f,%.1f,%s,%.1f,%c,A",
+            id, time, lat, lon, sog, cog, date, std::fabs(var), var_hem);
+    } else if (s.tag == "VTG") {
+        std::snprintf(b, sizeof(b), "%sVTG,%.1f,T,%.1f,M,%.1f,N,%.1f,K,A", id,
+            cog, Norm360(cog - var), sog, sog * 1.852);
+    } else if (s.tag == "ZDA") {
+        std::snprintf(b, sizeof(b), "%sZDA,%s,%02d,%02d,%04d,00,00", id, time,
+            t.day, t.month, t.year);
+    } else if (s.tag == "GNS") {
+        std::snprintf(b, sizeof(b), "%sGNS,%s,%s,%s,AA,%02d,0.9,2.3,47.0,,", id,
+            time, lat, lon, SATELLITES);
+    } else if (s.tag == "DBT" || s.tag == "DBK") {
+        const double d = s.tag == "DBK" ? depth + 1.2 : depth;
+        std::snprintf(b, sizeof(b), "%s%s,%.1f,f,%.1f,M,%.1f,F", id, tag,
+            d / 0.3048, d, d / 1.8288);
+    } else if (s.tag == "DPT") {
+        std::snprintf(b, sizeof(b), "%sDPT,%.1f,0.5", id, depth);
+    } else if (s.tag == "HDG") {
+        std::snprintf(b, sizeof(b), "%sHDG,%.1f,0.0,E,%.1f,%c", id,
+            Norm360(heading - var), std::fabs(var), var_hem);
+    } else if (s.tag == "HDM") {
+        std::snprintf(b, sizeof(b), "%sHDM,%.1f,M", id, Norm360(heading - var));
+    } else if (s.tag == "HDT") {
+        std::snprintf(b, sizeof(b), "%sHDT,%.1f,T", id, heading);
+    } else if (s.tag == "HSC") {
+        std::snprintf(b, sizeof(b), "%sHSC,%.1f,T,%.1f,M", id, to_dest,
+            Norm360(to_dest - var));
+    } else if (s.tag == "ROT") {
+        std::snprintf(b, sizeof(b), "%sROT,%.1f,A", id, v.rot + Noise(1.0));
+    } else if (s.tag == "RSA") {
+        std::snprintf(
+            b, sizeof(b), "%sRSA,%.1f,A,,V", id, v.rudder + Noise(0.3));
+    } else if (s.tag == "RPM") {
+        std::snprintf(b, sizeof(b), "%sRPM,E,1,%.0f,12.0,A", id,
+            v.stw * 300.0 + Noise(10.0));
+    } else if (s.tag == "MTA" || s.tag == "MTW") {
+        std::snprintf(b, sizeof(b), "%s%s,%.1f,C", id, tag,
+            (s.tag == "MTA" ? v.air : v.water) + Noise(0.05));
+    } else if (s.tag == "MWV") {
+        std::snprintf(b, sizeof(b), "%sMWV,%.1f,R,%.1f,N,A", id, Norm360(awa),
+            aws);
+    } else if (s.tag == "VWR") {
+        std::snprintf(b, sizeof(b), "%sVWR,%.1f,%c,%.1f,N,%.1f,M,%.1f,K", id,
+            std::fabs(awa), awa < 0 ? 'L' : 'R', aws, aws * MS, aws * 1.852);
+    } else if (s.tag == "MWD") {
+        const double tws = std::max(0.0, v.tws + Noise(0.3));
+        const double twd = Norm360(v.twd + Noise(2.0));
+        std::snprintf(b, sizeof(b), "%sMWD,%.1f,T,%.1f,M,%.1f,N,%.1f,M", id,
+            twd, Norm360(twd - var), tws, tws * MS);
+    } else if (s.tag == "VHW") {
+        std::snprintf(b, sizeof(b), "%sVHW,%.1f,T,%.1f,M,%.2f,N,%.2f,K", id,
+            heading, Norm360(heading - var), stw, stw * 1.852);
+    } else if (s.tag == "VLW") {
+        std::snprintf(b, sizeof(b), "%sVLW,%.2f,N,%.2f,N", id, 1234.5 + v.log,
+            v.log);
+    } else if (s.tag == "VPW") {
+        const double vpw = stw * std::cos(twa * DEG);
+        std::snprintf(b, sizeof(b), "%sVPW,%.2f,N,%.2f,M", id, vpw, vpw * MS);
+    } else if (s.tag == "VDR") {
+        std::snprintf(b, sizeof(b), "%sVDR,%.1f,T,%.1f,M,%.1f,N", id,
+            CURRENT_SET, Norm360(CURRENT_SET - var), CURRENT_DRIFT);
+    } else if (s.tag == "RMB") {
+        std::snprintf(b, sizeof(b),
+            "%sRMB,A,%.2f,%c,WP%03d,WP%03d,%s,%s,%.2f,%.1f,%.1f,%c", id,
+            std::fabs(xte), steer, v.leg, v.leg + 1, dest_lat, dest_lon, range,
+            to_dest, vmg, range < 0.1 ? 'A' : 'V');
+    } else if (s.tag == "XTE") {
+        std::snprintf(
+            b, sizeof(b), "%sXTE,A,A,%.2f,%c,N", id, std::fabs(xte), steer);
+    } else if (s.tag == "APB") {
+        std::snprintf(b, sizeof(b),
+            "%sAPB,A,A,%.2f,%c,N,%c,V,%.1f,T,WP%03d,%.1f,T,%.1f,T", id,
+            std::fabs(xte), steer, range < 0.1 ? 'A' : 'V', leg_bearing,
+            v.leg + 1, to_dest, to_dest);
+    } else if (s.tag == "BOD") {
+        std::snprintf(b, sizeof(b), "%sBOD,%.1f,T,%.1f,M,WP%03d,WP%03d", id,
+            leg_bearing, Norm360(leg_bearing - var), v.leg + 1, v.leg);
+    } else if (s.tag == "BWC" || s.tag == "BWR") {
+        std::snprintf(b, sizeof(b), "%s%s,%s,%s,%s,%.1f,T,%.1f,M,%.2f,N,WP%03d",
+            id, tag, time, dest_lat, dest_lon, to_dest,
+            Norm360(to_dest - var), range, v.leg + 1);
+    } else if (s.tag == "DSC") {
+        // Distress alert of a vessel nearby
+        const double alat = std::fabs(v.dest_lat);
+        const double alon = std::fabs(v.dest_lon);
+        const int quadrant
+            = (v.dest_lat < 0 ? 2 : 0) + (v.dest_lon < 0 ? 1 : 0);
+        std::snprintf(b, sizeof(b),
+            "%sDSC,20,2329876540,00,21,26,%d%02d%02d%03d%02d,%02d%02d,,,B,E",
+            id, quadrant, static_cast<int>(alat),
+            static_cast<int>((alat - std::floor(alat)) * 60),
+            static_cast<int>(alon),
+            static_cast<int>((alon - std::floor(alon)) * 60), t.hour,
+            t.minute);
+    } else if (s.tag == "VDM") {
+        // Position report (type 1) of the target
+        const auto& tg = m_targets[s.target];
+        std::vector<bool> bits;
+        bits.reserve(168);
+        Bits(bits, 1, 6);
+        Bits(bits, 0, 2);
+        Bits(bits, tg.mmsi, 30);
+        Bits(bits, tg.sog > 0.2 ? 0 : 1, 4);
+        Bits(bits, -128, 8);
+        Bits(bits, std::llround(tg.sog * 10), 10);
+        Bits(bits, 1, 1);
+        Bits(bits, std::llround(tg.lon * 600000), 28);
+        Bits(bits, std::llround(tg.lat * 600000), 27);
+        Bits(bits, std::llround(tg.cog * 10), 12);
+        Bits(bits, std::llround(tg.cog) % 360, 9);
+        Bits(bits, static_cast<int>(t.second), 6);
+        Bits(bits, 0, 2 + 3 + 1 + 19);
+        std::snprintf(b, sizeof(b), "%sVDM,1,1,,%c,%s,0", id,
+            s.target % 2 == 0 ? 'A' : 'B', Armor(bits).c_str());
+        Push('!', b);
+        return;
+    } else {
+        return;
+    }
+    Push('$', b);
+}
+
+const generated_sentence& NMEAGenerator::Next()
+{
+    while (m_pending.empty() && !m_streams.empty()) {
+        auto next = std::min_element(m_streams.begin(), m_streams.end(),
+            [](const stream& a, const stream& b) { return a.due < b.due; });
+        Advance(next->due);
+        Emit(*next);
+        next->due += next->interval;
+    }
+    if (!m_pending.empty()) {
+        m_last = std::move(m_pending.front());
+        m_pending.pop_front();
+    }
+    return m_last;
+}
+
+size_t NMEAGenerator::Until(int64_t time, std::vector<generated_sentence>& out)
+{
+    size_t count = 0;
+    while (true) {
+        if (m_pending.empty() && !m_streams.empty()) {
+            const auto next = std::min_element(m_streams.begin(),
+                m_streams.end(),
+                [](const stream& a, const stream& b) { return a.due < b.due; });
+            if (m_cfg.start + std::llround(next->due * 1000.0) > time) {
+                break;
+            }
+        }
+        if (m_pending.empty() && m_streams.empty()) {
+            break;
+        }
+        out.push_back(Next());
+        ++count;
+    }
+    Advance(static_cast<double>(time - m_cfg.start) / 1000.0);
+    return count;
+}
@@ -0,0 +1,201 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _NMEA_GENERATOR_H_
+#define _NMEA_GENERATOR_H_
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Synthetic NMEA 0183 traffic of a boat under way, for the benchmarks, the
+// soak tests and the fuzzing seeds.
+//
+// A simulated vessel follows an autopilot route of random legs, with wind,
+// depth and temperatures wandering around. Every sentence type NSK converts
+// (and AIS position reports of the vessels around) can be produced at its
+// own rate by any number of talkers, with configurable sensor noise, and a
+// share of the sentences can be damaged by bad checksums or truncation.
+
+// Rate of a sentence type
+struct sentence_rate {
+    // Sentence tag (eg. "RMC", "VDM" for the AIS targets)
+    std::string tag;
+    // Talker IDs sending the sentence, each one is a separate stream
+    std::vector<std::string> talkers;
+    // Sentences per second sent by each talker (per target for VDM)
+    double rate;
+};
+
+// Configuration of the generator
+struct generator_config {
+    // Seed of the random numbers, the same seed gives the same traffic
+    uint32_t seed = 1;
+    // UTC time of the start in milliseconds since the epoch
+    int64_t start = 1792404000000; // 2026-10-19T10:00:00Z
+    // Starting position in degrees
+    double lat = 50.75;
+    double lon = -1.30;
+    // Speed through water in knots
+    double speed = 6.0;
+    // Magnetic variation in degrees (east positive)
+    double variation = -1.5;
+    // Scale of the sensor noise, 0 for exact values
+    double noise = 1.0;
+    // Share of the sentences sent with a wrong checksum
+    double checksum_errors = 0.0;
+    // Share of the sentences cut short
+    double truncated = 0.0;
+    // Number of the AIS targets around
+    size_t ais_targets = 10;
+    // Multiplier of all the rates
+    double scale = 1.0;
+    // Rates of the sentence types
+    std::vector<sentence_rate> sentences;
+
+    // Traffic of a typical cruising boat, about 45 sentences per second
+    static generator_config Boat();
+    // Every supported sentence type at the same rate from one talker
+    static generator_config AllSentences(double rate = 1.0);
+};
+
+// Generated sentence
+struct generated_sentence {
+    // UTC time the sentence is sent in milliseconds since the epoch
+    int64_t time;
+    // Sentence without the line terminator
+    std::string sentence;
+};
+
+// Generator of the traffic
+class NMEAGenerator {
+public:
+    // Every sentence tag the generator knows
+    static const std::vector<std::string>& Tags();
+
+    explicit NMEAGenerator(
+        const generator_config& cfg = generator_config::Boat());
+
+    // Return the next sentence in time order, advancing the simulation
+    const generated_sentence& Next();
+    // Append the sentences sent until the time and advance the simulation
+    // to it, return the number of the sentences appended
+    size_t Until(int64_t time, std::vector<generated_sentence>& out);
+    // Return the current simulation time in milliseconds since the epoch
+    int64_t Time() const;
+    // Return the configuration
+    const generator_config& Config() const { return m_cfg; }
+
+    // Return the two hexadecimal digits of the checksum of the body (the
+    // part between '$' or '!' and '*')
+    static std::string Checksum(std::string_view body);
+    // Return whether the sentence is complete and its checksum matches
+    static bool Valid(std::string_view sentence);
+
+    // State of the simulated vessel
+    struct vessel {
+        double lat;
+        double lon;
+        // True heading in degrees
+        double heading;
+        // Speed through water in knots
+        double stw;
+        // Course and speed over ground
+        double cog;
+        double sog;
+        // Rate of turn in degrees per minute
+        double rot;
+        // Rudder angle in degrees, positive to starboard
+        double rudder;
+        // True wind direction (from) and speed in knots
+        double twd;
+        double tws;
+        // Depth below the transducer in meters
+        double depth;
+        // Water and air temperature in degrees Celsius
+        double water;
+        double air;
+        // Distance run in nautical miles
+        double log;
+        // Leg of the route being followed
+        double origin_lat;
+        double origin_lon;
+        double dest_lat;
+        double dest_lon;
+        int leg;
+    };
+    // Return the state of the simulated vessel
+    const vessel& Vessel() const { return m_vessel; }
+
+private:
+    // Stream of sentences of one tag from one talker
+    struct stream {
+        std::string tag;
+        std::string talker;
+        // Seconds between the sentences
+        double interval;
+        // Simulation time of the next sentence in seconds
+        double due;
+        // Index of the AIS target
+        size_t target;
+    };
+    // AIS target
+    struct target {
+        uint32_t mmsi;
+        double lat;
+        double lon;
+        double cog;
+        double sog;
+    };
+
+    // Advance the simulation to the time in seconds
+    void Advance(double t);
+    // Append the sentences of the stream to the pending ones
+    void Emit(const stream& s);
+    // Add a sentence built from the body to the pending ones, damaging it
+    // as configured
+    void Push(char start, const char* body);
+    // Return a normally distributed noise of the standard deviation scaled
+    // by the configuration
+    double Noise(double sigma);
+
+    generator_config m_cfg;
+    std::vector<stream> m_streams;
+    std::vector<target> m_targets;
+    std::deque<generated_sentence> m_pending;
+    generated_sentence m_last;
+    vessel m_vessel;
+    // Simulation time in seconds since the start
+    double m_time;
+    std::mt19937 m_rng;
+    std::normal_distribution<double> m_normal;
+    std::uniform_real_distribution<double> m_uniform;
+};
+
+#endif
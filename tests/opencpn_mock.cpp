@@ -0,0 +1,65 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  NSK Plugin
+ * Author:   Pavel Kalian
+ *
+ ******************************************************************************
+ * This file is part of the NSK plugin
+ * (https://github.com/nohal/nsk_pi).
+ *   Copyright (C) 2022 by Pavel Kalian
+ *   https://github.com/nohal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3, or (at your option) any later
+ * version of the license.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include "opencpn_mock.h"
+#include <mutex>
+
+namespace {
+std::mutex capture_mutex;
+bool capturing = false;
+std::vector<captured_message> captured;
+}
+
+void StartCapturingMessages()
+{
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    captured.clear();
+    capturing = true;
+}
+
+std::vector<captured_message> StopCapturingMessages()
+{
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    capturing = false;
+    return std::move(captured);
+}
+
+size_t CapturedMessages()
+{
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    return captured.size();
+}
+
+// wxString GetLocaleCanonicalName() { return "en_US"; }
+void SendPluginMessage(wxString message_id, wxString message_body)
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    if (capturing) {
+        captured.push_back({ message_id.ToStdString(),
+            message_body.ToStdString(), now, std::this_thread::get_id() });
+    }
+}
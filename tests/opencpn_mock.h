@@ -24,13 +24,38 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  ******************************************************************************/
 
+#ifndef _OPENCPN_MOCK_H_
+#define _OPENCPN_MOCK_H_
+
 #include "ocpn_plugin.h"
+#include <chrono>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Mocks of the OpenCPN API functions actually accessed from our code
 // These functions are declared external DECL_EXP in ocpn_plugin.h and normally
 // defined in the OpenCPN core application, which we obviously don't have
-// here...
+// here... The definitions live in opencpn_mock.cpp, so that the header can be
+// included from any number of test files.
+
+// Plugin message sent through the mocked SendPluginMessage
+struct captured_message {
+    std::string message_id;
+    std::string message_body;
+    // Time the message was sent
+    std::chrono::steady_clock::time_point time;
+    // Thread the message was sent from
+    std::thread::id thread;
+};
+
+// Start keeping the plugin messages sent (from any thread), forgetting the
+// ones kept before
+void StartCapturingMessages();
+// Stop keeping the plugin messages and return the ones sent since
+// StartCapturingMessages()
+std::vector<captured_message> StopCapturingMessages();
+// Return the number of the plugin messages kept so far
+size_t CapturedMessages();
 
-// wxString GetLocaleCanonicalName() { return "en_US"; }
-void SendPluginMessage(wxString message_id, wxString message_body) { return; }
+#endif
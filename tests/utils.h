@@ -34,7 +34,7 @@
 
 using namespace rapidjson;
 
-void DumpJSON(Document& d)
+inline void DumpJSON(Document& d)
 {
     StringBuffer buffer;
     Writer<StringBuffer> writer(buffer);